@@ -0,0 +1,162 @@
+#include "accessLog.h"
+#include "jsonWriter.h"
+#include <algorithm>
+#include <ctime>
+#include <utility>
+
+static std::atomic<uint64_t> next_log_id{0};
+
+AccessLog::AccessLog(const std::string &path, size_t max_bytes,
+                     size_t max_files, size_t ring_size,
+                     std::chrono::milliseconds flush_interval)
+    : path(path), max_bytes(max_bytes), max_files(max_files),
+      ring_size(std::max<size_t>(ring_size, 1)),
+      flush_interval(flush_interval), id(next_log_id++) {
+  if (path.empty()) {
+    file = stdout;
+  } else if ((file = std::fopen(path.c_str(), "a"))) {
+    std::fseek(file, 0, SEEK_END);
+    file_bytes = std::ftell(file);
+  }
+  writer = std::thread(&AccessLog::Run, this);
+}
+
+AccessLog::~AccessLog() {
+  {
+    std::lock_guard<std::mutex> guard(wake_lock);
+    stopping = true;
+  }
+  wake.notify_one();
+  writer.join();
+  Drain();
+  if (file && file != stdout) {
+    std::fclose(file);
+  }
+}
+
+AccessLog::Ring *AccessLog::ThreadRing() {
+  /* A thread writes to few logs, usually one, a linear search is enough */
+  thread_local std::vector<std::pair<uint64_t, std::shared_ptr<Ring>>> owned;
+  for (auto &it : owned) {
+    if (it.first == id) {
+      return it.second.get();
+    }
+  }
+  auto ring = std::make_shared<Ring>(ring_size);
+  {
+    std::lock_guard<std::mutex> guard(rings_lock);
+    rings.push_back(ring);
+  }
+  owned.emplace_back(id, ring);
+  return ring.get();
+}
+
+void AccessLog::Log(Entry &&entry) {
+  Ring *ring = ThreadRing();
+  const uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+  if (tail - ring->head.load(std::memory_order_acquire) >= ring_size) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  ring->slots[tail % ring_size] = std::move(entry);
+  ring->tail.store(tail + 1, std::memory_order_release);
+}
+
+void AccessLog::Flush() {
+  Drain();
+  std::lock_guard<std::mutex> guard(drain_lock);
+  if (file) {
+    std::fflush(file);
+  }
+}
+
+void AccessLog::Format(const Entry &entry, std::string *out) {
+  const auto since_epoch = entry.time.time_since_epoch();
+  const std::time_t seconds =
+      std::chrono::duration_cast<std::chrono::seconds>(since_epoch).count();
+  const long micros =
+      std::chrono::duration_cast<std::chrono::microseconds>(since_epoch)
+          .count() %
+      1000000;
+  std::tm tm;
+  gmtime_r(&seconds, &tm);
+  char time[40];
+  size_t length = std::strftime(time, sizeof(time), "%Y-%m-%dT%H:%M:%S", &tm);
+  std::snprintf(time + length, sizeof(time) - length, ".%06ldZ", micros);
+
+  *out += "{\"time\":\"";
+  *out += time;
+  *out += "\",\"method\":";
+  JsonWriter::WriteString(*out, entry.method);
+  *out += ",\"target\":";
+  JsonWriter::WriteString(*out, entry.target);
+  *out += ",\"status\":";
+  JsonWriter::WriteValue(*out, entry.status);
+  *out += ",\"latency_us\":";
+  JsonWriter::WriteValue(*out, entry.latency_us);
+  *out += ",\"db_us\":";
+  JsonWriter::WriteValue(*out, entry.db_us);
+  *out += ",\"bytes\":";
+  JsonWriter::WriteValue(*out, entry.bytes);
+  *out += ",\"user\":";
+  JsonWriter::WriteString(*out, entry.user);
+  *out += "}\n";
+}
+
+void AccessLog::Drain() {
+  std::vector<std::shared_ptr<Ring>> current;
+  {
+    std::lock_guard<std::mutex> guard(rings_lock);
+    current = rings;
+  }
+
+  std::lock_guard<std::mutex> guard(drain_lock);
+  for (auto &ring : current) {
+    const uint64_t head = ring->head.load(std::memory_order_relaxed);
+    const uint64_t tail = ring->tail.load(std::memory_order_acquire);
+    for (uint64_t i = head; i != tail; i++) {
+      Entry &entry = ring->slots[i % ring_size];
+      Format(entry, &buffer);
+      /* Free the strings here rather than on the next request */
+      entry = Entry();
+    }
+    ring->head.store(tail, std::memory_order_release);
+  }
+  if (buffer.empty() || !file) {
+    buffer.clear();
+    return;
+  }
+
+  std::fwrite(buffer.data(), 1, buffer.size(), file);
+  file_bytes += buffer.size();
+  buffer.clear();
+  if (file == stdout) {
+    std::fflush(file);
+  } else if (max_bytes && file_bytes >= max_bytes) {
+    Rotate();
+  }
+}
+
+void AccessLog::Rotate() {
+  std::fclose(file);
+  for (size_t i = max_files; i > 0; i--) {
+    const std::string from =
+        i == 1 ? path : path + "." + std::to_string(i - 1);
+    std::rename(from.c_str(), (path + "." + std::to_string(i)).c_str());
+  }
+  if (!max_files) {
+    std::remove(path.c_str());
+  }
+  file = std::fopen(path.c_str(), "a");
+  file_bytes = 0;
+}
+
+void AccessLog::Run() {
+  std::unique_lock<std::mutex> guard(wake_lock);
+  while (!stopping) {
+    wake.wait_for(guard, flush_interval);
+    guard.unlock();
+    Drain();
+    guard.lock();
+  }
+}
@@ -0,0 +1,141 @@
+/**
+ * @file accessLog.h
+ * @brief Definition of AccessLog, which writes one structured line per
+ * response without slowing the threads that serve them.
+ *
+ * A worker thread only fills an Entry and moves it into a ring buffer of its
+ * own: no lock, no allocation beyond the strings of the entry, no system call.
+ * A background writer drains all the rings every flush interval, formats the
+ * entries as JSON lines and writes them in one batch. The file is rotated to
+ * path.1, path.2, ... once it grows past max_bytes.
+ *
+ * If the writer falls behind and a ring is full, the entry is dropped and
+ * counted rather than making the request wait.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class AccessLog {
+public:
+  /**
+   * @brief What is logged about a response.
+   *
+   */
+  struct Entry {
+    std::chrono::system_clock::time_point time;
+    std::string method;
+    /* path and query string as requested */
+    std::string target;
+    int status = 0;
+    /* from the start of routing to the response being ready */
+    uint64_t latency_us = 0;
+    /* time spent with a DB connection open */
+    uint64_t db_us = 0;
+    /* length of the body, 0 for streamed ones */
+    size_t bytes = 0;
+    /* email of the authenticated user, empty if none */
+    std::string user;
+  };
+
+  /**
+   * @brief Construct a new Access Log object and start its writer.
+   *
+   * @param path File to write, empty for stdout which is never rotated.
+   * @param max_bytes Size past which the file is rotated, 0 for never.
+   * @param max_files Number of rotated files kept.
+   * @param ring_size Number of entries each thread can have waiting.
+   * @param flush_interval How often the writer drains the rings.
+   */
+  explicit AccessLog(const std::string &path = "", size_t max_bytes = 64 << 20,
+                     size_t max_files = 5, size_t ring_size = 4096,
+                     std::chrono::milliseconds flush_interval =
+                         std::chrono::milliseconds(200));
+
+  /**
+   * @brief Write what is still waiting and stop the writer.
+   */
+  ~AccessLog();
+
+  /**
+   * @brief Queue an entry for the writer, never blocks.
+   *
+   * @param entry The entry, moved from.
+   */
+  void Log(Entry &&entry);
+
+  /**
+   * @brief Write every entry logged so far before returning.
+   */
+  void Flush();
+
+  /**
+   * @brief Number of entries dropped because a ring was full.
+   */
+  uint64_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Format an entry as one JSON line, e.g.
+   * {"time":"2022-11-01T12:00:00.000123Z","method":"GET","target":"/v1/x",
+   * "status":200,"latency_us":52,"db_us":40,"bytes":18,"user":"a@b.c"}
+   *
+   * @param entry The entry.
+   * @param out The line will be appended there.
+   */
+  static void Format(const Entry &entry, std::string *out);
+
+private:
+  /* Written by one thread, read by the writer */
+  struct Ring {
+    explicit Ring(size_t size) : slots(size) {}
+    std::vector<Entry> slots;
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+  };
+
+  /* The ring of the calling thread, registered on its first entry */
+  Ring *ThreadRing();
+
+  /* Move the waiting entries into buffer and write them, holding drain_lock */
+  void Drain();
+
+  /* Rename the file to path.1 and so on, and open a new one */
+  void Rotate();
+
+  void Run();
+
+  const std::string path;
+  const size_t max_bytes;
+  const size_t max_files;
+  const size_t ring_size;
+  const std::chrono::milliseconds flush_interval;
+  /* tells the rings of different logs apart in the thread-local registry */
+  const uint64_t id;
+
+  std::mutex rings_lock;
+  std::vector<std::shared_ptr<Ring>> rings;
+  std::atomic<uint64_t> dropped{0};
+
+  std::mutex drain_lock;
+  std::FILE *file = nullptr;
+  size_t file_bytes = 0;
+  std::string buffer;
+
+  std::mutex wake_lock;
+  std::condition_variable wake;
+  bool stopping = false;
+  std::thread writer;
+};
@@ -8,19 +8,26 @@
  */
 #include "api.h"
 #include "base64.h"
+#include "bodyParser.h"
+#include "compressor.h"
 #include "common/utils.h"
 #include "db/DB.h"
+#include "jsonWriter.h"
+#include "metrics.h"
+#include "rateLimiter.h"
 #include "requestData.h"
 #include "tasklistContent.h"
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
-#include <ctime>
-#include <iostream>
 #include <iterator>
 #include <jwt/jwt.hpp>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <nlohmann/json_fwd.hpp>
+#include <set>
 #include <utility>
 
 #define API_REQ() __api_req_x92k_no_conflict
@@ -30,64 +37,410 @@
   void Api::name(const httplib::Request &API_REQ(),                            \
                  httplib::Response &API_RES()) noexcept
 
-#define API_ADD_HTTP_HANDLER(server, path, method, func)                       \
+#define API_ADD_HTTP_HANDLER(router, path, method, func)                       \
   do {                                                                         \
-    (server)->method((path), [this](const httplib::Request &API_REQ(),         \
-                                    httplib::Response &API_RES()) {            \
-      this->func(API_REQ(), API_RES());                                        \
-    });                                                                        \
+    RouteMetrics *route = AddRouteMetrics(#method, (path));                    \
+    (router).Add(#method, (path),                                              \
+                 [this, route](const httplib::Request &API_REQ(),              \
+                               httplib::Response &API_RES()) {                 \
+                   const RouteTimer timer(route, API_RES());                   \
+                   if (!timer.Admitted()) {                                    \
+                     API_RES().set_header(retry_after_key, "1");               \
+                     API_RETURN_HTTP_RESP(503, "msg", "failed server busy");   \
+                   }                                                           \
+                   this->func(API_REQ(), API_RES());                           \
+                   if (DB::threadTimedOut()) {                                 \
+                     API_RES().headers.clear();                                \
+                     API_RETURN_HTTP_RESP(504, "msg",                          \
+                                          "failed deadline exceeded");         \
+                   }                                                           \
+                 });                                                           \
   } while (false)
 
-inline void BuildHttpRespBody(nlohmann::json *js) { return; }
+/* The i-th capture of the route, see Router */
+#define API_MATCH(i) Router::Match(i)
+
+inline void BuildHttpRespBody(std::string *body) { return; }
 
+/* Append "field":value pairs to a JSON object being written, in the order
+   given and not sorted by field */
 template <typename FirstValue, typename... Rest>
-inline void BuildHttpRespBody(nlohmann::json *js, const std::string &field,
+inline void BuildHttpRespBody(std::string *body, const char *field,
                               FirstValue &&value, Rest &&...rest) {
-  (*js)[field] = std::forward<FirstValue>(value);
-  BuildHttpRespBody(js, std::forward<Rest>(rest)...);
+  if (body->back() != '{') {
+    *body += ',';
+  }
+  JsonWriter::WriteString(*body, field);
+  *body += ':';
+  JsonWriter::WriteValue(*body, value);
+  BuildHttpRespBody(body, std::forward<Rest>(rest)...);
+}
+
+/* CORS headers of every response, built once */
+static const std::string cors_origin_key = "Access-Control-Allow-Origin";
+static const std::string cors_origin_val = "*";
+static const std::string cors_methods_key = "Access-Control-Allow-Methods";
+static const std::string cors_methods_val = " GET, POST, PUT, DELETE, OPTIONS";
+static const std::string cors_headers_key = "Access-Control-Allow-Headers";
+static const std::string cors_headers_val =
+    "X-Requested-With, Content-Type, Accept, Origin, Authorization";
+static const std::string cors_preflight_methods_val =
+    "OPTIONS, GET, POST, PUT, DELETE";
+static const std::string allow_key = "Allow";
+static const std::string allow_val = "GET, POST, PUT, DELETE, OPTIONS";
+static const std::string content_type_text = "text/plain";
+static const std::string accept_encoding_key = "Accept-Encoding";
+static const std::string content_encoding_key = "Content-Encoding";
+static const std::string vary_key = "Vary";
+static const std::string etag_key = "ETag";
+static const std::string if_none_match_key = "If-None-Match";
+static const std::string cache_control_key = "Cache-Control";
+static const std::string cache_control_no_cache = "no-cache";
+static const std::string content_type_event_stream = "text/event-stream";
+static const std::string retry_after_key = "Retry-After";
+static const std::string content_type_metrics =
+    "text/plain; version=0.0.4; charset=utf-8";
+
+/* An idle change stream sends a comment this often, which also finds out when
+   the client went away */
+static constexpr std::chrono::seconds change_stream_keep_alive(15);
+
+/**
+ * @brief Set the body of a response, compressed if the client accepts it and
+ * the body is large enough. httplib is built without its own compression, so
+ * bodies are never compressed twice.
+ *
+ * @param req The request being answered.
+ * @param res The response, its content type will be text/plain.
+ * @param body The JSON body.
+ * @param cache Cache of compressed bodies if the body of this route is the
+ * same for every client, nullptr otherwise.
+ */
+static inline void SetHttpRespContent(const httplib::Request &req,
+                                      httplib::Response &res,
+                                      std::string &&body,
+                                      CompressedCache *cache) {
+  if (body.size() >= Compressor::kMinCompressSize) {
+    /* The body depends on Accept-Encoding, even when it is not compressed */
+    res.set_header(vary_key, accept_encoding_key);
+    auto encoding =
+        Compressor::Negotiate(req.get_header_value(accept_encoding_key));
+    std::string compressed;
+    if (encoding != Compressor::IDENTITY &&
+        (cache ? cache->Compress(req.path, body, encoding, &compressed)
+               : Compressor::Compress(body, encoding, &compressed))) {
+      res.set_header(content_encoding_key, Compressor::Name(encoding));
+      res.set_content(std::move(compressed), content_type_text);
+      return;
+    }
+  }
+  res.set_content(std::move(body), content_type_text);
+}
+
+/* What the access log needs to know about the request of this thread, beyond
+   the request and response themselves */
+struct AccessContext {
+  bool started = false;
+  std::chrono::steady_clock::time_point start;
+  uint64_t db_start = 0;
+  std::string user;
+};
+static thread_local AccessContext access_context;
+
+/* Called by the router before a request is routed */
+static void BeginAccess(const httplib::Request &) {
+  access_context.started = true;
+  access_context.start = std::chrono::steady_clock::now();
+  access_context.db_start = DB::threadQueryTime();
+  access_context.user.clear();
+}
+
+/* Called by httplib once a response was written, or its headers if streamed */
+static void LogAccess(AccessLog &log, const httplib::Request &req,
+                      const httplib::Response &res) {
+  AccessLog::Entry entry;
+  entry.time = std::chrono::system_clock::now();
+  entry.method = req.method;
+  entry.target = req.target;
+  entry.status = res.status;
+  entry.bytes = res.body.size();
+  /* Requests httplib could not parse were never routed */
+  if (access_context.started) {
+    entry.latency_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() -
+                           access_context.start)
+                           .count();
+    entry.db_us = DB::threadQueryTime() - access_context.db_start;
+    entry.user = std::move(access_context.user);
+    access_context.started = false;
+  }
+  log.Log(std::move(entry));
+}
+
+/* Names of the return codes of the workers, indexed by returnCode */
+static const char *const return_code_names[] = {
+    "SUCCESS",      "ERR_UNKNOWN", "ERR_KEY",    "ERR_RFIELD", "ERR_NO_NODE",
+    "ERR_DUP_NODE", "ERR_ACCESS",  "ERR_FORMAT", "ERR_REVISE", "ERR_TIMEOUT"};
+static constexpr size_t n_return_codes =
+    sizeof(return_code_names) / sizeof(return_code_names[0]);
+
+/* Http status codes are below this */
+static constexpr int max_status = 600;
+
+struct RouteMetrics {
+  Metrics *registry;
+  /* method and route */
+  Metrics::Labels labels;
+  Metrics::Histogram *latency;
+  Metrics::Histogram *db_time;
+  Metrics::Gauge *in_flight;
+  /* null for the routes that are never shed */
+  ConcurrencyLimiter *limiter;
+  /* null for the routes that are not in a lane */
+  Bulkhead *bulkhead;
+  Bulkhead::Lane lane;
+  Metrics::Histogram *lane_wait;
+  /* zero for none */
+  std::chrono::milliseconds deadline;
+  /* by status code and by return code, registered the first time they occur
+     so that the scrape only lists what happened */
+  std::array<std::atomic<Metrics::Counter *>, max_status> responses{};
+  std::array<std::atomic<Metrics::Counter *>, n_return_codes> returns{};
+};
+
+/* Route being handled by the current thread */
+static thread_local RouteMetrics *current_route = nullptr;
+
+/* The counter in a slot of a route, registering its series on first use.
+   Threads racing to register get the same counter from the registry. */
+static Metrics::Counter *RouteCounter(RouteMetrics &route,
+                                      std::atomic<Metrics::Counter *> &slot,
+                                      const char *name, const char *help,
+                                      const char *label,
+                                      const std::string &value) {
+  Metrics::Counter *counter = slot.load(std::memory_order_acquire);
+  if (!counter) {
+    Metrics::Labels labels = route.labels;
+    labels.emplace_back(label, value);
+    counter = route.registry->GetCounter(name, help, labels);
+    slot.store(counter, std::memory_order_release);
+  }
+  return counter;
+}
+
+/* Admits a request to the handler of its route, then times it and counts its
+   response when it goes out of scope, whichever way the handler returned */
+class RouteTimer {
+public:
+  RouteTimer(RouteMetrics *route, const httplib::Response &res)
+      : route(route), res(res), start(std::chrono::steady_clock::now()),
+        db_start(DB::threadQueryTime()) {
+    route->in_flight->Add(1);
+    current_route = route;
+    const auto deadline = route->deadline.count() > 0
+                              ? start + route->deadline
+                              : std::chrono::steady_clock::time_point::max();
+    if (route->bulkhead) {
+      grant = route->bulkhead->Acquire(route->lane, deadline);
+      route->lane_wait->Observe(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count());
+      if (grant == Bulkhead::REFUSED) {
+        return;
+      }
+    }
+    if (route->limiter && !route->limiter->Acquire()) {
+      ReleaseLane();
+      return;
+    }
+    admitted = true;
+    DB::setThreadDeadline(deadline);
+  }
+
+  ~RouteTimer() {
+    DB::setThreadDeadline(std::chrono::steady_clock::time_point::max());
+    current_route = nullptr;
+    route->in_flight->Add(-1);
+    const uint64_t db_us = DB::threadQueryTime() - db_start;
+    if (admitted) {
+      if (route->limiter) {
+        route->limiter->Release(db_us);
+      }
+      ReleaseLane();
+    }
+    route->latency->Observe(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count());
+    route->db_time->Observe(db_us);
+    if (res.status > 0 && res.status < max_status) {
+      RouteCounter(*route, route->responses[res.status],
+                   "lqxx_http_requests_total",
+                   "Responses by route and status code.", "code",
+                   std::to_string(res.status))
+          ->Add();
+    }
+  }
+
+  /* false if the request must be shed */
+  bool Admitted() const { return admitted; }
+
+private:
+  void ReleaseLane() {
+    if (grant != Bulkhead::REFUSED) {
+      route->bulkhead->Release(route->lane, grant);
+      grant = Bulkhead::REFUSED;
+    }
+  }
+
+  RouteMetrics *route;
+  const httplib::Response &res;
+  const std::chrono::steady_clock::time_point start;
+  const uint64_t db_start;
+  Bulkhead::Grant grant = Bulkhead::REFUSED;
+  bool admitted = false;
+};
+
+/* Count the return code of a worker call in the series of the current route.
+   A call that ran out of time may have returned what it had read so far, it
+   is a timeout all the same. */
+static inline returnCode Counted(returnCode ret) {
+  if (DB::threadTimedOut()) {
+    ret = ERR_TIMEOUT;
+  }
+  if (current_route && ret >= 0 && static_cast<size_t>(ret) < n_return_codes) {
+    RouteCounter(*current_route, current_route->returns[ret],
+                 "lqxx_worker_returns_total",
+                 "Return codes of the worker calls, by route.", "code",
+                 return_code_names[ret])
+        ->Add();
+  }
+  return ret;
+}
+
+/**
+ * @brief Content provider of a change stream: wait for the changes of the
+ * subscriber and write them, or a keep-alive comment if none came.
+ *
+ * @return false if the client went away.
+ */
+static bool WriteChangeStream(ChangeHub::Subscriber &subscriber, size_t offset,
+                              httplib::DataSink &sink) {
+  /* Clients reconnect after 3 seconds if the stream breaks */
+  static const std::string retry = "retry: 3000\n\n";
+  static const std::string keep_alive = ": keep-alive\n\n";
+  /* Changes were dropped, the client must reload the task list */
+  static const std::string reset = "event: reset\ndata: {}\n\n";
+
+  if (offset == 0 && !sink.write(retry.data(), retry.size())) {
+    return false;
+  }
+  std::vector<ChangeHub::Frame> frames;
+  bool overflowed = false;
+  if (!subscriber.Wait(change_stream_keep_alive, &frames, &overflowed)) {
+    sink.done();
+    return true;
+  }
+  if (overflowed && !sink.write(reset.data(), reset.size())) {
+    return false;
+  }
+  for (auto &frame : frames) {
+    if (!sink.write(frame->data(), frame->size())) {
+      return false;
+    }
+  }
+  if (frames.empty() && !overflowed) {
+    return sink.write(keep_alive.data(), keep_alive.size());
+  }
+  return true;
 }
 
-#define API_ADD_HTTP_OPTIONS_HANDLER(server, path)                             \
+#define API_ADD_HTTP_OPTIONS_HANDLER(router)                                   \
   do {                                                                         \
-    (server)->Options((path), [this](const httplib::Request &API_REQ(),        \
-                                     httplib::Response &API_RES()) {           \
-      API_RES().set_header("Access-Control-Allow-Origin", "*");                \
-      API_RES().set_header("Allow", "GET, POST, PUT, DELETE, OPTIONS");        \
-      API_RES().set_header(                                                    \
-          "Access-Control-Allow-Headers",                                      \
-          "X-Requested-With, Content-Type, Accept, Origin, Authorization");    \
-      API_RES().set_header("Access-Control-Allow-Methods",                     \
-                           "OPTIONS, GET, POST, PUT, DELETE");                 \
+    (router).SetOptions([this](const httplib::Request &API_REQ(),              \
+                               httplib::Response &API_RES()) {                 \
+      API_RES().set_header(cors_origin_key, cors_origin_val);                  \
+      API_RES().set_header(allow_key, allow_val);                              \
+      API_RES().set_header(cors_headers_key, cors_headers_val);                \
+      API_RES().set_header(cors_methods_key, cors_preflight_methods_val);      \
     });                                                                        \
   } while (false)
 
-#define API_RETURN_HTTP_RESP(code, ...)                                        \
+/* Respond and return, compressing the body through cache unless it is null */
+#define API_SEND_HTTP_RESP(cache, code, ...)                                   \
   do {                                                                         \
-    nlohmann::json result;                                                     \
+    std::string result = JsonWriter::TakeBuffer();                             \
+    result += '{';                                                             \
     BuildHttpRespBody(&result, __VA_ARGS__);                                   \
+    result += '}';                                                             \
+    JsonWriter::RecordBufferSize(result.size());                               \
     API_RES().status = (code);                                                 \
-    API_RES().set_header("Access-Control-Allow-Origin", "*");                  \
-    API_RES().set_header("Access-Control-Allow-Methods",                       \
-                         " GET, POST, PUT, DELETE, OPTIONS");                  \
-    API_RES().set_header(                                                      \
-        "Access-Control-Allow-Headers",                                        \
-        "X-Requested-With, Content-Type, Accept, Origin, Authorization");      \
-    API_RES().set_content(result.dump(), "text/plain");                        \
-    if (print) {                                                               \
-      std::time_t time = std::chrono::system_clock::to_time_t(                 \
-          std::chrono::system_clock::now());                                   \
-      std::string time_str = std::ctime(&time);                                \
-      time_str.pop_back();                                                     \
-      std::string path = API_REQ().path;                                       \
-      char cont = '?';                                                         \
-      for (auto &it : API_REQ().params) {                                      \
-        path += cont + it.first + "=" + it.second;                             \
-        cont = '&';                                                            \
+    API_RES().set_header(cors_origin_key, cors_origin_val);                    \
+    API_RES().set_header(cors_methods_key, cors_methods_val);                  \
+    API_RES().set_header(cors_headers_key, cors_headers_val);                  \
+    SetHttpRespContent(API_REQ(), API_RES(), std::move(result), (cache));      \
+    return;                                                                    \
+  } while (false)
+
+#define API_RETURN_HTTP_RESP(code, ...)                                        \
+  API_SEND_HTTP_RESP(nullptr, code, __VA_ARGS__)
+
+/* For routes whose body is the same for every client */
+#define API_RETURN_CACHED_HTTP_RESP(code, ...)                                 \
+  API_SEND_HTTP_RESP(&compressed_bodies, code, __VA_ARGS__)
+
+/**
+ * @brief Check whether an If-None-Match header lists an entity tag, comparing
+ * them weakly as GET requests do.
+ *
+ * @param header Value of the If-None-Match header, may be empty.
+ * @param etag The current entity tag.
+ * @return true if the client already has the current version.
+ */
+static inline bool ETagMatches(const std::string &header,
+                               const std::string &etag) {
+  auto opaque = [](std::string tag) {
+    tag.erase(0, tag.find_first_not_of(" \t"));
+    tag.erase(tag.find_last_not_of(" \t") + 1);
+    return tag.compare(0, 2, "W/") == 0 ? tag.substr(2) : tag;
+  };
+  const std::string current = opaque(etag);
+  for (auto &tag : Common::Split(header, ",")) {
+    if (opaque(tag) == current || opaque(tag) == "*") {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Probe the access of req once for all the worker calls of the request, and
+   the version for the ETag. A failed probe fails the request, the route answers
+   504 if it timed out. */
+#define API_RESOLVE_ACCESS(worker, req)                                        \
+  do {                                                                         \
+    if (Counted((worker)->ResolveAccess((req))) != returnCode::SUCCESS) {      \
+      API_RETURN_HTTP_RESP(500, "msg", "failed check access");                 \
+    }                                                                          \
+  } while (false)
+
+/* Send the version of the resource as its ETag, and answer 304 without a body
+   if the client already has it. Resolve the access of req first: the probe
+   reads the version, otherwise worker->Version costs one more query. */
+#define API_RETURN_IF_NOT_MODIFIED(worker, req)                                \
+  do {                                                                         \
+    int64_t version = 0;                                                       \
+    if (Counted((worker)->Version((req), version)) == returnCode::SUCCESS) {   \
+      std::string etag = "W/\"" + std::to_string(version) + "\"";             \
+      API_RES().set_header(etag_key, etag);                                    \
+      if (ETagMatches(API_REQ().get_header_value(if_none_match_key), etag)) {  \
+        API_RES().status = 304;                                                \
+        API_RES().set_header(cors_origin_key, cors_origin_val);                \
+        API_RES().set_header(cors_methods_key, cors_methods_val);              \
+        API_RES().set_header(cors_headers_key, cors_headers_val);              \
+        return;                                                                \
       }                                                                        \
-      std::cout << "[" << time_str << "] " << API_REQ().method << " " << path  \
-                << " " << API_RES().status << std::endl;                       \
     }                                                                          \
-    return;                                                                    \
   } while (false)
 
 #define API_PARSE_REQ_BODY(ret)                                                \
@@ -104,6 +457,23 @@ inline void BuildHttpRespBody(nlohmann::json *js, const std::string &field,
     std::move(json_body);                                                      \
   })
 
+/* Parse a body of a known shape with one of BodyParser's parsers */
+#define API_PARSE_REQ_BODY_AS(parse, err_field)                                \
+  do {                                                                         \
+    if (API_REQ().body.size() > BodyParser::kMaxBodySize) {                    \
+      API_RETURN_HTTP_RESP(413, "msg", "failed request body too large");       \
+    }                                                                          \
+    returnCode parse_ret = (parse);                                            \
+    if (parse_ret == returnCode::ERR_RFIELD) {                                 \
+      API_RETURN_HTTP_RESP(500, "msg",                                         \
+                           "failed missing required field " + (err_field));    \
+    } else if (parse_ret != returnCode::SUCCESS && (err_field).empty()) {      \
+      API_RETURN_HTTP_RESP(500, "msg", "failed request body format error");    \
+    } else if (parse_ret != returnCode::SUCCESS) {                             \
+      API_RETURN_HTTP_RESP(400, "msg", "failed invalid field " + (err_field)); \
+    }                                                                          \
+  } while (false)
+
 #define API_GET_JSON_REQUIRED(json_body, target, field)                        \
   do {                                                                         \
     if ((json_body).find(#field) == (json_body).end()) {                       \
@@ -127,21 +497,139 @@ inline void BuildHttpRespBody(nlohmann::json *js, const std::string &field,
     }                                                                          \
   } while (false)
 
-static inline std::string sha256_passwd(std::string passwd) {
-  std::string result;
-  unsigned char hash[SHA256_DIGEST_LENGTH];
-  SHA256_CTX sha256;
-  SHA256_Init(&sha256);
-  SHA256_Update(&sha256, passwd.c_str(), passwd.size());
-  SHA256_Final(hash, &sha256);
-  for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-    char buf[3];
-    snprintf(buf, 3, "%02x", hash[i]);
-    result += buf;
+/* Names of the fields that can be asked for with the "fields" query parameter,
+   together with their names in database. */
+using FieldNames = std::vector<std::pair<std::string, std::string>>;
+
+static const FieldNames task_field_names = {
+    {"name", "name"},           {"content", "content"},
+    {"date", "date"},           {"start_date", "startDate"},
+    {"end_date", "endDate"},    {"priority", "priority"},
+    {"status", "status"}};
+
+static const FieldNames tasklist_field_names = {
+    {"name", "name"}, {"content", "content"}, {"visibility", "visibility"}};
+
+/**
+ * @brief Parse the comma separated "fields" query parameter.
+ *
+ * @param param Value of the query parameter, may be empty.
+ * @param names Names of the known fields.
+ * @param fields Database names of the requested fields will be put there.
+ * @param keys Response names of the requested fields will be put there.
+ * @return false if there is an unknown field.
+ */
+static inline bool ParseFields(const std::string &param,
+                               const FieldNames &names,
+                               std::vector<std::string> *fields,
+                               std::vector<std::string> *keys) {
+  for (auto &key : Common::Split(param, ",")) {
+    auto it = std::find_if(names.begin(), names.end(),
+                           [&key](auto &name) { return name.first == key; });
+    if (it == names.end()) {
+      return false;
+    }
+    if (std::find(keys->begin(), keys->end(), key) == keys->end()) {
+      keys->push_back(key);
+      fields->push_back(it->second);
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Keep only the requested fields of a json object.
+ *
+ * @param js Json object with all fields.
+ * @param keys Response names of the requested fields, empty for all.
+ * @return nlohmann::json Json object with the requested fields.
+ */
+static inline nlohmann::json
+ProjectFields(nlohmann::json &&js, const std::vector<std::string> &keys) {
+  if (keys.empty()) {
+    return std::move(js);
+  }
+  nlohmann::json projected = nlohmann::json::object();
+  for (auto &key : keys) {
+    projected[key] = std::move(js[key]);
   }
-  return result;
+  return projected;
+}
+
+static inline nlohmann::json TaskToJson(TaskContent &task) {
+  return {{"name", std::move(task.name)},
+          {"content", std::move(task.content)},
+          {"date", std::move(task.date)},
+          {"start_date", std::move(task.startDate)},
+          {"end_date", std::move(task.endDate)},
+          {"priority", task.priority},
+          {"status", std::move(task.status)}};
+}
+
+static inline nlohmann::json TasklistToJson(TasklistContent &tasklist) {
+  return {{"name", std::move(tasklist.name)},
+          {"content", std::move(tasklist.content)},
+          {"visibility", std::move(tasklist.visibility)}};
+}
+
+#define API_GET_FIELDS_OPTIONAL(names, fields, keys)                           \
+  do {                                                                         \
+    std::string fields_param;                                                  \
+    API_GET_PARAM_OPTIONAL(fields_param, fields);                              \
+    if (!ParseFields(fields_param, (names), &(fields), &(keys))) {             \
+      API_RETURN_HTTP_RESP(400, "msg", "failed unknown field");                \
+    }                                                                          \
+  } while (false)
+
+/**
+ * @brief Parse a non-negative integer query parameter such as "offset".
+ *
+ * @param param Value of the query parameter, may be empty.
+ * @param count The parsed value will be put there, unchanged if empty.
+ * @return false if the value is not a non-negative integer.
+ */
+static inline bool ParseCount(const std::string &param, size_t *count) {
+  if (param.empty()) {
+    return true;
+  }
+  if (param.size() > 9 ||
+      !std::all_of(param.begin(), param.end(),
+                   [](char c) { return c >= '0' && c <= '9'; })) {
+    return false;
+  }
+  *count = std::stoul(param);
+  return true;
+}
+
+/**
+ * @brief Parse a sync cursor from a query parameter.
+ *
+ * @param param Value of the parameter, may be empty.
+ * @param cursor The parsed value will be put there, unchanged if empty.
+ * @return false if the value is not a non-negative integer.
+ */
+static inline bool ParseCursor(const std::string &param, uint64_t *cursor) {
+  if (param.empty()) {
+    return true;
+  }
+  if (param.size() > 18 ||
+      !std::all_of(param.begin(), param.end(),
+                   [](char c) { return c >= '0' && c <= '9'; })) {
+    return false;
+  }
+  *cursor = std::stoull(param);
+  return true;
 }
 
+#define API_GET_COUNT_OPTIONAL(target, key)                                    \
+  do {                                                                         \
+    std::string count_param;                                                   \
+    API_GET_PARAM_OPTIONAL(count_param, key);                                  \
+    if (!ParseCount(count_param, &(target))) {                                 \
+      API_RETURN_HTTP_RESP(400, "msg", "failed invalid " #key);                \
+    }                                                                          \
+  } while (false)
+
 static inline bool
 DecodeEmailAndPasswordFromBasicAuth(const std::string &auth, std::string *email,
                                     std::string *password) noexcept {
@@ -160,7 +648,7 @@ DecodeEmailAndPasswordFromBasicAuth(const std::string &auth, std::string *email,
   }
 
   *email = std::move(email_password[0]);
-  *password = sha256_passwd(std::move(email_password[0] + email_password[1]));
+  *password = std::move(email_password[1]);
   return true;
 }
 
@@ -177,9 +665,9 @@ EncodeTokenFromEmail(const std::string &email,
   return jwt_obj.signature();
 }
 
-static inline std::string
-DecodeEmailFromToken(const std::string &token,
-                     const std::string &secret_key) noexcept {
+static inline std::string DecodeEmailFromToken(
+    const std::string &token, const std::string &secret_key,
+    std::chrono::system_clock::time_point *expires = nullptr) noexcept {
 
   std::error_code err;
   const auto jwt_obj = jwt::decode(
@@ -190,9 +678,53 @@ DecodeEmailFromToken(const std::string &token,
   if (err) {
     return {};
   }
+  if (expires) {
+    *expires = std::chrono::system_clock::time_point(std::chrono::seconds(
+        jwt_obj.payload().get_claim_value<uint64_t>("exp")));
+  }
   return jwt_obj.payload().get_claim_value<std::string>("email");
 }
 
+/**
+ * @brief Same as DecodeEmailFromToken, but checks the tokens lqxx issued with
+ * the fast verifier and only passes the others to jwt::decode.
+ */
+static inline std::string VerifyEmailFromToken(
+    const std::string &token, const std::string &secret_key,
+    const Hs256Verifier &verifier,
+    std::chrono::system_clock::time_point *expires = nullptr) noexcept {
+  std::string email;
+  const auto result = verifier.Verify(token, &email, expires);
+  if (result == Hs256Verifier::VALID) {
+    return email;
+  }
+  if (result == Hs256Verifier::INVALID) {
+    return {};
+  }
+  return DecodeEmailFromToken(token, secret_key, expires);
+}
+
+/**
+ * @brief Same as VerifyEmailFromToken, but only verifies a token the first
+ * time it is seen, then takes its email from the cache until it expires.
+ */
+static inline std::string
+CachedEmailFromToken(const std::string &token, const std::string &secret_key,
+                     const Hs256Verifier &verifier,
+                     VerifiedTokenCache &cache) noexcept {
+  std::string email;
+  if (cache.Find(token, &email)) {
+    return email;
+  }
+
+  std::chrono::system_clock::time_point expires;
+  email = VerifyEmailFromToken(token, secret_key, verifier, &expires);
+  if (!email.empty()) {
+    cache.Insert(token, email, expires);
+  }
+  return email;
+}
+
 static inline std::string
 DecodeTokenFromBasicAuth(const std::string &auth) noexcept {
   const auto splited_auth = Common::Split(auth, " ");
@@ -213,30 +745,56 @@ DecodeTokenFromBasicAuth(const std::string &auth) noexcept {
   return token_null[0];
 }
 
+/* GET requests only read, they are limited apart from the writes */
+static inline bool IsReadRequest(const httplib::Request &req) {
+  return req.method == "GET" || req.method == "HEAD";
+}
+
+/* Answer 429 if the key used up its requests for now, telling the client how
+   many seconds to wait. A null limiter lets everything through. */
+#define API_CHECK_RATE_LIMIT(limiter, key)                                     \
+  do {                                                                         \
+    RateLimiter::Clock::duration retry_after;                                  \
+    if ((limiter) && !(limiter)->Allow((key), &retry_after)) {                 \
+      const auto seconds =                                                     \
+          std::chrono::ceil<std::chrono::seconds>(retry_after).count();        \
+      API_RES().set_header(retry_after_key,                                    \
+                           std::to_string(std::max<int64_t>(seconds, 1)));     \
+      API_RETURN_HTTP_RESP(429, "msg", "failed too many requests");            \
+    }                                                                          \
+  } while (false)
+
 #define API_CHECK_REQUEST_TOKEN(user_email, token)                             \
   do {                                                                         \
     const auto auth_header = API_REQ().headers.find("Authorization");          \
     if (auth_header == API_REQ().headers.cend() ||                             \
-        (user_email = DecodeEmailFromToken(                                    \
+        (user_email = CachedEmailFromToken(                                    \
              token = DecodeTokenFromBasicAuth(auth_header->second),            \
-             token_secret_key))                                                \
+             token_secret_key, token_verifier, verified_tokens))               \
             .empty()) {                                                        \
       API_RETURN_HTTP_RESP(500, "msg", "failed basic auth");                   \
     }                                                                          \
-    std::lock_guard<std::mutex> guard(invalid_tokens_lock);                    \
-    if (invalid_tokens.find(token) != invalid_tokens.end()) {                  \
+    if (revoked_tokens.IsRevoked(token)) {                                     \
       API_RETURN_HTTP_RESP(500, "msg", "failed token invalid");                \
     }                                                                          \
+    if (access_log) {                                                          \
+      access_context.user = user_email;                                        \
+    }                                                                          \
+    API_CHECK_RATE_LIMIT(                                                      \
+        IsReadRequest(API_REQ()) ? read_limiter : write_limiter, user_email);  \
   } while (false)
 
 /* Default arguments not cool, modify later */
 Api::Api(std::shared_ptr<Users> _users,
          std::shared_ptr<TaskListsWorker> _tasklists_worker,
          std::shared_ptr<TasksWorker> _tasks_worker, std::shared_ptr<DB> _db,
-         std::shared_ptr<httplib::Server> _svr)
+         std::shared_ptr<httplib::Server> _svr,
+         std::shared_ptr<GroupsWorker> _groups_worker)
     : users(_users), tasklists_worker(_tasklists_worker),
-      tasks_worker(_tasks_worker), db(_db), svr(_svr),
-      token_secret_key(Common::RandomString(128)) {
+      tasks_worker(_tasks_worker), groups_worker(_groups_worker), db(_db),
+      svr(_svr),
+      token_secret_key(Common::RandomString(128)),
+      token_verifier(token_secret_key) {
 
   if (!db) {
     db = std::make_shared<DB>();
@@ -255,9 +813,107 @@ Api::Api(std::shared_ptr<Users> _users,
     tasks_worker = std::make_shared<TasksWorker>(db, tasklists_worker);
   }
 
+  if (!groups_worker) {
+    groups_worker = std::make_shared<GroupsWorker>(db);
+  }
+
   if (!svr) {
     svr = std::make_shared<httplib::Server>();
   }
+
+  auto listeners = std::make_shared<ChangeListeners>();
+  listeners->Add(change_journal);
+  listeners->Add(change_hub);
+  tasklists_worker->SetChangeListener(listeners);
+  tasks_worker->SetChangeListener(listeners);
+  groups_worker->SetChangeListener(listeners);
+
+  /* Values owned by other objects, read when the metrics are scraped */
+  std::shared_ptr<const TaskQueueStats> stats = queue_stats;
+  metrics.AddCallback("lqxx_task_queue_depth",
+                      "Connections waiting for a worker thread.", false,
+                      [stats]() { return stats->depth.load(); });
+  metrics.AddCallback("lqxx_task_queue_tasks_total",
+                      "Connections taken by a worker thread.", true,
+                      [stats]() { return stats->tasks.load(); });
+  metrics.AddCallback("lqxx_task_queue_rejected_total",
+                      "Connections rejected because the queue was full.", true,
+                      [stats]() { return stats->rejected.load(); });
+  metrics.AddCallback("lqxx_task_queue_wait_seconds_total",
+                      "Time connections waited for a worker thread.", true,
+                      [stats]() { return stats->wait_us_total.load() / 1e6; });
+  metrics.AddCallback("lqxx_task_queue_wait_max_seconds",
+                      "Longest time a connection waited for a worker thread.",
+                      false,
+                      [stats]() { return stats->wait_us_max.load() / 1e6; });
+  std::shared_ptr<const PasswordHasher> hasher = users->Hasher();
+  if (hasher) {
+    metrics.AddCallback("lqxx_password_hash_queue_depth",
+                        "Password hashes waiting for a hashing thread.", false,
+                        [hasher]() { return hasher->Depth(); });
+    metrics.AddCallback("lqxx_password_hash_rejected_total",
+                        "Password hashes refused because the queue was full.",
+                        true, [hasher]() { return hasher->Rejected(); });
+  }
+  metrics.AddCallback("lqxx_verified_tokens",
+                      "Tokens in the cache of verified tokens.", false,
+                      [this]() { return verified_tokens.Size(); });
+  metrics.AddCallback("lqxx_revoked_tokens", "Tokens in the revocation set.",
+                      false, [this]() { return revoked_tokens.Size(); });
+  metrics.AddCallback("lqxx_change_streams", "Open change streams.", false,
+                      [this]() { return change_hub->Size(); });
+  metrics.AddCallback("lqxx_change_journal_entries",
+                      "Changes kept in the change journal.", false,
+                      [this]() { return change_journal->Size(); });
+}
+
+/* Registrations and logins hash a password, the GETs of a route ending with
+   a key read one item, the other GETs read many and the rest write */
+static Bulkhead::Lane LaneOf(const std::string &method,
+                             const std::string &path) {
+  if (path == "/v1/users/register" || path == "/v1/users/login") {
+    return Bulkhead::LOGIN;
+  }
+  if (method != "GET") {
+    return Bulkhead::WRITE;
+  }
+  return path.back() == '}' ? Bulkhead::INTERACTIVE : Bulkhead::BULK;
+}
+
+RouteMetrics *Api::AddRouteMetrics(const char *method,
+                                   const std::string &path) {
+  auto route = std::make_unique<RouteMetrics>();
+  route->registry = &metrics;
+  route->labels = {{"method", method}, {"route", path}};
+  route->latency = metrics.GetHistogram(
+      "lqxx_http_request_duration_seconds",
+      "Time spent in the handler of a route.", route->labels);
+  route->db_time = metrics.GetHistogram(
+      "lqxx_http_request_db_seconds",
+      "Time a request spent with a DB connection open.", route->labels);
+  route->in_flight = metrics.GetGauge("lqxx_http_requests_in_flight",
+                                      "Requests being handled.");
+  /* Health checks and metrics must answer when the DB is slow */
+  const bool is_v1 = path.compare(0, 4, "/v1/") == 0;
+  route->limiter = is_v1 ? concurrency_limiter.get() : nullptr;
+  route->bulkhead = is_v1 ? bulkhead.get() : nullptr;
+  route->lane = LaneOf(method, path);
+  route->lane_wait =
+      route->bulkhead
+          ? metrics.GetHistogram("lqxx_lane_queue_seconds",
+                                 "Time requests waited for a slot of a lane.",
+                                 {{"lane", Bulkhead::Name(route->lane)}})
+          : nullptr;
+  auto it = route_deadlines.find(path);
+  if (!is_v1) {
+    route->deadline = std::chrono::milliseconds(0);
+  } else if (it != route_deadlines.end()) {
+    route->deadline = it->second;
+  } else {
+    route->deadline = deadline;
+  }
+  route_metrics.push_back(std::move(route));
+  return route_metrics.back().get();
 }
 
 Api::~Api() { Stop(); }
@@ -268,6 +924,9 @@ API_DEFINE_HTTP_HANDLER(UsersRegister) {
   std::string user_email;
   nlohmann::json json_body;
 
+  /* Per address, before the password is hashed */
+  API_CHECK_RATE_LIMIT(anonymous_limiter, API_REQ().remote_addr);
+
   const auto auth_header = API_REQ().headers.find("Authorization");
   if (auth_header == API_REQ().headers.cend() ||
       !DecodeEmailAndPasswordFromBasicAuth(auth_header->second, &user_email,
@@ -282,15 +941,13 @@ API_DEFINE_HTTP_HANDLER(UsersRegister) {
   json_body = API_PARSE_REQ_BODY(false);
   API_GET_JSON_OPTIONAL(json_body, user_name, name);
 
-  // check if user email is duplicated
-  if (users->DuplicatedEmail(UserInfo("", user_email, ""))) {
-    API_RETURN_HTTP_RESP(400, "msg", "failed duplicated email");
-  }
-
-  // create user
-  if (users->Create(UserInfo(user_name, user_email, user_passwd))) {
+  // create user, a duplicated email is refused by the DB
+  switch (users->Register(UserInfo(user_name, user_email, user_passwd))) {
+  case returnCode::SUCCESS:
     API_RETURN_HTTP_RESP(200, "msg", "success");
-  } else {
+  case returnCode::ERR_DUP_NODE:
+    API_RETURN_HTTP_RESP(400, "msg", "failed duplicated email");
+  default:
     API_RETURN_HTTP_RESP(500, "msg", "failed create user");
   }
 }
@@ -299,6 +956,9 @@ API_DEFINE_HTTP_HANDLER(UsersLogin) {
   std::string user_passwd;
   std::string user_email;
 
+  /* Per address, before the password is hashed */
+  API_CHECK_RATE_LIMIT(anonymous_limiter, API_REQ().remote_addr);
+
   const auto auth_header = API_REQ().headers.find("Authorization");
   if (auth_header == API_REQ().headers.cend() ||
       !DecodeEmailAndPasswordFromBasicAuth(auth_header->second, &user_email,
@@ -326,13 +986,13 @@ API_DEFINE_HTTP_HANDLER(UsersLogin) {
 API_DEFINE_HTTP_HANDLER(UsersLogout) {
   std::string user_email;
   std::string token;
+  std::chrono::system_clock::time_point expires;
   API_CHECK_REQUEST_TOKEN(user_email, token);
 
-  /* invalid date the email and token */
-  {
-    std::lock_guard<std::mutex> guard(invalid_tokens_lock);
-    invalid_tokens.insert(token);
-  }
+  /* invalidate the token until it expires */
+  VerifyEmailFromToken(token, token_secret_key, token_verifier, &expires);
+  revoked_tokens.Revoke(token, expires);
+  verified_tokens.Erase(token);
 
   API_RETURN_HTTP_RESP(200, "msg", "success");
 }
@@ -341,17 +1001,24 @@ API_DEFINE_HTTP_HANDLER(TaskListsAll) {
   std::string token;
   std::string share;
   RequestData tasklist_req;
+  std::vector<std::string> keys;
   std::vector<std::string> out_names;
+  std::vector<TasklistContent> out_tasklists;
   std::vector<shareInfo> out_share_info;
   nlohmann::json data;
 
   API_CHECK_REQUEST_TOKEN(tasklist_req.user_key, token);
   API_GET_PARAM_OPTIONAL(share, share);
+  API_GET_FIELDS_OPTIONAL(tasklist_field_names, tasklist_req.fields, keys);
 
   if (share == "true") {
+    /* Only lists of one owner, and a page of them, if asked for */
+    API_GET_PARAM_OPTIONAL(tasklist_req.other_user_key, owner);
+    API_GET_COUNT_OPTIONAL(tasklist_req.offset, offset);
+    API_GET_COUNT_OPTIONAL(tasklist_req.limit, limit);
     /* Get all shared task lists */
-    if (tasklists_worker->GetAllAccessTaskList(tasklist_req, out_share_info) !=
-        returnCode::SUCCESS) {
+    if (Counted(tasklists_worker->GetAllAccessTaskList(
+            tasklist_req, out_share_info)) != returnCode::SUCCESS) {
       API_RETURN_HTTP_RESP(500, "msg", "failed get shared task lists");
     }
     std::transform(out_share_info.begin(), out_share_info.end(),
@@ -361,9 +1028,20 @@ API_DEFINE_HTTP_HANDLER(TaskListsAll) {
                          {"permission", info.permission ? "write" : "read"},
                          {"list", info.task_list_name}};
                    });
+  } else if (!keys.empty()) {
+    /* Get the requested fields of all task lists */
+    if (Counted(tasklists_worker->GetAllTasklistContent(
+            tasklist_req, out_tasklists)) != returnCode::SUCCESS) {
+      API_RETURN_HTTP_RESP(500, "msg", "failed get all task lists");
+    }
+    data = nlohmann::json::array();
+    std::transform(out_tasklists.begin(), out_tasklists.end(),
+                   std::back_inserter(data), [&keys](TasklistContent &list) {
+                     return ProjectFields(TasklistToJson(list), keys);
+                   });
   } else {
     /* Get all task lists */
-    if (tasklists_worker->GetAllTasklist(tasklist_req, out_names) !=
+    if (Counted(tasklists_worker->GetAllTasklist(tasklist_req, out_names)) !=
         returnCode::SUCCESS) {
       API_RETURN_HTTP_RESP(500, "msg", "failed get all task lists");
     }
@@ -378,23 +1056,67 @@ API_DEFINE_HTTP_HANDLER(TaskListsGet) {
   std::string token;
   RequestData tasklist_req;
   TasklistContent tasklist_content;
+  std::vector<std::string> keys;
   nlohmann::json data;
 
   API_CHECK_REQUEST_TOKEN(tasklist_req.user_key, token);
 
   /* Get one certain task list */
   API_GET_PARAM_OPTIONAL(tasklist_req.other_user_key, other);
-  tasklist_req.tasklist_key = API_REQ().matches[1];
-  if (tasklists_worker->Query(tasklist_req, tasklist_content) !=
+  API_GET_FIELDS_OPTIONAL(tasklist_field_names, tasklist_req.fields, keys);
+  tasklist_req.tasklist_key = API_MATCH(1);
+  API_RESOLVE_ACCESS(tasklists_worker, tasklist_req);
+  API_RETURN_IF_NOT_MODIFIED(tasklists_worker, tasklist_req);
+  if (Counted(tasklists_worker->Query(tasklist_req, tasklist_content)) !=
       returnCode::SUCCESS) {
     API_RETURN_HTTP_RESP(500, "msg", "failed get task list info");
   }
-  data = {{"name", std::move(tasklist_content.name)},
-          {"content", std::move(tasklist_content.content)},
-          {"visibility", std::move(tasklist_content.visibility)}};
+  data = ProjectFields(TasklistToJson(tasklist_content), keys);
   API_RETURN_HTTP_RESP(200, "msg", "success", "data", std::move(data));
 }
 
+API_DEFINE_HTTP_HANDLER(TaskListsEvents) {
+  std::string token;
+  RequestData tasklist_req;
+  int64_t version = 0;
+
+  API_CHECK_REQUEST_TOKEN(tasklist_req.user_key, token);
+  API_GET_PARAM_OPTIONAL(tasklist_req.other_user_key, other);
+  tasklist_req.tasklist_key = API_MATCH(1);
+
+  /* Version checks that the user may read the task list, cheaper than Query */
+  if (Counted(tasklists_worker->Version(tasklist_req, version)) !=
+      returnCode::SUCCESS) {
+    API_RETURN_HTTP_RESP(500, "msg", "failed get task list info");
+  }
+  auto subscriber = change_hub->Subscribe(tasklist_req.other_user_key.empty()
+                                              ? tasklist_req.user_key
+                                              : tasklist_req.other_user_key,
+                                          tasklist_req.tasklist_key,
+                                          tasklist_req.user_key);
+  if (!subscriber) {
+    API_RETURN_HTTP_RESP(503, "msg", "failed too many change streams");
+  }
+  /* The stream is written on this thread until the client leaves, give its
+     worker slot back to the pool so that streams never starve requests */
+  WorkStealingQueue::Detach();
+
+  /* Changes after this version will be streamed */
+  API_RES().status = 200;
+  API_RES().set_header(etag_key, "W/\"" + std::to_string(version) + "\"");
+  API_RES().set_header(cache_control_key, cache_control_no_cache);
+  API_RES().set_header(cors_origin_key, cors_origin_val);
+  API_RES().set_header(cors_methods_key, cors_methods_val);
+  API_RES().set_header(cors_headers_key, cors_headers_val);
+  std::shared_ptr<ChangeHub> hub = change_hub;
+  API_RES().set_chunked_content_provider(
+      content_type_event_stream,
+      [subscriber](size_t offset, httplib::DataSink &sink) {
+        return WriteChangeStream(*subscriber, offset, sink);
+      },
+      [hub, subscriber](bool) { hub->Unsubscribe(subscriber); });
+}
+
 API_DEFINE_HTTP_HANDLER(TaskListsUpdate) {
   std::string token;
   RequestData tasklist_req;
@@ -404,7 +1126,7 @@ API_DEFINE_HTTP_HANDLER(TaskListsUpdate) {
 
   API_CHECK_REQUEST_TOKEN(tasklist_req.user_key, token);
 
-  tasklist_req.tasklist_key = API_REQ().matches[1];
+  tasklist_req.tasklist_key = API_MATCH(1);
   json_body = API_PARSE_REQ_BODY(true);
 
   API_GET_JSON_OPTIONAL(json_body, optional_name, name);
@@ -417,7 +1139,7 @@ API_DEFINE_HTTP_HANDLER(TaskListsUpdate) {
   API_GET_JSON_OPTIONAL(json_body, tasklist_content.content, content);
   API_GET_JSON_OPTIONAL(json_body, tasklist_content.visibility, visibility);
 
-  if (tasklists_worker->Revise(tasklist_req, tasklist_content) !=
+  if (Counted(tasklists_worker->Revise(tasklist_req, tasklist_content)) !=
       returnCode::SUCCESS) {
     API_RETURN_HTTP_RESP(500, "msg", "failed update tasklist");
   }
@@ -431,9 +1153,9 @@ API_DEFINE_HTTP_HANDLER(TaskListsDelete) {
 
   API_CHECK_REQUEST_TOKEN(tasklist_req.user_key, token);
 
-  tasklist_req.tasklist_key = API_REQ().matches[1];
+  tasklist_req.tasklist_key = API_MATCH(1);
 
-  if (tasklists_worker->Delete(tasklist_req) != returnCode::SUCCESS) {
+  if (Counted(tasklists_worker->Delete(tasklist_req)) != returnCode::SUCCESS) {
     API_RETURN_HTTP_RESP(500, "msg", "failed delete tasklist");
   }
 
@@ -456,8 +1178,9 @@ API_DEFINE_HTTP_HANDLER(TaskListsCreate) {
   API_GET_JSON_OPTIONAL(json_body, tasklist_content.content, content);
   API_GET_JSON_OPTIONAL(json_body, tasklist_content.visibility, visibility);
 
-  if (tasklists_worker->Create(tasklist_req, tasklist_content,
-                               out_tasklist_name) != returnCode::SUCCESS) {
+  if (Counted(tasklists_worker->Create(
+          tasklist_req, tasklist_content, out_tasklist_name)) !=
+      returnCode::SUCCESS) {
     API_RETURN_HTTP_RESP(500, "msg", "failed create tasklist");
   }
 
@@ -467,15 +1190,34 @@ API_DEFINE_HTTP_HANDLER(TaskListsCreate) {
 API_DEFINE_HTTP_HANDLER(TasksAll) {
   std::string token;
   RequestData task_req;
+  std::vector<std::string> keys;
   std::vector<std::string> out_names;
+  std::vector<TaskContent> out_tasks;
 
   API_CHECK_REQUEST_TOKEN(task_req.user_key, token);
   API_GET_PARAM_OPTIONAL(task_req.other_user_key, other);
+  API_GET_FIELDS_OPTIONAL(task_field_names, task_req.fields, keys);
 
-  task_req.tasklist_key = API_REQ().matches[1];
+  task_req.tasklist_key = API_MATCH(1);
+  API_RESOLVE_ACCESS(tasks_worker, task_req);
+  API_RETURN_IF_NOT_MODIFIED(tasks_worker, task_req);
+
+  if (!keys.empty()) {
+    /* Get the requested fields of all tasks. */
+    if (Counted(tasks_worker->GetAllTasks(task_req, out_tasks)) !=
+        returnCode::SUCCESS) {
+      API_RETURN_HTTP_RESP(500, "msg", "failed get all tasks");
+    }
+    nlohmann::json data = nlohmann::json::array();
+    std::transform(out_tasks.begin(), out_tasks.end(), std::back_inserter(data),
+                   [&keys](TaskContent &task) {
+                     return ProjectFields(TaskToJson(task), keys);
+                   });
+    API_RETURN_HTTP_RESP(200, "msg", "success", "data", std::move(data));
+  }
 
   /* Get all tasks. */
-  if (tasks_worker->GetAllTasksName(task_req, out_names) !=
+  if (Counted(tasks_worker->GetAllTasksName(task_req, out_names)) !=
       returnCode::SUCCESS) {
     API_RETURN_HTTP_RESP(500, "msg", "failed get all tasks name");
   }
@@ -489,29 +1231,29 @@ API_DEFINE_HTTP_HANDLER(TasksGet) {
   std::string token;
   RequestData task_req;
   TaskContent task_content;
+  std::vector<std::string> keys;
   nlohmann::json data;
 
   API_CHECK_REQUEST_TOKEN(task_req.user_key, token);
   API_GET_PARAM_OPTIONAL(task_req.other_user_key, other);
+  API_GET_FIELDS_OPTIONAL(task_field_names, task_req.fields, keys);
 
-  task_req.tasklist_key = API_REQ().matches[1];
-  task_req.task_key = API_REQ().matches[2];
+  task_req.tasklist_key = API_MATCH(1);
+  task_req.task_key = API_MATCH(2);
 
   if (task_req.tasklist_key.empty()) {
     API_RETURN_HTTP_RESP(400, "msg", "failed need tasklist name");
   }
 
+  API_RESOLVE_ACCESS(tasks_worker, task_req);
+
   /* Get one certain task. */
-  if (tasks_worker->Query(task_req, task_content) != returnCode::SUCCESS) {
+  API_RETURN_IF_NOT_MODIFIED(tasks_worker, task_req);
+  if (Counted(tasks_worker->Query(task_req, task_content)) !=
+      returnCode::SUCCESS) {
     API_RETURN_HTTP_RESP(500, "msg", "failed get task info");
   }
-  data = {{"name", std::move(task_content.name)},
-          {"content", std::move(task_content.content)},
-          {"date", std::move(task_content.date)},
-          {"start_date", std::move(task_content.startDate)},
-          {"end_date", std::move(task_content.endDate)},
-          {"priority", task_content.priority},
-          {"status", std::move(task_content.status)}};
+  data = ProjectFields(TaskToJson(task_content), keys);
   API_RETURN_HTTP_RESP(200, "msg", "success", "data", std::move(data));
 }
 
@@ -519,34 +1261,31 @@ API_DEFINE_HTTP_HANDLER(TasksUpdate) {
   std::string token;
   RequestData task_req;
   TaskContent task_content;
-  nlohmann::json json_body;
-  std::string optional_name;
+  std::string err_field;
 
   API_CHECK_REQUEST_TOKEN(task_req.user_key, token);
   API_GET_PARAM_OPTIONAL(task_req.other_user_key, other);
 
-  task_req.task_key = API_REQ().matches[2];
-  task_req.tasklist_key = API_REQ().matches[1];
+  task_req.task_key = API_MATCH(2);
+  task_req.tasklist_key = API_MATCH(1);
 
   if (task_req.tasklist_key.empty()) {
     API_RETURN_HTTP_RESP(400, "msg", "failed need tasklist name");
   }
 
-  json_body = API_PARSE_REQ_BODY(true);
-  API_GET_JSON_OPTIONAL(json_body, optional_name, name);
+  API_PARSE_REQ_BODY_AS(BodyParser::ParseTask(API_REQ().body, &task_content,
+                                               false, &err_field),
+                        err_field);
 
-  if (!optional_name.empty() && optional_name != task_req.task_key) {
+  if (!task_content.name.empty() && task_content.name != task_req.task_key) {
     API_RETURN_HTTP_RESP(400, "msg", "failed task name can not be changed");
   }
+  /* The name only identifies the task, it is not revised */
+  task_content.name.clear();
 
-  API_GET_JSON_OPTIONAL(json_body, task_content.content, content);
-  API_GET_JSON_OPTIONAL(json_body, task_content.date, date);
-  API_GET_JSON_OPTIONAL(json_body, task_content.startDate, start_date);
-  API_GET_JSON_OPTIONAL(json_body, task_content.endDate, end_date);
-  API_GET_JSON_OPTIONAL(json_body, task_content.priority, priority);
-  API_GET_JSON_OPTIONAL(json_body, task_content.status, status);
-
-  if (tasks_worker->Revise(task_req, task_content) != returnCode::SUCCESS) {
+  API_RESOLVE_ACCESS(tasks_worker, task_req);
+  if (Counted(tasks_worker->Revise(task_req, task_content)) !=
+      returnCode::SUCCESS) {
     API_RETURN_HTTP_RESP(500, "msg", "failed update task");
   }
 
@@ -560,14 +1299,15 @@ API_DEFINE_HTTP_HANDLER(TasksDelete) {
   API_CHECK_REQUEST_TOKEN(task_req.user_key, token);
   API_GET_PARAM_OPTIONAL(task_req.other_user_key, other);
 
-  task_req.task_key = API_REQ().matches[2];
-  task_req.tasklist_key = API_REQ().matches[1];
+  task_req.task_key = API_MATCH(2);
+  task_req.tasklist_key = API_MATCH(1);
 
   if (task_req.tasklist_key.empty()) {
     API_RETURN_HTTP_RESP(400, "msg", "failed need tasklist name");
   }
 
-  if (tasks_worker->Delete(task_req) != returnCode::SUCCESS) {
+  API_RESOLVE_ACCESS(tasks_worker, task_req);
+  if (Counted(tasks_worker->Delete(task_req)) != returnCode::SUCCESS) {
     API_RETURN_HTTP_RESP(500, "msg", "failed delete task");
   }
 
@@ -579,24 +1319,19 @@ API_DEFINE_HTTP_HANDLER(TasksCreate) {
   std::string out_task_name;
   RequestData task_req;
   TaskContent task_content;
-  nlohmann::json json_body;
+  std::string err_field;
 
   API_CHECK_REQUEST_TOKEN(task_req.user_key, token);
   API_GET_PARAM_OPTIONAL(task_req.other_user_key, other);
 
-  task_req.tasklist_key = API_REQ().matches[1];
-  json_body = API_PARSE_REQ_BODY(true);
-
-  API_GET_JSON_REQUIRED(json_body, task_req.task_key, name);
-  API_GET_JSON_REQUIRED(json_body, task_content.name, name);
-  API_GET_JSON_OPTIONAL(json_body, task_content.content, content);
-  API_GET_JSON_OPTIONAL(json_body, task_content.date, date);
-  API_GET_JSON_OPTIONAL(json_body, task_content.startDate, start_date);
-  API_GET_JSON_OPTIONAL(json_body, task_content.endDate, end_date);
-  API_GET_JSON_OPTIONAL(json_body, task_content.priority, priority);
-  API_GET_JSON_OPTIONAL(json_body, task_content.status, status);
+  task_req.tasklist_key = API_MATCH(1);
+  API_PARSE_REQ_BODY_AS(BodyParser::ParseTask(API_REQ().body, &task_content,
+                                               true, &err_field),
+                        err_field);
+  task_req.task_key = task_content.name;
 
-  if (tasks_worker->Create(task_req, task_content, out_task_name) !=
+  API_RESOLVE_ACCESS(tasks_worker, task_req);
+  if (Counted(tasks_worker->Create(task_req, task_content, out_task_name)) !=
       returnCode::SUCCESS) {
     API_RETURN_HTTP_RESP(500, "msg", "failed create task");
   }
@@ -604,6 +1339,229 @@ API_DEFINE_HTTP_HANDLER(TasksCreate) {
   API_RETURN_HTTP_RESP(200, "msg", "success", "name", out_task_name);
 }
 
+API_DEFINE_HTTP_HANDLER(Agenda) {
+  std::string token;
+  std::string start_date;
+  std::string end_date;
+  std::string status;
+  RequestData agenda_req;
+  std::vector<AgendaItem> out_agenda;
+  nlohmann::json data = nlohmann::json::array();
+
+  API_CHECK_REQUEST_TOKEN(agenda_req.user_key, token);
+  API_GET_PARAM_OPTIONAL(start_date, start_date);
+  API_GET_PARAM_OPTIONAL(end_date, end_date);
+  API_GET_PARAM_OPTIONAL(status, status);
+
+  /* Get tasks of all owned and shared task lists in one request. */
+  if (Counted(tasks_worker->GetAgenda(
+          agenda_req, start_date, end_date, status, out_agenda)) !=
+      returnCode::SUCCESS) {
+    API_RETURN_HTTP_RESP(500, "msg", "failed get agenda");
+  }
+  std::transform(out_agenda.begin(), out_agenda.end(), std::back_inserter(data),
+                 [](AgendaItem &item) {
+                   return nlohmann::json{
+                       {"user", std::move(item.user_name)},
+                       {"list", std::move(item.task_list_name)},
+                       {"permission", item.permission ? "write" : "read"},
+                       {"name", std::move(item.task.name)},
+                       {"content", std::move(item.task.content)},
+                       {"start_date", std::move(item.task.startDate)},
+                       {"end_date", std::move(item.task.endDate)},
+                       {"priority", item.task.priority},
+                       {"status", std::move(item.task.status)}};
+                 });
+  API_RETURN_HTTP_RESP(200, "msg", "success", "data", std::move(data));
+}
+
+API_DEFINE_HTTP_HANDLER(Sync) {
+  std::string token;
+  std::string since_param;
+  RequestData sync_req;
+  std::vector<shareInfo> out_share_info;
+  std::vector<ChangeJournal::Entry> changes;
+  std::map<std::string, std::set<std::string>> shared_lists;
+  uint64_t since = 0;
+  nlohmann::json shared = nlohmann::json::array();
+  nlohmann::json data = nlohmann::json::array();
+
+  API_CHECK_REQUEST_TOKEN(sync_req.user_key, token);
+  API_GET_PARAM_OPTIONAL(since_param, since);
+  if (!ParseCursor(since_param, &since)) {
+    API_RETURN_HTTP_RESP(400, "msg", "failed invalid since");
+  }
+
+  /* Taken first, so that no change made during the sync is skipped next time */
+  const uint64_t cursor = change_journal->Cursor();
+  if (Counted(tasklists_worker->GetAllAccessTaskList(
+          sync_req, out_share_info)) != returnCode::SUCCESS) {
+    API_RETURN_HTTP_RESP(500, "msg", "failed get shared task lists");
+  }
+  for (auto &info : out_share_info) {
+    shared_lists[info.user_name].insert(info.task_list_name);
+    shared.push_back({{"user", info.user_name},
+                      {"permission", info.permission ? "write" : "read"},
+                      {"list", info.task_list_name}});
+  }
+
+  /* Own lists, then the lists each owner shares with the user */
+  bool complete =
+      change_journal->Read(sync_req.user_key, nullptr, since, &changes);
+  for (auto it = shared_lists.begin(); complete && it != shared_lists.end();
+       it++) {
+    complete = change_journal->Read(it->first, &it->second, since, &changes);
+  }
+  if (!complete) {
+    /* The client has to reload everything, then sync from the cursor */
+    API_RETURN_HTTP_RESP(200, "msg", "success", "cursor", cursor, "reset", true,
+                         "shared", std::move(shared));
+  }
+
+  std::sort(changes.begin(), changes.end(),
+            [](const ChangeJournal::Entry &a, const ChangeJournal::Entry &b) {
+              return a.seq < b.seq;
+            });
+  for (auto &change : changes) {
+    if (change.seq > cursor) {
+      break;
+    }
+    nlohmann::json item = {{"seq", change.seq},
+                           {"event", ChangeEvent::Name(change.event.type)},
+                           {"user", std::move(change.event.owner)},
+                           {"list", std::move(change.event.tasklist)},
+                           {"by", std::move(change.event.user)}};
+    if (!change.event.task.empty()) {
+      item["task"] = std::move(change.event.task);
+    }
+    data.push_back(std::move(item));
+  }
+  API_RETURN_HTTP_RESP(200, "msg", "success", "cursor", cursor, "reset", false,
+                       "shared", std::move(shared), "data", std::move(data));
+}
+
+API_DEFINE_HTTP_HANDLER(GroupsAll) {
+  std::string token;
+  RequestData group_req;
+  std::vector<GroupContent> out_groups;
+  nlohmann::json data = nlohmann::json::array();
+
+  API_CHECK_REQUEST_TOKEN(group_req.user_key, token);
+
+  /* Get all groups the user is a member of */
+  if (Counted(groups_worker->GetAllGroups(group_req, out_groups)) !=
+      returnCode::SUCCESS) {
+    API_RETURN_HTTP_RESP(500, "msg", "failed get all groups");
+  }
+  std::transform(out_groups.begin(), out_groups.end(), std::back_inserter(data),
+                 [](GroupContent &group) {
+                   return nlohmann::json{{"name", std::move(group.name)},
+                                         {"owner", std::move(group.owner)}};
+                 });
+  API_RETURN_HTTP_RESP(200, "msg", "success", "data", std::move(data));
+}
+
+API_DEFINE_HTTP_HANDLER(GroupsGet) {
+  std::string token;
+  RequestData group_req;
+  GroupContent group_content;
+  nlohmann::json data;
+
+  API_CHECK_REQUEST_TOKEN(group_req.user_key, token);
+
+  group_req.group_key = API_MATCH(1);
+  API_GET_PARAM_OPTIONAL(group_req.other_user_key, owner);
+  if (Counted(groups_worker->Query(group_req, group_content)) !=
+      returnCode::SUCCESS) {
+    API_RETURN_HTTP_RESP(500, "msg", "failed get group info");
+  }
+  data = {{"name", std::move(group_content.name)},
+          {"owner", std::move(group_content.owner)},
+          {"members", std::move(group_content.members)}};
+  API_RETURN_HTTP_RESP(200, "msg", "success", "data", std::move(data));
+}
+
+API_DEFINE_HTTP_HANDLER(GroupsCreate) {
+  std::string token;
+  RequestData group_req;
+  nlohmann::json json_body;
+
+  API_CHECK_REQUEST_TOKEN(group_req.user_key, token);
+
+  json_body = API_PARSE_REQ_BODY(true);
+  API_GET_JSON_REQUIRED(json_body, group_req.group_key, name);
+
+  returnCode ret = Counted(groups_worker->Create(group_req));
+  if (ret == returnCode::ERR_DUP_NODE) {
+    API_RETURN_HTTP_RESP(400, "msg", "failed duplicated group name");
+  } else if (ret != returnCode::SUCCESS) {
+    API_RETURN_HTTP_RESP(500, "msg", "failed create group");
+  }
+
+  API_RETURN_HTTP_RESP(200, "msg", "success", "name", group_req.group_key);
+}
+
+API_DEFINE_HTTP_HANDLER(GroupsDelete) {
+  std::string token;
+  RequestData group_req;
+
+  API_CHECK_REQUEST_TOKEN(group_req.user_key, token);
+
+  group_req.group_key = API_MATCH(1);
+  if (Counted(groups_worker->Delete(group_req)) != returnCode::SUCCESS) {
+    API_RETURN_HTTP_RESP(500, "msg", "failed delete group");
+  }
+
+  API_RETURN_HTTP_RESP(200, "msg", "success");
+}
+
+API_DEFINE_HTTP_HANDLER(GroupsAddMembers) {
+  std::string token;
+  std::string err_user;
+  RequestData group_req;
+  std::vector<std::string> user_list;
+  std::string err_field;
+
+  API_CHECK_REQUEST_TOKEN(group_req.user_key, token);
+
+  group_req.group_key = API_MATCH(1);
+  API_PARSE_REQ_BODY_AS(
+      BodyParser::ParseNameLists(API_REQ().body,
+                                 {{"user_list", &user_list, true}}, &err_field),
+      err_field);
+
+  if (Counted(groups_worker->AddMembers(group_req, user_list, err_user)) !=
+      returnCode::SUCCESS) {
+    API_RETURN_HTTP_RESP(500, "msg",
+                         err_user.empty() ? "failed add members"
+                                          : "failed no such user " + err_user);
+  }
+
+  API_RETURN_HTTP_RESP(200, "msg", "success");
+}
+
+API_DEFINE_HTTP_HANDLER(GroupsRemoveMembers) {
+  std::string token;
+  RequestData group_req;
+  std::vector<std::string> user_list;
+  std::string err_field;
+
+  API_CHECK_REQUEST_TOKEN(group_req.user_key, token);
+
+  group_req.group_key = API_MATCH(1);
+  API_PARSE_REQ_BODY_AS(
+      BodyParser::ParseNameLists(API_REQ().body,
+                                 {{"user_list", &user_list, true}}, &err_field),
+      err_field);
+
+  if (Counted(groups_worker->RemoveMembers(group_req, user_list)) !=
+      returnCode::SUCCESS) {
+    API_RETURN_HTTP_RESP(500, "msg", "failed remove members");
+  }
+
+  API_RETURN_HTTP_RESP(200, "msg", "success");
+}
+
 API_DEFINE_HTTP_HANDLER(ShareGet) {
   std::string token;
   RequestData share_info_req;
@@ -612,10 +1570,10 @@ API_DEFINE_HTTP_HANDLER(ShareGet) {
   nlohmann::json data;
 
   API_CHECK_REQUEST_TOKEN(share_info_req.user_key, share_info_req.tasklist_key);
-  share_info_req.tasklist_key = API_REQ().matches[1];
+  share_info_req.tasklist_key = API_MATCH(1);
 
-  if (tasklists_worker->GetAllGrantTaskList(share_info_req, share_info,
-                                            is_public) != returnCode::SUCCESS) {
+  if (Counted(tasklists_worker->GetAllGrantTaskList(
+          share_info_req, share_info, is_public)) != returnCode::SUCCESS) {
     API_RETURN_HTTP_RESP(500, "msg", "failed get share info");
   }
 
@@ -626,7 +1584,8 @@ API_DEFINE_HTTP_HANDLER(ShareGet) {
   std::transform(share_info.begin(), share_info.end(), std::back_inserter(data),
                  [](shareInfo &info) {
                    return nlohmann::json{
-                       {"user", std::move(info.user_name)},
+                       {info.is_group ? "group" : "user",
+                        std::move(info.user_name)},
                        {"permission", info.permission ? "write" : "read"}};
                  });
 
@@ -638,34 +1597,22 @@ API_DEFINE_HTTP_HANDLER(ShareCreate) {
   RequestData share_create_req;
   std::vector<shareInfo> share_info;
   std::string err_user;
-  nlohmann::json json_body;
-  nlohmann::json user_permission;
+  std::string err_field;
 
   API_CHECK_REQUEST_TOKEN(share_create_req.user_key, token);
-  json_body = API_PARSE_REQ_BODY(true);
-  share_create_req.tasklist_key = API_REQ().matches[1];
-
-  API_GET_JSON_REQUIRED(json_body, user_permission, user_permission);
+  share_create_req.tasklist_key = API_MATCH(1);
 
-  if (!user_permission.is_array()) {
-    API_RETURN_HTTP_RESP(400, "msg", "failed user_permission must be array");
-  }
-
-  /* Do not want to use for-loop, but API_GET_JSON_REQUIRED can not be used in
-   * lambda. * Bad Bad C++. */
-  for (auto &json_entry : user_permission) {
-    share_info.emplace_back();
-    share_info.back().task_list_name = API_REQ().matches[1];
-    API_GET_JSON_REQUIRED(json_entry, share_info.back().user_name, user);
-    API_GET_JSON_REQUIRED(json_entry, share_info.back().permission, permission);
-  }
+  API_PARSE_REQ_BODY_AS(BodyParser::ParseShares(API_REQ().body,
+                                                 share_create_req.tasklist_key,
+                                                 &share_info, &err_field),
+                        err_field);
 
-  if (tasklists_worker->ReviseGrantTaskList(share_create_req, share_info,
-                                            err_user) != returnCode::SUCCESS) {
+  if (Counted(tasklists_worker->ReviseGrantTaskList(
+          share_create_req, share_info, err_user)) != returnCode::SUCCESS) {
     API_RETURN_HTTP_RESP(500, "msg",
                          err_user.empty()
                              ? "falied all users"
-                             : "failed last updated user is " + err_user);
+                             : "failed no such user or group " + err_user);
   }
 
   API_RETURN_HTTP_RESP(200, "msg", "success");
@@ -676,37 +1623,55 @@ API_DEFINE_HTTP_HANDLER(ShareDelete) {
   RequestData share_delete_req;
   std::string err_user;
   std::vector<std::string> user_str_list;
-  nlohmann::json json_body;
-  nlohmann::json user_json_list;
+  std::vector<std::string> group_str_list;
+  std::string err_field;
 
   API_CHECK_REQUEST_TOKEN(share_delete_req.user_key, token);
 
-  share_delete_req.tasklist_key = API_REQ().matches[1];
-  json_body = API_PARSE_REQ_BODY(false);
-  API_GET_JSON_OPTIONAL(json_body, user_json_list, user_list);
-  API_GET_PARAM_OPTIONAL(share_delete_req.other_user_key, other);
-
-  if (!user_json_list.empty()) {
-    std::transform(user_json_list.cbegin(), user_json_list.cend(),
-                   std::back_inserter(user_str_list),
-                   [](auto &&x) { return x; });
+  share_delete_req.tasklist_key = API_MATCH(1);
+  /* The body is optional, but one that does not parse fails the request: the
+     grants it names must not be taken for none */
+  if (!API_REQ().body.empty()) {
+    if (API_REQ().body.size() > BodyParser::kMaxBodySize) {
+      API_RETURN_HTTP_RESP(413, "msg", "failed request body too large");
+    }
+    if (BodyParser::ParseNameLists(API_REQ().body,
+                                   {{"user_list", &user_str_list, false},
+                                    {"group_list", &group_str_list, false}},
+                                   &err_field) != returnCode::SUCCESS) {
+      API_RETURN_HTTP_RESP(400, "msg",
+                           err_field.empty()
+                               ? "failed request body format error"
+                               : "failed invalid field " + err_field);
+    }
   }
+  API_GET_PARAM_OPTIONAL(share_delete_req.other_user_key, other);
 
   if (!share_delete_req.other_user_key.empty()) {
-    if (tasklists_worker->RemoveGrantTaskList(share_delete_req) !=
+    if (Counted(tasklists_worker->RemoveGrantTaskList(share_delete_req)) !=
         returnCode::SUCCESS) {
       API_RETURN_HTTP_RESP(500, "msg", "failed delete sharing");
     }
   } else {
-    if (tasklists_worker->RemoveGrantTaskList(
-            share_delete_req, user_str_list, err_user) != returnCode::SUCCESS) {
+    if (Counted(tasklists_worker->RemoveGrantTaskList(
+            share_delete_req, user_str_list, err_user)) !=
+        returnCode::SUCCESS) {
       API_RETURN_HTTP_RESP(500, "msg",
                            err_user.empty()
                                ? "failed all users"
-                               : "failed last deleted user is " + err_user);
+                               : "failed no such user " + err_user);
     }
   }
 
+  if (!group_str_list.empty() &&
+      Counted(tasklists_worker->RemoveGroupGrantTaskList(
+              share_delete_req, group_str_list, err_user)) !=
+          returnCode::SUCCESS) {
+    API_RETURN_HTTP_RESP(500, "msg",
+                         err_user.empty() ? "failed all groups"
+                                          : "failed no such group " + err_user);
+  }
+
   API_RETURN_HTTP_RESP(200, "msg", "success");
 }
 
@@ -722,7 +1687,8 @@ API_DEFINE_HTTP_HANDLER(PublicGet) {
   API_CHECK_REQUEST_TOKEN(tasklist_req.user_key, token);
 
   /* Get all public task lists */
-  if (tasklists_worker->GetAllPublicTaskList(out_list) != returnCode::SUCCESS) {
+  if (Counted(tasklists_worker->GetAllPublicTaskList(out_list)) !=
+      returnCode::SUCCESS) {
     API_RETURN_HTTP_RESP(500, "msg", "failed get public task lists");
   }
   std::transform(out_list.begin(), out_list.end(), std::back_inserter(data),
@@ -730,12 +1696,17 @@ API_DEFINE_HTTP_HANDLER(PublicGet) {
                    return nlohmann::json{{"user", std::move(relation.first)},
                                          {"list", std::move(relation.second)}};
                  });
-  API_RETURN_HTTP_RESP(200, "msg", "success", "data", std::move(data));
+  API_RETURN_CACHED_HTTP_RESP(200, "msg", "success", "data", std::move(data));
+}
+
+API_DEFINE_HTTP_HANDLER(MetricsGet) {
+  API_RES().status = 200;
+  API_RES().set_content(metrics.Render(), content_type_metrics);
 }
 
 API_DEFINE_HTTP_HANDLER(Health) {
   try {
-    std::string numbers = API_REQ().matches[1];
+    std::string numbers = API_MATCH(1);
     API_RETURN_HTTP_RESP(200, "msg", "success", "data", numbers);
   } catch (...) {
     API_RETURN_HTTP_RESP(200, "msg", "success");
@@ -743,48 +1714,135 @@ API_DEFINE_HTTP_HANDLER(Health) {
 }
 
 void Api::Run(const std::string &host, uint32_t port) {
-  API_ADD_HTTP_HANDLER(svr, "/v1/users/register", Post, UsersRegister);
-  API_ADD_HTTP_HANDLER(svr, "/v1/users/login", Post, UsersLogin);
-  API_ADD_HTTP_HANDLER(svr, "/v1/users/logout", Post, UsersLogout);
-  API_ADD_HTTP_HANDLER(svr, "/v1/task_lists", Get, TaskListsAll);
-  API_ADD_HTTP_HANDLER(svr, R"(/v1/task_lists/([^\/]+))", Get, TaskListsGet);
-  API_ADD_HTTP_HANDLER(svr, "/v1/task_lists/create", Post, TaskListsCreate);
-  API_ADD_HTTP_HANDLER(svr, R"(/v1/task_lists/([^\/]+))", Put, TaskListsUpdate);
-  API_ADD_HTTP_HANDLER(svr, R"(/v1/task_lists/([^\/]+))", Delete,
+  API_ADD_HTTP_HANDLER(router, "/v1/users/register", POST, UsersRegister);
+  API_ADD_HTTP_HANDLER(router, "/v1/users/login", POST, UsersLogin);
+  API_ADD_HTTP_HANDLER(router, "/v1/users/logout", POST, UsersLogout);
+  API_ADD_HTTP_HANDLER(router, "/v1/task_lists", GET, TaskListsAll);
+  API_ADD_HTTP_HANDLER(router, "/v1/task_lists/{list}", GET, TaskListsGet);
+  API_ADD_HTTP_HANDLER(router, "/v1/task_lists/create", POST, TaskListsCreate);
+  API_ADD_HTTP_HANDLER(router, "/v1/task_lists/{list}", PUT, TaskListsUpdate);
+  API_ADD_HTTP_HANDLER(router, "/v1/task_lists/{list}", DELETE,
                        TaskListsDelete);
-  API_ADD_HTTP_HANDLER(svr, R"(/v1/task_lists/([^\/]+)/tasks)", Get, TasksAll);
-  API_ADD_HTTP_HANDLER(svr, R"(/v1/task_lists/([^\/]+)/tasks/([^\/]+))", Get,
+  API_ADD_HTTP_HANDLER(router, "/v1/task_lists/{list}/events", GET,
+                       TaskListsEvents);
+  API_ADD_HTTP_HANDLER(router, "/v1/task_lists/{list}/tasks", GET, TasksAll);
+  API_ADD_HTTP_HANDLER(router, "/v1/task_lists/{list}/tasks/{task}", GET,
                        TasksGet);
-  API_ADD_HTTP_HANDLER(svr, R"(/v1/task_lists/([^\/]+)/tasks/create)", Post,
+  API_ADD_HTTP_HANDLER(router, "/v1/task_lists/{list}/tasks/create", POST,
                        TasksCreate);
-  API_ADD_HTTP_HANDLER(svr, R"(/v1/task_lists/([^\/]+)/tasks/([^\/]+))", Put,
+  API_ADD_HTTP_HANDLER(router, "/v1/task_lists/{list}/tasks/{task}", PUT,
                        TasksUpdate);
-  API_ADD_HTTP_HANDLER(svr, R"(/v1/task_lists/([^\/]+)/tasks/([^\/]+))", Delete,
+  API_ADD_HTTP_HANDLER(router, "/v1/task_lists/{list}/tasks/{task}", DELETE,
                        TasksDelete);
-  API_ADD_HTTP_HANDLER(svr, R"(/v1/share/([^\/]+))", Get, ShareGet);
-  API_ADD_HTTP_HANDLER(svr, R"(/v1/share/([^\/]+))", Post, ShareCreate);
-  API_ADD_HTTP_HANDLER(svr, R"(/v1/share/([^\/]+))", Delete, ShareDelete);
-  API_ADD_HTTP_HANDLER(svr, "/v1/public/all", Get, PublicGet);
-  API_ADD_HTTP_HANDLER(svr, R"(/health/(\d+))", Get, Health);
-
-  API_ADD_HTTP_OPTIONS_HANDLER(svr, R"(/.*)");
+  API_ADD_HTTP_HANDLER(router, "/v1/agenda", GET, Agenda);
+  API_ADD_HTTP_HANDLER(router, "/v1/sync", GET, Sync);
+  API_ADD_HTTP_HANDLER(router, "/v1/groups", GET, GroupsAll);
+  API_ADD_HTTP_HANDLER(router, "/v1/groups/create", POST, GroupsCreate);
+  API_ADD_HTTP_HANDLER(router, "/v1/groups/{group}", GET, GroupsGet);
+  API_ADD_HTTP_HANDLER(router, "/v1/groups/{group}", DELETE, GroupsDelete);
+  API_ADD_HTTP_HANDLER(router, "/v1/groups/{group}/members", POST,
+                       GroupsAddMembers);
+  API_ADD_HTTP_HANDLER(router, "/v1/groups/{group}/members", DELETE,
+                       GroupsRemoveMembers);
+  API_ADD_HTTP_HANDLER(router, "/v1/share/{list}", GET, ShareGet);
+  API_ADD_HTTP_HANDLER(router, "/v1/share/{list}", POST, ShareCreate);
+  API_ADD_HTTP_HANDLER(router, "/v1/share/{list}", DELETE, ShareDelete);
+  API_ADD_HTTP_HANDLER(router, "/v1/public/all", GET, PublicGet);
+  API_ADD_HTTP_HANDLER(router, "/health/{n:int}", GET, Health);
+  API_ADD_HTTP_HANDLER(router, "/metrics", GET, MetricsGet);
+
+  API_ADD_HTTP_OPTIONS_HANDLER(router);
+  const std::pair<const char *, std::shared_ptr<RateLimiter>> limiters[] = {
+      {"read", read_limiter},
+      {"write", write_limiter},
+      {"anonymous", anonymous_limiter}};
+  for (auto &it : limiters) {
+    std::shared_ptr<RateLimiter> limiter = it.second;
+    if (limiter) {
+      metrics.AddCallback(
+          "lqxx_rate_limit_buckets", "Buckets kept by the rate limiters.",
+          false, [limiter]() { return limiter->Size(); },
+          {{"class", it.first}});
+    }
+  }
+  if (print && !access_log) {
+    access_log = std::make_shared<AccessLog>();
+  }
+  if (access_log) {
+    std::shared_ptr<AccessLog> log = access_log;
+    metrics.AddCallback("lqxx_access_log_dropped_total",
+                        "Access log entries dropped, the writer was behind.",
+                        true, [log]() { return log->Dropped(); });
+    router.SetRequestHook(BeginAccess);
+    svr->set_logger(
+        [log](const httplib::Request &req, const httplib::Response &res) {
+          LogAccess(*log, req, res);
+        });
+  }
+  router.Install(*svr);
+  size_t threads = n_threads ? n_threads : CPPHTTPLIB_THREAD_POOL_COUNT;
+  if (concurrency_limiter) {
+    std::shared_ptr<const ConcurrencyLimiter> limiter = concurrency_limiter;
+    concurrency_limiter->SetMaxLimit(threads);
+    metrics.AddCallback("lqxx_concurrency_limit",
+                        "Requests admitted at once, adapted to the DB latency.",
+                        false, [limiter]() { return limiter->Limit(); });
+    metrics.AddCallback("lqxx_concurrency_in_flight",
+                        "Requests admitted and not finished.", false,
+                        [limiter]() { return limiter->InFlight(); });
+    metrics.AddCallback("lqxx_concurrency_shed_total",
+                        "Requests refused because the limit was reached.",
+                        true, [limiter]() { return limiter->Shed(); });
+  }
+  if (bulkhead) {
+    std::shared_ptr<const Bulkhead> lanes = bulkhead;
+    bulkhead->SetThreads(threads);
+    for (size_t i = 0; i < Bulkhead::kLanes; i++) {
+      const auto lane = static_cast<Bulkhead::Lane>(i);
+      const Metrics::Labels labels = {{"lane", Bulkhead::Name(lane)}};
+      metrics.AddCallback(
+          "lqxx_lane_active", "Requests holding a slot of their lane.", false,
+          [lanes, lane]() { return lanes->Active(lane); }, labels);
+      metrics.AddCallback(
+          "lqxx_lane_queued", "Requests waiting for a slot of their lane.",
+          false, [lanes, lane]() { return lanes->Queued(lane); }, labels);
+      metrics.AddCallback(
+          "lqxx_lane_rejected_total",
+          "Requests refused because their lane was full.", true,
+          [lanes, lane]() { return lanes->Rejected(lane); }, labels);
+    }
+  }
+  svr->new_task_queue = [this, threads] {
+    return new WorkStealingQueue(threads, pin_cpus, max_queued, queue_stats);
+  };
   svr->listen(host, port);
 }
 
 void Api::Stop() {
+  /* End the change streams, or they would keep their threads until the next
+     keep-alive */
+  change_hub->Close();
   if (svr && svr->is_running()) {
     svr->stop();
   }
 }
 
 #undef API_ADD_HTTP_HANDLER
+#undef API_ADD_HTTP_OPTIONS_HANDLER
+#undef API_MATCH
 #undef API_DEFINE_HTTP_HANDLER
+#undef API_SEND_HTTP_RESP
 #undef API_RETURN_HTTP_RESP
+#undef API_RETURN_CACHED_HTTP_RESP
 #undef API_CHECK_REQUEST_TOKEN
+#undef API_CHECK_RATE_LIMIT
 #undef API_GET_JSON_REQUIRED
 #undef API_GET_JSON_OPTIONAL
 #undef API_GET_PARAM_OPTIONAL
+#undef API_RESOLVE_ACCESS
+#undef API_RETURN_IF_NOT_MODIFIED
 #undef API_PARSE_REQ_BODY
+#undef API_PARSE_REQ_BODY_AS
 #undef API_GET_OPTIONAL_FROM_REQ_HEADER
 #undef API_REQ
 #undef API_RES
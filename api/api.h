@@ -16,13 +16,28 @@
 
 #pragma once
 
+#include "api/accessLog.h"
+#include "api/bulkhead.h"
+#include "api/changeHub.h"
+#include "api/changeJournal.h"
+#include "api/compressor.h"
+#include "api/concurrencyLimiter.h"
+#include "api/metrics.h"
+#include "api/rateLimiter.h"
+#include "api/router.h"
+#include "api/taskQueue.h"
+#include "api/tokenCache.h"
+#include "api/tokenStore.h"
+#include "api/tokenVerifier.h"
+#include "groups/groupsWorker.h"
 #include "tasklists/tasklistsWorker.h"
 #include "tasks/tasksWorker.h"
 #include "users/users.h"
+#include <chrono>
 #include <httplib.h>
+#include <map>
 #include <memory>
-#include <mutex>
-#include <unordered_set>
+#include <vector>
 
 /* Declare a function that would be called to handle an http request of a
    certain route. The function name should be corresponding to the http
@@ -30,6 +45,9 @@
 #define API_DECLARE_HTTP_HANDLER(name)                                         \
   virtual void name(const httplib::Request &, httplib::Response &) noexcept
 
+/* Series of one route, defined in api.cpp */
+struct RouteMetrics;
+
 class Api {
 public:
   /**
@@ -38,12 +56,14 @@ public:
    *
    * @param _users A shared pointer of Users object.
    * @param _svr A shared pointer of httplib::Server object.
+   * @param _groups_worker A shared pointer of GroupsWorker object.
    */
   Api(std::shared_ptr<Users> _users = nullptr,
       std::shared_ptr<TaskListsWorker> _tasklists_worker = nullptr,
       std::shared_ptr<TasksWorker> _tasks_worker = nullptr,
       std::shared_ptr<DB> _db = nullptr,
-      std::shared_ptr<httplib::Server> _svr = nullptr);
+      std::shared_ptr<httplib::Server> _svr = nullptr,
+      std::shared_ptr<GroupsWorker> _groups_worker = nullptr);
 
   /**
    * @brief Destroy the API object
@@ -62,8 +82,97 @@ public:
 
   virtual void Stop();
 
+  /**
+   * @brief Log every response to stdout, unless an access log was set.
+   */
   virtual void set_print(bool _print) { print = _print; }
 
+  /**
+   * @brief Log every response to an access log, must be called before Run.
+   *
+   * @param _access_log The log, nullptr for none.
+   */
+  virtual void set_access_log(std::shared_ptr<AccessLog> _access_log) {
+    access_log = _access_log;
+  }
+
+  /**
+   * @brief Set the limiters of the request rate, must be called before Run.
+   * Each is given a key per client, and nullptr lets everything through.
+   *
+   * @param _read Limiter of the GET requests, per user.
+   * @param _write Limiter of the other requests, per user.
+   * @param _anonymous Limiter of registrations and logins, per address.
+   */
+  virtual void set_rate_limiters(std::shared_ptr<RateLimiter> _read,
+                                 std::shared_ptr<RateLimiter> _write,
+                                 std::shared_ptr<RateLimiter> _anonymous) {
+    read_limiter = _read;
+    write_limiter = _write;
+    anonymous_limiter = _anonymous;
+  }
+
+  /**
+   * @brief Set the limiter of the requests handled at once, must be called
+   * before Run. Its highest limit will be the number of worker threads.
+   *
+   * @param _limiter The limiter, nullptr to admit everything.
+   */
+  virtual void
+  set_concurrency_limiter(std::shared_ptr<ConcurrencyLimiter> _limiter) {
+    concurrency_limiter = _limiter;
+  }
+
+  /**
+   * @brief Set the lanes the worker threads are split into, must be called
+   * before Run. They will be sized for the number of worker threads.
+   *
+   * @param _bulkhead The lanes, nullptr to let every request run at once.
+   */
+  virtual void set_bulkhead(std::shared_ptr<Bulkhead> _bulkhead) {
+    bulkhead = _bulkhead;
+  }
+
+  /**
+   * @brief Set the time a request may run before its DB work is abandoned and
+   * it is answered with 504, must be called before Run. Only the /v1/ routes
+   * have a deadline.
+   *
+   * @param _deadline The deadline, 0 for none.
+   * @param route A route as it is registered, e.g. "/v1/agenda", or empty for
+   * the routes without a deadline of their own.
+   */
+  virtual void set_deadline(std::chrono::milliseconds _deadline,
+                            const std::string &route = "") {
+    if (route.empty()) {
+      deadline = _deadline;
+    } else {
+      route_deadlines[route] = _deadline;
+    }
+  }
+
+  /**
+   * @brief Configure the worker pool that handles connections, must be called
+   * before Run.
+   *
+   * @param _n_threads Number of worker threads, 0 for httplib's default.
+   * @param _pin_cpus Pin each worker thread to one CPU.
+   * @param _max_queued Max number of waiting connections, 0 for no limit.
+   */
+  virtual void set_task_queue(size_t _n_threads, bool _pin_cpus = false,
+                              size_t _max_queued = 0) {
+    n_threads = _n_threads;
+    pin_cpus = _pin_cpus;
+    max_queued = _max_queued;
+  }
+
+  /**
+   * @brief Get the counters of the worker pool, e.g. queue depth and wait time.
+   */
+  std::shared_ptr<const TaskQueueStats> task_queue_stats() const {
+    return queue_stats;
+  }
+
 protected:
   API_DECLARE_HTTP_HANDLER(UsersRegister);
 
@@ -75,6 +184,8 @@ protected:
 
   API_DECLARE_HTTP_HANDLER(TaskListsGet);
 
+  API_DECLARE_HTTP_HANDLER(TaskListsEvents);
+
   API_DECLARE_HTTP_HANDLER(TaskListsUpdate);
 
   API_DECLARE_HTTP_HANDLER(TaskListsDelete);
@@ -91,6 +202,22 @@ protected:
 
   API_DECLARE_HTTP_HANDLER(TasksCreate);
 
+  API_DECLARE_HTTP_HANDLER(Agenda);
+
+  API_DECLARE_HTTP_HANDLER(Sync);
+
+  API_DECLARE_HTTP_HANDLER(GroupsAll);
+
+  API_DECLARE_HTTP_HANDLER(GroupsGet);
+
+  API_DECLARE_HTTP_HANDLER(GroupsCreate);
+
+  API_DECLARE_HTTP_HANDLER(GroupsDelete);
+
+  API_DECLARE_HTTP_HANDLER(GroupsAddMembers);
+
+  API_DECLARE_HTTP_HANDLER(GroupsRemoveMembers);
+
   API_DECLARE_HTTP_HANDLER(ShareGet);
 
   API_DECLARE_HTTP_HANDLER(ShareCreate);
@@ -101,18 +228,49 @@ protected:
 
   API_DECLARE_HTTP_HANDLER(Health);
 
+  API_DECLARE_HTTP_HANDLER(MetricsGet);
+
 private:
+  /* Register the series of a route, kept for as long as the Api */
+  RouteMetrics *AddRouteMetrics(const char *method, const std::string &path);
+
   std::shared_ptr<Users> users;
   std::shared_ptr<TaskListsWorker> tasklists_worker;
   std::shared_ptr<TasksWorker> tasks_worker;
+  std::shared_ptr<GroupsWorker> groups_worker;
   std::shared_ptr<DB> db;
   std::shared_ptr<httplib::Server> svr;
+  Router router;
 
   const std::string token_secret_key;
-  std::unordered_set<std::string>
-      invalid_tokens; /* Not a good method, refactor it later */
-  std::mutex invalid_tokens_lock;
+  const Hs256Verifier token_verifier;
+  RevokedTokenStore revoked_tokens;
+  VerifiedTokenCache verified_tokens;
+  CompressedCache compressed_bodies;
+  std::shared_ptr<ChangeHub> change_hub = std::make_shared<ChangeHub>();
+  std::shared_ptr<ChangeJournal> change_journal =
+      std::make_shared<ChangeJournal>();
   bool print = false;
+  std::shared_ptr<AccessLog> access_log;
+  Metrics metrics;
+  std::shared_ptr<RateLimiter> read_limiter =
+      std::make_shared<RateLimiter>(50, 100);
+  std::shared_ptr<RateLimiter> write_limiter =
+      std::make_shared<RateLimiter>(20, 40);
+  std::shared_ptr<RateLimiter> anonymous_limiter =
+      std::make_shared<RateLimiter>(2, 20);
+  std::shared_ptr<ConcurrencyLimiter> concurrency_limiter =
+      std::make_shared<ConcurrencyLimiter>();
+  std::shared_ptr<Bulkhead> bulkhead = std::make_shared<Bulkhead>();
+  std::vector<std::unique_ptr<RouteMetrics>> route_metrics;
+  std::chrono::milliseconds deadline{10000};
+  std::map<std::string, std::chrono::milliseconds> route_deadlines;
+
+  size_t n_threads = 0;
+  bool pin_cpus = false;
+  size_t max_queued = 0;
+  std::shared_ptr<TaskQueueStats> queue_stats =
+      std::make_shared<TaskQueueStats>();
 };
 
 #undef API_DECLARE_HTTP_HANDLER
@@ -0,0 +1,444 @@
+#include "bodyParser.h"
+#include <cstdint>
+#include <nlohmann/json.hpp>
+
+namespace BodyParser {
+
+/* A scalar value as the SAX parser delivers it */
+struct Scalar {
+  enum Type { NUL, BOOLEAN, INTEGER, FLOAT, STRING } type;
+  bool boolean = false;
+  int64_t integer = 0;
+  std::string *string = nullptr;
+};
+
+/**
+ * @brief Base of the readers of each body shape.
+ *
+ * It counts the nesting depth, requires the body to be an object, skips the
+ * subtrees a reader does not want and enforces the limits. Readers see the
+ * keys, scalars and containers that are not skipped, with the depth they are
+ * at: 1 for the fields of the body object. Any callback returning false stops
+ * the parser at once.
+ */
+class SchemaReader : public nlohmann::json_sax<nlohmann::json> {
+public:
+  enum Action { FAIL, SKIP, ACCEPT };
+
+  bool null() override { return OnScalar({Scalar::NUL}); }
+
+  bool boolean(bool val) override {
+    Scalar scalar{Scalar::BOOLEAN};
+    scalar.boolean = val;
+    return OnScalar(scalar);
+  }
+
+  bool number_integer(number_integer_t val) override {
+    Scalar scalar{Scalar::INTEGER};
+    scalar.integer = val;
+    return OnScalar(scalar);
+  }
+
+  bool number_unsigned(number_unsigned_t val) override {
+    Scalar scalar{Scalar::INTEGER};
+    /* Only small integers are valid anywhere, keep huge ones out of range */
+    scalar.integer = val > INT64_MAX ? INT64_MAX : static_cast<int64_t>(val);
+    return OnScalar(scalar);
+  }
+
+  bool number_float(number_float_t, const string_t &) override {
+    return OnScalar({Scalar::FLOAT});
+  }
+
+  bool string(string_t &val) override {
+    if (val.size() > kMaxStringSize) {
+      return false;
+    }
+    Scalar scalar{Scalar::STRING};
+    scalar.string = &val;
+    return OnScalar(scalar);
+  }
+
+  bool binary(binary_t &) override { return false; }
+
+  bool start_object(std::size_t) override { return Open(false); }
+
+  bool end_object() override { return Close(); }
+
+  bool start_array(std::size_t) override { return Open(true); }
+
+  bool end_array() override { return Close(); }
+
+  bool key(string_t &val) override {
+    if (val.size() > kMaxStringSize) {
+      return false;
+    }
+    return skip_depth || Key(val);
+  }
+
+  bool parse_error(std::size_t, const std::string &,
+                   const nlohmann::json::exception &) override {
+    return false;
+  }
+
+  /**
+   * @brief Run the parser over a body.
+   *
+   * @return returnCode SUCCESS, or the error the reader failed with.
+   */
+  returnCode Parse(std::string_view body, std::string *err_field) {
+    if (body.size() > kMaxBodySize) {
+      return ERR_FORMAT;
+    }
+    if (!nlohmann::json::sax_parse(body.begin(), body.end(), this)) {
+      *err_field = bad_field;
+      return error;
+    }
+    return SUCCESS;
+  }
+
+protected:
+  /* A key of an object that is not skipped */
+  virtual bool Key(std::string &key) = 0;
+  /* A scalar that is not skipped */
+  virtual bool Value(Scalar &scalar) = 0;
+  /* An object or array below the body object is opened */
+  virtual Action Enter(bool is_array) = 0;
+  /* An object or array that was accepted is closed, depth is still its own */
+  virtual bool Leave() { return true; }
+
+  /* Stop the parser because of a field */
+  bool Fail(returnCode code, const char *field) {
+    error = code;
+    bad_field = field;
+    return false;
+  }
+
+  size_t depth = 0;
+
+private:
+  bool Count() { return ++values <= kMaxValues; }
+
+  bool OnScalar(Scalar scalar) {
+    if (!Count() || depth == 0) {
+      return false;
+    }
+    return skip_depth || Value(scalar);
+  }
+
+  bool Open(bool is_array) {
+    if (!Count()) {
+      return false;
+    }
+    depth++;
+    if (skip_depth) {
+      return true;
+    }
+    if (depth == 1) {
+      return !is_array;
+    }
+    switch (Enter(is_array)) {
+    case SKIP:
+      skip_depth = depth;
+      return true;
+    case ACCEPT:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  bool Close() {
+    if (skip_depth) {
+      if (skip_depth == depth) {
+        skip_depth = 0;
+      }
+      depth--;
+      return true;
+    }
+    bool ok = depth == 1 || Leave();
+    depth--;
+    return ok;
+  }
+
+  size_t values = 0;
+  /* depth of the container being skipped, 0 if none */
+  size_t skip_depth = 0;
+  returnCode error = ERR_FORMAT;
+  const char *bad_field = "";
+};
+
+/* String fields of a task body */
+static const std::pair<const char *, std::string TaskContent::*>
+    task_string_fields[] = {{"name", &TaskContent::name},
+                            {"content", &TaskContent::content},
+                            {"date", &TaskContent::date},
+                            {"start_date", &TaskContent::startDate},
+                            {"end_date", &TaskContent::endDate},
+                            {"status", &TaskContent::status}};
+
+class TaskReader : public SchemaReader {
+public:
+  explicit TaskReader(TaskContent *task) : task(task) {}
+
+  bool has_name = false;
+
+protected:
+  bool Key(std::string &key) override {
+    field = nullptr;
+    member = nullptr;
+    for (auto &string_field : task_string_fields) {
+      if (key == string_field.first) {
+        field = string_field.first;
+        member = string_field.second;
+        return true;
+      }
+    }
+    if (key == "priority") {
+      field = "priority";
+    }
+    return true;
+  }
+
+  bool Value(Scalar &scalar) override {
+    if (!field) {
+      return true;
+    }
+    if (member) {
+      if (scalar.type != Scalar::STRING) {
+        return Fail(ERR_FORMAT, field);
+      }
+      task->*member = std::move(*scalar.string);
+      has_name |= member == &TaskContent::name;
+      return true;
+    }
+    if (scalar.type != Scalar::INTEGER || scalar.integer < NULL_PRIORITY ||
+        scalar.integer > NORMAL) {
+      return Fail(ERR_FORMAT, field);
+    }
+    task->priority = static_cast<Priority>(scalar.integer);
+    return true;
+  }
+
+  Action Enter(bool) override {
+    if (!field) {
+      return SKIP;
+    }
+    Fail(ERR_FORMAT, field);
+    return FAIL;
+  }
+
+private:
+  TaskContent *task;
+  /* known key being read, nullptr for an unknown one */
+  const char *field = nullptr;
+  std::string TaskContent::*member = nullptr;
+};
+
+returnCode ParseTask(std::string_view body, TaskContent *task,
+                     bool name_required, std::string *err_field) {
+  TaskReader reader(task);
+  returnCode ret = reader.Parse(body, err_field);
+  if (ret == SUCCESS && name_required && !reader.has_name) {
+    *err_field = "name";
+    return ERR_RFIELD;
+  }
+  return ret;
+}
+
+class ShareReader : public SchemaReader {
+public:
+  ShareReader(const std::string &tasklist, std::vector<shareInfo> *shares)
+      : tasklist(tasklist), shares(shares) {}
+
+  bool has_list = false;
+
+protected:
+  enum Field { UNKNOWN, LIST, USER, GROUP, PERMISSION };
+
+  bool Key(std::string &key) override {
+    if (depth == 1) {
+      field = key == "user_permission" ? LIST : UNKNOWN;
+    } else if (key == "user") {
+      field = USER;
+    } else if (key == "group") {
+      field = GROUP;
+    } else if (key == "permission") {
+      field = PERMISSION;
+    } else {
+      field = UNKNOWN;
+    }
+    return true;
+  }
+
+  bool Value(Scalar &scalar) override {
+    if (depth == 2) {
+      /* Entries of the list must be objects */
+      return Fail(ERR_FORMAT, "user_permission");
+    }
+    if (field == UNKNOWN) {
+      return true;
+    }
+    if (depth == 1) {
+      return Fail(ERR_FORMAT, "user_permission");
+    }
+
+    shareInfo &share = shares->back();
+    switch (field) {
+    case USER:
+    case GROUP:
+      if (scalar.type != Scalar::STRING) {
+        return Fail(ERR_FORMAT, FieldName());
+      }
+      /* A group is shared with even if a user is given too */
+      if (field == GROUP || !share.is_group) {
+        share.user_name = std::move(*scalar.string);
+        share.is_group = field == GROUP;
+      }
+      has_name = true;
+      return true;
+    default:
+      if (scalar.type != Scalar::BOOLEAN) {
+        return Fail(ERR_FORMAT, "permission");
+      }
+      share.permission = scalar.boolean;
+      has_permission = true;
+      return true;
+    }
+  }
+
+  Action Enter(bool is_array) override {
+    if (depth == 2) {
+      if (field != LIST) {
+        return SKIP;
+      }
+      if (!is_array) {
+        Fail(ERR_FORMAT, "user_permission");
+        return FAIL;
+      }
+      has_list = true;
+      return ACCEPT;
+    }
+    if (depth == 3) {
+      if (is_array) {
+        Fail(ERR_FORMAT, "user_permission");
+        return FAIL;
+      }
+      shares->emplace_back();
+      shares->back().task_list_name = tasklist;
+      shares->back().permission = false;
+      has_name = has_permission = false;
+      return ACCEPT;
+    }
+    /* Fields of an entry are scalars */
+    if (field == UNKNOWN) {
+      return SKIP;
+    }
+    Fail(ERR_FORMAT, FieldName());
+    return FAIL;
+  }
+
+  bool Leave() override {
+    /* Only a closed entry has to be checked */
+    if (depth != 3) {
+      return true;
+    }
+    if (!has_name) {
+      return Fail(ERR_RFIELD, "user");
+    }
+    if (!has_permission) {
+      return Fail(ERR_RFIELD, "permission");
+    }
+    return true;
+  }
+
+private:
+  const char *FieldName() const {
+    return field == USER ? "user" : field == GROUP ? "group" : "permission";
+  }
+
+  const std::string &tasklist;
+  std::vector<shareInfo> *shares;
+  Field field = UNKNOWN;
+  bool has_name = false;
+  bool has_permission = false;
+};
+
+returnCode ParseShares(std::string_view body, const std::string &tasklist,
+                       std::vector<shareInfo> *shares, std::string *err_field) {
+  ShareReader reader(tasklist, shares);
+  returnCode ret = reader.Parse(body, err_field);
+  if (ret == SUCCESS && !reader.has_list) {
+    *err_field = "user_permission";
+    return ERR_RFIELD;
+  }
+  return ret;
+}
+
+class NameListReader : public SchemaReader {
+public:
+  explicit NameListReader(std::initializer_list<NameList> lists)
+      : lists(lists), found(lists.size(), false) {}
+
+  std::initializer_list<NameList> lists;
+  std::vector<bool> found;
+
+protected:
+  bool Key(std::string &key) override {
+    list = -1;
+    for (size_t i = 0; i < lists.size(); i++) {
+      if (key == lists.begin()[i].key) {
+        list = static_cast<int>(i);
+        break;
+      }
+    }
+    return true;
+  }
+
+  bool Value(Scalar &scalar) override {
+    if (list < 0) {
+      return true;
+    }
+    const NameList &name_list = lists.begin()[list];
+    if (depth == 1 || scalar.type != Scalar::STRING) {
+      return Fail(ERR_FORMAT, name_list.key);
+    }
+    name_list.names->push_back(std::move(*scalar.string));
+    return true;
+  }
+
+  Action Enter(bool is_array) override {
+    if (list < 0) {
+      return SKIP;
+    }
+    if (depth != 2 || !is_array) {
+      Fail(ERR_FORMAT, lists.begin()[list].key);
+      return FAIL;
+    }
+    found[list] = true;
+    return ACCEPT;
+  }
+
+private:
+  /* index of the list whose key is being read, -1 for an unknown key */
+  int list = -1;
+};
+
+returnCode ParseNameLists(std::string_view body,
+                          std::initializer_list<NameList> lists,
+                          std::string *err_field) {
+  NameListReader reader(lists);
+  returnCode ret = reader.Parse(body, err_field);
+  if (ret != SUCCESS) {
+    return ret;
+  }
+  for (size_t i = 0; i < lists.size(); i++) {
+    if (lists.begin()[i].required && !reader.found[i]) {
+      *err_field = lists.begin()[i].key;
+      return ERR_RFIELD;
+    }
+  }
+  return SUCCESS;
+}
+
+} // namespace BodyParser
@@ -0,0 +1,97 @@
+/**
+ * @file bodyParser.h
+ * @brief Parsers that read request bodies of a known shape straight into the
+ * structures the workers take.
+ *
+ * Parsing a body with nlohmann::json::parse builds a tree of every value,
+ * looks each field up in it by name, copies it out, and reports bad input by
+ * throwing. These parsers run nlohmann's SAX parser with a reader for one body
+ * shape instead: strings are moved from the tokenizer into TaskContent,
+ * shareInfo or a name list as they come, values of unknown keys are skipped
+ * without being stored, and bad input stops the parser and is returned as a
+ * returnCode. A body of thousands of entries is read in one pass and never
+ * exists as a tree. Bodies, strings and the number of values are bounded.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include "api/taskContent.h"
+#include "api/tasklistContent.h"
+#include "common/errorCode.h"
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BodyParser {
+
+/* Largest body that is parsed at all */
+constexpr size_t kMaxBodySize = 1 << 20;
+
+/* Longest string value or key */
+constexpr size_t kMaxStringSize = 1 << 16;
+
+/* Most values, containers included, in one body */
+constexpr size_t kMaxValues = 1 << 16;
+
+/**
+ * @brief A list of names read from the value of a key, such as "user_list".
+ */
+struct NameList {
+  /* key of the list in the body object */
+  const char *key;
+  /* the names are appended there */
+  std::vector<std::string> *names;
+  /* whether the body must have the key */
+  bool required;
+};
+
+/**
+ * @brief Parse the body of a task create or update request. Known keys are
+ * "name", "content", "date", "start_date", "end_date", "status", which must be
+ * strings, and "priority", which must be an integer from 0 to 3.
+ *
+ * @param body Request body.
+ * @param task Fields in the body are put there.
+ * @param name_required Whether the body must have "name".
+ * @param err_field Key of the bad or missing field, empty for a syntax error.
+ * @return returnCode ERR_FORMAT if the body is not valid JSON, too large, or
+ * a field has the wrong type, ERR_RFIELD if a required field is missing.
+ */
+returnCode ParseTask(std::string_view body, TaskContent *task,
+                     bool name_required, std::string *err_field);
+
+/**
+ * @brief Parse the body of a share create request: {"user_permission": [...]}
+ * where each entry is {"user": name, "permission": bool} or
+ * {"group": name, "permission": bool}.
+ *
+ * @param body Request body.
+ * @param tasklist Task list being shared, set on every entry.
+ * @param shares One shareInfo per entry is appended there.
+ * @param err_field Key of the bad or missing field, empty for a syntax error.
+ * @return returnCode ERR_FORMAT if the body is not valid JSON, too large, or
+ * a field has the wrong type, ERR_RFIELD if a required field is missing.
+ */
+returnCode ParseShares(std::string_view body, const std::string &tasklist,
+                       std::vector<shareInfo> *shares, std::string *err_field);
+
+/**
+ * @brief Parse a body whose known keys are arrays of names, such as
+ * {"user_list": [...], "group_list": [...]}.
+ *
+ * @param body Request body.
+ * @param lists Keys to read and where to put their names.
+ * @param err_field Key of the bad or missing field, empty for a syntax error.
+ * @return returnCode ERR_FORMAT if the body is not valid JSON, too large, or
+ * a list is not an array of strings, ERR_RFIELD if a required list is missing.
+ */
+returnCode ParseNameLists(std::string_view body,
+                          std::initializer_list<NameList> lists,
+                          std::string *err_field);
+
+} // namespace BodyParser
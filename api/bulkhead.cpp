@@ -0,0 +1,123 @@
+#include "bulkhead.h"
+#include <algorithm>
+
+/* Share of n threads, at least one */
+static size_t ShareOf(double share, size_t n) {
+  return std::max<size_t>(static_cast<size_t>(share * n), 1);
+}
+
+std::array<Bulkhead::LaneConfig, Bulkhead::kLanes> Bulkhead::DefaultLanes() {
+  return {{{0.25, 0.125}, {0.125, 0.0625}, {0.125, 0.0625}, {0.125, 0.0625}}};
+}
+
+Bulkhead::Bulkhead(size_t n_threads,
+                   const std::array<LaneConfig, kLanes> &lanes) {
+  for (size_t i = 0; i < kLanes; i++) {
+    this->lanes[i].config = lanes[i];
+  }
+  SetThreads(n_threads);
+}
+
+void Bulkhead::SetThreads(size_t n_threads) {
+  std::lock_guard<std::mutex> guard(lock);
+  size_t reserved = 0;
+  for (auto &lane : lanes) {
+    lane.reserved = ShareOf(lane.config.reserved, n_threads);
+    reserved += lane.reserved;
+  }
+  shared = n_threads > reserved ? n_threads - reserved : 0;
+  /* A waiting request holds a thread too, the queues of the first lanes get
+     theirs first */
+  for (auto &lane : lanes) {
+    lane.max_queued = std::min(
+        static_cast<size_t>(lane.config.queued * n_threads), shared);
+    shared -= lane.max_queued;
+  }
+}
+
+Bulkhead::Grant Bulkhead::Take(LaneState &lane) {
+  if (lane.used_reserved < lane.reserved) {
+    lane.used_reserved++;
+    return RESERVED;
+  }
+  if (used_shared < shared) {
+    used_shared++;
+    lane.used_shared++;
+    return SHARED;
+  }
+  return REFUSED;
+}
+
+Bulkhead::Grant Bulkhead::Acquire(Lane lane, Clock::time_point until) {
+  LaneState &state = lanes[lane];
+  std::unique_lock<std::mutex> guard(lock);
+  /* Waiting requests were there first */
+  if (state.waiters.empty()) {
+    const Grant grant = Take(state);
+    if (grant != REFUSED) {
+      return grant;
+    }
+  }
+  if (state.waiters.size() >= state.max_queued) {
+    state.rejected.fetch_add(1, std::memory_order_relaxed);
+    return REFUSED;
+  }
+
+  Waiter waiter;
+  state.waiters.push_back(&waiter);
+  state.granted.wait_until(guard, until,
+                           [&waiter] { return waiter.grant != REFUSED; });
+  if (waiter.grant == REFUSED) {
+    state.waiters.erase(
+        std::find(state.waiters.begin(), state.waiters.end(), &waiter));
+    state.rejected.fetch_add(1, std::memory_order_relaxed);
+  }
+  return waiter.grant;
+}
+
+void Bulkhead::Release(Lane lane, Grant grant) {
+  LaneState &state = lanes[lane];
+  std::lock_guard<std::mutex> guard(lock);
+  if (grant == RESERVED) {
+    state.used_reserved--;
+  } else if (grant == SHARED) {
+    state.used_shared--;
+    used_shared--;
+  }
+  Dispatch();
+}
+
+void Bulkhead::Dispatch() {
+  /* Lanes in the order of their priority, so the first ones get the shared
+     slots */
+  for (auto &lane : lanes) {
+    bool woke = false;
+    while (!lane.waiters.empty()) {
+      const Grant grant = Take(lane);
+      if (grant == REFUSED) {
+        break;
+      }
+      lane.waiters.front()->grant = grant;
+      lane.waiters.pop_front();
+      woke = true;
+    }
+    if (woke) {
+      lane.granted.notify_all();
+    }
+  }
+}
+
+const char *Bulkhead::Name(Lane lane) {
+  static const char *const names[] = {"interactive", "bulk", "write", "login"};
+  return names[lane];
+}
+
+size_t Bulkhead::Active(Lane lane) const {
+  std::lock_guard<std::mutex> guard(lock);
+  return lanes[lane].used_reserved + lanes[lane].used_shared;
+}
+
+size_t Bulkhead::Queued(Lane lane) const {
+  std::lock_guard<std::mutex> guard(lock);
+  return lanes[lane].waiters.size();
+}
@@ -0,0 +1,153 @@
+/**
+ * @file bulkhead.h
+ * @brief Definition of Bulkhead, which splits the worker threads between
+ * lanes of requests, so that one kind of request cannot take all of them.
+ *
+ * httplib hands connections to the worker threads before their requests are
+ * read, so requests cannot be sorted in the task queue. They are sorted once
+ * routed instead: each route belongs to a lane, and a request runs only once
+ * it holds a slot of its lane. Every lane has slots of its own, reserved out
+ * of the worker threads, and the remaining slots are shared. When slots free
+ * up, waiting requests get them in the order of the lanes, interactive reads
+ * first, so a login storm waits behind the task reads and not the reverse.
+ *
+ * A waiting request holds its worker thread, so the threads requests may wait
+ * on are taken out of the shared ones: requests running and waiting never
+ * hold more threads than there are, and the slots reserved to a lane always
+ * have a thread left to take them. A request finding the queue of its lane
+ * full is refused at once.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+class Bulkhead {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @brief Lanes, from the highest priority to the lowest.
+   */
+  enum Lane {
+    INTERACTIVE, // reads of one item
+    BULK,        // reads of many items
+    WRITE,       // everything but reads
+    LOGIN,       // registrations and logins, which hash passwords
+  };
+  static constexpr size_t kLanes = LOGIN + 1;
+
+  /**
+   * @brief How a request got its slot.
+   */
+  enum Grant {
+    REFUSED,
+    RESERVED,
+    SHARED,
+  };
+
+  struct LaneConfig {
+    /* share of the threads reserved to the lane, at least one thread */
+    double reserved;
+    /* share of the threads that may wait for the lane, taken out of the
+       shared threads while there are some left, none if it rounds to zero */
+    double queued;
+  };
+
+  /**
+   * @brief A quarter of the threads reserved to the interactive reads, an
+   * eighth to each other lane. An eighth of the threads may wait for an
+   * interactive read, a sixteenth for each other lane, and the rest shared.
+   */
+  static std::array<LaneConfig, kLanes> DefaultLanes();
+
+  /**
+   * @brief Construct a new Bulkhead object.
+   *
+   * @param n_threads Number of worker threads.
+   * @param lanes Configuration of each lane.
+   */
+  explicit Bulkhead(size_t n_threads = 8,
+                    const std::array<LaneConfig, kLanes> &lanes =
+                        DefaultLanes());
+
+  /**
+   * @brief Size the lanes for a number of worker threads, must be called
+   * before any request.
+   */
+  void SetThreads(size_t n_threads);
+
+  /**
+   * @brief Take a slot of a lane, waiting for one if the queue of the lane is
+   * not full.
+   *
+   * @param lane The lane of the request.
+   * @param until When to stop waiting.
+   * @return REFUSED if the request must be refused, otherwise what to give
+   * back to Release.
+   */
+  Grant Acquire(Lane lane, Clock::time_point until);
+
+  /**
+   * @brief Give back the slot of a request, to the first request waiting.
+   */
+  void Release(Lane lane, Grant grant);
+
+  /**
+   * @brief Name of a lane, e.g. for metrics.
+   */
+  static const char *Name(Lane lane);
+
+  /**
+   * @brief Requests of a lane holding a slot.
+   */
+  size_t Active(Lane lane) const;
+
+  /**
+   * @brief Requests of a lane waiting for a slot.
+   */
+  size_t Queued(Lane lane) const;
+
+  /**
+   * @brief Requests of a lane refused.
+   */
+  uint64_t Rejected(Lane lane) const {
+    return lanes[lane].rejected.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Waiter {
+    Grant grant = REFUSED;
+  };
+
+  struct LaneState {
+    LaneConfig config;
+    size_t reserved = 0;
+    size_t max_queued = 0;
+    size_t used_reserved = 0;
+    size_t used_shared = 0;
+    std::deque<Waiter *> waiters;
+    std::condition_variable granted;
+    std::atomic<uint64_t> rejected{0};
+  };
+
+  /* Hand the free slots to the waiting requests, the lock must be held */
+  void Dispatch();
+
+  /* A free slot for a lane, REFUSED if none, the lock must be held */
+  Grant Take(LaneState &lane);
+
+  mutable std::mutex lock;
+  std::array<LaneState, kLanes> lanes;
+  size_t shared = 0;
+  size_t used_shared = 0;
+};
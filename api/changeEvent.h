@@ -0,0 +1,109 @@
+/**
+ * @file changeEvent.h
+ * @brief Definition of ChangeEvent and ChangeListener, through which the
+ * workers report the writes they made.
+ *
+ * TaskListsWorker and TasksWorker call their listener after every create,
+ * revise or delete that succeeded, so anything that has to follow the data,
+ * e.g. the change streams of the Api, hears about every write whichever
+ * handler made it. ChangeListeners passes each change on to several listeners,
+ * in the order they were added.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A write to a tasklist or one of its tasks.
+ *
+ */
+struct ChangeEvent {
+  enum Type {
+    TASKLIST_CREATED,
+    TASKLIST_REVISED,
+    TASKLIST_DELETED,
+    TASK_CREATED,
+    TASK_REVISED,
+    TASK_DELETED,
+    /* not a write to the data: users lost access to tasklists, see user */
+    ACCESS_REVOKED
+  };
+
+  /**
+   * @brief what happened
+   *
+   */
+  Type type;
+  /**
+   * @brief owner of the tasklist, empty for an ACCESS_REVOKED of every owner
+   *
+   */
+  std::string owner;
+  /**
+   * @brief name of the tasklist, empty for an ACCESS_REVOKED of every owner
+   *
+   */
+  std::string tasklist;
+  /**
+   * @brief name of the task, empty for tasklist events
+   *
+   */
+  std::string task;
+  /**
+   * @brief user who made the change, the owner or a collaborator; for
+   * ACCESS_REVOKED, the user who lost access, empty if any collaborator may
+   * have
+   *
+   */
+  std::string user;
+
+  /**
+   * @brief Name of an event type, e.g. "task.revised".
+   */
+  static const char *Name(Type type) {
+    static const char *const names[] = {
+        "tasklist.created", "tasklist.revised", "tasklist.deleted",
+        "task.created",     "task.revised",     "task.deleted",
+        "access.revoked"};
+    return names[type];
+  }
+};
+
+class ChangeListener {
+public:
+  virtual ~ChangeListener() {}
+
+  /**
+   * @brief Called on the thread that made the change, right after it was
+   * written. It must not block.
+   *
+   * @param event The change.
+   */
+  virtual void OnChange(const ChangeEvent &event) = 0;
+};
+
+class ChangeListeners : public ChangeListener {
+public:
+  /**
+   * @brief Add a listener, must be called before any change is reported.
+   */
+  void Add(std::shared_ptr<ChangeListener> listener) {
+    listeners.push_back(std::move(listener));
+  }
+
+  void OnChange(const ChangeEvent &event) override {
+    for (auto &listener : listeners) {
+      listener->OnChange(event);
+    }
+  }
+
+private:
+  std::vector<std::shared_ptr<ChangeListener>> listeners;
+};
@@ -0,0 +1,166 @@
+#include "changeHub.h"
+#include "api/jsonWriter.h"
+#include <algorithm>
+
+bool ChangeHub::Subscriber::Wait(std::chrono::milliseconds timeout,
+                                 std::vector<Frame> *frames,
+                                 bool *dropped) {
+  std::unique_lock<std::mutex> guard(lock);
+  ready.wait_for(guard, timeout, [this] {
+    return closed || ending || overflowed || !pending.empty();
+  });
+  if (closed || (ending && pending.empty() && !overflowed)) {
+    return false;
+  }
+  *dropped = overflowed;
+  overflowed = false;
+  frames->insert(frames->end(), std::make_move_iterator(pending.begin()),
+                 std::make_move_iterator(pending.end()));
+  pending.clear();
+  return true;
+}
+
+ChangeHub::ChangeHub(size_t max_subscribers, size_t max_pending)
+    : max_subscribers(std::max<size_t>(max_subscribers, 1)),
+      max_pending(std::max<size_t>(max_pending, 1)) {}
+
+std::shared_ptr<ChangeHub::Subscriber>
+ChangeHub::Subscribe(const std::string &owner, const std::string &tasklist,
+                     const std::string &user) {
+  auto subscriber = std::make_shared<Subscriber>();
+  subscriber->key = {owner, tasklist};
+  subscriber->user = user;
+  std::unique_lock<std::shared_mutex> guard(lock);
+  if (closed || count >= max_subscribers.load()) {
+    return nullptr;
+  }
+  subscribers[subscriber->key].push_back(subscriber);
+  count++;
+  return subscriber;
+}
+
+void ChangeHub::Unsubscribe(const std::shared_ptr<Subscriber> &subscriber) {
+  std::unique_lock<std::shared_mutex> guard(lock);
+  auto it = subscribers.find(subscriber->key);
+  if (it == subscribers.end()) {
+    return;
+  }
+  auto &list = it->second;
+  auto pos = std::find(list.begin(), list.end(), subscriber);
+  if (pos == list.end()) {
+    return;
+  }
+  /* Order does not matter, swap the last one in */
+  *pos = std::move(list.back());
+  list.pop_back();
+  count--;
+  if (list.empty()) {
+    subscribers.erase(it);
+  }
+}
+
+void ChangeHub::OnChange(const ChangeEvent &event) {
+  std::shared_lock<std::shared_mutex> guard(lock);
+  if (event.type == ChangeEvent::ACCESS_REVOKED) {
+    Revoke(event);
+    return;
+  }
+  auto it = subscribers.find({event.owner, event.tasklist});
+  if (it == subscribers.end()) {
+    return;
+  }
+  Frame frame = std::make_shared<const std::string>(
+      FormatFrame(event, next_id.fetch_add(1)));
+  for (auto &subscriber : it->second) {
+    {
+      std::lock_guard<std::mutex> sub_guard(subscriber->lock);
+      if (subscriber->overflowed) {
+        continue;
+      }
+      if (subscriber->pending.size() >= max_pending) {
+        subscriber->pending.clear();
+        subscriber->overflowed = true;
+      } else {
+        subscriber->pending.push_back(frame);
+      }
+    }
+    subscriber->ready.notify_one();
+  }
+  /* Nothing more will come from a deleted tasklist */
+  if (event.type == ChangeEvent::TASKLIST_DELETED) {
+    for (auto &subscriber : it->second) {
+      End(*subscriber);
+    }
+  }
+}
+
+void ChangeHub::Revoke(const ChangeEvent &event) {
+  auto revoke = [&event](std::vector<std::shared_ptr<Subscriber>> &list) {
+    for (auto &subscriber : list) {
+      /* The owner never loses access */
+      if (subscriber->user != subscriber->key.first &&
+          (event.user.empty() || subscriber->user == event.user)) {
+        End(*subscriber);
+      }
+    }
+  };
+  if (!event.owner.empty()) {
+    auto it = subscribers.find({event.owner, event.tasklist});
+    if (it != subscribers.end()) {
+      revoke(it->second);
+    }
+    return;
+  }
+  for (auto &it : subscribers) {
+    revoke(it.second);
+  }
+}
+
+void ChangeHub::End(Subscriber &subscriber) {
+  {
+    std::lock_guard<std::mutex> guard(subscriber.lock);
+    subscriber.ending = true;
+  }
+  subscriber.ready.notify_one();
+}
+
+void ChangeHub::Close() {
+  std::unique_lock<std::shared_mutex> guard(lock);
+  closed = true;
+  for (auto &it : subscribers) {
+    for (auto &subscriber : it.second) {
+      {
+        std::lock_guard<std::mutex> sub_guard(subscriber->lock);
+        subscriber->closed = true;
+      }
+      subscriber->ready.notify_one();
+    }
+  }
+}
+
+void ChangeHub::SetMaxSubscribers(size_t max_subscribers) {
+  this->max_subscribers = max_subscribers;
+}
+
+size_t ChangeHub::Size() const {
+  std::shared_lock<std::shared_mutex> guard(lock);
+  return count;
+}
+
+std::string ChangeHub::FormatFrame(const ChangeEvent &event, uint64_t id) {
+  std::string frame = "id: ";
+  JsonWriter::WriteInt(frame, static_cast<int64_t>(id));
+  frame += "\nevent: ";
+  frame += ChangeEvent::Name(event.type);
+  /* JSON text has no raw newline, so the data fits in one line */
+  frame += "\ndata: {\"tasklist\":";
+  JsonWriter::WriteString(frame, event.tasklist);
+  if (!event.task.empty()) {
+    frame += ",\"task\":";
+    JsonWriter::WriteString(frame, event.task);
+  }
+  frame += ",\"user\":";
+  JsonWriter::WriteString(frame, event.user);
+  frame += "}\n\n";
+  return frame;
+}
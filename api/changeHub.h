@@ -0,0 +1,147 @@
+/**
+ * @file changeHub.h
+ * @brief Definition of ChangeHub, which fans the changes of each tasklist out
+ * to the clients streaming it.
+ *
+ * Each change is formatted once as a Server-Sent Events frame and the same
+ * frame is queued for every subscriber of its tasklist, so publishing costs
+ * one map lookup and a pointer push per subscriber, and never waits for a
+ * client. A subscriber queues at most max_pending frames: a client that falls
+ * further behind loses its queue and is told to reload the tasklist instead,
+ * so a slow reader can neither block writers nor grow without bound. The hub
+ * starts no thread; subscribers wait on their own condition variable, with a
+ * timeout for the keep-alive comments.
+ *
+ * Access is only checked when a client subscribes, so the hub ends the
+ * streams that may no longer be allowed: every stream of a deleted tasklist,
+ * after its last frame, and the streams of collaborators who lost access. The
+ * clients reconnect and their access is checked again.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include "api/changeEvent.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+class ChangeHub : public ChangeListener {
+public:
+  using Frame = std::shared_ptr<const std::string>;
+
+  class Subscriber {
+  public:
+    /**
+     * @brief Wait until frames are queued, the timeout passes or the stream is
+     * ended, and take the queued frames.
+     *
+     * @param timeout Longest time to wait.
+     * @param frames The queued frames will be appended there.
+     * @param dropped Set to true if frames were dropped since the last call,
+     * the client must then reload the tasklist.
+     * @return false if the stream was ended and has no frame left.
+     */
+    bool Wait(std::chrono::milliseconds timeout, std::vector<Frame> *frames,
+              bool *dropped);
+
+  private:
+    friend ChangeHub;
+
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<Frame> pending;
+    bool overflowed = false;
+    bool closed = false;
+    /* the frames queued are the last ones */
+    bool ending = false;
+    /* (owner, tasklist) streamed */
+    std::pair<std::string, std::string> key;
+    /* user streaming it, the owner or a collaborator */
+    std::string user;
+  };
+
+  /**
+   * @brief Construct a new Change Hub object.
+   *
+   * @param max_subscribers Max number of subscribers at a time, at least 1.
+   * @param max_pending Max number of frames queued for one subscriber.
+   */
+  explicit ChangeHub(size_t max_subscribers = 1024, size_t max_pending = 256);
+
+  /**
+   * @brief Start streaming the changes of a tasklist. The caller must have
+   * checked that the user may read it.
+   *
+   * @param owner Owner of the tasklist.
+   * @param tasklist Name of the tasklist.
+   * @param user User streaming it.
+   * @return nullptr if there are max_subscribers already or the hub is closed.
+   */
+  std::shared_ptr<Subscriber> Subscribe(const std::string &owner,
+                                        const std::string &tasklist,
+                                        const std::string &user);
+
+  /**
+   * @brief Stop streaming, e.g. when the client went away.
+   */
+  void Unsubscribe(const std::shared_ptr<Subscriber> &subscriber);
+
+  /**
+   * @brief Queue a change for the subscribers of its tasklist, and end the
+   * streams it makes stale.
+   */
+  void OnChange(const ChangeEvent &event) override;
+
+  /**
+   * @brief Wake and end every subscriber, and refuse new ones.
+   */
+  void Close();
+
+  /**
+   * @brief Change the max number of subscribers, does not drop any. 0
+   * refuses every new subscriber.
+   */
+  void SetMaxSubscribers(size_t max_subscribers);
+
+  /**
+   * @brief Number of subscribers.
+   */
+  size_t Size() const;
+
+  /**
+   * @brief Format a change as a Server-Sent Events frame.
+   *
+   * @param event The change.
+   * @param id Id of the frame.
+   */
+  static std::string FormatFrame(const ChangeEvent &event, uint64_t id);
+
+private:
+  /* End the streams of collaborators who lost access, lock held */
+  void Revoke(const ChangeEvent &event);
+
+  /* Let a subscriber take its queued frames, then end its stream */
+  static void End(Subscriber &subscriber);
+
+  mutable std::shared_mutex lock;
+  std::map<std::pair<std::string, std::string>,
+           std::vector<std::shared_ptr<Subscriber>>>
+      subscribers;
+  size_t count = 0;
+  bool closed = false;
+  std::atomic<size_t> max_subscribers;
+  const size_t max_pending;
+  std::atomic<uint64_t> next_id{1};
+};
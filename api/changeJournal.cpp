@@ -0,0 +1,101 @@
+#include "changeJournal.h"
+#include <algorithm>
+#include <mutex>
+#include <unordered_set>
+
+/* Entries past the retention window of idle owners are dropped this often */
+static constexpr std::chrono::minutes kCompactInterval(1);
+
+ChangeJournal::ChangeJournal(std::chrono::seconds retention,
+                             size_t max_entries)
+    : last_compact(Clock::now()), retention(retention),
+      max_entries(std::max<size_t>(max_entries, 1)) {
+  floor = last_seq = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+}
+
+void ChangeJournal::OnChange(const ChangeEvent &event) {
+  /* Revocations only end change streams, the data did not change */
+  if (event.type == ChangeEvent::ACCESS_REVOKED) {
+    return;
+  }
+  const auto now = Clock::now();
+  std::unique_lock<std::shared_mutex> guard(lock);
+  Journal &journal =
+      journals.try_emplace(event.owner, Journal{{}, floor}).first->second;
+  journal.entries.push_back({++last_seq, now, event});
+  count++;
+  CompactJournal(journal, now);
+
+  if (now - last_compact >= kCompactInterval) {
+    last_compact = now;
+    for (auto &it : journals) {
+      CompactJournal(it.second, now);
+    }
+  }
+}
+
+uint64_t ChangeJournal::Cursor() const {
+  std::shared_lock<std::shared_mutex> guard(lock);
+  return last_seq;
+}
+
+bool ChangeJournal::Read(const std::string &owner,
+                         const std::set<std::string> *tasklists,
+                         uint64_t since, std::vector<Entry> *out) const {
+  std::shared_lock<std::shared_mutex> guard(lock);
+  if (since > last_seq) {
+    return false;
+  }
+  const auto it = journals.find(owner);
+  if (since < (it == journals.end() ? floor : it->second.floor)) {
+    return false;
+  }
+  if (it == journals.end()) {
+    return true;
+  }
+
+  const auto &entries = it->second.entries;
+  auto first = std::upper_bound(
+      entries.begin(), entries.end(), since,
+      [](uint64_t seq, const Entry &entry) { return seq < entry.seq; });
+
+  /* Walk backwards so the last change of each task or tasklist is kept */
+  std::unordered_set<std::string> seen;
+  std::vector<Entry> changes;
+  for (auto entry = entries.end(); entry != first;) {
+    --entry;
+    if (tasklists && !tasklists->count(entry->event.tasklist)) {
+      continue;
+    }
+    if (seen.insert(entry->event.tasklist + '\0' + entry->event.task).second) {
+      changes.push_back(*entry);
+    }
+  }
+  out->insert(out->end(), changes.rbegin(), changes.rend());
+  return true;
+}
+
+void ChangeJournal::Compact(Clock::time_point now) {
+  std::unique_lock<std::shared_mutex> guard(lock);
+  last_compact = now;
+  for (auto &it : journals) {
+    CompactJournal(it.second, now);
+  }
+}
+
+size_t ChangeJournal::Size() const {
+  std::shared_lock<std::shared_mutex> guard(lock);
+  return count;
+}
+
+void ChangeJournal::CompactJournal(Journal &journal, Clock::time_point now) {
+  auto &entries = journal.entries;
+  while (!entries.empty() && (entries.size() > max_entries ||
+                              entries.front().time + retention < now)) {
+    journal.floor = entries.front().seq;
+    entries.pop_front();
+    count--;
+  }
+}
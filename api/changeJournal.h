@@ -0,0 +1,112 @@
+/**
+ * @file changeJournal.h
+ * @brief Definition of ChangeJournal, the ordered record of the changes made
+ * to each user's tasklists, from which clients sync incrementally.
+ *
+ * Every change gets a sequence number, and is appended to the journal of the
+ * tasklist's owner. A client keeps the cursor returned by its last sync and
+ * asks for the changes after it: its own journal, plus the journals of the
+ * owners who share lists with it, filtered to those lists. Repeated changes
+ * of the same task or tasklist are reduced to the last one, so a reply grows
+ * with what changed rather than with how often.
+ *
+ * Entries older than the retention window, or beyond max_entries per owner,
+ * are dropped. A cursor older than what was dropped cannot be served and the
+ * client must reload everything. Sequence numbers start from the time the
+ * journal was created, in microseconds, so cursors handed out before a restart
+ * are older than the new journal and are refused too, rather than misread.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include "api/changeEvent.h"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ChangeJournal : public ChangeListener {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Entry {
+    uint64_t seq;
+    Clock::time_point time;
+    ChangeEvent event;
+  };
+
+  /**
+   * @brief Construct a new Change Journal object.
+   *
+   * @param retention How long entries are kept.
+   * @param max_entries Max number of entries kept per owner, at least 1.
+   */
+  explicit ChangeJournal(
+      std::chrono::seconds retention = std::chrono::hours(24),
+      size_t max_entries = 10000);
+
+  /**
+   * @brief Append a change to the journal of its owner.
+   */
+  void OnChange(const ChangeEvent &event) override;
+
+  /**
+   * @brief Sequence number of the last change, the cursor of a sync that
+   * starts now. Must be taken before the changes are read.
+   */
+  uint64_t Cursor() const;
+
+  /**
+   * @brief Get the changes of an owner's tasklists after a cursor, the last
+   * one for each task or tasklist, in order.
+   *
+   * @param owner Owner of the tasklists.
+   * @param tasklists Only changes of these tasklists, nullptr for all.
+   * @param since Cursor of the previous sync.
+   * @param out The changes will be appended there.
+   * @return false if changes after the cursor were dropped, or the cursor was
+   * not handed out by this journal, out is then unchanged.
+   */
+  bool Read(const std::string &owner, const std::set<std::string> *tasklists,
+            uint64_t since, std::vector<Entry> *out) const;
+
+  /**
+   * @brief Drop the entries older than the retention window of all owners.
+   *
+   * @param now Entries older than now minus the retention window are dropped.
+   */
+  void Compact(Clock::time_point now = Clock::now());
+
+  /**
+   * @brief Number of entries kept.
+   */
+  size_t Size() const;
+
+private:
+  /* Kept even when empty, for its floor */
+  struct Journal {
+    std::deque<Entry> entries;
+    /* every change after this sequence number is in entries */
+    uint64_t floor;
+  };
+
+  /* Drop the old entries of a journal, the lock must be held */
+  void CompactJournal(Journal &journal, Clock::time_point now);
+
+  mutable std::shared_mutex lock;
+  std::unordered_map<std::string, Journal> journals;
+  /* floor of the owners without a journal */
+  uint64_t floor;
+  uint64_t last_seq;
+  size_t count = 0;
+  Clock::time_point last_compact;
+  const std::chrono::seconds retention;
+  const size_t max_entries;
+};
@@ -0,0 +1,172 @@
+#include "compressor.h"
+#include <cstdlib>
+#include <mutex>
+#include <zlib.h>
+
+namespace Compressor {
+
+/* zlib window bits of each encoding, 16 more asks for a gzip wrapper */
+static constexpr int kGzipWindowBits = 15 + 16;
+static constexpr int kDeflateWindowBits = 15;
+
+/* Level 6 is zlib's default, a good ratio at a fraction of level 9's cost */
+static constexpr int kLevel = 6;
+
+/**
+ * @brief The deflate streams of one thread, created on first use and reset
+ * between bodies.
+ */
+class Streams {
+public:
+  ~Streams() {
+    for (auto &stream : streams) {
+      if (stream.initialized) {
+        deflateEnd(&stream.z);
+      }
+    }
+  }
+
+  z_stream *Get(Encoding encoding) {
+    Stream &stream = streams[encoding == GZIP ? 0 : 1];
+    if (!stream.initialized) {
+      stream.z = {};
+      if (deflateInit2(&stream.z, kLevel, Z_DEFLATED,
+                       encoding == GZIP ? kGzipWindowBits : kDeflateWindowBits,
+                       8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return nullptr;
+      }
+      stream.initialized = true;
+    } else if (deflateReset(&stream.z) != Z_OK) {
+      return nullptr;
+    }
+    return &stream.z;
+  }
+
+private:
+  struct Stream {
+    z_stream z;
+    bool initialized = false;
+  };
+
+  Stream streams[2];
+};
+
+static thread_local Streams thread_streams;
+
+static std::string_view Trim(std::string_view str) {
+  while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) {
+    str.remove_prefix(1);
+  }
+  while (!str.empty() && (str.back() == ' ' || str.back() == '\t')) {
+    str.remove_suffix(1);
+  }
+  return str;
+}
+
+/**
+ * @brief Quality of an Accept-Encoding entry such as "gzip;q=0.5", in
+ * thousandths. An entry without q has quality 1.
+ */
+static int Quality(std::string_view params) {
+  size_t q = params.find("q=");
+  if (q == std::string_view::npos) {
+    return 1000;
+  }
+  std::string value(Trim(params.substr(q + 2)));
+  return static_cast<int>(std::strtod(value.c_str(), nullptr) * 1000);
+}
+
+Encoding Negotiate(std::string_view accept_encoding) {
+  /* Quality of each coding, -1 if it is not listed */
+  int gzip = -1;
+  int deflate = -1;
+  int any = 0;
+  while (!accept_encoding.empty()) {
+    size_t comma = accept_encoding.find(',');
+    std::string_view entry = accept_encoding.substr(0, comma);
+    accept_encoding.remove_prefix(comma == std::string_view::npos
+                                      ? accept_encoding.size()
+                                      : comma + 1);
+
+    size_t semicolon = entry.find(';');
+    std::string_view coding = Trim(entry.substr(0, semicolon));
+    int quality = semicolon == std::string_view::npos
+                      ? 1000
+                      : Quality(entry.substr(semicolon + 1));
+    if (coding == "gzip" || coding == "x-gzip") {
+      gzip = quality;
+    } else if (coding == "deflate") {
+      deflate = quality;
+    } else if (coding == "*") {
+      any = quality;
+    }
+  }
+
+  /* "*" stands for the codings that are not listed */
+  gzip = gzip < 0 ? any : gzip;
+  deflate = deflate < 0 ? any : deflate;
+  if (gzip > 0 && gzip >= deflate) {
+    return GZIP;
+  }
+  return deflate > 0 ? DEFLATE : IDENTITY;
+}
+
+const std::string &Name(Encoding encoding) {
+  static const std::string names[] = {"identity", "gzip", "deflate"};
+  return names[encoding];
+}
+
+bool Compress(std::string_view body, Encoding encoding, std::string *out) {
+  if (encoding == IDENTITY) {
+    return false;
+  }
+  z_stream *z = thread_streams.Get(encoding);
+  if (!z) {
+    return false;
+  }
+
+  /* deflateBound is enough for deflate to finish in one call */
+  out->resize(deflateBound(z, body.size()));
+  z->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(body.data()));
+  z->avail_in = body.size();
+  z->next_out = reinterpret_cast<Bytef *>(&(*out)[0]);
+  z->avail_out = out->size();
+  if (deflate(z, Z_FINISH) != Z_STREAM_END) {
+    return false;
+  }
+  out->resize(z->total_out);
+  return true;
+}
+
+} // namespace Compressor
+
+bool CompressedCache::Compress(const std::string &route,
+                               const std::string &body,
+                               Compressor::Encoding encoding,
+                               std::string *out) {
+  std::string key = Compressor::Name(encoding) + ' ' + route;
+  {
+    std::shared_lock<std::shared_mutex> guard(lock);
+    auto it = entries.find(key);
+    if (it != entries.end() && it->second.body == body) {
+      *out = it->second.compressed;
+      return true;
+    }
+  }
+
+  if (!Compressor::Compress(body, encoding, out)) {
+    return false;
+  }
+  Entry entry{body, *out};
+  std::unique_lock<std::shared_mutex> guard(lock);
+  if (entries.size() >= capacity && entries.find(key) == entries.end()) {
+    entries.erase(entries.begin());
+  }
+  entries[key] = std::move(entry);
+  return true;
+}
+
+size_t CompressedCache::Size() const {
+  std::shared_lock<std::shared_mutex> guard(lock);
+  return entries.size();
+}
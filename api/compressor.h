@@ -0,0 +1,101 @@
+/**
+ * @file compressor.h
+ * @brief Compression of response bodies, and a cache of compressed bodies.
+ *
+ * Responses are JSON text, which deflate shrinks several times over. The
+ * encoding is negotiated from the Accept-Encoding header of each request,
+ * gzip being preferred over deflate, and bodies under kMinCompressSize are
+ * sent as they are, since the headers would outweigh the saving. Each thread
+ * keeps one zlib stream per encoding and resets it between bodies instead of
+ * allocating its window and tables every time.
+ *
+ * CompressedCache keeps the last compressed body of a route and encoding, for
+ * routes whose body is the same for every client. A body is only served from
+ * the cache when it is byte for byte the body that was compressed, so the
+ * cache needs no invalidation: comparing a body is much cheaper than
+ * deflating it again.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace Compressor {
+
+enum Encoding { IDENTITY, GZIP, DEFLATE };
+
+/* Bodies shorter than this are not compressed */
+constexpr size_t kMinCompressSize = 1024;
+
+/**
+ * @brief Pick the encoding of a response from the Accept-Encoding header.
+ *
+ * @param accept_encoding Value of the header, may be empty.
+ * @return Encoding GZIP or DEFLATE if the client accepts it, else IDENTITY.
+ */
+Encoding Negotiate(std::string_view accept_encoding);
+
+/**
+ * @brief Name of an encoding in the Content-Encoding header.
+ */
+const std::string &Name(Encoding encoding);
+
+/**
+ * @brief Compress a body with the stream of the current thread.
+ *
+ * @param body Body to compress.
+ * @param encoding GZIP or DEFLATE.
+ * @param out The compressed body will be put there.
+ * @return false if zlib failed, out is then unspecified.
+ */
+bool Compress(std::string_view body, Encoding encoding, std::string *out);
+
+} // namespace Compressor
+
+class CompressedCache {
+public:
+  /**
+   * @brief Construct a new Compressed Cache object.
+   *
+   * @param capacity Max number of bodies kept, one per route and encoding.
+   */
+  explicit CompressedCache(size_t capacity = 64)
+      : capacity(std::max<size_t>(capacity, 1)) {}
+
+  /**
+   * @brief Compress a body, or take its compressed bytes from the cache if
+   * the same body of the same route was compressed before.
+   *
+   * @param route Route the body is a response of, e.g. the request path.
+   * @param body Body to compress.
+   * @param encoding GZIP or DEFLATE.
+   * @param out The compressed body will be put there.
+   * @return false if zlib failed, out is then unspecified.
+   */
+  bool Compress(const std::string &route, const std::string &body,
+                Compressor::Encoding encoding, std::string *out);
+
+  /**
+   * @brief Number of bodies kept.
+   */
+  size_t Size() const;
+
+private:
+  struct Entry {
+    std::string body;
+    std::string compressed;
+  };
+
+  mutable std::shared_mutex lock;
+  /* key is the encoding followed by the route */
+  std::unordered_map<std::string, Entry> entries;
+  const size_t capacity;
+};
@@ -0,0 +1,65 @@
+#include "concurrencyLimiter.h"
+#include <algorithm>
+
+/* The baseline may rise this much per window */
+static constexpr double kBaselineDrift = 1.02;
+/* The limit is multiplied by this when the DB is queueing */
+static constexpr double kBackoff = 0.8;
+
+ConcurrencyLimiter::ConcurrencyLimiter(size_t min_limit, size_t max_limit,
+                                       double tolerance, size_t window)
+    : min_limit(std::max<size_t>(min_limit, 1)),
+      tolerance(std::max(tolerance, 1.0)),
+      window(std::max<size_t>(window, 1)),
+      max_limit(std::max(max_limit, this->min_limit)),
+      limit(this->max_limit.load()) {}
+
+bool ConcurrencyLimiter::Acquire() {
+  size_t current = in_flight.load(std::memory_order_relaxed);
+  do {
+    if (current >= limit.load(std::memory_order_relaxed)) {
+      shed.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  } while (!in_flight.compare_exchange_weak(current, current + 1,
+                                            std::memory_order_relaxed));
+  return true;
+}
+
+void ConcurrencyLimiter::Release(uint64_t db_us) {
+  const size_t current = in_flight.fetch_sub(1, std::memory_order_relaxed);
+  if (!db_us) {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(lock);
+  window_sum_us += db_us;
+  window_peak = std::max(window_peak, current);
+  if (++window_count >= window) {
+    Update();
+  }
+}
+
+void ConcurrencyLimiter::SetMaxLimit(size_t max) {
+  std::lock_guard<std::mutex> guard(lock);
+  max_limit = std::max(max, min_limit);
+  limit = std::min(limit.load(), max_limit.load());
+}
+
+void ConcurrencyLimiter::Update() {
+  const double average = static_cast<double>(window_sum_us) / window_count;
+  baseline_us = baseline_us > 0
+                    ? std::min(average, baseline_us * kBaselineDrift)
+                    : average;
+
+  size_t current = limit.load(std::memory_order_relaxed);
+  if (average > baseline_us * tolerance) {
+    current = std::max(min_limit, static_cast<size_t>(current * kBackoff));
+  } else if (window_peak * 4 >= current * 3) {
+    current = std::min(max_limit.load(), current + 1);
+  }
+  limit.store(current, std::memory_order_relaxed);
+
+  window_sum_us = 0;
+  window_count = 0;
+  window_peak = 0;
+}
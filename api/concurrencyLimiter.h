@@ -0,0 +1,88 @@
+/**
+ * @file concurrencyLimiter.h
+ * @brief Definition of ConcurrencyLimiter, which bounds the number of requests
+ * doing DB work at once and adapts the bound to the DB latency.
+ *
+ * When neo4j slows down, every worker thread ends up waiting on it, new
+ * requests queue behind them and everybody times out. The limiter admits a
+ * request only while fewer than limit requests are in flight; the others are
+ * refused at once, so that a client can retry later rather than wait.
+ *
+ * The limit follows AIMD. Requests report the time they spent in the DB, and
+ * every window of reports is averaged and compared to a baseline, the lowest
+ * average seen, which drifts up slowly so that a lasting change becomes the
+ * new normal. An average above tolerance times the baseline means the DB is
+ * queueing: the limit is cut by a fifth. Otherwise, if the requests used most
+ * of the limit, it grows by one.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+class ConcurrencyLimiter {
+public:
+  /**
+   * @brief Construct a new Concurrency Limiter object, starting at max_limit.
+   *
+   * @param min_limit Lowest limit, at least 1.
+   * @param max_limit Highest limit, at least min_limit.
+   * @param tolerance DB latency over the baseline that cuts the limit.
+   * @param window Number of reports averaged before the limit changes.
+   */
+  explicit ConcurrencyLimiter(size_t min_limit = 2, size_t max_limit = 64,
+                              double tolerance = 2.0, size_t window = 32);
+
+  /**
+   * @brief Admit a request if there is room for it.
+   *
+   * @return false if the request must be refused, Release must not be called.
+   */
+  bool Acquire();
+
+  /**
+   * @brief End an admitted request.
+   *
+   * @param db_us Time the request spent in the DB in microseconds, 0 if it
+   * did not reach it, which is not counted.
+   */
+  void Release(uint64_t db_us);
+
+  /**
+   * @brief Set the highest limit, e.g. the number of worker threads.
+   */
+  void SetMaxLimit(size_t max_limit);
+
+  size_t Limit() const { return limit.load(std::memory_order_relaxed); }
+
+  size_t InFlight() const { return in_flight.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Number of requests refused.
+   */
+  uint64_t Shed() const { return shed.load(std::memory_order_relaxed); }
+
+private:
+  /* Change the limit from the reports of a window, the lock must be held */
+  void Update();
+
+  const size_t min_limit;
+  const double tolerance;
+  const size_t window;
+  std::atomic<size_t> max_limit;
+  std::atomic<size_t> limit;
+  std::atomic<size_t> in_flight{0};
+  std::atomic<uint64_t> shed{0};
+
+  std::mutex lock;
+  uint64_t window_sum_us = 0;
+  size_t window_count = 0;
+  /* most requests in flight during the window */
+  size_t window_peak = 0;
+  double baseline_us = 0;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief This is a structure that uses as output for groupsWorker object's
+ * properties/fields. A group is a set of users that a tasklist can be shared
+ * with at once.
+ */
+struct GroupContent {
+  /* data */
+
+  /**
+   * @brief key: group name
+   *
+   */
+  std::string name;
+
+  /**
+   * @brief owner of the group, the only user that can change it
+   *
+   */
+  std::string owner;
+
+  /**
+   * @brief users in the group, including the owner
+   *
+   */
+  std::vector<std::string> members;
+
+  /* methods */
+
+  /**
+   * @brief Construct a new Group Content object
+   *
+   */
+  GroupContent() {}
+
+  /**
+   * @brief Construct a new Group Content object
+   *
+   * @param _name value for group name
+   * @param _owner value for group owner
+   */
+  template <typename Name, typename Owner>
+  GroupContent(Name &&_name, Owner &&_owner)
+      : name(std::forward<Name>(_name)), owner(std::forward<Owner>(_owner)) {}
+};
@@ -0,0 +1,162 @@
+#include "jsonWriter.h"
+#include <charconv>
+#include <cstring>
+
+namespace JsonWriter {
+
+/* Response bodies are moved into httplib, only their size is kept */
+static thread_local size_t last_buffer_size = 0;
+
+/* Do not keep reserving for one huge response */
+static constexpr size_t kMaxReserve = 1 << 20;
+
+/**
+ * @brief Check whether any of 8 bytes has to be escaped: a control character,
+ * a quote or a backslash. Each test sets the high bit of the matching bytes.
+ */
+static inline bool NeedsEscape(uint64_t word) {
+  constexpr uint64_t kOnes = 0x0101010101010101ULL;
+  constexpr uint64_t kHigh = 0x8080808080808080ULL;
+  const uint64_t control = (word - kOnes * 0x20) & ~word & kHigh;
+  const uint64_t quote = word ^ (kOnes * '"');
+  const uint64_t backslash = word ^ (kOnes * '\\');
+  return control | ((quote - kOnes) & ~quote & kHigh) |
+         ((backslash - kOnes) & ~backslash & kHigh);
+}
+
+static inline bool NeedsEscape(unsigned char c) {
+  return c < 0x20 || c == '"' || c == '\\';
+}
+
+static void WriteEscaped(std::string &out, unsigned char c) {
+  static const char kHex[] = "0123456789abcdef";
+  switch (c) {
+  case '"':
+    out += "\\\"";
+    break;
+  case '\\':
+    out += "\\\\";
+    break;
+  case '\b':
+    out += "\\b";
+    break;
+  case '\f':
+    out += "\\f";
+    break;
+  case '\n':
+    out += "\\n";
+    break;
+  case '\r':
+    out += "\\r";
+    break;
+  case '\t':
+    out += "\\t";
+    break;
+  default:
+    out += "\\u00";
+    out += kHex[c >> 4];
+    out += kHex[c & 0xf];
+  }
+}
+
+void WriteString(std::string &out, std::string_view str) {
+  const char *data = str.data();
+  const size_t size = str.size();
+  size_t begin = 0;
+  size_t i = 0;
+
+  out += '"';
+  while (i < size) {
+    /* Skip 8 clean bytes at a time */
+    if (i + 8 <= size) {
+      uint64_t word;
+      std::memcpy(&word, data + i, sizeof(word));
+      if (!NeedsEscape(word)) {
+        i += 8;
+        continue;
+      }
+    }
+    const unsigned char c = data[i];
+    if (NeedsEscape(c)) {
+      out.append(data + begin, i - begin);
+      WriteEscaped(out, c);
+      begin = i + 1;
+    }
+    i++;
+  }
+  out.append(data + begin, size - begin);
+  out += '"';
+}
+
+void WriteInt(std::string &out, int64_t value) {
+  char buf[24];
+  const auto result = std::to_chars(buf, buf + sizeof(buf), value);
+  out.append(buf, result.ptr - buf);
+}
+
+void WriteJson(std::string &out, const nlohmann::json &js) {
+  switch (js.type()) {
+  case nlohmann::json::value_t::null:
+    out += "null";
+    break;
+  case nlohmann::json::value_t::boolean:
+    out += js.get<bool>() ? "true" : "false";
+    break;
+  case nlohmann::json::value_t::number_integer:
+    WriteInt(out, js.get<int64_t>());
+    break;
+  case nlohmann::json::value_t::number_unsigned: {
+    char buf[24];
+    const auto result =
+        std::to_chars(buf, buf + sizeof(buf), js.get<uint64_t>());
+    out.append(buf, result.ptr - buf);
+    break;
+  }
+  case nlohmann::json::value_t::string:
+    WriteString(out, js.get_ref<const std::string &>());
+    break;
+  case nlohmann::json::value_t::array: {
+    out += '[';
+    bool first = true;
+    for (auto &element : js) {
+      if (!first) {
+        out += ',';
+      }
+      first = false;
+      WriteJson(out, element);
+    }
+    out += ']';
+    break;
+  }
+  case nlohmann::json::value_t::object: {
+    out += '{';
+    bool first = true;
+    for (auto it = js.begin(); it != js.end(); ++it) {
+      if (!first) {
+        out += ',';
+      }
+      first = false;
+      WriteString(out, it.key());
+      out += ':';
+      WriteJson(out, it.value());
+    }
+    out += '}';
+    break;
+  }
+  default:
+    /* Floats and binary values are rare, use nlohmann's own formatting */
+    out += js.dump();
+  }
+}
+
+std::string TakeBuffer() {
+  std::string buffer;
+  buffer.reserve(last_buffer_size);
+  return buffer;
+}
+
+void RecordBufferSize(size_t size) {
+  last_buffer_size = size < kMaxReserve ? size : kMaxReserve;
+}
+
+} // namespace JsonWriter
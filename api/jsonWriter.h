@@ -0,0 +1,92 @@
+/**
+ * @file jsonWriter.h
+ * @brief Helpers that serialize response bodies straight into a string.
+ *
+ * Building a nlohmann::json object for every response copies the data into the
+ * tree, dump() copies it into a new string, and set_content copies it again.
+ * These helpers append the JSON text of each value to the response string
+ * directly: strings are escaped a word at a time and copied in runs, and
+ * nlohmann::json values are walked without an intermediate dump. Each value is
+ * written as nlohmann::json::dump() writes it, objects with sorted keys. The
+ * fields of a response body are written in the order they are given instead,
+ * "msg" before "data", where dump() of the whole body sorted them.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace JsonWriter {
+
+/**
+ * @brief Append a JSON string literal, with quotes, escaped as dump() does.
+ *
+ * @param out String to append to.
+ * @param str Raw string.
+ */
+void WriteString(std::string &out, std::string_view str);
+
+/**
+ * @brief Append the JSON text of a nlohmann::json value.
+ *
+ * @param out String to append to.
+ * @param js Value to write.
+ */
+void WriteJson(std::string &out, const nlohmann::json &js);
+
+/**
+ * @brief Append an integer.
+ *
+ * @param out String to append to.
+ * @param value Value to write.
+ */
+void WriteInt(std::string &out, int64_t value);
+
+/**
+ * @brief Get an empty string for a response body on the current thread, with
+ * as much room reserved as the previous body of this thread needed.
+ */
+std::string TakeBuffer();
+
+/**
+ * @brief Remember how large a response body was, for the next TakeBuffer.
+ */
+void RecordBufferSize(size_t size);
+
+/* Write any value a response field may hold */
+inline void WriteValue(std::string &out, std::string_view str) {
+  WriteString(out, str);
+}
+
+inline void WriteValue(std::string &out, const std::string &str) {
+  WriteString(out, str);
+}
+
+inline void WriteValue(std::string &out, const char *str) {
+  WriteString(out, str);
+}
+
+inline void WriteValue(std::string &out, const nlohmann::json &js) {
+  WriteJson(out, js);
+}
+
+inline void WriteValue(std::string &out, bool value) {
+  out += value ? "true" : "false";
+}
+
+template <typename Integer,
+          std::enable_if_t<std::is_integral<Integer>::value &&
+                               !std::is_same<Integer, bool>::value,
+                           bool> = true>
+inline void WriteValue(std::string &out, Integer value) {
+  WriteInt(out, static_cast<int64_t>(value));
+}
+
+} // namespace JsonWriter
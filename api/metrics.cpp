@@ -0,0 +1,218 @@
+#include "metrics.h"
+#include <algorithm>
+#include <cstdio>
+
+/* Escape a label value, \, " and new lines are escaped */
+static void WriteLabelValue(std::string &out, const std::string &value) {
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      out += '\\';
+      out += c;
+    } else if (c == '\n') {
+      out += "\\n";
+    } else {
+      out += c;
+    }
+  }
+}
+
+static std::string FormatLabels(const Metrics::Labels &labels) {
+  std::string out;
+  for (auto &label : labels) {
+    if (!out.empty()) {
+      out += ',';
+    }
+    out += label.first;
+    out += "=\"";
+    WriteLabelValue(out, label.second);
+    out += '"';
+  }
+  return out;
+}
+
+static void WriteNumber(std::string &out, double value) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%.9g", value);
+  out += buf;
+}
+
+static void WriteNumber(std::string &out, uint64_t value) {
+  out += std::to_string(value);
+}
+
+static void WriteNumber(std::string &out, int64_t value) {
+  out += std::to_string(value);
+}
+
+/* Write one sample line, name{labels,extra} value */
+template <typename Value>
+static void WriteSample(std::string &out, const std::string &name,
+                        const std::string &labels, const std::string &extra,
+                        Value value) {
+  out += name;
+  if (!labels.empty() || !extra.empty()) {
+    out += '{';
+    out += labels;
+    if (!labels.empty() && !extra.empty()) {
+      out += ',';
+    }
+    out += extra;
+    out += '}';
+  }
+  out += ' ';
+  WriteNumber(out, value);
+  out += '\n';
+}
+
+uint64_t Metrics::Counter::Value() const {
+  uint64_t value = 0;
+  for (auto &shard : shards) {
+    value += shard.value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
+
+int64_t Metrics::Gauge::Value() const {
+  int64_t value = 0;
+  for (auto &shard : shards) {
+    value += shard.value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
+
+Metrics::Histogram::Histogram(std::vector<uint64_t> bounds)
+    : bounds(std::move(bounds)) {
+  for (size_t i = 0; i < kShards; i++) {
+    shards.push_back(std::make_unique<Shard>(this->bounds.size() + 1));
+  }
+}
+
+void Metrics::Histogram::Observe(uint64_t us) {
+  Shard &shard = *shards[ShardIndex()];
+  /* Few buckets, a linear search beats a binary one */
+  size_t i = 0;
+  while (i < bounds.size() && us > bounds[i]) {
+    i++;
+  }
+  shard.buckets[i].fetch_add(1, std::memory_order_relaxed);
+  shard.sum_us.fetch_add(us, std::memory_order_relaxed);
+}
+
+const std::vector<uint64_t> &Metrics::LatencyBounds() {
+  static const std::vector<uint64_t> bounds = {
+      100,    250,    500,     1000,    2500,    5000,    10000,
+      25000,  50000,  100000,  250000,  500000,  1000000, 2500000,
+      5000000, 10000000};
+  return bounds;
+}
+
+Metrics::Series &Metrics::Find(const std::string &name,
+                               const std::string &help, Type type,
+                               const Labels &labels) {
+  auto it = family_index.find(name);
+  if (it == family_index.end()) {
+    it = family_index.emplace(name, families.size()).first;
+    families.push_back({name, help, type, {}, {}});
+  }
+  Family &family = families[it->second];
+
+  std::string rendered = FormatLabels(labels);
+  auto series = family.index.find(rendered);
+  if (series == family.index.end()) {
+    series = family.index.emplace(rendered, family.series.size()).first;
+    family.series.push_back({std::move(rendered), nullptr, nullptr, nullptr,
+                             nullptr});
+  }
+  return family.series[series->second];
+}
+
+Metrics::Counter *Metrics::GetCounter(const std::string &name,
+                                      const std::string &help,
+                                      const Labels &labels) {
+  std::lock_guard<std::mutex> guard(lock);
+  Series &series = Find(name, help, COUNTER, labels);
+  if (!series.counter) {
+    series.counter = std::make_unique<Counter>();
+  }
+  return series.counter.get();
+}
+
+Metrics::Gauge *Metrics::GetGauge(const std::string &name,
+                                  const std::string &help,
+                                  const Labels &labels) {
+  std::lock_guard<std::mutex> guard(lock);
+  Series &series = Find(name, help, GAUGE, labels);
+  if (!series.gauge) {
+    series.gauge = std::make_unique<Gauge>();
+  }
+  return series.gauge.get();
+}
+
+Metrics::Histogram *
+Metrics::GetHistogram(const std::string &name, const std::string &help,
+                      const Labels &labels,
+                      const std::vector<uint64_t> &bounds) {
+  std::lock_guard<std::mutex> guard(lock);
+  Series &series = Find(name, help, HISTOGRAM, labels);
+  if (!series.histogram) {
+    series.histogram = std::make_unique<Histogram>(bounds);
+  }
+  return series.histogram.get();
+}
+
+void Metrics::AddCallback(const std::string &name, const std::string &help,
+                          bool is_counter, std::function<double()> read,
+                          const Labels &labels) {
+  std::lock_guard<std::mutex> guard(lock);
+  Find(name, help, is_counter ? COUNTER : GAUGE, labels).read =
+      std::move(read);
+}
+
+std::string Metrics::Render() const {
+  static const char *const type_names[] = {"counter", "gauge", "histogram"};
+  std::lock_guard<std::mutex> guard(lock);
+  std::string out;
+  for (auto &family : families) {
+    out += "# HELP " + family.name + " " + family.help + "\n";
+    out += "# TYPE " + family.name + " " + type_names[family.type] + "\n";
+    for (auto &series : family.series) {
+      if (series.read) {
+        WriteSample(out, family.name, series.labels, "", series.read());
+      } else if (series.counter) {
+        WriteSample(out, family.name, series.labels, "",
+                    series.counter->Value());
+      } else if (series.gauge) {
+        WriteSample(out, family.name, series.labels, "",
+                    series.gauge->Value());
+      } else if (series.histogram) {
+        const Histogram &histogram = *series.histogram;
+        const size_t n = histogram.bounds.size() + 1;
+        std::vector<uint64_t> buckets(n);
+        uint64_t sum_us = 0;
+        for (auto &shard : histogram.shards) {
+          for (size_t i = 0; i < n; i++) {
+            buckets[i] += shard->buckets[i].load(std::memory_order_relaxed);
+          }
+          sum_us += shard->sum_us.load(std::memory_order_relaxed);
+        }
+        /* Buckets are cumulative, bounds in seconds */
+        uint64_t count = 0;
+        for (size_t i = 0; i < n; i++) {
+          count += buckets[i];
+          std::string le = "le=\"";
+          if (i + 1 < n) {
+            WriteNumber(le, histogram.bounds[i] / 1e6);
+          } else {
+            le += "+Inf";
+          }
+          le += '"';
+          WriteSample(out, family.name + "_bucket", series.labels, le, count);
+        }
+        WriteSample(out, family.name + "_sum", series.labels, "",
+                    sum_us / 1e6);
+        WriteSample(out, family.name + "_count", series.labels, "", count);
+      }
+    }
+  }
+  return out;
+}
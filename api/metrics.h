@@ -0,0 +1,182 @@
+/**
+ * @file metrics.h
+ * @brief Definition of Metrics, a registry of counters, gauges and histograms
+ * rendered in the Prometheus text exposition format.
+ *
+ * Recording is on the path of every request, so it takes no lock: a counter
+ * is split into shards on separate cache lines, and each thread adds to the
+ * shard picked by its index with one relaxed atomic add. Reading sums the
+ * shards, which only happens when the metrics are scraped. Histograms keep
+ * their buckets per shard the same way, and count durations in whole
+ * microseconds so their sum stays an integer.
+ *
+ * Metrics are registered under a lock, once per series, and live as long as
+ * the registry: the pointers handed out can be kept and used without it.
+ * Values owned by other objects, e.g. the size of a cache, are registered as
+ * callbacks read at scrape time.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class Metrics {
+public:
+  using Labels = std::vector<std::pair<std::string, std::string>>;
+
+  /* Enough to keep the threads of a pool on different cache lines */
+  static constexpr size_t kShards = 16;
+
+  class Counter {
+  public:
+    void Add(uint64_t n = 1) {
+      shards[ShardIndex()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+    uint64_t Value() const;
+
+  private:
+    struct alignas(64) Shard {
+      std::atomic<uint64_t> value{0};
+    };
+    Shard shards[kShards];
+  };
+
+  class Gauge {
+  public:
+    void Add(int64_t n) {
+      shards[ShardIndex()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+    int64_t Value() const;
+
+  private:
+    struct alignas(64) Shard {
+      std::atomic<int64_t> value{0};
+    };
+    Shard shards[kShards];
+  };
+
+  class Histogram {
+  public:
+    /**
+     * @brief Construct a new Histogram object.
+     *
+     * @param bounds Upper bounds of the buckets in microseconds, ascending.
+     */
+    explicit Histogram(std::vector<uint64_t> bounds);
+
+    /**
+     * @brief Count a duration.
+     *
+     * @param us The duration in microseconds.
+     */
+    void Observe(uint64_t us);
+
+  private:
+    friend class Metrics;
+
+    struct alignas(64) Shard {
+      explicit Shard(size_t n) : buckets(n) {}
+      /* one per bound, and one past the last */
+      std::vector<std::atomic<uint64_t>> buckets;
+      std::atomic<uint64_t> sum_us{0};
+    };
+
+    const std::vector<uint64_t> bounds;
+    std::vector<std::unique_ptr<Shard>> shards;
+  };
+
+  /**
+   * @brief Bounds of latency histograms, from 100us to 10s.
+   */
+  static const std::vector<uint64_t> &LatencyBounds();
+
+  /**
+   * @brief Get the counter of a series, registering it the first time.
+   *
+   * @param name Name of the metric, e.g. "lqxx_http_requests_total".
+   * @param help One line describing the metric, taken from its first series.
+   * @param labels Labels of the series.
+   * @return Counter* The counter, valid as long as the registry.
+   */
+  Counter *GetCounter(const std::string &name, const std::string &help,
+                      const Labels &labels = {});
+
+  /**
+   * @brief Get the gauge of a series, registering it the first time.
+   */
+  Gauge *GetGauge(const std::string &name, const std::string &help,
+                  const Labels &labels = {});
+
+  /**
+   * @brief Get the histogram of a series, registering it the first time.
+   *
+   * @param bounds Bucket bounds in microseconds, used the first time only.
+   */
+  Histogram *GetHistogram(const std::string &name, const std::string &help,
+                          const Labels &labels = {},
+                          const std::vector<uint64_t> &bounds =
+                              LatencyBounds());
+
+  /**
+   * @brief Register a counter or gauge whose value is read from a callback
+   * when the metrics are rendered.
+   *
+   * @param is_counter Whether the value only grows.
+   * @param read Returns the value, called from the thread rendering.
+   */
+  void AddCallback(const std::string &name, const std::string &help,
+                   bool is_counter, std::function<double()> read,
+                   const Labels &labels = {});
+
+  /**
+   * @brief Render all metrics in the text exposition format, version 0.0.4.
+   */
+  std::string Render() const;
+
+private:
+  enum Type { COUNTER, GAUGE, HISTOGRAM };
+
+  struct Series {
+    /* rendered labels, e.g. route="/v1/sync",code="200" */
+    std::string labels;
+    std::unique_ptr<Counter> counter;
+    std::unique_ptr<Gauge> gauge;
+    std::unique_ptr<Histogram> histogram;
+    std::function<double()> read;
+  };
+
+  struct Family {
+    std::string name;
+    std::string help;
+    Type type;
+    std::vector<Series> series;
+    std::unordered_map<std::string, size_t> index;
+  };
+
+  /* Shard of the calling thread */
+  static size_t ShardIndex() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t index = next++ % kShards;
+    return index;
+  }
+
+  /* The series of a family, added if missing, the lock must be held */
+  Series &Find(const std::string &name, const std::string &help, Type type,
+               const Labels &labels);
+
+  mutable std::mutex lock;
+  /* in the order they were registered */
+  std::vector<Family> families;
+  std::unordered_map<std::string, size_t> family_index;
+};
@@ -0,0 +1,57 @@
+#include "rateLimiter.h"
+#include <algorithm>
+#include <functional>
+
+RateLimiter::RateLimiter(double rate, double burst, size_t n_shards)
+    : rate(std::max(rate, 1e-6)), burst(std::max(burst, 1.0)),
+      idle(std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(this->burst / this->rate))) {
+  n_shards = std::max<size_t>(n_shards, 1);
+  for (size_t i = 0; i < n_shards; i++) {
+    shards.push_back(std::make_unique<Shard>());
+  }
+}
+
+bool RateLimiter::Allow(const std::string &key, Clock::duration *retry_after,
+                        Clock::time_point now) {
+  Shard &shard = ShardOf(key);
+  std::lock_guard<std::mutex> guard(shard.lock);
+  if (now - shard.last_sweep >= idle) {
+    Sweep(shard, now);
+  }
+
+  auto it = shard.buckets.find(key);
+  if (it == shard.buckets.end()) {
+    it = shard.buckets.emplace(key, Bucket{burst, now}).first;
+    count++;
+  }
+  Bucket &bucket = it->second;
+  const std::chrono::duration<double> elapsed = now - bucket.last;
+  if (elapsed.count() > 0) {
+    bucket.tokens = std::min(burst, bucket.tokens + elapsed.count() * rate);
+    bucket.last = now;
+  }
+  if (bucket.tokens >= 1) {
+    bucket.tokens -= 1;
+    return true;
+  }
+  *retry_after = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>((1 - bucket.tokens) / rate));
+  return false;
+}
+
+void RateLimiter::Sweep(Shard &shard, Clock::time_point now) {
+  shard.last_sweep = now;
+  for (auto it = shard.buckets.begin(); it != shard.buckets.end();) {
+    if (now - it->second.last >= idle) {
+      it = shard.buckets.erase(it);
+      count--;
+    } else {
+      it++;
+    }
+  }
+}
+
+RateLimiter::Shard &RateLimiter::ShardOf(const std::string &key) const {
+  return *shards[std::hash<std::string>{}(key) % shards.size()];
+}
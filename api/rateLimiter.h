@@ -0,0 +1,83 @@
+/**
+ * @file rateLimiter.h
+ * @brief Definition of RateLimiter, a token bucket per key, e.g. per user.
+ *
+ * Every key gets a bucket holding up to burst tokens, refilled at rate tokens
+ * per second. A request takes one token, and is refused when the bucket is
+ * empty, together with the time until the next token. So a client may send
+ * burst requests at once, then rate requests per second, and one script in a
+ * loop is held to that before it reaches the DB, whatever the others do.
+ *
+ * Buckets are kept in shards like VerifiedTokenCache, each behind its own
+ * lock. A bucket left alone long enough to refill is the same as no bucket,
+ * so buckets idle for that long are dropped when their shard is swept, and
+ * the table only holds the recently active keys.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class RateLimiter {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @brief Construct a new Rate Limiter object.
+   *
+   * @param rate Tokens added to a bucket per second, more than 0.
+   * @param burst Max number of tokens in a bucket, at least 1.
+   * @param n_shards Number of shards, at least 1.
+   */
+  RateLimiter(double rate, double burst, size_t n_shards = 16);
+
+  /**
+   * @brief Take a token from the bucket of a key.
+   *
+   * @param key The key, e.g. the email of a user.
+   * @param retry_after When refused, the time until a token is available will
+   * be put there.
+   * @param now The current time.
+   * @return true if the request may go on.
+   */
+  bool Allow(const std::string &key, Clock::duration *retry_after,
+             Clock::time_point now = Clock::now());
+
+  /**
+   * @brief Number of buckets kept.
+   */
+  size_t Size() const { return count.load(); }
+
+private:
+  struct Bucket {
+    double tokens;
+    Clock::time_point last;
+  };
+
+  struct Shard {
+    std::mutex lock;
+    std::unordered_map<std::string, Bucket> buckets;
+    Clock::time_point last_sweep;
+  };
+
+  /* Drop the buckets that have refilled, the lock must be held */
+  void Sweep(Shard &shard, Clock::time_point now);
+
+  Shard &ShardOf(const std::string &key) const;
+
+  const double rate;
+  const double burst;
+  /* time for an empty bucket to refill */
+  const Clock::duration idle;
+  std::vector<std::unique_ptr<Shard>> shards;
+  std::atomic<size_t> count{0};
+};
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 /*
  * @brief This is a structure that specifies which object is what we try to
@@ -27,6 +30,43 @@ struct RequestData {
    *
    */
   std::string other_user_key;
+  /**
+   * @brief Group id
+   *
+   */
+  std::string group_key;
+  /**
+   * @brief field names the client asked for, empty for all fields
+   *
+   */
+  std::vector<std::string> fields;
+  /**
+   * @brief number of items to skip when listing
+   *
+   */
+  size_t offset = 0;
+  /**
+   * @brief max number of items to list, 0 for no limit
+   *
+   */
+  size_t limit = 0;
+  /**
+   * @brief what the user may do on the tasklist, resolved once per request by
+   * TaskListsWorker::ResolveAccess, so that the workers do not probe it again
+   *
+   */
+  struct Access {
+    /* the fields below are only meaningful once resolved */
+    bool resolved = false;
+    /* other_user_key if set, user_key otherwise */
+    std::string owner;
+    bool exists = false;
+    bool readable = false;
+    bool writable = false;
+    /* version of the task if the request names one, of the tasklist
+       otherwise, -1 if there is no such task */
+    int64_t version = -1;
+  } access;
 
   /* methods */
   /*
@@ -60,16 +100,25 @@ struct RequestData {
     tasklist_key = data.tasklist_key;
     task_key = data.task_key;
     other_user_key = data.other_user_key;
+    group_key = data.group_key;
+    fields = data.fields;
+    offset = data.offset;
+    limit = data.limit;
+    access = data.access;
   }
   /*
-   * @brief operator == overload
+   * @brief operator == overload, the access is derived from the keys and is
+   * not compared
    * @param data RequestData object to compare
    */
   bool operator==(const RequestData &other) const {
     return this->user_key == other.user_key &&
            this->tasklist_key == other.tasklist_key &&
            this->task_key == other.task_key &&
-           this->other_user_key == other.other_user_key;
+           this->other_user_key == other.other_user_key &&
+           this->group_key == other.group_key &&
+           this->fields == other.fields && this->offset == other.offset &&
+           this->limit == other.limit;
   }
   /*
    * @brief Check if the User id is empty, const method
@@ -85,6 +134,14 @@ struct RequestData {
     return user_key == "" || tasklist_key == "";
   }
 
+  /*
+   * @brief For GroupsWorker in request
+   * @return true if the Group id is empty
+   */
+  bool RequestGroupIsEmpty() const {
+    return user_key == "" || group_key == "";
+  }
+
   /*
    * @brief For TaskWorker in request
    * @return true if the Task id is empty
@@ -0,0 +1,165 @@
+#include "router.h"
+#include <algorithm>
+
+/* Captures of the route being handled by the current thread */
+static thread_local std::vector<std::string> current_captures;
+
+/**
+ * @brief Split a path into its segments, "/a/b" gives "a" and "b".
+ *
+ * @return Number of segments, or max + 1 if there are more than max.
+ */
+static size_t SplitPath(std::string_view path, std::string_view *segments,
+                        size_t max) {
+  if (path.empty() || path[0] != '/') {
+    return max + 1;
+  }
+  size_t n = 0;
+  size_t begin = 1;
+  for (;;) {
+    if (n == max) {
+      return max + 1;
+    }
+    size_t end = path.find('/', begin);
+    if (end == std::string_view::npos) {
+      segments[n++] = path.substr(begin);
+      return n;
+    }
+    segments[n++] = path.substr(begin, end - begin);
+    begin = end + 1;
+  }
+}
+
+static bool IsDigits(std::string_view segment) {
+  return !segment.empty() &&
+         std::all_of(segment.begin(), segment.end(),
+                     [](char c) { return c >= '0' && c <= '9'; });
+}
+
+void Router::Add(const std::string &method, const std::string &pattern,
+                 Handler handler) {
+  std::string_view segments[kMaxSegments];
+  size_t n = SplitPath(pattern, segments, kMaxSegments);
+  Node *node = &roots[method];
+  for (size_t i = 0; i < n && i < kMaxSegments; i++) {
+    std::string_view segment = segments[i];
+    std::unique_ptr<Node> *child = nullptr;
+    if (segment.size() > 2 && segment.front() == '{' &&
+        segment.back() == '}') {
+      bool is_int = segment.size() > 6 &&
+                    segment.substr(segment.size() - 5) == ":int}";
+      child = is_int ? &node->int_capture : &node->str_capture;
+    } else {
+      auto it = std::find_if(
+          node->literals.begin(), node->literals.end(),
+          [&segment](auto &literal) { return literal.first == segment; });
+      if (it == node->literals.end()) {
+        node->literals.emplace_back(std::string(segment), nullptr);
+        it = std::prev(node->literals.end());
+      }
+      child = &it->second;
+    }
+    if (!*child) {
+      *child = std::make_unique<Node>();
+    }
+    node = child->get();
+  }
+  node->handler = std::move(handler);
+}
+
+bool Router::Dispatch(const httplib::Request &req,
+                      httplib::Response &res) const {
+  /* HEAD is served by the GET routes, as httplib does */
+  const auto root = roots.find(req.method == "HEAD" ? "GET" : req.method);
+  if (root == roots.end()) {
+    return false;
+  }
+
+  std::string_view segments[kMaxSegments];
+  size_t n = SplitPath(req.path, segments, kMaxSegments);
+  if (n > kMaxSegments) {
+    return false;
+  }
+
+  std::vector<std::string> &captures = current_captures;
+  captures.clear();
+  captures.emplace_back(req.path);
+  const Node *node = Find(&root->second, segments, n, captures);
+  if (!node) {
+    return false;
+  }
+  node->handler(req, res);
+  return true;
+}
+
+void Router::Install(httplib::Server &svr) {
+  svr.set_pre_routing_handler(
+      [this](const httplib::Request &req, httplib::Response &res) {
+        if (request_hook) {
+          request_hook(req);
+        }
+        if (req.method == "OPTIONS" && options) {
+          options(req, res);
+          return httplib::Server::HandlerResponse::Handled;
+        }
+        if (req.method == "GET" || req.method == "HEAD") {
+          return Dispatch(req, res)
+                     ? httplib::Server::HandlerResponse::Handled
+                     : httplib::Server::HandlerResponse::Unhandled;
+        }
+        return httplib::Server::HandlerResponse::Unhandled;
+      });
+
+  auto dispatch = [this](const httplib::Request &req,
+                         httplib::Response &res) {
+    if (!Dispatch(req, res)) {
+      res.status = 404;
+    }
+  };
+  svr.Post(".*", dispatch);
+  svr.Put(".*", dispatch);
+  svr.Delete(".*", dispatch);
+  svr.Patch(".*", dispatch);
+}
+
+const std::string &Router::Match(size_t i) {
+  static const std::string empty;
+  return i < current_captures.size() ? current_captures[i] : empty;
+}
+
+const Router::Node *Router::Find(const Node *node,
+                                 const std::string_view *segments, size_t n,
+                                 std::vector<std::string> &captures) const {
+  if (n == 0) {
+    return node->handler ? node : nullptr;
+  }
+
+  /* Literal segments first, then digits, then any segment */
+  const std::string_view segment = segments[0];
+  for (auto &literal : node->literals) {
+    if (literal.first == segment) {
+      if (const Node *found = Find(literal.second.get(), segments + 1, n - 1,
+                                   captures)) {
+        return found;
+      }
+      break;
+    }
+  }
+  if (node->int_capture && IsDigits(segment)) {
+    captures.emplace_back(segment);
+    if (const Node *found =
+            Find(node->int_capture.get(), segments + 1, n - 1, captures)) {
+      return found;
+    }
+    captures.pop_back();
+  }
+  if (node->str_capture && !segment.empty()) {
+    captures.emplace_back(segment);
+    if (const Node *found =
+            Find(node->str_capture.get(), segments + 1, n - 1, captures)) {
+      return found;
+    }
+    captures.pop_back();
+  }
+  return nullptr;
+}
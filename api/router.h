@@ -0,0 +1,108 @@
+/**
+ * @file router.h
+ * @brief Definition of Router, which maps request paths to http handlers.
+ *
+ * httplib matches a request against its routes one by one with
+ * std::regex_match. Router instead compiles the route table into one trie of
+ * path segments per method: a request walks down one node per segment, trying
+ * a literal segment before a capture, so a lookup costs O(path segments) and
+ * never runs a regex. Patterns are written with typed captures:
+ *
+ *   /v1/task_lists/{list}/tasks/{task}   {name} matches any non-empty segment
+ *   /health/{n:int}                      {name:int} matches digits only
+ *
+ * The captures of the route being handled are read with Router::Match(i),
+ * i = 1 for the first one, like std::smatch.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <functional>
+#include <httplib.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class Router {
+public:
+  using Handler =
+      std::function<void(const httplib::Request &, httplib::Response &)>;
+
+  /**
+   * @brief Add a route.
+   *
+   * @param method Http method, e.g. "GET".
+   * @param pattern Path pattern, see the file comment.
+   * @param handler Handler of the matching requests.
+   */
+  void Add(const std::string &method, const std::string &pattern,
+           Handler handler);
+
+  /**
+   * @brief Set the handler of all OPTIONS requests, whatever their path.
+   *
+   * @param handler Handler of the preflight requests.
+   */
+  void SetOptions(Handler handler) { options = std::move(handler); }
+
+  /**
+   * @brief Set a function run on the worker thread at the start of every
+   * request, before it is routed, e.g. to time it.
+   *
+   * @param hook The function, must be set before Install.
+   */
+  void SetRequestHook(std::function<void(const httplib::Request &)> hook) {
+    request_hook = std::move(hook);
+  }
+
+  /**
+   * @brief Find the route of a request and run its handler.
+   *
+   * @return false if no route matches, nothing is run.
+   */
+  bool Dispatch(const httplib::Request &req, httplib::Response &res) const;
+
+  /**
+   * @brief Route requests of a server through this router.
+   *
+   * Requests without a body are dispatched before httplib reads anything else.
+   * Requests of methods that may carry a body go through one catch-all route
+   * per method, so that httplib has read the body when the handler runs.
+   *
+   * @param svr The server.
+   */
+  void Install(httplib::Server &svr);
+
+  /**
+   * @brief Get a capture of the route being handled on the current thread.
+   *
+   * @param i 0 for the whole path, 1 for the first capture, etc.
+   * @return const std::string& The capture, empty if there is no such one.
+   */
+  static const std::string &Match(size_t i);
+
+private:
+  /* Requests with more segments never match */
+  static constexpr size_t kMaxSegments = 16;
+
+  struct Node {
+    /* Few per node, compared in place without building a key */
+    std::vector<std::pair<std::string, std::unique_ptr<Node>>> literals;
+    std::unique_ptr<Node> int_capture;
+    std::unique_ptr<Node> str_capture;
+    Handler handler;
+  };
+
+  const Node *Find(const Node *node, const std::string_view *segments,
+                   size_t n, std::vector<std::string> &captures) const;
+
+  std::unordered_map<std::string, Node> roots;
+  Handler options;
+  std::function<void(const httplib::Request &)> request_hook;
+};
@@ -75,6 +75,17 @@ struct TaskContent {
         priority(std::forward<PriorityType>(_priority)),
         status(std::forward<Status>(_status)) {}
 
+  /*
+   * @brief Check if a field name is a stored task field
+   * @param field field name, as stored in the database
+   * @return true if it is a task field
+   */
+  static bool IsField(const std::string &field) {
+    return field == "name" || field == "content" || field == "startDate" ||
+           field == "endDate" || field == "date" || field == "priority" ||
+           field == "status";
+  }
+
   /*
    * @brief Check if the task has a name
    * @return true if the task has a name
@@ -168,3 +179,32 @@ struct TaskContent {
     return true;
   }
 };
+
+/*
+ * @brief This is a structure that uses as output for the agenda of a user. It
+ * contains a task together with the tasklist it belongs to
+ */
+struct AgendaItem {
+  /*
+   * @brief owner of the tasklist
+   */
+  std::string user_name;
+  /*
+   * @brief tasklist name
+   */
+  std::string task_list_name;
+  /*
+   * @brief permission on the tasklist: true for write, false for read only
+   */
+  bool permission;
+  /*
+   * @brief task content
+   */
+  TaskContent task;
+
+  /* methods */
+  /*
+   * @brief AgendaItem default constructor
+   */
+  AgendaItem() : permission(false) {}
+};
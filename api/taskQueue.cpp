@@ -0,0 +1,175 @@
+#include "taskQueue.h"
+#include <algorithm>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+/* Queue and worker id of the running thread, null off the workers and once
+   detached */
+thread_local WorkStealingQueue *current_queue = nullptr;
+thread_local size_t current_id = 0;
+} // namespace
+
+WorkStealingQueue::WorkStealingQueue(size_t n_threads, bool pin_cpus,
+                                     size_t max_queued,
+                                     std::shared_ptr<TaskQueueStats> stats)
+    : max_queued(max_queued), pin_cpus(pin_cpus), stats(stats) {
+  n_threads = std::max<size_t>(n_threads, 1);
+  for (size_t i = 0; i < n_threads; i++) {
+    deques.push_back(std::make_unique<Deque>());
+  }
+  threads.resize(n_threads);
+  for (size_t i = 0; i < n_threads; i++) {
+    Start(i);
+  }
+}
+
+WorkStealingQueue::~WorkStealingQueue() { shutdown(); }
+
+bool WorkStealingQueue::enqueue(std::function<void()> fn) {
+  {
+    std::lock_guard<std::mutex> guard(idle_lock);
+    if (stopping) {
+      return false;
+    }
+  }
+  if (max_queued > 0 && pending.load() >= max_queued) {
+    if (stats) {
+      stats->rejected++;
+    }
+    return false;
+  }
+
+  /* Count the task first so that no worker sees it taken before counted */
+  pending++;
+  if (stats) {
+    stats->depth++;
+  }
+  Deque &target = *deques[next++ % deques.size()];
+  {
+    std::lock_guard<std::mutex> guard(target.lock);
+    target.tasks.push_back({std::move(fn), Clock::now()});
+  }
+
+  /* Taking the lock orders this wake-up after a worker checked pending */
+  { std::lock_guard<std::mutex> guard(idle_lock); }
+  idle_cond.notify_one();
+  return true;
+}
+
+void WorkStealingQueue::shutdown() {
+  {
+    std::lock_guard<std::mutex> guard(idle_lock);
+    stopping = true;
+  }
+  idle_cond.notify_all();
+  for (auto &thread : threads) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+  /* Detached threads still use the queue when their task ends */
+  std::unique_lock<std::mutex> guard(idle_lock);
+  detached_cond.wait(guard, [this] { return detached == 0; });
+}
+
+bool WorkStealingQueue::Detach() {
+  WorkStealingQueue *queue = current_queue;
+  if (!queue) {
+    return false;
+  }
+  std::lock_guard<std::mutex> guard(queue->idle_lock);
+  /* shutdown joins the workers once stopping is set, leave them be */
+  if (queue->stopping) {
+    return false;
+  }
+  queue->threads[current_id].detach();
+  queue->Start(current_id);
+  queue->detached++;
+  current_queue = nullptr;
+  return true;
+}
+
+void WorkStealingQueue::Start(size_t id) {
+  threads[id] = std::thread(&WorkStealingQueue::Work, this, id);
+#ifdef __linux__
+  if (pin_cpus) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(id % std::max(std::thread::hardware_concurrency(), 1u), &cpus);
+    pthread_setaffinity_np(threads[id].native_handle(), sizeof(cpus), &cpus);
+  }
+#endif
+}
+
+bool WorkStealingQueue::Pop(size_t id, Task &task) {
+  /* Own deque first, oldest task first */
+  {
+    Deque &own = *deques[id];
+    std::lock_guard<std::mutex> guard(own.lock);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.front());
+      own.tasks.pop_front();
+      pending--;
+      return true;
+    }
+  }
+  /* Steal the newest task of another worker */
+  for (size_t i = 1; i < deques.size(); i++) {
+    Deque &victim = *deques[(id + i) % deques.size()];
+    std::lock_guard<std::mutex> guard(victim.lock);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.back());
+      victim.tasks.pop_back();
+      pending--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingQueue::Work(size_t id) {
+  current_queue = this;
+  current_id = id;
+  for (;;) {
+    Task task;
+    if (Pop(id, task)) {
+      RecordWait(task);
+      task.fn();
+      if (!current_queue) {
+        /* Detached, a new worker runs in this slot. Notify under the lock so
+           that shutdown does not return before this thread is done with it */
+        std::lock_guard<std::mutex> guard(idle_lock);
+        detached--;
+        detached_cond.notify_all();
+        return;
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> guard(idle_lock);
+    idle_cond.wait(guard, [this] { return pending.load() > 0 || stopping; });
+    /* Waiting tasks are still run after shutdown */
+    if (stopping && pending.load() == 0) {
+      return;
+    }
+  }
+}
+
+void WorkStealingQueue::RecordWait(const Task &task) {
+  if (!stats) {
+    return;
+  }
+  uint64_t wait_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                         Clock::now() - task.enqueued)
+                         .count();
+  stats->depth--;
+  stats->tasks++;
+  stats->wait_us_total += wait_us;
+  uint64_t longest = stats->wait_us_max.load();
+  while (wait_us > longest &&
+         !stats->wait_us_max.compare_exchange_weak(longest, wait_us)) {
+  }
+}
@@ -0,0 +1,153 @@
+/**
+ * @file taskQueue.h
+ * @brief Definition of WorkStealingQueue, the task queue of the http server.
+ *
+ * httplib runs every accepted connection as a task of its TaskQueue. The
+ * default ThreadPool keeps all tasks in one queue behind one mutex, with a
+ * thread count fixed at compile time. WorkStealingQueue gives each worker
+ * thread its own deque: new tasks are spread over the deques round-robin, a
+ * worker takes tasks from the front of its own deque and steals from the back
+ * of the others when it runs dry. The thread count is set at runtime, workers
+ * can be pinned to CPUs, and queue depth and wait time are exported through
+ * TaskQueueStats. A task that will run for long, like a change stream, can
+ * Detach its thread from the pool: a new worker takes its place and the task
+ * goes on outside of the thread count.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <httplib.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Counters of a task queue, shared with whoever wants to observe it.
+ * They outlive the queue, which is owned and deleted by httplib.
+ */
+struct TaskQueueStats {
+  /**
+   * @brief number of tasks waiting for a worker
+   *
+   */
+  std::atomic<size_t> depth{0};
+
+  /**
+   * @brief number of tasks taken by a worker
+   *
+   */
+  std::atomic<uint64_t> tasks{0};
+
+  /**
+   * @brief number of tasks rejected because the queue was full
+   *
+   */
+  std::atomic<uint64_t> rejected{0};
+
+  /**
+   * @brief sum of the time tasks waited before running, in microseconds
+   *
+   */
+  std::atomic<uint64_t> wait_us_total{0};
+
+  /**
+   * @brief longest time a task waited before running, in microseconds
+   *
+   */
+  std::atomic<uint64_t> wait_us_max{0};
+};
+
+class WorkStealingQueue : public httplib::TaskQueue {
+public:
+  /**
+   * @brief Construct a new Work Stealing Queue object and start its workers.
+   *
+   * @param n_threads Number of worker threads, at least 1.
+   * @param pin_cpus Pin worker i to CPU i modulo the number of CPUs.
+   * @param max_queued Max number of waiting tasks, 0 for no limit.
+   * @param stats Counters to update, may be nullptr.
+   */
+  WorkStealingQueue(size_t n_threads, bool pin_cpus = false,
+                    size_t max_queued = 0,
+                    std::shared_ptr<TaskQueueStats> stats = nullptr);
+
+  /**
+   * @brief Destroy the Work Stealing Queue object, waits for all tasks.
+   */
+  ~WorkStealingQueue() override;
+
+  /**
+   * @brief Put a task into the deque of the next worker.
+   *
+   * @param fn Task to run.
+   * @return false if the queue is full or shut down, the task is dropped.
+   */
+  bool enqueue(std::function<void()> fn) override;
+
+  /**
+   * @brief Run all waiting tasks, then stop and join the workers, and wait
+   * for the detached tasks to end.
+   */
+  void shutdown() override;
+
+  /**
+   * @brief Called from a task, hand the worker slot of its thread to a new
+   * worker. The task goes on on its own thread, which ends with it.
+   *
+   * @return false if the caller is not a worker or the queue is shutting
+   * down, the task keeps its worker slot.
+   */
+  static bool Detach();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Task {
+    std::function<void()> fn;
+    Clock::time_point enqueued;
+  };
+
+  struct Deque {
+    std::mutex lock;
+    std::deque<Task> tasks;
+  };
+
+  /* Take a task from the deque of worker id, or steal one from the others */
+  bool Pop(size_t id, Task &task);
+
+  /* Start the thread of worker id, idle_lock held once workers run */
+  void Start(size_t id);
+
+  /* Main loop of worker id */
+  void Work(size_t id);
+
+  /* Record how long a task waited */
+  void RecordWait(const Task &task);
+
+  std::vector<std::unique_ptr<Deque>> deques;
+  std::vector<std::thread> threads;
+  std::atomic<size_t> next{0};
+  std::atomic<size_t> pending{0};
+  const size_t max_queued;
+  const bool pin_cpus;
+  std::shared_ptr<TaskQueueStats> stats;
+
+  /* Idle workers sleep on idle_cond, stopping is guarded by idle_lock */
+  std::mutex idle_lock;
+  std::condition_variable idle_cond;
+  bool stopping = false;
+
+  /* Tasks running on a detached thread, guarded by idle_lock */
+  size_t detached = 0;
+  std::condition_variable detached_cond;
+};
@@ -54,6 +54,16 @@ struct TasklistContent {
         content(std::forward<Content>(_content)),
         visibility(std::forward<Visibility>(_vis)) {}
 
+  /**
+   * @brief check if a field name is a stored tasklist field
+   *
+   * @param field field name, as stored in the database
+   * @return true if it is a tasklist field
+   */
+  static bool IsField(const std::string &field) {
+    return field == "name" || field == "content" || field == "visibility";
+  }
+
   /**
    * @brief check if the key -- name is missing
    *
@@ -105,6 +115,12 @@ struct shareInfo {
    */
   bool permission;
 
+  /**
+   * @brief true if user_name is the name of a group of users
+   * by default, it is a single user
+   */
+  bool is_group = false;
+
   /**
    * @brief Construct a new shareInfo object
    *
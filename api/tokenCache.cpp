@@ -0,0 +1,73 @@
+#include "tokenCache.h"
+#include <algorithm>
+#include <functional>
+#include <mutex>
+
+VerifiedTokenCache::VerifiedTokenCache(size_t capacity, size_t n_shards) {
+  n_shards = std::max<size_t>(n_shards, 1);
+  shard_capacity = std::max<size_t>(capacity / n_shards, 1);
+  for (size_t i = 0; i < n_shards; i++) {
+    shards.push_back(std::make_unique<Shard>());
+  }
+}
+
+bool VerifiedTokenCache::Find(const std::string &token,
+                              std::string *email) const {
+  Shard &shard = ShardOf(token);
+  std::shared_lock<std::shared_mutex> guard(shard.lock);
+  const auto it = shard.tokens.find(token);
+  if (it == shard.tokens.end() || it->second.expires <= Clock::now()) {
+    return false;
+  }
+  *email = it->second.email;
+  return true;
+}
+
+void VerifiedTokenCache::Insert(const std::string &token,
+                                const std::string &email,
+                                Clock::time_point expires) {
+  const auto now = Clock::now();
+  if (expires <= now) {
+    return;
+  }
+
+  Shard &shard = ShardOf(token);
+  std::unique_lock<std::shared_mutex> guard(shard.lock);
+  const auto found = shard.tokens.find(token);
+  if (found != shard.tokens.end()) {
+    shard.expiries.erase(found->second.expiry);
+    found->second.email = email;
+    found->second.expires = expires;
+    found->second.expiry = shard.expiries.emplace(expires, &found->first);
+    return;
+  }
+
+  /* Drop the expired tokens, then the one that expires first if still full */
+  while (!shard.expiries.empty() &&
+         (shard.expiries.begin()->first <= now ||
+          shard.tokens.size() >= shard_capacity)) {
+    const auto first = shard.expiries.begin();
+    shard.tokens.erase(shard.tokens.find(*first->second));
+    shard.expiries.erase(first);
+    count--;
+  }
+  const auto it = shard.tokens.emplace(token, Entry{email, expires, {}}).first;
+  it->second.expiry = shard.expiries.emplace(expires, &it->first);
+  count++;
+}
+
+void VerifiedTokenCache::Erase(const std::string &token) {
+  Shard &shard = ShardOf(token);
+  std::unique_lock<std::shared_mutex> guard(shard.lock);
+  const auto it = shard.tokens.find(token);
+  if (it != shard.tokens.end()) {
+    shard.expiries.erase(it->second.expiry);
+    shard.tokens.erase(it);
+    count--;
+  }
+}
+
+VerifiedTokenCache::Shard &
+VerifiedTokenCache::ShardOf(const std::string &token) const {
+  return *shards[std::hash<std::string>{}(token) % shards.size()];
+}
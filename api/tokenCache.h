@@ -0,0 +1,95 @@
+/**
+ * @file tokenCache.h
+ * @brief Definition of VerifiedTokenCache, the tokens whose signature passed.
+ *
+ * Verifying a token means a base64 decode, a JSON parse and an HMAC-SHA256,
+ * while clients send the same token with every request. Once a token is
+ * verified, its email and expiry are cached so that the next requests with it
+ * only cost a hash lookup. Entries are keyed by the whole token, so that a hash
+ * collision can never authenticate one token as another, and are dropped when
+ * the token expires or is logged out. The cache is sharded like
+ * RevokedTokenStore and bounded. Each shard indexes its tokens by expiry, so
+ * that an insert drops the expired ones and, if the shard is still full,
+ * evicts the one that expires first, in logarithmic time and without a scan.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class VerifiedTokenCache {
+public:
+  using Clock = std::chrono::system_clock;
+
+  /**
+   * @brief Construct a new Verified Token Cache object.
+   *
+   * @param capacity Max number of tokens kept, at least one per shard.
+   * @param n_shards Number of shards, at least 1.
+   */
+  explicit VerifiedTokenCache(size_t capacity = 65536, size_t n_shards = 16);
+
+  /**
+   * @brief Look up a verified token.
+   *
+   * @param token The token to look up.
+   * @param email The email in the token will be put there on a hit.
+   * @return true if the token was verified and has not expired yet.
+   */
+  bool Find(const std::string &token, std::string *email) const;
+
+  /**
+   * @brief Remember a verified token until it expires.
+   *
+   * @param token The verified token.
+   * @param email The email in the token.
+   * @param expires When the token expires.
+   */
+  void Insert(const std::string &token, const std::string &email,
+              Clock::time_point expires);
+
+  /**
+   * @brief Forget a token, e.g. when it is logged out.
+   *
+   * @param token The token to forget.
+   */
+  void Erase(const std::string &token);
+
+  /**
+   * @brief Number of tokens kept.
+   */
+  size_t Size() const { return count.load(); }
+
+private:
+  /* The tokens of a shard by expiry, pointing to the keys of the shard */
+  using Expiries = std::multimap<Clock::time_point, const std::string *>;
+
+  struct Entry {
+    std::string email;
+    Clock::time_point expires;
+    /* position of the token in the expiries of its shard */
+    Expiries::iterator expiry;
+  };
+
+  struct Shard {
+    mutable std::shared_mutex lock;
+    std::unordered_map<std::string, Entry> tokens;
+    Expiries expiries;
+  };
+
+  Shard &ShardOf(const std::string &token) const;
+
+  std::vector<std::unique_ptr<Shard>> shards;
+  size_t shard_capacity;
+  std::atomic<size_t> count{0};
+};
@@ -0,0 +1,68 @@
+#include "tokenStore.h"
+#include <algorithm>
+#include <mutex>
+
+RevokedTokenStore::RevokedTokenStore(size_t n_shards) {
+  n_shards = std::max<size_t>(n_shards, 1);
+  for (size_t i = 0; i < n_shards; i++) {
+    shards.push_back(std::make_unique<Shard>());
+  }
+}
+
+void RevokedTokenStore::Revoke(const std::string &token,
+                               Clock::time_point expires) {
+  const auto now = Clock::now();
+  if (expires <= now) {
+    return;
+  }
+
+  Shard &shard = ShardOf(token);
+  {
+    std::unique_lock<std::shared_mutex> guard(shard.lock);
+    PurgeShard(shard, now);
+    if (shard.tokens.emplace(token, expires).second) {
+      shard.expiries.emplace(expires, token);
+      count++;
+    }
+  }
+  SweepNext(now);
+}
+
+bool RevokedTokenStore::IsRevoked(const std::string &token) const {
+  /* Nothing was logged out, skip hashing and locking */
+  if (count.load() == 0) {
+    return false;
+  }
+
+  const auto now = Clock::now();
+  if (++checks % 64 == 0) {
+    SweepNext(now);
+  }
+
+  Shard &shard = ShardOf(token);
+  std::shared_lock<std::shared_mutex> guard(shard.lock);
+  const auto it = shard.tokens.find(token);
+  return it != shard.tokens.end() && it->second > now;
+}
+
+RevokedTokenStore::Shard &
+RevokedTokenStore::ShardOf(const std::string &token) const {
+  return *shards[std::hash<std::string>{}(token) % shards.size()];
+}
+
+void RevokedTokenStore::SweepNext(Clock::time_point now) const {
+  Shard &shard = *shards[next_sweep++ % shards.size()];
+  std::unique_lock<std::shared_mutex> guard(shard.lock, std::try_to_lock);
+  if (guard.owns_lock()) {
+    PurgeShard(shard, now);
+  }
+}
+
+void RevokedTokenStore::PurgeShard(Shard &shard,
+                                   Clock::time_point now) const {
+  while (!shard.expiries.empty() && shard.expiries.top().first <= now) {
+    shard.tokens.erase(shard.expiries.top().second);
+    shard.expiries.pop();
+    count--;
+  }
+}
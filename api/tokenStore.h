@@ -0,0 +1,87 @@
+/**
+ * @file tokenStore.h
+ * @brief Definition of RevokedTokenStore, the tokens logged out before expiry.
+ *
+ * Every authenticated request checks whether its token was logged out, so the
+ * store is read far more often than written. Tokens are spread over shards by
+ * hash, each behind a shared_mutex, so that checks never wait for each other
+ * and a logout only blocks the checks of one shard. A token is kept only until
+ * its "exp" claim passes: after that the signature check rejects it anyway.
+ * Each shard indexes its tokens by expiry and drops the expired ones whenever a
+ * token is added to it. Every logout and every 64th check also sweeps one more
+ * shard in turn, if no one holds it, so the expired tokens of every shard are
+ * dropped without a timer even when logouts stop.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class RevokedTokenStore {
+public:
+  using Clock = std::chrono::system_clock;
+
+  /**
+   * @brief Construct a new Revoked Token Store object.
+   *
+   * @param n_shards Number of shards, at least 1.
+   */
+  explicit RevokedTokenStore(size_t n_shards = 16);
+
+  /**
+   * @brief Revoke a token until it expires.
+   *
+   * @param token The token to revoke.
+   * @param expires When the token expires, it is forgotten afterwards.
+   */
+  void Revoke(const std::string &token, Clock::time_point expires);
+
+  /**
+   * @brief Check whether a token was revoked, does not block other checks.
+   *
+   * @param token The token to check.
+   * @return true if the token was revoked and has not expired yet.
+   */
+  bool IsRevoked(const std::string &token) const;
+
+  /**
+   * @brief Number of tokens kept.
+   */
+  size_t Size() const { return count.load(); }
+
+private:
+  using Expiry = std::pair<Clock::time_point, std::string>;
+
+  struct Shard {
+    mutable std::shared_mutex lock;
+    std::unordered_map<std::string, Clock::time_point> tokens;
+    /* Min-heap of the tokens by expiry */
+    std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>>
+        expiries;
+  };
+
+  Shard &ShardOf(const std::string &token) const;
+
+  /* Drop the expired tokens of a shard, its lock must be held */
+  void PurgeShard(Shard &shard, Clock::time_point now) const;
+
+  /* Purge the next shard in turn, skipped if its lock is taken */
+  void SweepNext(Clock::time_point now) const;
+
+  std::vector<std::unique_ptr<Shard>> shards;
+  mutable std::atomic<size_t> count{0};
+  mutable std::atomic<size_t> checks{0};
+  mutable std::atomic<size_t> next_sweep{0};
+};
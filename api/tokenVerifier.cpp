@@ -0,0 +1,237 @@
+#include "tokenVerifier.h"
+#include <cstring>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+
+/* base64url of {"alg":"HS256","typ":"JWT"}, the header cpp-jwt writes */
+static const char kHeader[] = "eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9";
+
+static const char kAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+/* Decoded payloads larger than this are left to jwt::decode */
+static constexpr size_t kMaxPayload = 768;
+
+/* Values of the base64url characters, -1 for the others */
+struct Base64UrlTable {
+  int8_t values[256];
+
+  constexpr Base64UrlTable() : values() {
+    for (int i = 0; i < 256; i++) {
+      values[i] = -1;
+    }
+    for (int i = 0; i < 64; i++) {
+      values[static_cast<unsigned char>(kAlphabet[i])] = i;
+    }
+  }
+};
+
+static constexpr Base64UrlTable kTable;
+
+/**
+ * @brief Decode unpadded base64url, 4 characters into 3 bytes at a time.
+ *
+ * @return Number of bytes written to out, or -1 if the input is not base64url.
+ */
+static int DecodeBase64Url(const char *in, size_t len, uint8_t *out) {
+  if (len % 4 == 1) {
+    return -1;
+  }
+  const unsigned char *src = reinterpret_cast<const unsigned char *>(in);
+  uint8_t *dst = out;
+  size_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    int8_t a = kTable.values[src[i]], b = kTable.values[src[i + 1]],
+           c = kTable.values[src[i + 2]], d = kTable.values[src[i + 3]];
+    /* An invalid character sets the sign bit */
+    if ((a | b | c | d) < 0) {
+      return -1;
+    }
+    uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+    dst[0] = static_cast<uint8_t>(v >> 16);
+    dst[1] = static_cast<uint8_t>(v >> 8);
+    dst[2] = static_cast<uint8_t>(v);
+    dst += 3;
+  }
+  if (i < len) {
+    uint32_t v = 0;
+    for (size_t j = 0; j < 4; j++) {
+      int8_t c = i + j < len ? kTable.values[src[i + j]] : 0;
+      if (c < 0) {
+        return -1;
+      }
+      v = (v << 6) | c;
+    }
+    *dst++ = static_cast<uint8_t>(v >> 16);
+    if (len - i == 3) {
+      *dst++ = static_cast<uint8_t>(v >> 8);
+    }
+  }
+  return static_cast<int>(dst - out);
+}
+
+/* Encode the 32 bytes of an HMAC-SHA256 into 43 base64url characters */
+static void EncodeMac(const uint8_t *mac, char *out) {
+  size_t i = 0;
+  for (; i + 3 <= 32; i += 3) {
+    uint32_t v = (mac[i] << 16) | (mac[i + 1] << 8) | mac[i + 2];
+    *out++ = kAlphabet[(v >> 18) & 63];
+    *out++ = kAlphabet[(v >> 12) & 63];
+    *out++ = kAlphabet[(v >> 6) & 63];
+    *out++ = kAlphabet[v & 63];
+  }
+  uint32_t v = (mac[i] << 16) | (mac[i + 1] << 8);
+  *out++ = kAlphabet[(v >> 18) & 63];
+  *out++ = kAlphabet[(v >> 12) & 63];
+  *out++ = kAlphabet[(v >> 6) & 63];
+}
+
+/**
+ * @brief Read {"email":"...","exp":...} exactly as nlohmann::json dumps it.
+ *
+ * @return false if the payload has any other form, e.g. an escaped email.
+ */
+static bool ParsePayload(const char *p, size_t len, const char **email,
+                         size_t *email_len, uint64_t *exp) {
+  static const char kEmail[] = "{\"email\":\"";
+  static const char kExp[] = "\",\"exp\":";
+  const char *end = p + len;
+
+  if (len < sizeof(kEmail) - 1 ||
+      std::memcmp(p, kEmail, sizeof(kEmail) - 1) != 0) {
+    return false;
+  }
+  p += sizeof(kEmail) - 1;
+  *email = p;
+  while (p < end && *p != '"') {
+    if (*p == '\\' || static_cast<unsigned char>(*p) < 0x20) {
+      return false;
+    }
+    p++;
+  }
+  *email_len = p - *email;
+  if (static_cast<size_t>(end - p) < sizeof(kExp) - 1 ||
+      std::memcmp(p, kExp, sizeof(kExp) - 1) != 0) {
+    return false;
+  }
+  p += sizeof(kExp) - 1;
+
+  /* Canonical unsigned integer, then the closing brace */
+  const char *digits = p;
+  *exp = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    *exp = *exp * 10 + (*p - '0');
+    p++;
+  }
+  size_t n_digits = p - digits;
+  if (n_digits == 0 || n_digits > 18 || (n_digits > 1 && *digits == '0')) {
+    return false;
+  }
+  return p + 1 == end && *p == '}';
+}
+
+/* The HMAC implementation, fetched once, nullptr if there is none */
+static EVP_MAC *Hmac() {
+  static EVP_MAC *const mac =
+      EVP_MAC_fetch(nullptr, OSSL_MAC_NAME_HMAC, nullptr);
+  return mac;
+}
+
+/* HMAC context of the current thread, keyed for one verifier at a time */
+struct ThreadHmac {
+  uint64_t owner = 0;
+  EVP_MAC_CTX *ctx = Hmac() ? EVP_MAC_CTX_new(Hmac()) : nullptr;
+
+  ~ThreadHmac() { EVP_MAC_CTX_free(ctx); }
+};
+
+std::atomic<uint64_t> Hs256Verifier::next_id{1};
+
+Hs256Verifier::Hs256Verifier(const std::string &secret)
+    : secret(secret), id(next_id++) {}
+
+Hs256Verifier::Result
+Hs256Verifier::Verify(const std::string &token, std::string *email,
+                      std::chrono::system_clock::time_point *expires) const {
+  /* header.payload.signature, with exactly our header */
+  const size_t header_len = sizeof(kHeader) - 1;
+  if (token.size() <= header_len || token[header_len] != '.' ||
+      std::memcmp(token.data(), kHeader, header_len) != 0) {
+    return UNSUPPORTED;
+  }
+  const size_t dot = token.find('.', header_len + 1);
+  if (dot == std::string::npos ||
+      token.find('.', dot + 1) != std::string::npos) {
+    return UNSUPPORTED;
+  }
+
+  /* Sign header.payload, only the first use on a thread sets the key. If
+     OpenSSL fails, jwt::decode has the last word */
+  thread_local ThreadHmac hmac;
+  if (!hmac.ctx) {
+    return UNSUPPORTED;
+  }
+  int ok = 0;
+  if (hmac.owner != id) {
+    char digest[] = OSSL_DIGEST_NAME_SHA2_256;
+    const OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+        OSSL_PARAM_construct_end()};
+    ok = EVP_MAC_init(hmac.ctx,
+                      reinterpret_cast<const uint8_t *>(secret.data()),
+                      secret.size(), params);
+    hmac.owner = ok ? id : 0;
+  } else {
+    ok = EVP_MAC_init(hmac.ctx, nullptr, 0, nullptr);
+  }
+  uint8_t mac[EVP_MAX_MD_SIZE];
+  size_t mac_len = 0;
+  if (!ok ||
+      !EVP_MAC_update(hmac.ctx, reinterpret_cast<const uint8_t *>(token.data()),
+                      dot) ||
+      !EVP_MAC_final(hmac.ctx, mac, &mac_len, sizeof(mac)) || mac_len != 32) {
+    return UNSUPPORTED;
+  }
+
+  /* Compare the encoded signature, as cpp-jwt does */
+  char signature[43];
+  EncodeMac(mac, signature);
+  if (token.size() - dot - 1 != sizeof(signature) ||
+      CRYPTO_memcmp(token.data() + dot + 1, signature, sizeof(signature)) !=
+          0) {
+    return INVALID;
+  }
+
+  /* Read the claims */
+  const size_t payload_len = dot - header_len - 1;
+  if (payload_len > kMaxPayload / 3 * 4) {
+    return UNSUPPORTED;
+  }
+  uint8_t payload[kMaxPayload];
+  int decoded_len =
+      DecodeBase64Url(token.data() + header_len + 1, payload_len, payload);
+  const char *email_begin = nullptr;
+  size_t email_len = 0;
+  uint64_t exp = 0;
+  if (decoded_len < 0 ||
+      !ParsePayload(reinterpret_cast<const char *>(payload), decoded_len,
+                    &email_begin, &email_len, &exp)) {
+    return UNSUPPORTED;
+  }
+
+  /* Expired only after the second of exp, as cpp-jwt */
+  const uint64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count();
+  if (now > exp) {
+    return INVALID;
+  }
+
+  email->assign(email_begin, email_len);
+  if (expires) {
+    *expires = std::chrono::system_clock::time_point(std::chrono::seconds(exp));
+  }
+  return VALID;
+}
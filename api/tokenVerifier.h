@@ -0,0 +1,60 @@
+/**
+ * @file tokenVerifier.h
+ * @brief Definition of Hs256Verifier, a fast verifier for lqxx login tokens.
+ *
+ * jwt::decode splits the token into strings, parses the header and payload
+ * into json objects and re-encodes the signature. The tokens lqxx issues always
+ * have the same header and a payload of exactly {"email":...,"exp":...}, so
+ * Hs256Verifier checks them without any of that: the header is compared as
+ * is, the HMAC-SHA256 is computed with an EVP_MAC context keyed once per
+ * thread and compared in its base64url form like cpp-jwt does, and the two
+ * claims are read straight from the decoded payload on the stack. Any other
+ * token, or any failure of OpenSSL, is left to jwt::decode, so the accepted
+ * tokens and their claims stay the same.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+class Hs256Verifier {
+public:
+  enum Result {
+    /* signature and expiry are valid, the claims are returned */
+    VALID,
+    /* wrong signature or expired, jwt::decode would reject it as well */
+    INVALID,
+    /* not a token in the form lqxx issues, use jwt::decode instead */
+    UNSUPPORTED
+  };
+
+  /**
+   * @brief Construct a new Hs256 Verifier object.
+   *
+   * @param secret The secret key the tokens are signed with.
+   */
+  explicit Hs256Verifier(const std::string &secret);
+
+  /**
+   * @brief Verify a token and read its claims.
+   *
+   * @param token The token to verify.
+   * @param email The "email" claim will be put there if VALID.
+   * @param expires The "exp" claim will be put there if VALID, may be nullptr.
+   * @return Result
+   */
+  Result Verify(const std::string &token, std::string *email,
+                std::chrono::system_clock::time_point *expires) const;
+
+private:
+  const std::string secret;
+  /* Tells the per thread HMAC contexts of different verifiers apart */
+  const uint64_t id;
+  static std::atomic<uint64_t> next_id;
+};
@@ -1,6 +1,6 @@
 if [[ "$1" == "install" || "$1" == "" ]]; then
     sudo apt update
-    sudo apt install build-essential git cmake libssl-dev autoconf libtool clang-format libcypher-parser-dev libedit-dev pkg-config nlohmann-json3-dev python3-pip -y
+    sudo apt install build-essential git cmake libssl-dev zlib1g-dev autoconf libtool clang-format libcypher-parser-dev libedit-dev pkg-config nlohmann-json3-dev python3-pip -y
     pip install gcovr
     git submodule update --init
     cd external/googletest && mkdir build && cd build && cmake .. && make && sudo make install && cd ../../..
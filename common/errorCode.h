@@ -13,4 +13,5 @@ enum returnCode {
   ERR_ACCESS,   // Access denied
   ERR_FORMAT,   // Content format error
   ERR_REVISE,   // Field not revisible
+  ERR_TIMEOUT,  // Deadline exceeded
 };
\ No newline at end of file
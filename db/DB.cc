@@ -1,5 +1,134 @@
 #include "DB.h"
 #include "common/errorCode.h"
+#include <chrono>
+
+/* Time spent by this thread between connectDB and closeDB, in microseconds.
+   Connections may nest, only the outermost one is timed. */
+static thread_local uint64_t thread_query_time = 0;
+static thread_local int thread_open_connections = 0;
+static thread_local std::chrono::steady_clock::time_point thread_connected_at;
+
+/* Deadline of the request handled by this thread, and whether a query was
+   skipped or abandoned because of it since the deadline was set */
+static thread_local std::chrono::steady_clock::time_point thread_deadline =
+    std::chrono::steady_clock::time_point::max();
+static thread_local bool thread_timed_out = false;
+
+static bool deadlinePassed() {
+  if (thread_deadline != std::chrono::steady_clock::time_point::max() &&
+      std::chrono::steady_clock::now() >= thread_deadline) {
+    thread_timed_out = true;
+  }
+  return thread_timed_out;
+}
+
+/* results is null when the query was not issued, see executeQuery */
+static bool queryFailed(neo4j_result_stream_t *results) {
+  return results == NULL || neo4j_check_failure(results) != 0;
+}
+
+static void closeResults(neo4j_result_stream_t *results) {
+  if (results != NULL) {
+    neo4j_close_results(results);
+  }
+}
+
+/* Return code of a failed query */
+static returnCode queryError() {
+  return thread_timed_out ? ERR_TIMEOUT : ERR_UNKNOWN;
+}
+
+/* Return code when fetchNext gave no record: it may have abandoned the
+   results at the deadline rather than reached their end */
+static returnCode noRecord(returnCode none) {
+  return thread_timed_out ? ERR_TIMEOUT : none;
+}
+
+/**
+ * @brief Fetch the next record, or abandon the results once the deadline has
+ * passed: the connection is reset, so that the server stops sending them and
+ * closing the results does not wait for the rest.
+ *
+ * @return neo4j_result_t* the record, NULL at the end or if abandoned
+ */
+static neo4j_result_t *fetchNext(neo4j_result_stream_t *results,
+                                 neo4j_connection_t *connection) {
+  if (deadlinePassed()) {
+    neo4j_reset(connection);
+    return NULL;
+  }
+  return neo4j_fetch_next(results);
+}
+
+/**
+ * @brief Build the RETURN clause of a node: the whole node if no field is
+ * requested, otherwise only the requested properties in the given order.
+ *
+ * @param var variable name of the node in the query
+ * @param fields requested field names
+ * @return std::string RETURN clause without the RETURN keyword
+ */
+static std::string projection(const std::string &var,
+                              const std::vector<std::string> &fields) {
+  if (fields.empty()) {
+    return var;
+  }
+  std::string clause;
+  for (const auto &field : fields) {
+    clause += var + "." + field + ", ";
+  }
+  clause.pop_back();
+  clause.pop_back();
+  return clause;
+}
+
+static std::string projection(const std::string &var,
+                              const std::map<std::string, std::string> &info) {
+  std::vector<std::string> fields;
+  for (auto it = info.begin(); it != info.end(); it++) {
+    fields.push_back(it->first);
+  }
+  return projection(var, fields);
+}
+
+/**
+ * @brief Build an expression of a version newer than another: the current time
+ * in milliseconds, or one more than the other if it is already that large.
+ *
+ * @param version expression of the other version, may be null
+ * @return std::string Cypher expression
+ */
+static std::string newerVersion(const std::string &version) {
+  return "CASE WHEN timestamp() > coalesce(" + version +
+         ", 0) THEN timestamp() ELSE " + version + " + 1 END";
+}
+
+/**
+ * @brief Build a SET item that bumps the version of a node, past the version
+ * of a child deleted in the same statement too if one is given.
+ *
+ * Versions only grow. A node is created with a version newer than its parent,
+ * a list's version is never older than its tasks since every change of a task
+ * bumps its list, and deleting a list bumps its user past it. So a node
+ * deleted and created again under the same parent gets a version newer than
+ * any the deleted one had, and a client can never hold an old version of a
+ * new node. Only a user deleted and registered again starts over from the
+ * current time.
+ *
+ * @param var variable name of the node in the query
+ * @param child variable name of the deleted child, empty for none
+ * @return std::string SET item without the SET keyword
+ */
+static std::string bumpVersion(const std::string &var,
+                               const std::string &child = "") {
+  std::string version = var + ".version";
+  if (!child.empty()) {
+    version = "CASE WHEN coalesce(" + child + ".version, 0) > coalesce(" +
+              version + ", 0) THEN " + child + ".version ELSE " + version +
+              " END";
+  }
+  return var + ".version = " + newerVersion(version);
+}
 
 DB::DB(std::string host) {
   this->host_ = host; // hardcode
@@ -63,26 +192,24 @@ DB::createUserNode(const std::map<std::string, std::string> &user_info) {
   for (auto it = user_info.begin(); it != user_info.end(); it++) {
     query += it->first + ": '" + it->second + "', ";
   }
-  query.pop_back();
-  query.pop_back();
-  query += "})";
+  query += "version: timestamp()})";
   neo4j_result_stream_t *results = executeQuery(query, connection);
 
   // Check result
-  if (neo4j_check_failure(results)) {
-    if (error_code_of_dup == neo4j_error_code(results)) {
-      neo4j_close_results(results);
+  if (queryFailed(results)) {
+    if (results && error_code_of_dup == neo4j_error_code(results)) {
+      closeResults(results);
       closeDB(connection);
       return ERR_DUP_NODE;
     } else {
-      neo4j_close_results(results);
+      closeResults(results);
       closeDB(connection);
-      return ERR_UNKNOWN;
+      return queryError();
     }
   }
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
@@ -97,66 +224,43 @@ returnCode DB::createTaskListNode(
 
   neo4j_connection_t *connection = connectDB();
 
-  // Check Foreign Key - user_pkey exsits
-  std::string query =
-      "MATCH (n:User) WHERE n.email = '" + user_pkey + "' RETURN n";
-  neo4j_result_stream_t *results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
-    closeDB(connection);
-    return ERR_UNKNOWN;
-  }
-  if (neo4j_fetch_next(results) == NULL) {
-    neo4j_close_results(results);
-    closeDB(connection);
-    return ERR_NO_NODE;
-  }
-
-  // Create node TaskList
+  // Create node TaskList owned by the User, which has a new list, in one
+  // statement so that no list is left without its owner
   std::map<std::string, std::string> revised_info = task_list_info;
-  revised_info["name"] = revised_info["name"];
   revised_info["user"] = user_pkey;
   if (task_list_info.find("visibility") == task_list_info.end()) {
     revised_info["visibility"] = "private";
   }
-  query = "CREATE (n:TaskList {";
+  std::string query = "MATCH (a:User {email: '" + user_pkey +
+                      "'}) CREATE (a)-[:Owns]->(n:TaskList {";
   for (auto it = revised_info.begin(); it != revised_info.end(); it++) {
     query += it->first + ": '" + it->second + "', ";
   }
-  query.pop_back();
-  query.pop_back();
-  query += "})";
-  results = executeQuery(query, connection);
+  query += "version: " + newerVersion("a.version") + "}) SET " +
+           bumpVersion("a") + " RETURN n";
+  neo4j_result_stream_t *results = executeQuery(query, connection);
 
   // Check result
-  if (neo4j_check_failure(results)) {
-    if (error_code_of_dup == neo4j_error_code(results)) {
-      neo4j_close_results(results);
+  if (queryFailed(results)) {
+    if (results && error_code_of_dup == neo4j_error_code(results)) {
+      closeResults(results);
       closeDB(connection);
       return ERR_DUP_NODE;
     } else {
-      neo4j_close_results(results);
+      closeResults(results);
       closeDB(connection);
-      return ERR_UNKNOWN;
+      return queryError();
     }
   }
-
-  // Create relationship between User and TaskList
-  std::string user_node = "(a:User {email: '" + user_pkey + "'})";
-  std::string list_node = "(b:TaskList {name: '" + revised_info["name"] +
-                          "', user: '" + revised_info["user"] + "'})";
-  query = "MATCH " + user_node + ", " + list_node + " MERGE (a)-[r:Owns]->(b)";
-  results = executeQuery(query, connection);
-
-  // Check result
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  // Check Foreign Key - user_pkey exsits
+  if (fetchNext(results, connection) == NULL) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return noRecord(ERR_NO_NODE);
   }
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
@@ -172,79 +276,43 @@ DB::createTaskNode(const std::string &user_pkey,
 
   neo4j_connection_t *connection = connectDB();
 
-  // Check Foreign Key - user_pkey exsits
-  std::string query =
-      "MATCH (n:User) WHERE n.email = '" + user_pkey + "' RETURN n";
-  neo4j_result_stream_t *results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    closeDB(connection);
-    return ERR_UNKNOWN;
-  }
-  if (neo4j_fetch_next(results) == NULL) {
-    closeDB(connection);
-    return ERR_NO_NODE;
-  }
-  // Check Foreign Key - task_list_pkey exsits
-  query = "MATCH (n:TaskList) WHERE n.name = '" + task_list_pkey +
-          "' AND n.user = '" + user_pkey + "' RETURN n";
-  results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
-    closeDB(connection);
-    return ERR_UNKNOWN;
-  }
-  if (neo4j_fetch_next(results) == NULL) {
-    neo4j_close_results(results);
-    closeDB(connection);
-    return ERR_NO_NODE;
-  }
-
+  // Create node Task contained in the TaskList, which has a new task, in one
+  // statement so that no task is left out of its list
   std::map<std::string, std::string> revised_info = task_info;
-  revised_info["name"] = revised_info["name"];
   revised_info["list"] = task_list_pkey;
   revised_info["user"] = user_pkey;
-  // Create node Task
-  query = "CREATE (n:Task {";
+  std::string query = "MATCH (a:TaskList {name: '" + task_list_pkey +
+                      "', user: '" + user_pkey +
+                      "'}) CREATE (a)-[:Contains]->(n:Task {";
   for (auto it = revised_info.begin(); it != revised_info.end(); it++) {
     query += it->first + ": '" + it->second + "', ";
   }
-  query.pop_back();
-  query.pop_back();
-  query += "})";
-  results = executeQuery(query, connection);
+  query += "version: " + newerVersion("a.version") + "}) SET " +
+           bumpVersion("a") + " RETURN n";
+  neo4j_result_stream_t *results = executeQuery(query, connection);
 
   // Check result
-  if (neo4j_check_failure(results)) {
-    if (error_code_of_dup == neo4j_error_code(results)) {
-      neo4j_close_results(results);
+  if (queryFailed(results)) {
+    if (results && error_code_of_dup == neo4j_error_code(results)) {
+      closeResults(results);
       closeDB(connection);
       return ERR_DUP_NODE;
     } else {
-      neo4j_close_results(results);
+      closeResults(results);
       closeDB(connection);
-      return ERR_UNKNOWN;
+      return queryError();
     }
   }
-
-  // Create relationship between TaskList and Task
-  std::string list_node = "(a:TaskList {name: '" + task_list_pkey +
-                          "', user: '" + user_pkey + "'})";
-  std::string task_node = "(b:Task {name: '" + revised_info["name"] +
-                          "', list: '" + task_list_pkey + "', user: '" +
-                          user_pkey + "'})";
-  query =
-      "MATCH " + list_node + ", " + task_node + " MERGE (a)-[r:Contains]->(b)";
-  results = executeQuery(query, connection);
-
-  // Check result
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  // Check Foreign Key - user_pkey and task_list_pkey exsit, a task list only
+  // exists along with its user
+  if (fetchNext(results, connection) == NULL) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return noRecord(ERR_NO_NODE);
   }
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
@@ -274,19 +342,19 @@ DB::reviseUserNode(const std::string &user_pkey,
   neo4j_result_stream_t *results = executeQuery(query, connection);
 
   // Check result
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  if (neo4j_fetch_next(results) == NULL) {
-    neo4j_close_results(results);
+  if (fetchNext(results, connection) == NULL) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_NO_NODE;
+    return noRecord(ERR_NO_NODE);
   }
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
@@ -311,25 +379,23 @@ returnCode DB::reviseTaskListNode(
   for (auto it = task_list_info.begin(); it != task_list_info.end(); it++) {
     query += "n." + it->first + " = '" + it->second + "', ";
   }
-  query.pop_back();
-  query.pop_back();
-  query += " RETURN n";
+  query += bumpVersion("n") + " RETURN n";
   neo4j_result_stream_t *results = executeQuery(query, connection);
 
   // Check result
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  if (neo4j_fetch_next(results) == NULL) {
-    neo4j_close_results(results);
+  if (fetchNext(results, connection) == NULL) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_NO_NODE;
+    return noRecord(ERR_NO_NODE);
   }
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
@@ -350,31 +416,32 @@ DB::reviseTaskNode(const std::string &user_pkey,
 
   neo4j_connection_t *connection = connectDB();
 
-  // Modify node Task
-  std::string query = "MATCH (n:Task {name: '" + task_pkey + "', list: '" +
-                      task_list_pkey + "', user: '" + user_pkey + "'}) SET ";
+  // Modify node Task, both the task and its list have a new version
+  std::string query = "MATCH (l:TaskList {name: '" + task_list_pkey +
+                      "', user: '" + user_pkey +
+                      "'})-[:Contains]->(n:Task {name: '" + task_pkey +
+                      "', list: '" + task_list_pkey + "', user: '" + user_pkey +
+                      "'}) SET ";
   for (auto it = task_info.begin(); it != task_info.end(); it++) {
     query += "n." + it->first + " = '" + it->second + "', ";
   }
-  query.pop_back();
-  query.pop_back();
-  query += " RETURN n";
+  query += bumpVersion("n") + ", " + bumpVersion("l") + " RETURN n";
   neo4j_result_stream_t *results = executeQuery(query, connection);
 
   // Check result
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  if (neo4j_fetch_next(results) == NULL) {
-    neo4j_close_results(results);
+  if (fetchNext(results, connection) == NULL) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_NO_NODE;
+    return noRecord(ERR_NO_NODE);
   }
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
@@ -382,34 +449,26 @@ DB::reviseTaskNode(const std::string &user_pkey,
 returnCode DB::deleteUserNode(const std::string &user_pkey) {
   neo4j_connection_t *connection = connectDB();
 
-  // Delete node User
+  // Delete node User with its tasks, task lists and groups, in one statement
+  // so that a user is never left half deleted
   std::string query =
       "MATCH (a:User {email: '" + user_pkey +
-      "'})-[r:Owns]->(b:TaskList)-[s:Contains]->(c:Task) DETACH DELETE s, c";
+      "'}) OPTIONAL MATCH (a)-[:Owns]->(b:TaskList) "
+      "OPTIONAL MATCH (b)-[:Contains]->(c:Task) "
+      "WITH a, collect(DISTINCT b) + collect(DISTINCT c) AS owned "
+      "OPTIONAL MATCH (g:Group {owner: '" +
+      user_pkey +
+      "'}) WITH a, owned + collect(g) AS nodes "
+      "FOREACH (n IN nodes | DETACH DELETE n) DETACH DELETE a";
   neo4j_result_stream_t *results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
-    closeDB(connection);
-    return ERR_UNKNOWN;
-  }
-  query = "MATCH (a:User {email: '" + user_pkey +
-          "'})-[r:Owns]->(b:TaskList) DETACH DELETE r, b";
-  results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
-    closeDB(connection);
-    return ERR_UNKNOWN;
-  }
-  query = "MATCH (a:User {email: '" + user_pkey + "'}) DETACH DELETE a";
-  results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
@@ -418,27 +477,24 @@ returnCode DB::deleteTaskListNode(const std::string &user_pkey,
                                   const std::string &task_list_pkey) {
   neo4j_connection_t *connection = connectDB();
 
-  // Delete node TaskList
-  std::string query = "MATCH (a:TaskList {name: '" + task_list_pkey +
+  // Delete node TaskList with its tasks, the user has a new list of lists,
+  // in one statement so that a list is never left half deleted
+  std::string query = "MATCH (u:User {email: '" + user_pkey +
+                      "'})-[:Owns]->(a:TaskList {name: '" + task_list_pkey +
                       "', user: '" + user_pkey +
-                      "'})-[r:Contains]->(b:Task) DETACH DELETE r, b";
+                      "'}) OPTIONAL MATCH (a)-[:Contains]->(b:Task) "
+                      "WITH u, a, collect(b) AS tasks SET " +
+                      bumpVersion("u", "a") +
+                      " FOREACH (t IN tasks | DETACH DELETE t) DETACH DELETE a";
   neo4j_result_stream_t *results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
-    closeDB(connection);
-    return ERR_UNKNOWN;
-  }
-  query = "MATCH (a:TaskList {name: '" + task_list_pkey + "', user: '" +
-          user_pkey + "'}) DETACH DELETE a";
-  results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
@@ -448,19 +504,21 @@ returnCode DB::deleteTaskNode(const std::string &user_pkey,
                               const std::string &task_pkey) {
   neo4j_connection_t *connection = connectDB();
 
-  // Delete node Task
-  std::string query = "MATCH (a:Task {name: '" + task_pkey + "', list: '" +
-                      task_list_pkey + "', user: '" + user_pkey +
-                      "'}) DETACH DELETE a";
+  // Delete node Task, its list has a new version
+  std::string query = "MATCH (l:TaskList {name: '" + task_list_pkey +
+                      "', user: '" + user_pkey +
+                      "'})-[:Contains]->(a:Task {name: '" + task_pkey +
+                      "', list: '" + task_list_pkey + "', user: '" + user_pkey +
+                      "'}) SET " + bumpVersion("l", "a") + " DETACH DELETE a";
   neo4j_result_stream_t *results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
@@ -469,27 +527,29 @@ returnCode DB::getUserNode(const std::string &user_pkey,
                            std::map<std::string, std::string> &user_info) {
   neo4j_connection_t *connection = connectDB();
 
-  // Get node User
-  std::string query = "MATCH (n:User {email: '" + user_pkey + "'}) RETURN n";
+  // Get node User, only return the requested fields if any
+  std::string query =
+      "MATCH (n:User {email: '" + user_pkey + "'}) RETURN " +
+      projection("n", user_info);
   neo4j_result_stream_t *results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  neo4j_result_t *result = neo4j_fetch_next(results);
+  neo4j_result_t *result = fetchNext(results, connection);
   if (result == NULL) {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
-    return ERR_NO_NODE;
+    return noRecord(ERR_NO_NODE);
   }
 
   // Extract node info
-  neo4j_value_t node = neo4j_result_field(result, 0);
-  neo4j_value_t value = neo4j_node_properties(node);
   char buf[1024];
   // Empty: return all fields / Not empty: return specified fields
   if (user_info.empty()) {
+    neo4j_value_t node = neo4j_result_field(result, 0);
+    neo4j_value_t value = neo4j_node_properties(node);
     for (int i = 0; i < neo4j_map_size(value); i++) {
       const neo4j_map_entry_t *kv = neo4j_map_getentry(value, i);
       neo4j_value_t key = kv->key;
@@ -505,8 +565,9 @@ returnCode DB::getUserNode(const std::string &user_pkey,
       user_info[key_str] = val_str;
     }
   } else {
+    unsigned int index = 0;
     for (auto it = user_info.begin(); it != user_info.end(); it++) {
-      neo4j_value_t field_value = neo4j_map_get(value, it->first.c_str());
+      neo4j_value_t field_value = neo4j_result_field(result, index++);
       if (neo4j_is_null(field_value)) {
         it->second = "";
       } else {
@@ -518,9 +579,11 @@ returnCode DB::getUserNode(const std::string &user_pkey,
       }
     }
   }
+  // Delete version field
+  user_info.erase("version");
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
@@ -531,27 +594,28 @@ DB::getTaskListNode(const std::string &user_pkey,
                     std::map<std::string, std::string> &task_list_info) {
   neo4j_connection_t *connection = connectDB();
 
-  // Get node TaskList
+  // Get node TaskList, only return the requested fields if any
   std::string query = "MATCH (n:TaskList {name: '" + task_list_pkey +
-                      "', user: '" + user_pkey + "'}) RETURN n";
+                      "', user: '" + user_pkey + "'}) RETURN " +
+                      projection("n", task_list_info);
   neo4j_result_stream_t *results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  neo4j_result_t *result = neo4j_fetch_next(results);
+  neo4j_result_t *result = fetchNext(results, connection);
   if (result == NULL) {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
-    return ERR_NO_NODE;
+    return noRecord(ERR_NO_NODE);
   }
   // Extract node info
-  neo4j_value_t node = neo4j_result_field(result, 0);
-  neo4j_value_t value = neo4j_node_properties(node);
   char buf[1024];
   // Empty: return all fields / Not empty: return specified fields
   if (task_list_info.empty()) {
+    neo4j_value_t node = neo4j_result_field(result, 0);
+    neo4j_value_t value = neo4j_node_properties(node);
     for (int i = 0; i < neo4j_map_size(value); i++) {
       const neo4j_map_entry_t *kv = neo4j_map_getentry(value, i);
       neo4j_value_t key = kv->key;
@@ -567,8 +631,9 @@ DB::getTaskListNode(const std::string &user_pkey,
       task_list_info[key_str] = val_str;
     }
   } else {
+    unsigned int index = 0;
     for (auto it = task_list_info.begin(); it != task_list_info.end(); it++) {
-      neo4j_value_t field_value = neo4j_map_get(value, it->first.c_str());
+      neo4j_value_t field_value = neo4j_result_field(result, index++);
       if (neo4j_is_null(field_value)) {
         it->second = "";
       } else {
@@ -580,11 +645,12 @@ DB::getTaskListNode(const std::string &user_pkey,
       }
     }
   }
-  // Delete user field
+  // Delete user and version field
   task_list_info.erase("user");
+  task_list_info.erase("version");
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
@@ -595,28 +661,28 @@ returnCode DB::getTaskNode(const std::string &user_pkey,
                            std::map<std::string, std::string> &task_info) {
   neo4j_connection_t *connection = connectDB();
 
-  // Get node Task
+  // Get node Task, only return the requested fields if any
   std::string query = "MATCH (n:Task {name: '" + task_pkey + "', list: '" +
                       task_list_pkey + "', user: '" + user_pkey +
-                      "'}) RETURN n";
+                      "'}) RETURN " + projection("n", task_info);
   neo4j_result_stream_t *results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  neo4j_result_t *result = neo4j_fetch_next(results);
+  neo4j_result_t *result = fetchNext(results, connection);
   if (result == NULL) {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
-    return ERR_NO_NODE;
+    return noRecord(ERR_NO_NODE);
   }
   // Extract node info
-  neo4j_value_t node = neo4j_result_field(result, 0);
-  neo4j_value_t value = neo4j_node_properties(node);
   char buf[1024];
   // Empty: return all fields / Not empty: return specified fields
   if (task_info.empty()) {
+    neo4j_value_t node = neo4j_result_field(result, 0);
+    neo4j_value_t value = neo4j_node_properties(node);
     for (int i = 0; i < neo4j_map_size(value); i++) {
       const neo4j_map_entry_t *kv = neo4j_map_getentry(value, i);
       neo4j_value_t key = kv->key;
@@ -632,8 +698,9 @@ returnCode DB::getTaskNode(const std::string &user_pkey,
       task_info[key_str] = val_str;
     }
   } else {
+    unsigned int index = 0;
     for (auto it = task_info.begin(); it != task_info.end(); it++) {
-      neo4j_value_t field_value = neo4j_map_get(value, it->first.c_str());
+      neo4j_value_t field_value = neo4j_result_field(result, index++);
       if (neo4j_is_null(field_value)) {
         it->second = "";
       } else {
@@ -645,12 +712,13 @@ returnCode DB::getTaskNode(const std::string &user_pkey,
       }
     }
   }
-  // Delete user and list field
+  // Delete user, list and version field
   task_info.erase("user");
   task_info.erase("list");
+  task_info.erase("version");
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
@@ -664,15 +732,15 @@ returnCode DB::getAllUserNodes(std::vector<std::string> &user_info) {
   // Get all nodes User
   std::string query = "MATCH (n:User) RETURN n";
   neo4j_result_stream_t *results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
 
   // Extract returned info
   neo4j_result_t *result;
-  while ((result = neo4j_fetch_next(results)) != NULL) {
+  while ((result = fetchNext(results, connection)) != NULL) {
     neo4j_value_t node = neo4j_result_field(result, 0);
     neo4j_value_t value = neo4j_node_properties(node);
     char buf[1024];
@@ -683,9 +751,15 @@ returnCode DB::getAllUserNodes(std::vector<std::string> &user_info) {
     value_str.erase(0, 1);
     user_info.push_back(value_str);
   }
+  // Abandoned at the deadline, what was read is partial
+  if (thread_timed_out) {
+    closeResults(results);
+    closeDB(connection);
+    return ERR_TIMEOUT;
+  }
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
@@ -700,29 +774,29 @@ returnCode DB::getAllTaskListNodes(const std::string &user_pkey,
   // Check User node exists
   std::string query = "MATCH (n:User {email: '" + user_pkey + "'}) RETURN n";
   neo4j_result_stream_t *results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  neo4j_result_t *result = neo4j_fetch_next(results);
+  neo4j_result_t *result = fetchNext(results, connection);
   if (result == NULL) {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
-    return ERR_NO_NODE;
+    return noRecord(ERR_NO_NODE);
   }
 
   // Get all nodes TaskList
   query = "MATCH (n:User {email: '" + user_pkey + "'})-[:Owns]->(m) RETURN m";
   results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
 
   // Extract returned info
-  while ((result = neo4j_fetch_next(results)) != NULL) {
+  while ((result = fetchNext(results, connection)) != NULL) {
     neo4j_value_t node = neo4j_result_field(result, 0);
     neo4j_value_t value = neo4j_node_properties(node);
     char buf[1024];
@@ -733,9 +807,15 @@ returnCode DB::getAllTaskListNodes(const std::string &user_pkey,
     value_str.erase(0, 1);
     task_list_info.push_back(value_str);
   }
+  // Abandoned at the deadline, what was read is partial
+  if (thread_timed_out) {
+    closeResults(results);
+    closeDB(connection);
+    return ERR_TIMEOUT;
+  }
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
@@ -751,45 +831,45 @@ returnCode DB::getAllTaskNodes(const std::string &user_pkey,
   // Check User node exists
   std::string query = "MATCH (n:User {email: '" + user_pkey + "'}) RETURN n";
   neo4j_result_stream_t *results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  neo4j_result_t *result = neo4j_fetch_next(results);
+  neo4j_result_t *result = fetchNext(results, connection);
   if (result == NULL) {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
-    return ERR_NO_NODE;
+    return noRecord(ERR_NO_NODE);
   }
   // Check TaskList node exists
   query = "MATCH (n:TaskList {name: '" + task_list_pkey + "', user: '" +
           user_pkey + "'}) RETURN n";
   results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  result = neo4j_fetch_next(results);
+  result = fetchNext(results, connection);
   if (result == NULL) {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
-    return ERR_NO_NODE;
+    return noRecord(ERR_NO_NODE);
   }
 
   // Get all nodes Task
   query = "MATCH (n:TaskList {name: '" + task_list_pkey + "', user: '" +
           user_pkey + "'})-[:Contains]->(m) RETURN m";
   results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
 
   // Extract returned info
-  while ((result = neo4j_fetch_next(results)) != NULL) {
+  while ((result = fetchNext(results, connection)) != NULL) {
     neo4j_value_t node = neo4j_result_field(result, 0);
     neo4j_value_t value = neo4j_node_properties(node);
     char buf[1024];
@@ -800,62 +880,252 @@ returnCode DB::getAllTaskNodes(const std::string &user_pkey,
     value_str.erase(0, 1);
     task_info.push_back(value_str);
   }
+  // Abandoned at the deadline, what was read is partial
+  if (thread_timed_out) {
+    closeResults(results);
+    closeDB(connection);
+    return ERR_TIMEOUT;
+  }
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
 
-returnCode DB::addAccess(const std::string &src_user_pkey,
-                         const std::string &dst_user_pkey,
-                         const std::string &task_list_pkey,
-                         const bool read_write) {
+/**
+ * @brief Extract one row of a projected query into a field map.
+ *
+ * @param result row returned by neo4j
+ * @param offset index of the first column to extract
+ * @param fields requested fields, empty if the column holds the whole node
+ * @param info key: field name, value: field value
+ */
+static void extractRow(neo4j_result_t *result, unsigned int offset,
+                       const std::vector<std::string> &fields,
+                       std::map<std::string, std::string> &info) {
+  char buf[1024];
+  if (fields.empty()) {
+    neo4j_value_t value =
+        neo4j_node_properties(neo4j_result_field(result, offset));
+    for (int i = 0; i < neo4j_map_size(value); i++) {
+      const neo4j_map_entry_t *kv = neo4j_map_getentry(value, i);
+      neo4j_tostring(kv->key, buf, sizeof(buf));
+      std::string key_str(buf);
+      key_str.pop_back();
+      key_str.erase(0, 1);
+      neo4j_tostring(kv->value, buf, sizeof(buf));
+      std::string val_str(buf);
+      val_str.pop_back();
+      val_str.erase(0, 1);
+      info[key_str] = val_str;
+    }
+    return;
+  }
+  for (unsigned int i = 0; i < fields.size(); i++) {
+    neo4j_value_t field_value = neo4j_result_field(result, offset + i);
+    if (neo4j_is_null(field_value)) {
+      info[fields[i]] = "";
+      continue;
+    }
+    neo4j_tostring(field_value, buf, sizeof(buf));
+    std::string value_str(buf);
+    value_str.pop_back();
+    value_str.erase(0, 1);
+    info[fields[i]] = value_str;
+  }
+}
+
+returnCode DB::getTaskListNodes(
+    const std::string &user_pkey, const std::vector<std::string> &fields,
+    std::vector<std::map<std::string, std::string>> &task_list_infos) {
   neo4j_connection_t *connection = connectDB();
 
-  // Check User node exists - src
-  std::string query =
-      "MATCH (n:User {email: '" + src_user_pkey + "'}) RETURN n";
+  // Clear vector
+  task_list_infos.clear();
+
+  // Check User node exists and get the owned lists in one query
+  std::string query = "MATCH (n:User {email: '" + user_pkey +
+                      "'}) OPTIONAL MATCH (n)-[:Owns]->(m:TaskList) "
+                      "RETURN m IS NULL, " +
+                      projection("m", fields);
   neo4j_result_stream_t *results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  neo4j_result_t *result = neo4j_fetch_next(results);
+  neo4j_result_t *result = fetchNext(results, connection);
   if (result == NULL) {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
-    return ERR_NO_NODE;
+    return noRecord(ERR_NO_NODE);
   }
-  // Check User node exists - dst
-  query = "MATCH (n:User {email: '" + dst_user_pkey + "'}) RETURN n";
-  results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+
+  // Extract returned info, a single null row means the user owns no list
+  for (; result != NULL; result = fetchNext(results, connection)) {
+    if (neo4j_bool_value(neo4j_result_field(result, 0))) {
+      break;
+    }
+    std::map<std::string, std::string> info;
+    extractRow(result, 1, fields, info);
+    info.erase("user");
+    info.erase("version");
+    task_list_infos.push_back(info);
+  }
+  // Abandoned at the deadline, what was read is partial
+  if (thread_timed_out) {
+    closeResults(results);
+    closeDB(connection);
+    return ERR_TIMEOUT;
+  }
+
+  // Success
+  closeResults(results);
+  closeDB(connection);
+  return SUCCESS;
+}
+
+returnCode
+DB::getTaskNodes(const std::string &user_pkey,
+                 const std::string &task_list_pkey,
+                 const std::vector<std::string> &fields,
+                 std::vector<std::map<std::string, std::string>> &task_infos) {
+  neo4j_connection_t *connection = connectDB();
+
+  // Clear vector
+  task_infos.clear();
+
+  // Check TaskList node exists and get its tasks in one query
+  std::string query = "MATCH (n:TaskList {name: '" + task_list_pkey +
+                      "', user: '" + user_pkey +
+                      "'}) OPTIONAL MATCH (n)-[:Contains]->(m:Task) "
+                      "RETURN m IS NULL, " +
+                      projection("m", fields);
+  neo4j_result_stream_t *results = executeQuery(query, connection);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  result = neo4j_fetch_next(results);
+  neo4j_result_t *result = fetchNext(results, connection);
   if (result == NULL) {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
-    return ERR_NO_NODE;
+    return noRecord(ERR_NO_NODE);
   }
-  // Check TaskList node exists
-  query = "MATCH (n:TaskList {name: '" + task_list_pkey + "', user: '" +
-          src_user_pkey + "'}) RETURN n.visibility";
-  results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+
+  // Extract returned info, a single null row means the list has no task
+  for (; result != NULL; result = fetchNext(results, connection)) {
+    if (neo4j_bool_value(neo4j_result_field(result, 0))) {
+      break;
+    }
+    std::map<std::string, std::string> info;
+    extractRow(result, 1, fields, info);
+    info.erase("user");
+    info.erase("list");
+    info.erase("version");
+    task_infos.push_back(info);
+  }
+  // Abandoned at the deadline, what was read is partial
+  if (thread_timed_out) {
+    closeResults(results);
+    closeDB(connection);
+    return ERR_TIMEOUT;
+  }
+
+  // Success
+  closeResults(results);
+  closeDB(connection);
+  return SUCCESS;
+}
+
+returnCode DB::getVersion(const std::string &user_pkey,
+                          const std::string &task_list_pkey,
+                          const std::string &task_pkey, int64_t &version) {
+  neo4j_connection_t *connection = connectDB();
+
+  // Get only the version of the node
+  std::string node;
+  if (task_list_pkey.empty()) {
+    node = "(n:User {email: '" + user_pkey + "'})";
+  } else if (task_pkey.empty()) {
+    node = "(n:TaskList {name: '" + task_list_pkey + "', user: '" +
+           user_pkey + "'})";
+  } else {
+    node = "(n:Task {name: '" + task_pkey + "', list: '" + task_list_pkey +
+           "', user: '" + user_pkey + "'})";
+  }
+  std::string query = "MATCH " + node + " RETURN coalesce(n.version, 0)";
+  neo4j_result_stream_t *results = executeQuery(query, connection);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  result = neo4j_fetch_next(results);
+  neo4j_result_t *result = fetchNext(results, connection);
   if (result == NULL) {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
-    return ERR_NO_NODE;
+    return noRecord(ERR_NO_NODE);
+  }
+  version = neo4j_int_value(neo4j_result_field(result, 0));
+
+  // Success
+  closeResults(results);
+  closeDB(connection);
+  return SUCCESS;
+}
+
+returnCode DB::addAccess(const std::string &src_user_pkey,
+                         const std::string &dst_user_pkey,
+                         const std::string &task_list_pkey,
+                         const bool read_write) {
+  neo4j_connection_t *connection = connectDB();
+
+  // Check User node exists - src
+  std::string query =
+      "MATCH (n:User {email: '" + src_user_pkey + "'}) RETURN n";
+  neo4j_result_stream_t *results = executeQuery(query, connection);
+  if (queryFailed(results)) {
+    closeResults(results);
+    closeDB(connection);
+    return queryError();
+  }
+  neo4j_result_t *result = fetchNext(results, connection);
+  if (result == NULL) {
+    closeResults(results);
+    closeDB(connection);
+    return noRecord(ERR_NO_NODE);
+  }
+  // Check User node exists - dst
+  query = "MATCH (n:User {email: '" + dst_user_pkey + "'}) RETURN n";
+  results = executeQuery(query, connection);
+  if (queryFailed(results)) {
+    closeResults(results);
+    closeDB(connection);
+    return queryError();
+  }
+  result = fetchNext(results, connection);
+  if (result == NULL) {
+    closeResults(results);
+    closeDB(connection);
+    return noRecord(ERR_NO_NODE);
+  }
+  // Check TaskList node exists
+  query = "MATCH (n:TaskList {name: '" + task_list_pkey + "', user: '" +
+          src_user_pkey + "'}) RETURN n.visibility";
+  results = executeQuery(query, connection);
+  if (queryFailed(results)) {
+    closeResults(results);
+    closeDB(connection);
+    return queryError();
+  }
+  result = fetchNext(results, connection);
+  if (result == NULL) {
+    closeResults(results);
+    closeDB(connection);
+    return noRecord(ERR_NO_NODE);
   }
   // Check TaskList visibility
   neo4j_value_t value = neo4j_result_field(result, 0);
@@ -865,7 +1135,7 @@ returnCode DB::addAccess(const std::string &src_user_pkey,
   value_str.pop_back();
   value_str.erase(0, 1);
   if (value_str == "private") {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
     return ERR_ACCESS;
   }
@@ -876,14 +1146,14 @@ returnCode DB::addAccess(const std::string &src_user_pkey,
           src_user_pkey + "'}) MERGE (n)-[r:Access]->(m) SET r.read_write = " +
           std::to_string(read_write) + " RETURN r";
   results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
@@ -903,45 +1173,45 @@ returnCode DB::checkAccess(const std::string &src_user_pkey,
   std::string query =
       "MATCH (n:User {email: '" + src_user_pkey + "'}) RETURN n";
   neo4j_result_stream_t *results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  neo4j_result_t *result = neo4j_fetch_next(results);
+  neo4j_result_t *result = fetchNext(results, connection);
   if (result == NULL) {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
-    return ERR_NO_NODE;
+    return noRecord(ERR_NO_NODE);
   }
   // Check User node exists - dst
   query = "MATCH (n:User {email: '" + dst_user_pkey + "'}) RETURN n";
   results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  result = neo4j_fetch_next(results);
+  result = fetchNext(results, connection);
   if (result == NULL) {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
-    return ERR_NO_NODE;
+    return noRecord(ERR_NO_NODE);
   }
   // Check TaskList node exists
   query = "MATCH (n:TaskList {name: '" + task_list_pkey + "', user: '" +
           src_user_pkey + "'}) RETURN n.visibility";
   results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  result = neo4j_fetch_next(results);
+  result = fetchNext(results, connection);
   if (result == NULL) {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
-    return ERR_NO_NODE;
+    return noRecord(ERR_NO_NODE);
   }
   // Check TaskList visibility
   neo4j_value_t value = neo4j_result_field(result, 0);
@@ -951,39 +1221,100 @@ returnCode DB::checkAccess(const std::string &src_user_pkey,
   value_str.pop_back();
   value_str.erase(0, 1);
   if (value_str == "private") {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
     return ERR_ACCESS;
   } else if (value_str == "public") {
     read_write = true;
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
     return SUCCESS;
   }
 
-  // Check access relationship
+  // Check access relationship, directly or through a group, write wins
   query = "MATCH (n:User {email: '" + dst_user_pkey +
-          "'})-[r:Access]->(m:TaskList {name: '" + task_list_pkey +
-          "', user: '" + src_user_pkey + "'}) RETURN r.read_write";
+          "'})-[:MemberOf*0..1]->()-[r:Access]->(m:TaskList {name: '" +
+          task_list_pkey + "', user: '" + src_user_pkey +
+          "'}) RETURN r.read_write ORDER BY r.read_write DESC LIMIT 1";
   results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  result = neo4j_fetch_next(results);
+  result = fetchNext(results, connection);
   if (result == NULL) {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
-    return ERR_ACCESS;
+    return noRecord(ERR_ACCESS);
   }
   value = neo4j_result_field(result, 0);
   neo4j_tostring(value, buf, sizeof(buf));
   read_write = bool(buf[0] - '0');
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
+  closeDB(connection);
+  return SUCCESS;
+}
+
+returnCode DB::probeAccess(const std::string &src_user_pkey,
+                           const std::string &dst_user_pkey,
+                           const std::string &task_list_pkey,
+                           const std::string &task_pkey, bool &read_write,
+                           int64_t &version) {
+  neo4j_connection_t *connection = connectDB();
+
+  // The TaskList, its visibility, the best access of the user, -1 if none,
+  // and the version of the TaskList or of its Task, -1 if no such Task
+  std::string query = "MATCH (m:TaskList {name: '" + task_list_pkey +
+                      "', user: '" + src_user_pkey + "'})";
+  std::string node_version = "coalesce(m.version, 0)";
+  if (!task_pkey.empty()) {
+    query += " OPTIONAL MATCH (m)-[:Contains]->(t:Task {name: '" + task_pkey +
+             "'})";
+    node_version = "CASE WHEN t IS NULL THEN -1 ELSE coalesce(t.version, 0) "
+                   "END";
+  }
+  if (src_user_pkey == dst_user_pkey) {
+    query += " RETURN m.visibility, 1, " + node_version;
+  } else {
+    query += " OPTIONAL MATCH (n:User {email: '" + dst_user_pkey +
+             "'})-[:MemberOf*0..1]->()-[r:Access]->(m) RETURN m.visibility, "
+             "coalesce(max(r.read_write), -1), " +
+             node_version;
+  }
+  neo4j_result_stream_t *results = executeQuery(query, connection);
+  if (queryFailed(results)) {
+    closeResults(results);
+    closeDB(connection);
+    return queryError();
+  }
+  neo4j_result_t *result = fetchNext(results, connection);
+  if (result == NULL) {
+    closeResults(results);
+    closeDB(connection);
+    return noRecord(ERR_NO_NODE);
+  }
+  neo4j_value_t value = neo4j_result_field(result, 0);
+  char buf[16];
+  neo4j_tostring(value, buf, sizeof(buf));
+  std::string value_str(buf);
+  value_str.pop_back();
+  value_str.erase(0, 1);
+  const int64_t access = neo4j_int_value(neo4j_result_field(result, 1));
+  version = neo4j_int_value(neo4j_result_field(result, 2));
+  closeResults(results);
   closeDB(connection);
+
+  if (src_user_pkey == dst_user_pkey || value_str == "public") {
+    read_write = true;
+    return SUCCESS;
+  }
+  if (value_str == "private" || access < 0) {
+    return ERR_ACCESS;
+  }
+  read_write = access > 0;
   return SUCCESS;
 }
 
@@ -997,21 +1328,232 @@ returnCode DB::removeAccess(const std::string &src_user_pkey,
                       "'})-[r:Access]->(m:TaskList {name: '" + task_list_pkey +
                       "', user: '" + src_user_pkey + "'}) DELETE r";
   neo4j_result_stream_t *results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
+  closeDB(connection);
+  return SUCCESS;
+}
+
+/**
+ * @brief Build a Cypher list literal of strings.
+ *
+ * @param items strings in the list
+ * @return std::string list literal like ['a', 'b']
+ */
+static std::string cypherList(const std::vector<std::string> &items) {
+  std::string list = "[";
+  for (auto &item : items) {
+    list += "'" + item + "', ";
+  }
+  if (!items.empty()) {
+    list.pop_back();
+    list.pop_back();
+  }
+  return list + "]";
+}
+
+/**
+ * @brief Build a Cypher list literal of maps, each with one pkey.
+ *
+ * @param items primary keys in the list
+ * @return std::string list literal like [{pkey: 'a'}, {pkey: 'b'}]
+ */
+static std::string cypherMaps(const std::vector<std::string> &items) {
+  std::string list = "[";
+  for (auto &item : items) {
+    list += "{pkey: '" + item + "'}, ";
+  }
+  if (!items.empty()) {
+    list.pop_back();
+    list.pop_back();
+  }
+  return list + "]";
+}
+
+/**
+ * @brief Build the start of a share statement: match the task list as m and
+ * every user or group to share with as n, one row per target d.
+ *
+ * @param src_user_pkey user that owns the list
+ * @param task_list_pkey task list primary key
+ * @param dst_list list literal of targets, each a map with a pkey
+ * @param dst_match clauses that bind the target of d as n, null if missing
+ * @return std::string the MATCH and UNWIND clauses
+ */
+static std::string shareTargets(const std::string &src_user_pkey,
+                                const std::string &task_list_pkey,
+                                const std::string &dst_list,
+                                const std::string &dst_match) {
+  return "OPTIONAL MATCH (m:TaskList {name: '" + task_list_pkey +
+         "', user: '" + src_user_pkey + "'}) UNWIND " + dst_list + " AS d " +
+         dst_match + " ";
+}
+
+/* Targets of a share statement by kind, groups are those of the owner */
+static const char *kUserTargets = "OPTIONAL MATCH (n:User {email: d.pkey})";
+static const char *kGroupTargets =
+    "OPTIONAL MATCH (n:Group {name: d.pkey, owner: m.user})";
+static const char *kMixedTargets =
+    "OPTIONAL MATCH (u:User {email: d.pkey}) WHERE NOT d.group "
+    "OPTIONAL MATCH (g:Group {name: d.pkey, owner: m.user}) WHERE d.group "
+    "WITH m, d, coalesce(u, g) AS n";
+
+/* The targets of a share statement that were found, if all of them were */
+static const char *kMissingTargets =
+    "collect(CASE WHEN n IS NULL THEN d.pkey END) AS missing";
+
+/* What a share statement writes: rows, unless a check failed */
+static std::string shareWrites(const std::string &rows) {
+  return "CASE WHEN m.visibility = 'shared' AND size(missing) = 0 THEN " +
+         rows + " ELSE [] END";
+}
+
+/**
+ * @brief Build a share statement that creates or modifies the access
+ * relationships of many users and groups to a task list.
+ *
+ * @param grants array of (user, read or write)
+ * @param group_grants array of (group, read or write)
+ * @return std::string the statement without its RETURN clause
+ */
+static std::string
+grantQuery(const std::string &src_user_pkey, const std::string &task_list_pkey,
+           const std::vector<std::pair<std::string, bool>> &grants,
+           const std::vector<std::pair<std::string, bool>> &group_grants) {
+  std::string grant_list = "[";
+  for (auto *batch : {&grants, &group_grants}) {
+    const std::string group = batch == &grants ? "false" : "true";
+    for (auto &grant : *batch) {
+      grant_list += "{pkey: '" + grant.first + "', group: " + group +
+                    ", read_write: " + std::to_string(grant.second) + "}, ";
+    }
+  }
+  grant_list.pop_back();
+  grant_list.pop_back();
+  grant_list += "]";
+
+  return shareTargets(src_user_pkey, task_list_pkey, grant_list,
+                      kMixedTargets) +
+         "WITH m, " + kMissingTargets +
+         ", collect([n, d.read_write]) AS rows FOREACH (row IN " +
+         shareWrites("rows") +
+         " | FOREACH (n IN [row[0]] | MERGE (n)-[r:Access]->(m) SET "
+         "r.read_write = row[1]))";
+}
+
+/**
+ * @brief Build a share statement that deletes the access relationships of
+ * many users or groups to a task list.
+ *
+ * @param dst_match kUserTargets or kGroupTargets
+ * @param dst_pkeys targets to revoke
+ * @return std::string the statement without its RETURN clause
+ */
+static std::string revokeQuery(const std::string &src_user_pkey,
+                               const std::string &task_list_pkey,
+                               const std::string &dst_match,
+                               const std::vector<std::string> &dst_pkeys) {
+  return shareTargets(src_user_pkey, task_list_pkey, cypherMaps(dst_pkeys),
+                      dst_match) +
+         "OPTIONAL MATCH (n)-[r:Access]->(m) WITH m, " + kMissingTargets +
+         ", collect(r) AS rows FOREACH (r IN " + shareWrites("rows") +
+         " | DELETE r)";
+}
+
+returnCode DB::runShareBatch(const std::string &query, std::string &err_dst) {
+  neo4j_connection_t *connection = connectDB();
+
+  // Checks and writes run as one statement, so nothing is written if any
+  // check fails
+  neo4j_result_stream_t *results =
+      executeQuery(query + " RETURN m.visibility, missing[0]", connection);
+  if (queryFailed(results)) {
+    closeResults(results);
+    closeDB(connection);
+    return queryError();
+  }
+  neo4j_result_t *result = fetchNext(results, connection);
+  if (result == NULL) {
+    closeResults(results);
+    closeDB(connection);
+    return noRecord(ERR_UNKNOWN);
+  }
+
+  // Check TaskList node exists and is shared
+  neo4j_value_t value = neo4j_result_field(result, 0);
+  if (neo4j_is_null(value)) {
+    closeResults(results);
+    closeDB(connection);
+    return ERR_NO_NODE;
+  }
+  char buf[1024];
+  neo4j_tostring(value, buf, sizeof(buf));
+  std::string value_str(buf);
+  value_str.pop_back();
+  value_str.erase(0, 1);
+  if (value_str != "shared") {
+    closeResults(results);
+    closeDB(connection);
+    return ERR_ACCESS;
+  }
+
+  // Check all User or Group nodes exist - dst, report the first missing one
+  value = neo4j_result_field(result, 1);
+  if (!neo4j_is_null(value)) {
+    neo4j_tostring(value, buf, sizeof(buf));
+    err_dst = buf;
+    err_dst.pop_back();
+    err_dst.erase(0, 1);
+    closeResults(results);
+    closeDB(connection);
+    return ERR_NO_NODE;
+  }
+
+  // Success
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
 
+returnCode DB::addAccessBatch(
+    const std::string &src_user_pkey, const std::string &task_list_pkey,
+    const std::vector<std::pair<std::string, bool>> &grants,
+    const std::vector<std::pair<std::string, bool>> &group_grants,
+    std::string &err_dst) {
+  if (grants.empty() && group_grants.empty()) {
+    return SUCCESS;
+  }
+
+  // Create or Modify all access relationships, if all users and groups exist
+  return runShareBatch(
+      grantQuery(src_user_pkey, task_list_pkey, grants, group_grants),
+      err_dst);
+}
+
+returnCode DB::removeAccessBatch(const std::string &src_user_pkey,
+                                 const std::string &task_list_pkey,
+                                 const std::vector<std::string> &dst_user_pkeys,
+                                 std::string &err_user) {
+  if (dst_user_pkeys.empty()) {
+    return SUCCESS;
+  }
+
+  // Remove all access relationships, if all users exist
+  return runShareBatch(revokeQuery(src_user_pkey, task_list_pkey,
+                                   kUserTargets, dst_user_pkeys),
+                       err_user);
+}
+
 returnCode DB::allAccess(
     const std::string &dst_user_pkey,
-    std::map<std::pair<std::string, std::string>, bool> &list_accesses) {
+    std::map<std::pair<std::string, std::string>, bool> &list_accesses,
+    const std::string &owner_pkey, size_t skip, size_t limit) {
   neo4j_connection_t *connection = connectDB();
 
   // clear map
@@ -1021,58 +1563,60 @@ returnCode DB::allAccess(
   std::string query =
       "MATCH (n:User {email: '" + dst_user_pkey + "'}) RETURN n";
   neo4j_result_stream_t *results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  neo4j_result_t *result = neo4j_fetch_next(results);
+  neo4j_result_t *result = fetchNext(results, connection);
   if (result == NULL) {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
-    return ERR_NO_NODE;
+    return noRecord(ERR_NO_NODE);
   }
 
-  // Get all TaskList nodes
+  // Get all non-private TaskList nodes, directly or through a group. A list
+  // granted both ways is one row where write wins, public implies write.
   query = "MATCH (n:User {email: '" + dst_user_pkey +
-          "'})-[r:Access]->(m:TaskList) RETURN m.user, m.name, m.visibility, "
-          "r.read_write";
+          "'})-[:MemberOf*0..1]->()-[r:Access]->(m:TaskList) WHERE "
+          "m.visibility <> 'private'";
+  if (!owner_pkey.empty()) {
+    query += " AND m.user = '" + owner_pkey + "'";
+  }
+  query += " RETURN m.user AS user, m.name AS name, max(CASE WHEN "
+           "m.visibility = 'public' OR r.read_write = 1 THEN 1 ELSE 0 END) = "
+           "1 ORDER BY user, name";
+  if (skip > 0) {
+    query += " SKIP " + std::to_string(skip);
+  }
+  if (limit > 0) {
+    query += " LIMIT " + std::to_string(limit);
+  }
   results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  while ((result = neo4j_fetch_next(results)) != NULL) {
-    // Check TaskList visibility
-    neo4j_value_t value = neo4j_result_field(result, 2);
-    char buf[1024];
-    neo4j_tostring(value, buf, sizeof(buf));
-    std::string value_str(buf);
-    value_str.pop_back();
-    value_str.erase(0, 1);
-    if (value_str == "private") {
-      continue;
-    }
-    // Check access relationship
-    value = neo4j_result_field(result, 1);
-    neo4j_tostring(value, buf, sizeof(buf));
-    std::string task_list_pkey(buf);
-    task_list_pkey.pop_back();
-    task_list_pkey.erase(0, 1);
-    value = neo4j_result_field(result, 0);
-    neo4j_tostring(value, buf, sizeof(buf));
-    std::string user_pkey(buf);
-    user_pkey.pop_back();
-    user_pkey.erase(0, 1);
-    value = neo4j_result_field(result, 3);
-    neo4j_tostring(value, buf, sizeof(buf));
-    bool read_write = (value_str == "public") ? true : bool(buf[0] - '0');
-    list_accesses[{user_pkey, task_list_pkey}] = read_write;
+  while ((result = fetchNext(results, connection)) != NULL) {
+    char user_pkey[1024];
+    char task_list_pkey[1024];
+    neo4j_string_value(neo4j_result_field(result, 0), user_pkey,
+                       sizeof(user_pkey));
+    neo4j_string_value(neo4j_result_field(result, 1), task_list_pkey,
+                       sizeof(task_list_pkey));
+    list_accesses[{user_pkey, task_list_pkey}] =
+        neo4j_bool_value(neo4j_result_field(result, 2));
+  }
+  // Abandoned at the deadline, what was read is partial
+  if (thread_timed_out) {
+    closeResults(results);
+    closeDB(connection);
+    return ERR_TIMEOUT;
   }
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
@@ -1089,31 +1633,31 @@ returnCode DB::allGrant(const std::string &src_user_pkey,
   std::string query =
       "MATCH (n:User {email: '" + src_user_pkey + "'}) RETURN n";
   neo4j_result_stream_t *results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  neo4j_result_t *result = neo4j_fetch_next(results);
+  neo4j_result_t *result = fetchNext(results, connection);
   if (result == NULL) {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
-    return ERR_NO_NODE;
+    return noRecord(ERR_NO_NODE);
   }
   // Check TaskList node exists
   query = "MATCH (n:TaskList {name: '" + task_list_pkey + "', user: '" +
           src_user_pkey + "'}) RETURN n.visibility";
   results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  result = neo4j_fetch_next(results);
+  result = fetchNext(results, connection);
   if (result == NULL) {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
-    return ERR_NO_NODE;
+    return noRecord(ERR_NO_NODE);
   }
   // Check TaskList visibility
   neo4j_value_t value = neo4j_result_field(result, 0);
@@ -1123,7 +1667,7 @@ returnCode DB::allGrant(const std::string &src_user_pkey,
   value_str.pop_back();
   value_str.erase(0, 1);
   if (value_str != "shared") {
-    neo4j_close_results(results);
+    closeResults(results);
     closeDB(connection);
     return SUCCESS;
   }
@@ -1132,12 +1676,12 @@ returnCode DB::allGrant(const std::string &src_user_pkey,
   query = "MATCH (n:User)-[r:Access]->(m:TaskList {name: '" + task_list_pkey +
           "', user: '" + src_user_pkey + "'}) RETURN n.email, r.read_write";
   results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
-  while ((result = neo4j_fetch_next(results)) != NULL) {
+  while ((result = fetchNext(results, connection)) != NULL) {
     // Check access relationship
     neo4j_value_t value = neo4j_result_field(result, 0);
     char buf[1024];
@@ -1150,9 +1694,15 @@ returnCode DB::allGrant(const std::string &src_user_pkey,
     bool read_write = bool(buf[0] - '0');
     list_grants[user_pkey] = read_write;
   }
+  // Abandoned at the deadline, what was read is partial
+  if (thread_timed_out) {
+    closeResults(results);
+    closeDB(connection);
+    return ERR_TIMEOUT;
+  }
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
@@ -1168,13 +1718,13 @@ DB::getAllPublic(std::vector<std::pair<std::string, std::string>> &user_list) {
   std::string query =
       "MATCH (n:TaskList) WHERE n.visibility = 'public' RETURN n.user, n.name";
   neo4j_result_stream_t *results = executeQuery(query, connection);
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
   neo4j_result_t *result;
-  while ((result = neo4j_fetch_next(results)) != NULL) {
+  while ((result = fetchNext(results, connection)) != NULL) {
     // Get TaskList info
     neo4j_value_t value = neo4j_result_field(result, 0);
     char buf[1024];
@@ -1189,9 +1739,448 @@ DB::getAllPublic(std::vector<std::pair<std::string, std::string>> &user_list) {
     task_list_pkey.erase(0, 1);
     user_list.push_back({user_pkey, task_list_pkey});
   }
+  // Abandoned at the deadline, what was read is partial
+  if (thread_timed_out) {
+    closeResults(results);
+    closeDB(connection);
+    return ERR_TIMEOUT;
+  }
 
   // Success
-  neo4j_close_results(results);
+  closeResults(results);
+  closeDB(connection);
+  return SUCCESS;
+}
+
+returnCode DB::getAgenda(
+    const std::string &user_pkey, const std::string &status,
+    std::vector<std::map<std::string, std::string>> &task_infos) {
+  neo4j_connection_t *connection = connectDB();
+
+  // clear vector
+  task_infos.clear();
+
+  // Get tasks of owned and accessible TaskList nodes in one traversal, a
+  // task reached both directly and through a group is returned once.
+  // OPTIONAL MATCH keeps one row for an existing user without any task.
+  std::string query =
+      "MATCH (u:User {email: '" + user_pkey +
+      "'}) OPTIONAL MATCH (u)-[:MemberOf*0..1]->()-[r:Owns|Access]->"
+      "(m:TaskList)-[:Contains]->(t:Task) WHERE (type(r) = 'Owns' OR "
+      "m.visibility <> 'private')";
+  if (!status.empty()) {
+    query += " AND t.status = '" + status + "'";
+  }
+  query += " RETURN t, max(CASE WHEN type(r) = 'Owns' OR m.visibility = "
+           "'public' OR r.read_write = 1 THEN 1 ELSE 0 END) = 1";
+  neo4j_result_stream_t *results = executeQuery(query, connection);
+  if (queryFailed(results)) {
+    closeResults(results);
+    closeDB(connection);
+    return queryError();
+  }
+  neo4j_result_t *result = fetchNext(results, connection);
+  if (result == NULL) {
+    closeResults(results);
+    closeDB(connection);
+    return noRecord(ERR_NO_NODE);
+  }
+
+  // Extract returned info
+  for (; result != NULL; result = fetchNext(results, connection)) {
+    neo4j_value_t node = neo4j_result_field(result, 0);
+    if (neo4j_is_null(node)) {
+      continue;
+    }
+    neo4j_value_t value = neo4j_node_properties(node);
+    std::map<std::string, std::string> task_info;
+    char buf[1024];
+    for (int i = 0; i < neo4j_map_size(value); i++) {
+      const neo4j_map_entry_t *kv = neo4j_map_getentry(value, i);
+      neo4j_tostring(kv->key, buf, sizeof(buf));
+      std::string key_str(buf);
+      key_str.pop_back();
+      key_str.erase(0, 1);
+      neo4j_tostring(kv->value, buf, sizeof(buf));
+      std::string val_str(buf);
+      val_str.pop_back();
+      val_str.erase(0, 1);
+      task_info[key_str] = val_str;
+    }
+    task_info.erase("version");
+    task_info["permission"] =
+        neo4j_bool_value(neo4j_result_field(result, 1)) ? "1" : "0";
+    task_infos.push_back(std::move(task_info));
+  }
+  // Abandoned at the deadline, what was read is partial
+  if (thread_timed_out) {
+    closeResults(results);
+    closeDB(connection);
+    return ERR_TIMEOUT;
+  }
+
+  // Success
+  closeResults(results);
+  closeDB(connection);
+  return SUCCESS;
+}
+
+returnCode DB::createGroupNode(const std::string &user_pkey,
+                               const std::string &group_pkey) {
+  neo4j_connection_t *connection = connectDB();
+
+  // Check Foreign Key - user_pkey exsits
+  std::string query =
+      "MATCH (n:User) WHERE n.email = '" + user_pkey + "' RETURN n";
+  neo4j_result_stream_t *results = executeQuery(query, connection);
+  if (queryFailed(results)) {
+    closeResults(results);
+    closeDB(connection);
+    return queryError();
+  }
+  if (fetchNext(results, connection) == NULL) {
+    closeResults(results);
+    closeDB(connection);
+    return noRecord(ERR_NO_NODE);
+  }
+
+  // Create node Group, the owner is its first member
+  query = "MATCH (n:User {email: '" + user_pkey +
+          "'}) CREATE (g:Group {name: '" + group_pkey + "', owner: '" +
+          user_pkey + "'}), (n)-[:MemberOf]->(g)";
+  results = executeQuery(query, connection);
+
+  // Check result
+  if (queryFailed(results)) {
+    if (results && error_code_of_dup == neo4j_error_code(results)) {
+      closeResults(results);
+      closeDB(connection);
+      return ERR_DUP_NODE;
+    } else {
+      closeResults(results);
+      closeDB(connection);
+      return queryError();
+    }
+  }
+
+  // Success
+  closeResults(results);
+  closeDB(connection);
+  return SUCCESS;
+}
+
+returnCode DB::checkGroupOwner(neo4j_connection_t *connection,
+                               const std::string &user_pkey,
+                               const std::string &group_pkey) {
+  std::string query = "MATCH (g:Group {name: '" + group_pkey + "', owner: '" +
+                      user_pkey + "'}) RETURN g.owner";
+  neo4j_result_stream_t *results = executeQuery(query, connection);
+  if (queryFailed(results)) {
+    closeResults(results);
+    return queryError();
+  }
+  if (fetchNext(results, connection) == NULL) {
+    closeResults(results);
+    return noRecord(ERR_NO_NODE);
+  }
+  closeResults(results);
+  return SUCCESS;
+}
+
+returnCode DB::deleteGroupNode(const std::string &user_pkey,
+                               const std::string &group_pkey,
+                               std::vector<std::string> &task_list_pkeys) {
+  neo4j_connection_t *connection = connectDB();
+
+  // Clear vector
+  task_list_pkeys.clear();
+
+  // Only the owner can delete a group
+  returnCode ret = checkGroupOwner(connection, user_pkey, group_pkey);
+  if (ret != SUCCESS) {
+    closeDB(connection);
+    return ret;
+  }
+
+  // Delete node Group with its memberships and grants, and return the lists
+  // it was granted in the same statement
+  std::string query = "MATCH (g:Group {name: '" + group_pkey + "', owner: '" +
+                      user_pkey +
+                      "'}) OPTIONAL MATCH (g)-[:Access]->(l:TaskList) WITH g, "
+                      "collect(l.name) AS lists DETACH DELETE g WITH lists "
+                      "UNWIND lists AS list RETURN list";
+  neo4j_result_stream_t *results = executeQuery(query, connection);
+  if (queryFailed(results)) {
+    closeResults(results);
+    closeDB(connection);
+    return queryError();
+  }
+  neo4j_result_t *result;
+  while ((result = fetchNext(results, connection)) != NULL) {
+    char buf[1024];
+    neo4j_tostring(neo4j_result_field(result, 0), buf, sizeof(buf));
+    std::string task_list_pkey(buf);
+    task_list_pkey.pop_back();
+    task_list_pkey.erase(0, 1);
+    task_list_pkeys.push_back(task_list_pkey);
+  }
+  // Abandoned at the deadline, what was read is partial
+  if (thread_timed_out) {
+    closeResults(results);
+    closeDB(connection);
+    return ERR_TIMEOUT;
+  }
+
+  // Success
+  closeResults(results);
+  closeDB(connection);
+  return SUCCESS;
+}
+
+returnCode DB::getGroupNode(const std::string &user_pkey,
+                            const std::string &group_pkey,
+                            std::vector<std::string> &members) {
+  neo4j_connection_t *connection = connectDB();
+
+  // Clear vector
+  members.clear();
+
+  // Get node Group with all its members
+  std::string query = "MATCH (g:Group {name: '" + group_pkey + "', owner: '" +
+                      user_pkey +
+                      "'}) OPTIONAL MATCH (n:User)-[:MemberOf]->(g) RETURN "
+                      "n.email";
+  neo4j_result_stream_t *results = executeQuery(query, connection);
+  if (queryFailed(results)) {
+    closeResults(results);
+    closeDB(connection);
+    return queryError();
+  }
+  neo4j_result_t *result = fetchNext(results, connection);
+  if (result == NULL) {
+    closeResults(results);
+    closeDB(connection);
+    return noRecord(ERR_NO_NODE);
+  }
+
+  // Extract returned info
+  char buf[1024];
+  for (; result != NULL; result = fetchNext(results, connection)) {
+    neo4j_value_t value = neo4j_result_field(result, 0);
+    if (neo4j_is_null(value)) {
+      continue;
+    }
+    neo4j_tostring(value, buf, sizeof(buf));
+    std::string member(buf);
+    member.pop_back();
+    member.erase(0, 1);
+    members.push_back(member);
+  }
+  // Abandoned at the deadline, what was read is partial
+  if (thread_timed_out) {
+    closeResults(results);
+    closeDB(connection);
+    return ERR_TIMEOUT;
+  }
+
+  // Success
+  closeResults(results);
+  closeDB(connection);
+  return SUCCESS;
+}
+
+returnCode DB::getAllGroupNodes(
+    const std::string &user_pkey,
+    std::vector<std::pair<std::string, std::string>> &groups) {
+  neo4j_connection_t *connection = connectDB();
+
+  // Clear vector
+  groups.clear();
+
+  // Get all groups the user is a member of, with their owner
+  std::string query = "MATCH (n:User {email: '" + user_pkey +
+                      "'}) OPTIONAL MATCH (n)-[:MemberOf]->(g:Group) RETURN "
+                      "g.owner, g.name ORDER BY g.owner, g.name";
+  neo4j_result_stream_t *results = executeQuery(query, connection);
+  if (queryFailed(results)) {
+    closeResults(results);
+    closeDB(connection);
+    return queryError();
+  }
+  neo4j_result_t *result = fetchNext(results, connection);
+  if (result == NULL) {
+    closeResults(results);
+    closeDB(connection);
+    return noRecord(ERR_NO_NODE);
+  }
+
+  // Extract returned info, a single null row means no group
+  for (; result != NULL; result = fetchNext(results, connection)) {
+    neo4j_value_t value = neo4j_result_field(result, 0);
+    if (neo4j_is_null(value)) {
+      continue;
+    }
+    char buf[1024];
+    neo4j_tostring(value, buf, sizeof(buf));
+    std::string owner(buf);
+    owner.pop_back();
+    owner.erase(0, 1);
+    neo4j_tostring(neo4j_result_field(result, 1), buf, sizeof(buf));
+    std::string group_pkey(buf);
+    group_pkey.pop_back();
+    group_pkey.erase(0, 1);
+    groups.emplace_back(owner, group_pkey);
+  }
+  // Abandoned at the deadline, what was read is partial
+  if (thread_timed_out) {
+    closeResults(results);
+    closeDB(connection);
+    return ERR_TIMEOUT;
+  }
+
+  // Success
+  closeResults(results);
+  closeDB(connection);
+  return SUCCESS;
+}
+
+returnCode DB::addGroupMembers(const std::string &user_pkey,
+                               const std::string &group_pkey,
+                               const std::vector<std::string> &member_pkeys,
+                               std::string &err_user) {
+  neo4j_connection_t *connection = connectDB();
+
+  // Only the owner can change the members
+  returnCode ret = checkGroupOwner(connection, user_pkey, group_pkey);
+  if (ret != SUCCESS) {
+    closeDB(connection);
+    return ret;
+  }
+
+  // Check all User nodes exist, report the first missing one
+  std::string query =
+      "UNWIND " + cypherList(member_pkeys) +
+      " AS email OPTIONAL MATCH (n:User {email: email}) WITH email, n "
+      "WHERE n IS NULL RETURN email LIMIT 1";
+  neo4j_result_stream_t *results = executeQuery(query, connection);
+  if (queryFailed(results)) {
+    closeResults(results);
+    closeDB(connection);
+    return queryError();
+  }
+  neo4j_result_t *result = fetchNext(results, connection);
+  if (result != NULL) {
+    char buf[1024];
+    neo4j_tostring(neo4j_result_field(result, 0), buf, sizeof(buf));
+    err_user = buf;
+    err_user.pop_back();
+    err_user.erase(0, 1);
+    closeResults(results);
+    closeDB(connection);
+    return ERR_NO_NODE;
+  }
+
+  // Add all memberships in one statement
+  query = "MATCH (g:Group {name: '" + group_pkey + "', owner: '" + user_pkey +
+          "'}) UNWIND " + cypherList(member_pkeys) +
+          " AS email MATCH (n:User {email: email}) MERGE (n)-[:MemberOf]->(g)";
+  results = executeQuery(query, connection);
+  if (queryFailed(results)) {
+    closeResults(results);
+    closeDB(connection);
+    return queryError();
+  }
+
+  // Success
+  closeResults(results);
+  closeDB(connection);
+  return SUCCESS;
+}
+
+returnCode
+DB::removeGroupMembers(const std::string &user_pkey,
+                       const std::string &group_pkey,
+                       const std::vector<std::string> &member_pkeys) {
+  neo4j_connection_t *connection = connectDB();
+
+  // Only the owner can change the members
+  returnCode ret = checkGroupOwner(connection, user_pkey, group_pkey);
+  if (ret != SUCCESS) {
+    closeDB(connection);
+    return ret;
+  }
+
+  // Remove all memberships in one statement, the owner always stays
+  std::string query = "UNWIND " + cypherList(member_pkeys) +
+                      " AS email MATCH (n:User {email: email})-[r:MemberOf]->"
+                      "(g:Group {name: '" +
+                      group_pkey + "', owner: '" + user_pkey +
+                      "'}) WHERE email <> g.owner DELETE r";
+  neo4j_result_stream_t *results = executeQuery(query, connection);
+  if (queryFailed(results)) {
+    closeResults(results);
+    closeDB(connection);
+    return queryError();
+  }
+
+  // Success
+  closeResults(results);
+  closeDB(connection);
+  return SUCCESS;
+}
+
+returnCode
+DB::removeGroupAccessBatch(const std::string &src_user_pkey,
+                           const std::string &task_list_pkey,
+                           const std::vector<std::string> &group_pkeys,
+                           std::string &err_group) {
+  if (group_pkeys.empty()) {
+    return SUCCESS;
+  }
+
+  // Remove all access relationships, if all groups exist
+  return runShareBatch(revokeQuery(src_user_pkey, task_list_pkey,
+                                   kGroupTargets, group_pkeys),
+                       err_group);
+}
+
+returnCode DB::allGroupGrant(const std::string &src_user_pkey,
+                             const std::string &task_list_pkey,
+                             std::map<std::string, bool> &group_grants) {
+  neo4j_connection_t *connection = connectDB();
+
+  // clear map
+  group_grants.clear();
+
+  // Get all grants to groups
+  std::string query = "MATCH (n:Group)-[r:Access]->(m:TaskList {name: '" +
+                      task_list_pkey + "', user: '" + src_user_pkey +
+                      "'}) RETURN n.name, r.read_write";
+  neo4j_result_stream_t *results = executeQuery(query, connection);
+  if (queryFailed(results)) {
+    closeResults(results);
+    closeDB(connection);
+    return queryError();
+  }
+  neo4j_result_t *result;
+  while ((result = fetchNext(results, connection)) != NULL) {
+    char buf[1024];
+    neo4j_tostring(neo4j_result_field(result, 0), buf, sizeof(buf));
+    std::string group_pkey(buf);
+    group_pkey.pop_back();
+    group_pkey.erase(0, 1);
+    neo4j_tostring(neo4j_result_field(result, 1), buf, sizeof(buf));
+    group_grants[group_pkey] = bool(buf[0] - '0');
+  }
+  // Abandoned at the deadline, what was read is partial
+  if (thread_timed_out) {
+    closeResults(results);
+    closeDB(connection);
+    return ERR_TIMEOUT;
+  }
+
+  // Success
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
@@ -1202,30 +2191,68 @@ returnCode DB::deleteEverything(void) {
 
   neo4j_result_stream_t *results = executeQuery(query, connection);
 
-  if (neo4j_check_failure(results)) {
-    neo4j_close_results(results);
+  if (queryFailed(results)) {
+    closeResults(results);
     closeDB(connection);
-    return ERR_UNKNOWN;
+    return queryError();
   }
 
-  neo4j_close_results(results);
+  closeResults(results);
   closeDB(connection);
   return SUCCESS;
 }
 
+uint64_t DB::threadQueryTime() {
+  uint64_t time = thread_query_time;
+  if (thread_open_connections > 0) {
+    time += std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - thread_connected_at)
+                .count();
+  }
+  return time;
+}
+
+void DB::setThreadDeadline(std::chrono::steady_clock::time_point deadline) {
+  thread_deadline = deadline;
+  thread_timed_out = false;
+}
+
+bool DB::threadTimedOut() { return thread_timed_out; }
+
 neo4j_connection_t *DB::connectDB() {
+  const auto start = std::chrono::steady_clock::now();
   neo4j_connection_t *connection =
       neo4j_connect(host_.c_str(), NULL, NEO4J_INSECURE);
   if (!connection) {
+    thread_query_time +=
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count();
     throw std::runtime_error("Connection failed");
   }
+  if (thread_open_connections++ == 0) {
+    thread_connected_at = start;
+  }
   return connection;
 }
 
-void DB::closeDB(neo4j_connection_t *connection) { neo4j_close(connection); }
+void DB::closeDB(neo4j_connection_t *connection) {
+  neo4j_close(connection);
+  if (thread_open_connections > 0 && --thread_open_connections == 0) {
+    thread_query_time +=
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - thread_connected_at)
+            .count();
+  }
+}
 
 neo4j_result_stream_t *DB::executeQuery(const std::string &query,
                                         neo4j_connection_t *connection) {
+  // Do not issue a query the request has no time left for
+  if (deadlinePassed()) {
+    errno = ETIMEDOUT;
+    return NULL;
+  }
   // Execute the query
   neo4j_result_stream_t *results =
       neo4j_run(connection, query.c_str(), neo4j_null);
@@ -1258,6 +2285,14 @@ void DB::ensureConstraints() {
     closeDB(connection);
     throw std::runtime_error(get_Neo4jC_error());
   }
+  // Create constraints for Group_pkey
+  query = "CREATE CONSTRAINT Group_pkey IF NOT EXISTS FOR (n:Group) "
+          "REQUIRE (n.name, n.owner) IS UNIQUE";
+  results = executeQuery(query, connection);
+  if (neo4j_check_failure(results)) {
+    closeDB(connection);
+    throw std::runtime_error(get_Neo4jC_error());
+  }
   closeDB(connection);
   neo4j_close_results(results);
 }
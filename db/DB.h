@@ -1,6 +1,8 @@
 #pragma once
 
 #include "common/errorCode.h"
+#include <chrono>
+#include <cstdint>
 #include <errno.h>
 #include <map>
 #include <stdexcept>
@@ -40,14 +42,6 @@ private:
    *
    */
   void closeDB(neo4j_connection_t *connection);
-  /**
-   * @brief Execute a query.
-   *
-   * @param query
-   * @return neo4j_result_stream_t *: a pointer to a list of results
-   */
-  neo4j_result_stream_t *executeQuery(const std::string &query,
-                                      neo4j_connection_t *connection);
   /**
    * @brief Get Neo4j Client Error Message
    *
@@ -58,6 +52,42 @@ private:
    *
    */
   void ensureConstraints();
+  /**
+   * @brief Run a statement that checks and writes the shares of a task list
+   * at once. The statement matches the list as m, ends with m and the list
+   * of missing users or groups bound, and writes only if the list is shared
+   * and none is missing.
+   *
+   * @param query the statement without its RETURN clause
+   * @param err_dst the first user or group that does not exist
+   * @return returnCode ERR_NO_NODE if no such list or target, ERR_ACCESS if
+   * the list is not shared
+   */
+  returnCode runShareBatch(const std::string &query, std::string &err_dst);
+  /**
+   * @brief Check a user owns a group of this name.
+   *
+   * @param connection connection to run the check on
+   * @param user_pkey user primary key
+   * @param group_pkey group name, unique among the groups of the user
+   * @return returnCode ERR_NO_NODE if the user owns no such group
+   */
+  returnCode checkGroupOwner(neo4j_connection_t *connection,
+                             const std::string &user_pkey,
+                             const std::string &group_pkey);
+
+protected:
+  /**
+   * @brief Execute a query, unless the deadline of the thread has passed.
+   * Writes are single statements, so a write is either issued whole or not
+   * at all. Virtual so that tests can make the deadline pass mid-call.
+   *
+   * @param query
+   * @return neo4j_result_stream_t *: a pointer to a list of results, NULL if
+   * the query was not issued
+   */
+  virtual neo4j_result_stream_t *executeQuery(const std::string &query,
+                                              neo4j_connection_t *connection);
 
 public:
   DB() {}
@@ -74,6 +104,30 @@ public:
    */
   ~DB();
 
+  /**
+   * @brief Time the calling thread has spent with a connection to neo4j open,
+   * from connectDB to closeDB, in microseconds. Read it before and after a
+   * request to know how long the request waited on the DB.
+   */
+  static uint64_t threadQueryTime();
+
+  /**
+   * @brief Set the deadline of the request handled by the calling thread.
+   * Past it, queries are not issued and the results being read are abandoned,
+   * the method returns ERR_TIMEOUT, or what it had read so far. So check
+   * threadTimedOut after calling it.
+   *
+   * @param deadline The deadline, time_point::max() for none.
+   */
+  static void
+  setThreadDeadline(std::chrono::steady_clock::time_point deadline);
+
+  /**
+   * @brief Whether a query of the calling thread was skipped or abandoned
+   * since its deadline was set.
+   */
+  static bool threadTimedOut();
+
   /*
    * All parameters are passed by reference. Therefore, the caller should
    * allocate them even if it is a return value. (Except for the return code)
@@ -236,6 +290,46 @@ public:
   virtual returnCode getAllTaskNodes(const std::string &user_pkey,
                                      const std::string &task_list_pkey,
                                      std::vector<std::string> &task_info);
+  /**
+   * @brief Get all task list nodes of a user with the requested fields only.
+   *
+   * @param [in] user_pkey user primary key
+   * @param [in] fields field names to return, empty for all fields
+   * @param [out] task_list_infos array of task list fields
+   * @return returnCode error message
+   */
+  virtual returnCode getTaskListNodes(
+      const std::string &user_pkey, const std::vector<std::string> &fields,
+      std::vector<std::map<std::string, std::string>> &task_list_infos);
+  /**
+   * @brief Get all task nodes of a task list with the requested fields only.
+   *
+   * @param [in] user_pkey user primary key
+   * @param [in] task_list_pkey task list primary key
+   * @param [in] fields field names to return, empty for all fields
+   * @param [out] task_infos array of task fields
+   * @return returnCode error message
+   */
+  virtual returnCode
+  getTaskNodes(const std::string &user_pkey, const std::string &task_list_pkey,
+               const std::vector<std::string> &fields,
+               std::vector<std::map<std::string, std::string>> &task_infos);
+  /**
+   * @brief Get the version of a user, task list or task node. A task list's
+   * version grows whenever it or one of its tasks is created, revised or
+   * deleted, a task's whenever it is revised, and a user's whenever one of
+   * its task lists is created or deleted.
+   *
+   * @param [in] user_pkey user primary key
+   * @param [in] task_list_pkey task list primary key, empty for the user
+   * @param [in] task_pkey task primary key, empty for the task list
+   * @param [out] version version of the node, 0 if it was never versioned
+   * @return returnCode error message
+   */
+  virtual returnCode getVersion(const std::string &user_pkey,
+                                const std::string &task_list_pkey,
+                                const std::string &task_pkey,
+                                int64_t &version);
   /**
    * @brief Create or Revise access relationship between a user and a task list.
    *
@@ -250,7 +344,8 @@ public:
                                const std::string &task_list_pkey,
                                const bool read_write);
   /**
-   * @brief Check access relationship between a user and a task list.
+   * @brief Check access relationship between a user and a task list, directly
+   * or through the groups the user is a member of.
    *
    * @param [in] src_user_pkey user that owns the list
    * @param [in] dst_user_pkey user that ask for access the list
@@ -262,6 +357,26 @@ public:
                                  const std::string &dst_user_pkey,
                                  const std::string &task_list_pkey,
                                  bool &read_write);
+  /**
+   * @brief Same as checkAccess in a single query, and for the owner too: the
+   * task list must exist whoever asks. The user nodes are not looked up, a
+   * task list exists only along with its owner. The same query reads the
+   * version getVersion would give, so that a conditional GET needs no other.
+   *
+   * @param [in] src_user_pkey user that owns the list
+   * @param [in] dst_user_pkey user that ask for access the list
+   * @param [in] task_list_pkey task list primary key
+   * @param [in] task_pkey task primary key, empty for the task list
+   * @param [out] read_write read or write access
+   * @param [out] version version of the task, or of the task list if
+   * task_pkey is empty, -1 if there is no such task
+   * @return returnCode error message
+   */
+  virtual returnCode probeAccess(const std::string &src_user_pkey,
+                                 const std::string &dst_user_pkey,
+                                 const std::string &task_list_pkey,
+                                 const std::string &task_pkey,
+                                 bool &read_write, int64_t &version);
   /**
    * @brief Delete access relationship between a user and a task list.
    *
@@ -274,16 +389,56 @@ public:
                                   const std::string &dst_user_pkey,
                                   const std::string &task_list_pkey);
   /**
-   * @brief Get All the access lists of a dst user.
+   * @brief Create or Revise access relationships between many users and
+   * groups and a task list in one statement. Members of a group get its
+   * access. Nothing is changed if any check fails.
+   *
+   * @param [in] src_user_pkey user that grants access
+   * @param [in] task_list_pkey task list primary key
+   * @param [in] grants array of (user that is granted access, read or write)
+   * @param [in] group_grants array of (group of src_user_pkey that is
+   * granted access, read or write)
+   * @param [out] err_dst the user or group that does not exist, if any
+   * @return returnCode error message
+   */
+  virtual returnCode
+  addAccessBatch(const std::string &src_user_pkey,
+                 const std::string &task_list_pkey,
+                 const std::vector<std::pair<std::string, bool>> &grants,
+                 const std::vector<std::pair<std::string, bool>> &group_grants,
+                 std::string &err_dst);
+  /**
+   * @brief Delete access relationships between many users and a task list in
+   * one statement. Nothing is changed if any check fails.
+   *
+   * @param [in] src_user_pkey user that grants access
+   * @param [in] task_list_pkey task list primary key
+   * @param [in] dst_user_pkeys users that are granted access
+   * @param [out] err_user the user that does not exist, if any
+   * @return returnCode error message
+   */
+  virtual returnCode
+  removeAccessBatch(const std::string &src_user_pkey,
+                    const std::string &task_list_pkey,
+                    const std::vector<std::string> &dst_user_pkeys,
+                    std::string &err_user);
+  /**
+   * @brief Get All the non-private access lists of a dst user, directly or
+   * through the groups the user is a member of, ordered by owner and name.
    *
    * @param [in] dst_user_pkey user that is granted access
    * @param [out] list_accesses a map: key: (user_pkey, task list pkey), value:
    * read or write
+   * @param [in] owner_pkey only lists of this owner, empty for all owners
+   * @param [in] skip number of lists to skip
+   * @param [in] limit max number of lists to return, 0 for no limit
    * @return returnCode error message
    */
   virtual returnCode
   allAccess(const std::string &dst_user_pkey,
-            std::map<std::pair<std::string, std::string>, bool> &list_accesses);
+            std::map<std::pair<std::string, std::string>, bool> &list_accesses,
+            const std::string &owner_pkey = "", size_t skip = 0,
+            size_t limit = 0);
   /**
    * @brief Get All the grant shared lists of a src user given tasklist.
    *
@@ -303,6 +458,115 @@ public:
    */
   virtual returnCode
   getAllPublic(std::vector<std::pair<std::string, std::string>> &user_list);
+  /**
+   * @brief Get all tasks of the lists a user owns or is granted access to, in
+   * a single traversal over Owns and Access relationships.
+   *
+   * @param [in] user_pkey user primary key
+   * @param [in] status only tasks in this status, empty for any status
+   * @param [out] task_infos array of task fields, together with "user" (list
+   * owner), "list" (task list pkey) and "permission" ("1" write, "0" read)
+   * @return returnCode error message
+   */
+  virtual returnCode
+  getAgenda(const std::string &user_pkey, const std::string &status,
+            std::vector<std::map<std::string, std::string>> &task_infos);
+
+  /**
+   * @brief Create a group node owned by a user, who is its first member.
+   * Groups are keyed by (owner, name), as task lists are.
+   *
+   * @param [in] user_pkey owner of the group
+   * @param [in] group_pkey group name, unique among the groups of the user
+   * @return returnCode error message
+   */
+  virtual returnCode createGroupNode(const std::string &user_pkey,
+                                     const std::string &group_pkey);
+  /**
+   * @brief Delete a group node with its memberships and grants.
+   *
+   * @param [in] user_pkey owner of the group
+   * @param [in] group_pkey group primary key
+   * @param [out] task_list_pkeys task lists of the owner the group was
+   * granted, its members may have lost access to them
+   * @return returnCode error message
+   */
+  virtual returnCode deleteGroupNode(const std::string &user_pkey,
+                                     const std::string &group_pkey,
+                                     std::vector<std::string> &task_list_pkeys);
+  /**
+   * @brief Get a group node with its members.
+   *
+   * @param [in] user_pkey owner of the group
+   * @param [in] group_pkey group primary key
+   * @param [out] members array of member user pkeys
+   * @return returnCode error message
+   */
+  virtual returnCode getGroupNode(const std::string &user_pkey,
+                                  const std::string &group_pkey,
+                                  std::vector<std::string> &members);
+  /**
+   * @brief Get all groups a user is a member of.
+   *
+   * @param [in] user_pkey user primary key
+   * @param [out] groups array of (owner, group pkey), ordered by owner and
+   * name
+   * @return returnCode error message
+   */
+  virtual returnCode
+  getAllGroupNodes(const std::string &user_pkey,
+                   std::vector<std::pair<std::string, std::string>> &groups);
+  /**
+   * @brief Add users to a group in one statement.
+   *
+   * @param [in] user_pkey owner of the group
+   * @param [in] group_pkey group primary key
+   * @param [in] member_pkeys users to add
+   * @param [out] err_user the user that does not exist, if any
+   * @return returnCode error message
+   */
+  virtual returnCode
+  addGroupMembers(const std::string &user_pkey, const std::string &group_pkey,
+                  const std::vector<std::string> &member_pkeys,
+                  std::string &err_user);
+  /**
+   * @brief Remove users from a group in one statement. The owner stays.
+   *
+   * @param [in] user_pkey owner of the group
+   * @param [in] group_pkey group primary key
+   * @param [in] member_pkeys users to remove
+   * @return returnCode error message
+   */
+  virtual returnCode
+  removeGroupMembers(const std::string &user_pkey,
+                     const std::string &group_pkey,
+                     const std::vector<std::string> &member_pkeys);
+  /**
+   * @brief Delete access relationships between many groups and a task list
+   * in one statement. Nothing is changed if any check fails.
+   *
+   * @param [in] src_user_pkey user that grants access
+   * @param [in] task_list_pkey task list primary key
+   * @param [in] group_pkeys groups of src_user_pkey that are granted access
+   * @param [out] err_group the group that does not exist, if any
+   * @return returnCode error message
+   */
+  virtual returnCode
+  removeGroupAccessBatch(const std::string &src_user_pkey,
+                         const std::string &task_list_pkey,
+                         const std::vector<std::string> &group_pkeys,
+                         std::string &err_group);
+  /**
+   * @brief Get All the groups a task list is shared to.
+   *
+   * @param [in] src_user_pkey user that grants access
+   * @param [in] task_list_pkey task list primary key
+   * @param [out] group_grants a map: key: group_pkey, value: read or write
+   * @return returnCode error message
+   */
+  virtual returnCode allGroupGrant(const std::string &src_user_pkey,
+                                   const std::string &task_list_pkey,
+                                   std::map<std::string, bool> &group_grants);
 
   /* Delete everything in the database,
      mainly used for cleaning up in integrated tests. */
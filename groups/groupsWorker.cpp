@@ -0,0 +1,113 @@
+#include "groupsWorker.h"
+#include <algorithm>
+
+GroupsWorker::GroupsWorker(std::shared_ptr<DB> _db) : db(_db) {}
+
+GroupsWorker ::~GroupsWorker() {}
+
+returnCode GroupsWorker ::Create(const RequestData &data) {
+  // request has empty value
+  if (data.RequestGroupIsEmpty())
+    return ERR_RFIELD;
+
+  // group names are unique among the groups of a user, no rename on
+  // duplication
+  returnCode ret = db->createGroupNode(data.user_key, data.group_key);
+  return ret;
+}
+
+returnCode GroupsWorker ::Delete(const RequestData &data) {
+  // request has empty value
+  if (data.RequestGroupIsEmpty())
+    return ERR_RFIELD;
+
+  std::vector<std::string> tasklists;
+  returnCode ret =
+      db->deleteGroupNode(data.user_key, data.group_key, tasklists);
+  // the members may have lost access to the tasklists granted to the group
+  if (ret == SUCCESS && changeListener)
+    for (auto &tasklist : tasklists)
+      changeListener->OnChange(
+          {ChangeEvent::ACCESS_REVOKED, data.user_key, tasklist, "", ""});
+  return ret;
+}
+
+returnCode GroupsWorker ::Query(const RequestData &data, GroupContent &out) {
+  // request has empty value
+  if (data.RequestGroupIsEmpty())
+    return ERR_RFIELD;
+
+  // the group of another user if other_user_key is set, like a tasklist
+  const std::string &owner =
+      data.other_user_key.empty() ? data.user_key : data.other_user_key;
+  std::vector<std::string> members;
+  returnCode ret = db->getGroupNode(owner, data.group_key, members);
+  if (ret != SUCCESS)
+    return ret;
+
+  // only members can see who else is in the group
+  if (std::find(members.begin(), members.end(), data.user_key) ==
+      members.end())
+    return ERR_ACCESS;
+
+  out.name = data.group_key;
+  out.owner = owner;
+  out.members = members;
+  return ret;
+}
+
+returnCode GroupsWorker ::GetAllGroups(const RequestData &data,
+                                       std::vector<GroupContent> &out) {
+  // request has empty value
+  if (data.RequestUserIsEmpty())
+    return ERR_RFIELD;
+
+  std::vector<std::pair<std::string, std::string>> groups;
+  returnCode ret = db->getAllGroupNodes(data.user_key, groups);
+  if (ret != SUCCESS)
+    return ret;
+
+  for (auto &it : groups) {
+    out.emplace_back(it.second, it.first);
+  }
+  return ret;
+}
+
+returnCode GroupsWorker ::AddMembers(const RequestData &data,
+                                     std::vector<std::string> &in_list,
+                                     std::string &errUser) {
+  // request has empty value
+  if (data.RequestGroupIsEmpty())
+    return ERR_RFIELD;
+
+  for (auto &user : in_list) {
+    if (user.empty())
+      return ERR_RFIELD;
+  }
+
+  // addGroupMembers checks the owner and whether the users exist
+  returnCode ret =
+      db->addGroupMembers(data.user_key, data.group_key, in_list, errUser);
+  return ret;
+}
+
+returnCode GroupsWorker ::RemoveMembers(const RequestData &data,
+                                        std::vector<std::string> &in_list) {
+  // request has empty value
+  if (data.RequestGroupIsEmpty())
+    return ERR_RFIELD;
+
+  for (auto &user : in_list) {
+    if (user.empty())
+      return ERR_RFIELD;
+  }
+
+  // removeGroupMembers checks the owner
+  returnCode ret =
+      db->removeGroupMembers(data.user_key, data.group_key, in_list);
+  // the removed members may have lost access to any tasklist
+  if (ret == SUCCESS && changeListener)
+    for (auto &user : in_list)
+      changeListener->OnChange({ChangeEvent::ACCESS_REVOKED, "", "", "", user});
+  return ret;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "api/changeEvent.h"
+#include "api/groupContent.h"
+#include "api/requestData.h"
+#include "common/errorCode.h"
+#include "db/DB.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief This class is a worker class for groups
+ *
+ */
+class GroupsWorker {
+private:
+  /* data */
+
+  /**
+   * @brief DB pointer
+   *
+   */
+  std::shared_ptr<DB> db;
+
+  /**
+   * @brief told when members lose the access given through a group, may be
+   * nullptr
+   *
+   */
+  std::shared_ptr<ChangeListener> changeListener;
+
+public:
+  /**
+   * @brief Construct a new Groups Worker object
+   *
+   * @param _db value for DB
+   */
+  GroupsWorker(std::shared_ptr<DB> _db = nullptr);
+
+  /**
+   * @brief Destroy the Groups Worker object
+   *
+   */
+  virtual ~GroupsWorker();
+
+  /**
+   * @brief Set the listener told when members lose the access given through
+   * a group. Must be called before the worker is used.
+   *
+   * @param listener listener, nullptr for none
+   */
+  void SetChangeListener(std::shared_ptr<ChangeListener> listener) {
+    changeListener = std::move(listener);
+  }
+
+  /**
+   * @brief Create a new group owned by the user in data, its name is unique
+   * among the groups of the user
+   *
+   * @param [in] data target user and group name
+   * @return returnCode
+   */
+  virtual returnCode Create(const RequestData &data);
+
+  /**
+   * @brief Delete a group, only its owner can delete it
+   *
+   * @param [in] data target user and group
+   * @return returnCode
+   */
+  virtual returnCode Delete(const RequestData &data);
+
+  /**
+   * @brief Query a group with its members, only its members can query it
+   *
+   * @param [in] data target user and group, other_user_key is the owner of
+   * the group if it is not the user
+   * @param [out] out group's owner and members
+   * @return returnCode
+   */
+  virtual returnCode Query(const RequestData &data, GroupContent &out);
+
+  /**
+   * @brief Get all groups the user is a member of
+   *
+   * @param [in] data target user
+   * @param [out] out name and owner of the groups
+   * @return returnCode
+   */
+  virtual returnCode GetAllGroups(const RequestData &data,
+                                  std::vector<GroupContent> &out);
+
+  /**
+   * @brief Add users to a group, only its owner can add them. All users are
+   * added in one statement: if one of them fails, none of them is added
+   *
+   * @param [in] data target user and group
+   * @param [in] in_list users to add
+   * @param [out] errUser the user that causes the err
+   * @return returnCode
+   */
+  virtual returnCode AddMembers(const RequestData &data,
+                                std::vector<std::string> &in_list,
+                                std::string &errUser);
+
+  /**
+   * @brief Remove users from a group, only its owner can remove them. The
+   * owner itself always stays in the group
+   *
+   * @param [in] data target user and group
+   * @param [in] in_list users to remove
+   * @return returnCode
+   */
+  virtual returnCode RemoveMembers(const RequestData &data,
+                                   std::vector<std::string> &in_list);
+};
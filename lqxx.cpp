@@ -9,6 +9,14 @@ int main(void) {
   std::cout << "Welcome to Task Management Service: LQXX" << std::endl;
   std::string api_host = Common::GetEnv<std::string>("api_host");
   uint32_t api_port = Common::GetEnv<uint32_t>("api_port");
+  size_t api_threads = Common::GetEnv<size_t>("api_threads");
+  bool api_pin_cpus = Common::GetEnv<int>("api_pin_cpus") != 0;
+  size_t api_max_queued = Common::GetEnv<size_t>("api_max_queued");
+  std::string api_access_log = Common::GetEnv<std::string>("api_access_log");
+  size_t api_deadline_ms = Common::GetEnv<size_t>("api_deadline_ms");
+  std::string passwd_kdf = Common::GetEnv<std::string>("passwd_kdf");
+  uint64_t passwd_cost = Common::GetEnv<uint64_t>("passwd_cost");
+  size_t passwd_threads = Common::GetEnv<size_t>("passwd_threads");
 
   if (api_host.empty()) {
     api_host = "0.0.0.0";
@@ -22,8 +30,30 @@ int main(void) {
   auto svr =
       std::make_shared<httplib::SSLServer>("/root/cert.pem", "/root/key.pem");
 
-  Api api(nullptr, nullptr, nullptr, db_instance, svr);
-  api.set_print(true);
+  PasswordHasher::Options passwd_options;
+  if (passwd_kdf == "scrypt") {
+    passwd_options.kdf = PasswordHasher::SCRYPT;
+    passwd_options.cost = 1 << 15;
+  }
+  if (passwd_cost) {
+    passwd_options.cost = passwd_cost;
+  }
+  if (passwd_threads) {
+    passwd_options.n_threads = passwd_threads;
+  }
+  auto users = std::make_shared<Users>(
+      db_instance, std::make_shared<PasswordHasher>(passwd_options));
+
+  Api api(users, nullptr, nullptr, db_instance, svr);
+  if (api_access_log.empty()) {
+    api.set_print(true);
+  } else {
+    api.set_access_log(std::make_shared<AccessLog>(api_access_log));
+  }
+  api.set_task_queue(api_threads, api_pin_cpus, api_max_queued);
+  if (api_deadline_ms) {
+    api.set_deadline(std::chrono::milliseconds(api_deadline_ms));
+  }
   api.Run(api_host, api_port);
   return 0;
 }
@@ -35,12 +35,37 @@ void TaskListsWorker ::Map2Content(
     tasklistContent.visibility = task_list_info.at("visibility");
 }
 
+void TaskListsWorker ::Notify(ChangeEvent::Type type, const RequestData &data,
+                              const std::string &tasklist) {
+  if (!changeListener)
+    return;
+
+  const std::string &owner =
+      data.other_user_key.empty() ? data.user_key : data.other_user_key;
+  changeListener->OnChange({type, owner, tasklist, "", data.user_key});
+}
+
+void TaskListsWorker ::Revoked(const std::string &owner,
+                               const std::string &tasklist,
+                               const std::string &user) {
+  if (!changeListener)
+    return;
+
+  changeListener->OnChange(
+      {ChangeEvent::ACCESS_REVOKED, owner, tasklist, "", user});
+}
+
 returnCode TaskListsWorker ::Query(const RequestData &data,
                                    TasklistContent &out) {
   // request has empty value
   if (data.RequestTaskListIsEmpty())
     return ERR_RFIELD;
 
+  // only known fields can be requested
+  for (auto &field : data.fields)
+    if (!TasklistContent::IsField(field))
+      return ERR_FORMAT;
+
   // checkAccess has already checked the src and dst user
   // checkAccess also ensures that tasklist exists
   // here we should learn from xsc
@@ -55,8 +80,10 @@ returnCode TaskListsWorker ::Query(const RequestData &data,
 
   // can access
   std::map<std::string, std::string> task_list_info;
+  for (auto &field : data.fields)
+    task_list_info[field] = "";
 
-  // get all available fields
+  // get the requested fields, all available fields if none is requested
   returnCode ret = db->getTaskListNode(
       data.other_user_key.empty() ? data.user_key : data.other_user_key,
       data.tasklist_key, task_list_info);
@@ -72,6 +99,60 @@ returnCode TaskListsWorker ::Query(const RequestData &data,
   return ret;
 }
 
+returnCode TaskListsWorker ::ResolveAccess(RequestData &data) {
+  // request has empty value
+  if (data.RequestTaskListIsEmpty())
+    return ERR_RFIELD;
+
+  // one query tells whether the tasklist exists and what the user may do
+  const std::string owner =
+      data.other_user_key.empty() ? data.user_key : data.other_user_key;
+  bool permission = false;
+  int64_t version = -1;
+  returnCode ret = db->probeAccess(owner, data.user_key, data.tasklist_key,
+                                   data.task_key, permission, version);
+  if (ret != SUCCESS && ret != ERR_NO_NODE && ret != ERR_ACCESS)
+    return ret;
+
+  data.access.resolved = true;
+  data.access.owner = owner;
+  data.access.exists = ret != ERR_NO_NODE;
+  data.access.readable = ret == SUCCESS;
+  data.access.writable = ret == SUCCESS && permission;
+  data.access.version = version;
+  return SUCCESS;
+}
+
+returnCode TaskListsWorker ::Version(const RequestData &data,
+                                     int64_t &version) {
+  // request has empty value
+  if (data.RequestTaskListIsEmpty())
+    return ERR_RFIELD;
+
+  // the probe that resolved the access also read the version
+  if (data.access.resolved) {
+    if (!data.access.exists)
+      return ERR_NO_NODE;
+    if (!data.access.readable)
+      return ERR_ACCESS;
+    version = data.access.version;
+    return SUCCESS;
+  }
+
+  // the version of a shared tasklist is only given to users who can access it
+  if (!data.other_user_key.empty()) {
+    bool permission = false;
+    returnCode ret = db->checkAccess(data.other_user_key, data.user_key,
+                                     data.tasklist_key, permission);
+    if (ret != SUCCESS)
+      return ret;
+  }
+
+  return db->getVersion(data.other_user_key.empty() ? data.user_key
+                                                    : data.other_user_key,
+                        data.tasklist_key, "", version);
+}
+
 returnCode TaskListsWorker ::Create(const RequestData &data,
                                     TasklistContent &in,
                                     std::string &outTasklistName) {
@@ -101,6 +182,8 @@ returnCode TaskListsWorker ::Create(const RequestData &data,
 
   if (ret != SUCCESS)
     outTasklistName = "";
+  else
+    Notify(ChangeEvent::TASKLIST_CREATED, data, outTasklistName);
 
   return ret;
 }
@@ -111,6 +194,8 @@ returnCode TaskListsWorker ::Delete(const RequestData &data) {
     return ERR_RFIELD;
 
   returnCode ret = db->deleteTaskListNode(data.user_key, data.tasklist_key);
+  if (ret == SUCCESS)
+    Notify(ChangeEvent::TASKLIST_DELETED, data, data.tasklist_key);
   return ret;
 }
 
@@ -155,6 +240,11 @@ returnCode TaskListsWorker ::Revise(const RequestData &data,
   returnCode ret = db->reviseTaskListNode(
       data.other_user_key.empty() ? data.user_key : data.other_user_key,
       data.tasklist_key, task_list_info);
+  if (ret == SUCCESS)
+    Notify(ChangeEvent::TASKLIST_REVISED, data, data.tasklist_key);
+  // only the owner changes the visibility, and only public lets everyone in
+  if (ret == SUCCESS && !in.visibility.empty() && in.visibility != "public")
+    Revoked(data.user_key, data.tasklist_key, "");
 
   return ret;
 }
@@ -170,14 +260,42 @@ TaskListsWorker ::GetAllTasklist(const RequestData &data,
   return ret;
 }
 
+returnCode
+TaskListsWorker ::GetAllTasklistContent(const RequestData &data,
+                                        std::vector<TasklistContent> &out) {
+  // request has empty value
+  if (data.RequestUserIsEmpty())
+    return ERR_RFIELD;
+
+  // only known fields can be requested
+  for (auto &field : data.fields)
+    if (!TasklistContent::IsField(field))
+      return ERR_FORMAT;
+
+  std::vector<std::map<std::string, std::string>> task_list_infos;
+  returnCode ret =
+      db->getTaskListNodes(data.user_key, data.fields, task_list_infos);
+  if (ret != SUCCESS)
+    return ret;
+
+  for (auto &task_list_info : task_list_infos) {
+    TasklistContent tasklist;
+    Map2Content(task_list_info, tasklist);
+    out.push_back(std::move(tasklist));
+  }
+  return ret;
+}
+
 returnCode
 TaskListsWorker ::GetAllAccessTaskList(const RequestData &data,
                                        std::vector<shareInfo> &out_list) {
   if (data.RequestUserIsEmpty())
     return ERR_RFIELD;
 
+  // private lists are filtered out and pages are cut by the query
   std::map<std::pair<std::string, std::string>, bool> list_accesses;
-  returnCode ret = db->allAccess(data.user_key, list_accesses);
+  returnCode ret = db->allAccess(data.user_key, list_accesses,
+                                 data.other_user_key, data.offset, data.limit);
   if (ret != SUCCESS)
     return ret;
 
@@ -247,6 +365,28 @@ returnCode TaskListsWorker ::GetAllGrantTaskList(
     out_list.push_back(sh);
   }
 
+  // groups come after users
+  std::map<std::string, bool> group_grants;
+  ret = db->allGroupGrant(data.user_key, data.tasklist_key, group_grants);
+  if (ret != SUCCESS)
+    return ret;
+
+  for (auto it : group_grants) {
+    shareInfo sh;
+    sh.user_name = it.first;
+    sh.permission = it.second;
+    sh.is_group = true;
+    out_list.push_back(sh);
+  }
+
+  return ret;
+}
+
+returnCode TaskListsWorker ::SharingError(returnCode ret,
+                                          const std::string &err_dst) {
+  // a tasklist that does not exist is not shared either
+  if (ret == ERR_NO_NODE && err_dst.empty())
+    return ERR_ACCESS;
   return ret;
 }
 
@@ -259,32 +399,23 @@ TaskListsWorker ::ReviseGrantTaskList(const RequestData &data,
     return ERR_RFIELD;
 
   returnCode ret;
-  std::string visibility;
-
-  // we can only grant permission to shared tasklist
-  // also check whether the tasklist exists
-  ret = GetVisibility(data, visibility);
-  if (ret != SUCCESS || visibility != "shared") {
-    return ERR_ACCESS;
-  }
-
-  for (int i = 0; i < in_list.size(); i++) {
+  std::vector<std::pair<std::string, bool>> grants;
+  std::vector<std::pair<std::string, bool>> group_grants;
+  for (auto &info : in_list) {
     // shareInfo should check whether the user_name is empty
-    if (in_list[i].MissingKey()) {
+    if (info.MissingKey()) {
       return ERR_RFIELD;
     }
-
-    // add grant
-    // addAccess has already checked whether the user exists
-    ret = db->addAccess(data.user_key, in_list[i].user_name, data.tasklist_key,
-                        in_list[i].permission);
-    if (ret != SUCCESS) {
-      errUser = in_list[i].user_name;
-      return ret;
-    }
+    (info.is_group ? group_grants : grants)
+        .emplace_back(info.user_name, info.permission);
   }
 
-  return ret;
+  // add all grants at once, a group is granted with a single relationship
+  // addAccessBatch checks in the same statement that the tasklist is shared
+  // and the users and groups exist, so either all are granted or none
+  ret = db->addAccessBatch(data.user_key, data.tasklist_key, grants,
+                           group_grants, errUser);
+  return SharingError(ret, errUser);
 }
 
 returnCode TaskListsWorker ::RemoveGrantTaskList(const RequestData &data) {
@@ -310,9 +441,59 @@ returnCode TaskListsWorker ::RemoveGrantTaskList(const RequestData &data) {
 
   // remove grant
   ret = db->removeAccess(data.user_key, data.other_user_key, data.tasklist_key);
+  if (ret == SUCCESS)
+    Revoked(data.user_key, data.tasklist_key, data.other_user_key);
   return ret;
 }
 
+returnCode TaskListsWorker ::RemoveGrantTaskList(
+    const RequestData &data, std::vector<std::string> &in_list,
+    std::string &errUser) {
+
+  if (data.RequestTaskListIsEmpty())
+    return ERR_RFIELD;
+
+  returnCode ret;
+  for (auto &user : in_list) {
+    if (user.empty())
+      return ERR_RFIELD;
+  }
+
+  // remove all grants at once
+  // removeAccessBatch checks in the same statement that the tasklist is
+  // shared and the users exist
+  ret = db->removeAccessBatch(data.user_key, data.tasklist_key, in_list,
+                              errUser);
+  if (ret == SUCCESS)
+    for (auto &user : in_list)
+      Revoked(data.user_key, data.tasklist_key, user);
+  return SharingError(ret, errUser);
+}
+
+returnCode TaskListsWorker ::RemoveGroupGrantTaskList(
+    const RequestData &data, std::vector<std::string> &in_list,
+    std::string &errGroup) {
+
+  if (data.RequestTaskListIsEmpty())
+    return ERR_RFIELD;
+
+  returnCode ret;
+  for (auto &group : in_list) {
+    if (group.empty())
+      return ERR_RFIELD;
+  }
+
+  // remove all grants at once
+  // removeGroupAccessBatch checks in the same statement that the tasklist is
+  // shared and the groups exist
+  ret = db->removeGroupAccessBatch(data.user_key, data.tasklist_key, in_list,
+                                   errGroup);
+  // the members of the groups are not known here
+  if (ret == SUCCESS)
+    Revoked(data.user_key, data.tasklist_key, "");
+  return SharingError(ret, errGroup);
+}
+
 returnCode TaskListsWorker ::GetAllPublicTaskList(
     std::vector<std::pair<std::string, std::string>> &out_list) {
 
@@ -327,8 +508,11 @@ returnCode TaskListsWorker ::GetAllPublicTaskList(
 }
 
 bool TaskListsWorker ::Exists(const RequestData &data) {
+  // the fields of data may be those of a task, Query would refuse them
+  RequestData tasklist(data);
+  tasklist.fields.clear();
   TasklistContent out;
-  returnCode ret = Query(data, out);
+  returnCode ret = Query(tasklist, out);
   if (ret == SUCCESS) {
     return true;
   }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "api/changeEvent.h"
 #include "api/requestData.h"
 #include "api/tasklistContent.h"
 #include "common/errorCode.h"
@@ -29,6 +30,12 @@ private:
    */
   std::shared_ptr<Users> users;
 
+  /**
+   * @brief told about every write, may be nullptr
+   *
+   */
+  std::shared_ptr<ChangeListener> changeListener;
+
   /* methods */
   /**
    * @brief convert tasklist content struct to map
@@ -48,6 +55,35 @@ private:
   void Map2Content(const std::map<std::string, std::string> &task_info,
                    TasklistContent &tasklistContent);
 
+  /**
+   * @brief tell the listener, if any, about a write to the tasklist in data
+   *
+   * @param [in] type what happened
+   * @param [in] data request that made the change
+   * @param [in] tasklist name of the tasklist written
+   */
+  void Notify(ChangeEvent::Type type, const RequestData &data,
+              const std::string &tasklist);
+
+  /**
+   * @brief tell the listener, if any, that a user lost access to a tasklist
+   *
+   * @param [in] owner owner of the tasklist
+   * @param [in] tasklist name of the tasklist
+   * @param [in] user user who lost access, empty for every collaborator
+   */
+  void Revoked(const std::string &owner, const std::string &tasklist,
+               const std::string &user);
+
+  /**
+   * @brief return code of a batch share, as the sharing calls return them
+   *
+   * @param [in] ret return code of the DB
+   * @param [in] err_dst the user or group that does not exist, if any
+   * @return returnCode ERR_ACCESS if the tasklist does not exist
+   */
+  returnCode SharingError(returnCode ret, const std::string &err_dst);
+
 public:
   /**
    * @brief Construct a new Task Lists Worker object
@@ -72,6 +108,39 @@ public:
    */
   virtual returnCode Query(const RequestData &data, TasklistContent &out);
 
+  /**
+   * @brief Set the listener told about every tasklist created, revised or
+   * deleted. Must be called before the worker is used.
+   *
+   * @param listener listener, nullptr for none
+   */
+  void SetChangeListener(std::shared_ptr<ChangeListener> listener) {
+    changeListener = std::move(listener);
+  }
+
+  /**
+   * @brief Resolve what the user may do on the tasklist in data with a single
+   * probe and keep it in data.access, for the next calls with data, along
+   * with the version of the task or tasklist. Left unresolved if the probe
+   * fails.
+   *
+   * @param [in,out] data target tasklist, of other_user_key if it is not empty
+   * @return returnCode SUCCESS once resolved, even if the tasklist does not
+   * exist or cannot be accessed
+   */
+  virtual returnCode ResolveAccess(RequestData &data);
+
+  /**
+   * @brief Get the version of a tasklist, which grows whenever the tasklist
+   * or one of its tasks changes. It is much cheaper than Query, and free once
+   * the access of data is resolved: the probe read it.
+   *
+   * @param [in] data target tasklist, of other_user_key if it is not empty
+   * @param [out] version version of the tasklist
+   * @return returnCode
+   */
+  virtual returnCode Version(const RequestData &data, int64_t &version);
+
   /**
    * @brief Create a new tasklist in database
    *
@@ -110,10 +179,21 @@ public:
   virtual returnCode GetAllTasklist(const RequestData &data,
                                     std::vector<std::string> &outNames);
 
+  /**
+   * @brief Get all Tasklists with the fields requested in data
+   *
+   * @param [in] data target user we'd want to get tasklist for
+   * @param [out] out all tasklists with the requested fields
+   * @return returnCode
+   */
+  virtual returnCode GetAllTasklistContent(const RequestData &data,
+                                           std::vector<TasklistContent> &out);
+
   /**
    * @brief Get the all Tasklist info that are shared by others
    *
-   * @param [in] data target user that we'd want to get all grant for
+   * @param [in] data target user that we'd want to get all grant for, with
+   * optional owner (other_user_key), offset and limit
    * @param [out] out_list vector of shareInfo with information about the users,
    * tasklists and permissions that current user have access to
    * @return returnCode
@@ -126,7 +206,7 @@ public:
    *
    * @param [in] data target user and tasklist we'd want to get all grant for
    * @param [out] out_list vector of shareInfo with information about the users
-   * who have access to the current user's tasklist
+   * and groups who have access to the current user's tasklist
    * @param [out] isPublic is true when the requested tasklist is public to
    * everyone, and false otherwise
    * @return returnCode
@@ -136,9 +216,9 @@ public:
                                          bool &isPublic);
 
   /**
-   * @brief Create if not exists or Revise the share status for a tasklist. It
-   * is guaranteed that all operations on users before errUser in the in_list
-   * are successful
+   * @brief Create if not exists or Revise the share status for a tasklist.
+   * All users are granted in one statement: if one of them fails, none of
+   * them is granted. Groups in in_list are granted after all users
    *
    * @param [in] data target tasklist that we'd want to revise share status
    * @param [in] in_list list of shareInfo to add/revise for target tasklist
@@ -150,20 +230,38 @@ public:
                                          std::string &errUser);
 
   /**
-   * @brief Delete the share for a tasklist. It is guaranteed that
-   * all deletions on users before errUser in the in_list are successful
+   * @brief Delete the share of the other user in data for a tasklist.
    *
    * @param [in] data target tasklists that we'd want to delete share status
    * @return returnCode
    */
   virtual returnCode RemoveGrantTaskList(const RequestData &data);
 
-  // for compilation before api revise
+  /**
+   * @brief Delete the share for a tasklist. All users are removed in one
+   * statement: if one of them fails, none of them is removed
+   *
+   * @param [in] data target tasklists that we'd want to delete share status
+   * @param [in] in_list users to remove from the share of target tasklist
+   * @param [out] errUser the user that causes the err
+   * @return returnCode
+   */
   virtual returnCode RemoveGrantTaskList(const RequestData &data,
                                          std::vector<std::string> &in_list,
-                                         std::string &errUser) {
-    return SUCCESS;
-  }
+                                         std::string &errUser);
+
+  /**
+   * @brief Delete the share to groups for a tasklist. All groups are removed
+   * in one statement: if one of them fails, none of them is removed
+   *
+   * @param [in] data target tasklists that we'd want to delete share status
+   * @param [in] in_list groups to remove from the share of target tasklist
+   * @param [out] errGroup the group that causes the err
+   * @return returnCode
+   */
+  virtual returnCode RemoveGroupGrantTaskList(const RequestData &data,
+                                              std::vector<std::string> &in_list,
+                                              std::string &errGroup);
   /**
    * @brief Get all public tasklists
    *
@@ -176,7 +274,8 @@ public:
   /**
    * @brief Check if a tasklist exists
    *
-   * @param [in] data target tasklist we'd want to check
+   * @param [in] data target tasklist we'd want to check, its fields are
+   * ignored
    * @return true if the tasklist exists
    */
   virtual bool Exists(const RequestData &data);
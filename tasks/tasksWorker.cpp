@@ -54,22 +54,44 @@ void TasksWorker::Map2TaskStruct(
   if (task_info.count("date"))
     taskContent.date = task_info.at("date");
 
-  if (task_info.count("priority"))
+  if (task_info.count("priority") && !task_info.at("priority").empty())
     taskContent.priority = (Priority)stoi(task_info.at("priority"));
 
   if (task_info.count("status"))
     taskContent.status = task_info.at("status");
 }
 
-returnCode TasksWorker::Query(const RequestData &data, TaskContent &out) {
-  // request has empty value
-  if (data.RequestIsEmpty())
-    return ERR_RFIELD;
+void TasksWorker::Notify(ChangeEvent::Type type, const RequestData &data,
+                         const std::string &task) {
+  if (!changeListener)
+    return;
+
+  changeListener->OnChange({type, Owner(data), data.tasklist_key, task,
+                            data.user_key});
+}
+
+const std::string &TasksWorker::Owner(const RequestData &data) {
+  if (data.access.resolved)
+    return data.access.owner;
+  return data.other_user_key.empty() ? data.user_key : data.other_user_key;
+}
+
+returnCode TasksWorker::ResolveAccess(RequestData &data) {
+  return taskListsWorker->ResolveAccess(data);
+}
+
+returnCode TasksWorker::Authorize(const RequestData &data, bool write) {
+  if (data.access.resolved) {
+    if (!data.access.exists)
+      return ERR_NO_NODE;
+    if (!data.access.readable || (write && !data.access.writable))
+      return ERR_ACCESS;
+    return SUCCESS;
+  }
 
-  // if other_user_key is not empty, "chekcAccess" has already checked the src
-  // and dst user checkAccess also ensures that tasklist exists but if
-  // other_user_key is empty, we need to check the tasklist exists so we use
-  // "Exists" to check
+  // if other_user_key is not empty, "chekcAccess" checks the src and dst user
+  // and also ensures that tasklist exists but if other_user_key is empty, we
+  // need to check the tasklist exists so we use "Exists" to check
   if (!data.other_user_key.empty()) {
     bool permission = false;
     returnCode ret = db->checkAccess(data.other_user_key, data.user_key,
@@ -77,21 +99,39 @@ returnCode TasksWorker::Query(const RequestData &data, TaskContent &out) {
     if (ret != SUCCESS)
       // no permission
       return ret;
-  } else {
-    // tasklist itself does not exist
-    if (!taskListsWorker->Exists(data)) {
-      // maybe create taskList first
-      return ERR_NO_NODE;
-    }
+    if (write && !permission)
+      // read only permission cannot write
+      return ERR_ACCESS;
+  } else if (!taskListsWorker->Exists(data)) {
+    // tasklist itself does not exist, maybe create taskList first
+    return ERR_NO_NODE;
   }
+  return SUCCESS;
+}
+
+returnCode TasksWorker::Query(const RequestData &data, TaskContent &out) {
+  // request has empty value
+  if (data.RequestIsEmpty())
+    return ERR_RFIELD;
+
+  // only known fields can be requested
+  for (auto &field : data.fields)
+    if (!TaskContent::IsField(field))
+      return ERR_FORMAT;
+
+  // the user must be able to read the tasklist
+  returnCode ret = Authorize(data, false);
+  if (ret != SUCCESS)
+    return ret;
 
   // can access
   std::map<std::string, std::string> task_info;
+  for (auto &field : data.fields)
+    task_info[field] = "";
 
-  // get all available fields
-  returnCode ret = db->getTaskNode(
-      data.other_user_key.empty() ? data.user_key : data.other_user_key,
-      data.tasklist_key, data.task_key, task_info);
+  // get the requested fields, all available fields if none is requested
+  ret = db->getTaskNode(Owner(data), data.tasklist_key, data.task_key,
+                        task_info);
 
   // there is no such task
   if (ret != SUCCESS) {
@@ -104,6 +144,34 @@ returnCode TasksWorker::Query(const RequestData &data, TaskContent &out) {
   return ret;
 }
 
+returnCode TasksWorker::Version(const RequestData &data, int64_t &version) {
+  // the version of all tasks is the version of their tasklist
+  if (data.task_key.empty())
+    return taskListsWorker->Version(data, version);
+
+  // request has empty value
+  if (data.RequestIsEmpty())
+    return ERR_RFIELD;
+
+  // the version of a shared task is only given to users who can access it
+  if (!data.other_user_key.empty() || data.access.resolved) {
+    returnCode ret = Authorize(data, false);
+    if (ret != SUCCESS)
+      return ret;
+  }
+
+  // the probe that resolved the access also read the version
+  if (data.access.resolved) {
+    if (data.access.version < 0)
+      return ERR_NO_NODE;
+    version = data.access.version;
+    return SUCCESS;
+  }
+
+  return db->getVersion(Owner(data), data.tasklist_key, data.task_key,
+                        version);
+}
+
 returnCode TasksWorker::Create(const RequestData &data, TaskContent &in,
                                std::string &outTaskName) {
   // request has empty value
@@ -118,45 +186,26 @@ returnCode TasksWorker::Create(const RequestData &data, TaskContent &in,
   if (!in.IsValid())
     return ERR_FORMAT;
 
-  // if other_user_key is not empty, "chekcAccess" has already checked the src
-  // and dst user checkAccess also ensures that tasklist exists but if
-  // other_user_key is empty, we need to check the tasklist exists so we use
-  // "Exists" to check "both user and tasklist"
-  if (!data.other_user_key.empty()) {
-    bool permission = false;
-    returnCode ret = db->checkAccess(data.other_user_key, data.user_key,
-                                     data.tasklist_key, permission);
-    if (ret != SUCCESS)
-      // no permission
-      return ret;
-    if (!permission) {
-      // read only permission cannot create
-      return ERR_ACCESS;
-    }
-  } else {
-    // tasklist itself does not exist
-    if (!taskListsWorker->Exists(data)) {
-      // maybe create taskList first
-      return ERR_NO_NODE;
-    }
-  }
+  // the user must be able to write the tasklist
+  returnCode ret = Authorize(data, true);
+  if (ret != SUCCESS)
+    return ret;
 
   // can access
   std::map<std::string, std::string> task_info;
   TaskStruct2Map(in, task_info);
 
   int suffix = 0;
-  returnCode ret;
   std::string originTaskName = task_info["name"];
   do {
     // For Create, data.task_key can be "", so we should use task_info["name"]
     outTaskName = Common::Rename(originTaskName, suffix++);
     task_info["name"] = outTaskName;
-    ret = db->createTaskNode(data.other_user_key.empty() ? data.user_key
-                                                         : data.other_user_key,
-                             data.tasklist_key, task_info);
+    ret = db->createTaskNode(Owner(data), data.tasklist_key, task_info);
   } while (ret == ERR_DUP_NODE);
 
+  if (ret == SUCCESS)
+    Notify(ChangeEvent::TASK_CREATED, data, outTaskName);
   return ret;
 }
 
@@ -165,32 +214,15 @@ returnCode TasksWorker::Delete(const RequestData &data) {
   if (data.RequestIsEmpty())
     return ERR_RFIELD;
 
-  // if other_user_key is not empty, "chekcAccess" has already checked the src
-  // and dst user checkAccess also ensures that tasklist exists but if
-  // other_user_key is empty, we need to check the tasklist exists so we use
-  // "Exists" to check
-  if (!data.other_user_key.empty()) {
-    bool permission = false;
-    returnCode ret = db->checkAccess(data.other_user_key, data.user_key,
-                                     data.tasklist_key, permission);
-    if (ret != SUCCESS)
-      // no permission
-      return ret;
-    if (!permission) {
-      // read only permission cannot delete
-      return ERR_ACCESS;
-    }
-  } else {
-    // tasklist itself does not exist
-    if (!taskListsWorker->Exists(data)) {
-      return ERR_NO_NODE;
-    }
-  }
+  // the user must be able to write the tasklist
+  returnCode ret = Authorize(data, true);
+  if (ret != SUCCESS)
+    return ret;
 
   // can access
-  returnCode ret = db->deleteTaskNode(
-      data.other_user_key.empty() ? data.user_key : data.other_user_key,
-      data.tasklist_key, data.task_key);
+  ret = db->deleteTaskNode(Owner(data), data.tasklist_key, data.task_key);
+  if (ret == SUCCESS)
+    Notify(ChangeEvent::TASK_DELETED, data, data.task_key);
   return ret;
 }
 
@@ -209,35 +241,19 @@ returnCode TasksWorker::Revise(const RequestData &data, TaskContent &in) {
   if (!in.IsValid())
     return ERR_FORMAT;
 
-  // if other_user_key is not empty, "chekcAccess" has already checked the src
-  // and dst user checkAccess also ensures that tasklist exists but if
-  // other_user_key is empty, we need to check the tasklist exists so we use
-  // "Exists" to check
-  if (!data.other_user_key.empty()) {
-    bool permission = false;
-    returnCode ret = db->checkAccess(data.other_user_key, data.user_key,
-                                     data.tasklist_key, permission);
-    if (ret != SUCCESS)
-      // no permission
-      return ret;
-    if (!permission) {
-      // read only permission cannot revise
-      return ERR_ACCESS;
-    }
-  } else {
-    // tasklist itself does not exist
-    if (!taskListsWorker->Exists(data)) {
-      return ERR_NO_NODE;
-    }
-  }
+  // the user must be able to write the tasklist
+  returnCode ret = Authorize(data, true);
+  if (ret != SUCCESS)
+    return ret;
 
   // can access
   std::map<std::string, std::string> task_info;
   TaskStruct2Map(in, task_info);
 
-  returnCode ret = db->reviseTaskNode(
-      data.other_user_key.empty() ? data.user_key : data.other_user_key,
-      data.tasklist_key, data.task_key, task_info);
+  ret = db->reviseTaskNode(Owner(data), data.tasklist_key, data.task_key,
+                           task_info);
+  if (ret == SUCCESS)
+    Notify(ChangeEvent::TASK_REVISED, data, data.task_key);
   return ret;
 }
 
@@ -248,27 +264,86 @@ TasksWorker::GetAllTasksName(const RequestData &data,
   if (data.RequestTaskListIsEmpty())
     return ERR_RFIELD;
 
-  // if other_user_key is not empty, "chekcAccess" has already checked the src
-  // and dst user checkAccess also ensures that tasklist exists but if
-  // other_user_key is empty, we need to check the tasklist exists so we use
-  // "Exists" to check
-  if (!data.other_user_key.empty()) {
-    bool permission = false;
-    returnCode ret = db->checkAccess(data.other_user_key, data.user_key,
-                                     data.tasklist_key, permission);
+  // the user must be able to read the tasklist
+  returnCode ret = Authorize(data, false);
+  if (ret != SUCCESS)
+    return ret;
+  // can access
+
+  return db->getAllTaskNodes(Owner(data), data.tasklist_key, outTaskNameList);
+}
+
+returnCode TasksWorker::GetAllTasks(const RequestData &data,
+                                    std::vector<TaskContent> &outTasks) {
+  // request has empty value
+  if (data.RequestTaskListIsEmpty())
+    return ERR_RFIELD;
+
+  // only known fields can be requested
+  for (auto &field : data.fields)
+    if (!TaskContent::IsField(field))
+      return ERR_FORMAT;
+
+  // getTaskNodes ensures the tasklist exists, only the access of another
+  // user's tasklist needs to be checked, unless it is already resolved
+  if (!data.other_user_key.empty() || data.access.resolved) {
+    returnCode ret = Authorize(data, false);
     if (ret != SUCCESS)
-      // no permission
       return ret;
-  } else {
-    // tasklist itself does not exist
-    if (!taskListsWorker->Exists(data)) {
-      return ERR_NO_NODE;
-    }
   }
+
   // can access
+  std::vector<std::map<std::string, std::string>> task_infos;
+  returnCode ret =
+      db->getTaskNodes(Owner(data), data.tasklist_key, data.fields, task_infos);
+  if (ret != SUCCESS)
+    return ret;
+
+  for (auto &task_info : task_infos) {
+    TaskContent task;
+    Map2TaskStruct(task_info, task);
+    outTasks.push_back(std::move(task));
+  }
+  return ret;
+}
+returnCode TasksWorker::GetAgenda(const RequestData &data,
+                                  const std::string &startDate,
+                                  const std::string &endDate,
+                                  const std::string &status,
+                                  std::vector<AgendaItem> &outAgenda) {
+  // request has empty value
+  if (data.RequestUserIsEmpty())
+    return ERR_RFIELD;
+
+  // check the date range and status are valid
+  TaskContent range("", "", startDate, endDate, NULL_PRIORITY, status);
+  if (!range.IsValid())
+    return ERR_FORMAT;
+
+  // one traversal over owned and shared tasklists, filtered by status
+  std::vector<std::map<std::string, std::string>> task_infos;
+  returnCode ret = db->getAgenda(data.user_key, status, task_infos);
+  if (ret != SUCCESS)
+    return ret;
+
+  for (auto &task_info : task_infos) {
+    AgendaItem item;
+    item.user_name = task_info["user"];
+    item.task_list_name = task_info["list"];
+    item.permission = task_info["permission"] == "1";
+    Map2TaskStruct(task_info, item.task);
+
+    // filter by date range: keep tasks overlapping [startDate, endDate]
+    // tasks without date only show up when no range is requested
+    if (!startDate.empty()) {
+      if (item.task.startDate.empty() || item.task.endDate.empty())
+        continue;
+      if (!range.CompareTime(item.task.startDate, endDate) ||
+          !range.CompareTime(startDate, item.task.endDate))
+        continue;
+    }
+    outAgenda.push_back(std::move(item));
+  }
 
-  returnCode ret = db->getAllTaskNodes(
-      data.other_user_key.empty() ? data.user_key : data.other_user_key,
-      data.tasklist_key, outTaskNameList);
   return ret;
-}
\ No newline at end of file
+}
@@ -29,6 +29,12 @@ protected:
    */
   std::shared_ptr<TaskListsWorker> taskListsWorker;
 
+  /**
+   * @brief told about every write, may be nullptr
+   *
+   */
+  std::shared_ptr<ChangeListener> changeListener;
+
   /**
    * @brief Construct a new Tasks Worker object
    *
@@ -46,6 +52,36 @@ protected:
   void Map2TaskStruct(const std::map<std::string, std::string> &task_info,
                       TaskContent &taskContent);
 
+  /**
+   * @brief Tell the listener, if any, about a write to a task of the tasklist
+   * in data.
+   *
+   * @param type
+   * @param data
+   * @param task
+   */
+  void Notify(ChangeEvent::Type type, const RequestData &data,
+              const std::string &task);
+
+  /**
+   * @brief Check the user may read, or write, the tasklist in data: with the
+   * access resolved in data if any, else by probing the DB, checkAccess for
+   * another user's tasklist, TaskListsWorker::Exists for one's own.
+   *
+   * @param data
+   * @param write
+   * @return returnCode SUCCESS, ERR_NO_NODE, ERR_ACCESS or the probe's error
+   */
+  returnCode Authorize(const RequestData &data, bool write);
+
+  /**
+   * @brief The user owning the tasklist in data.
+   *
+   * @param data
+   * @return const std::string&
+   */
+  static const std::string &Owner(const RequestData &data);
+
 public:
   /* method */
   /**
@@ -72,6 +108,35 @@ public:
    */
   virtual returnCode Query(const RequestData &data, TaskContent &out);
 
+  /**
+   * @brief Resolve the access of data, see TaskListsWorker::ResolveAccess.
+   *
+   * @param data
+   * @return returnCode SUCCESS once resolved
+   */
+  virtual returnCode ResolveAccess(RequestData &data);
+
+  /**
+   * @brief Set the listener told about every task created, revised or
+   * deleted. Must be called before the worker is used.
+   *
+   * @param listener listener, nullptr for none
+   */
+  void SetChangeListener(std::shared_ptr<ChangeListener> listener) {
+    changeListener = std::move(listener);
+  }
+
+  /**
+   * @brief Get the version of the task, which grows whenever the task is
+   * revised, or of its tasklist if task_key is empty. No query once the
+   * access of data is resolved, the probe read the version.
+   *
+   * @param data
+   * @param version
+   * @return returnCode
+   */
+  virtual returnCode Version(const RequestData &data, int64_t &version);
+
   /**
    * @brief Create a Task object and return the task name in outTaskName.
    *
@@ -110,4 +175,32 @@ public:
    */
   virtual returnCode GetAllTasksName(const RequestData &data,
                                      std::vector<std::string> &outTaskNameList);
+
+  /**
+   * @brief Get all tasks in the tasklist with the fields requested in data and
+   * return them in outTasks.
+   *
+   * @param data
+   * @param outTasks
+   * @return returnCode
+   */
+  virtual returnCode GetAllTasks(const RequestData &data,
+                                 std::vector<TaskContent> &outTasks);
+
+  /**
+   * @brief Get all tasks of the tasklists owned by or shared to the user whose
+   * date range overlaps [startDate, endDate] and return them in outAgenda.
+   *
+   * @param data
+   * @param startDate
+   * @param endDate
+   * @param status
+   * @param outAgenda
+   * @return returnCode
+   */
+  virtual returnCode GetAgenda(const RequestData &data,
+                               const std::string &startDate,
+                               const std::string &endDate,
+                               const std::string &status,
+                               std::vector<AgendaItem> &outAgenda);
 };
\ No newline at end of file
@@ -0,0 +1,59 @@
+/**
+ * @file bench_token.cpp
+ * @brief Compare jwt::decode with Hs256Verifier on lqxx login tokens.
+ *
+ * Usage: bench_token [iterations]
+ */
+
+#include "api/tokenVerifier.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <jwt/jwt.hpp>
+#include <string>
+
+template <typename Fn> static double NanosPerOp(size_t iterations, Fn &&fn) {
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    fn();
+  }
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         iterations;
+}
+
+int main(int argc, char **argv) {
+  const size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10)
+                                     : 200000;
+  const std::string secret(128, 'k');
+
+  jwt::jwt_object jwt_obj{jwt::params::algorithm("HS256"),
+                          jwt::params::secret(secret),
+                          jwt::params::payload({{"email", "user@test.com"}})};
+  jwt_obj.add_claim("exp", std::chrono::system_clock::now() +
+                               std::chrono::seconds(3600));
+  const std::string token = jwt_obj.signature();
+
+  size_t accepted = 0;
+  const double jwt_ns = NanosPerOp(iterations, [&] {
+    std::error_code err;
+    const auto obj = jwt::decode(
+        jwt::string_view(token), jwt::params::algorithms({"HS256"}), err,
+        jwt::params::secret(secret), jwt::params::verify(true));
+    accepted += !err && !obj.payload()
+                             .get_claim_value<std::string>("email")
+                             .empty();
+  });
+
+  Hs256Verifier verifier(secret);
+  const double fast_ns = NanosPerOp(iterations, [&] {
+    std::string email;
+    accepted += verifier.Verify(token, &email, nullptr) == Hs256Verifier::VALID;
+  });
+
+  std::cout << "iterations:     " << iterations << std::endl;
+  std::cout << "jwt::decode:    " << jwt_ns << " ns/op" << std::endl;
+  std::cout << "Hs256Verifier:  " << fast_ns << " ns/op" << std::endl;
+  std::cout << "speedup:        " << jwt_ns / fast_ns << "x" << std::endl;
+  return accepted == 2 * iterations ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+#include "api/accessLog.h"
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+static std::string ReadFile(const std::string &path) {
+  std::ifstream in(path);
+  std::stringstream content;
+  content << in.rdbuf();
+  return content.str();
+}
+
+static size_t CountLines(const std::string &text) {
+  size_t lines = 0;
+  for (char c : text) {
+    lines += c == '\n';
+  }
+  return lines;
+}
+
+static AccessLog::Entry Entry(int status, const std::string &user = "") {
+  AccessLog::Entry entry;
+  entry.time = std::chrono::system_clock::time_point(1667304000123456us);
+  entry.method = "GET";
+  entry.target = "/v1/task_lists?fields=name";
+  entry.status = status;
+  entry.latency_us = 52;
+  entry.db_us = 40;
+  entry.bytes = 18;
+  entry.user = user;
+  return entry;
+}
+
+TEST(AccessLogTest, Format) {
+  std::string line;
+  AccessLog::Format(Entry(200, "a\"b@c.d"), &line);
+  EXPECT_EQ(line, "{\"time\":\"2022-11-01T12:00:00.123456Z\","
+                  "\"method\":\"GET\","
+                  "\"target\":\"/v1/task_lists?fields=name\",\"status\":200,"
+                  "\"latency_us\":52,\"db_us\":40,\"bytes\":18,"
+                  "\"user\":\"a\\\"b@c.d\"}\n");
+}
+
+TEST(AccessLogTest, ManyThreads) {
+  const std::string path = "test_accesslog_threads.log";
+  std::remove(path.c_str());
+  {
+    AccessLog log(path, 0, 0, 1024, 1ms);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+      threads.emplace_back([&log]() {
+        for (int j = 0; j < 500; j++) {
+          log.Log(Entry(200));
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    log.Flush();
+    EXPECT_EQ(CountLines(ReadFile(path)) + log.Dropped(), 2000);
+  }
+  std::remove(path.c_str());
+}
+
+TEST(AccessLogTest, FullRing) {
+  const std::string path = "test_accesslog_full.log";
+  std::remove(path.c_str());
+  {
+    // the writer does not wake up during the test
+    AccessLog log(path, 0, 0, 4, 1h);
+    for (int i = 0; i < 10; i++) {
+      log.Log(Entry(200));
+    }
+    EXPECT_EQ(log.Dropped(), 6);
+    log.Flush();
+    EXPECT_EQ(CountLines(ReadFile(path)), 4);
+
+    // drained rings take entries again
+    log.Log(Entry(404));
+    log.Flush();
+    EXPECT_EQ(CountLines(ReadFile(path)), 5);
+  }
+  std::remove(path.c_str());
+}
+
+TEST(AccessLogTest, Rotate) {
+  const std::string path = "test_accesslog_rotate.log";
+  std::string line;
+  AccessLog::Format(Entry(200), &line);
+  {
+    AccessLog log(path, line.size() * 3, 2, 16, 1h);
+    for (int i = 0; i < 10; i++) {
+      log.Log(Entry(200));
+      log.Flush();
+    }
+  }
+  // 3 lines per file, the oldest ones were dropped
+  EXPECT_EQ(CountLines(ReadFile(path)), 1);
+  EXPECT_EQ(CountLines(ReadFile(path + ".1")), 3);
+  EXPECT_EQ(CountLines(ReadFile(path + ".2")), 3);
+  EXPECT_TRUE(ReadFile(path + ".3").empty());
+  for (auto suffix : {"", ".1", ".2"}) {
+    std::remove((path + suffix).c_str());
+  }
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -15,6 +15,10 @@ class MockedUsers : public Users {
 public:
   ~MockedUsers() {}
 
+  returnCode Register(const UserInfo &) override {
+    return register_mock_return;
+  }
+
   bool Create(const UserInfo &) override { return create_mock_return; }
 
   bool Validate(const UserInfo &) override { return validate_mock_return; }
@@ -23,6 +27,8 @@ public:
     return duplicatedemail_return;
   }
 
+  void SetRegisterResult(returnCode value) { register_mock_return = value; }
+
   void SetCreateResult(bool value) { create_mock_return = value; }
 
   void SetValidateResult(bool value) { validate_mock_return = value; }
@@ -30,6 +36,7 @@ public:
   void SetDuplicatedemaiResult(bool value) { duplicatedemail_return = value; }
 
 private:
+  returnCode register_mock_return;
   bool create_mock_return;
   bool validate_mock_return;
   bool duplicatedemail_return;
@@ -47,6 +54,11 @@ public:
 
   ~MockedTasklistsWorker() {}
 
+  /* Leaves the access unresolved, the mocked calls check it themselves */
+  returnCode ResolveAccess(RequestData &data) override {
+    return returnCode::SUCCESS;
+  }
+
   returnCode Query(const RequestData &data, TasklistContent &out) override {
     std::string query_user_key = data.user_key;
     if (!data.other_user_key.empty()) {
@@ -125,6 +137,7 @@ public:
       in.name = tasklist_key;
     }
     mocked_data[data.user_key][tasklist_key] = in;
+    mocked_version++;
     return returnCode::SUCCESS;
   }
 
@@ -154,6 +167,7 @@ public:
     if (!in.content.empty()) {
       it->second.content = in.content;
     }
+    mocked_version++;
     return returnCode::SUCCESS;
   }
 
@@ -163,9 +177,19 @@ public:
       return returnCode::ERR_NO_NODE;
     }
     mocked_data[data.user_key].erase(it);
+    mocked_version++;
     return returnCode::SUCCESS;
   }
 
+  returnCode Version(const RequestData &data, int64_t &version) override {
+    TasklistContent content;
+    returnCode ret = Query(data, content);
+    if (ret == returnCode::SUCCESS) {
+      version = mocked_version;
+    }
+    return ret;
+  }
+
   bool Exists(const RequestData &data) override {
     return mocked_data[data.user_key].find(data.tasklist_key) !=
            mocked_data[data.user_key].end();
@@ -272,6 +296,8 @@ public:
 private:
   /* (user_key, tasklist_key) -> TasklistContent */
   std::map<std::string, std::map<std::string, TasklistContent>> mocked_data;
+  /* bumped by every change, shared by all task lists */
+  int64_t mocked_version = 1;
   /* (user_key, tasklsit_key) -> shareInfo */
   std::map<std::string, std::map<std::string, std::vector<shareInfo>>>
       mocked_share;
@@ -285,6 +311,14 @@ public:
 
   ~MockedTasksWorker() {}
 
+  /* Leaves the access unresolved, the mocked calls check it themselves */
+  returnCode ResolveAccess(RequestData &data) override {
+    return resolve_result;
+  }
+
+  /* what ResolveAccess returns, to fail the probe */
+  returnCode resolve_result = returnCode::SUCCESS;
+
   returnCode Query(const RequestData &data, TaskContent &out) override {
     std::string query_user_key = data.user_key;
     if (!data.other_user_key.empty()) {
@@ -349,6 +383,7 @@ public:
     }
     in.name = task_key;
     mocked_tasks[task_key] = in;
+    mocked_version++;
     return returnCode::SUCCESS;
   }
 
@@ -376,6 +411,7 @@ public:
     if (!in.startDate.empty()) {
       it->second.startDate = in.startDate;
     }
+    mocked_version++;
     return returnCode::SUCCESS;
   }
 
@@ -395,9 +431,27 @@ public:
       return returnCode::ERR_NO_NODE;
     }
     mocked_tasks.erase(it);
+    mocked_version++;
     return returnCode::SUCCESS;
   }
 
+  returnCode Version(const RequestData &data, int64_t &version) override {
+    if (data.task_key.empty()) {
+      std::vector<std::string> names;
+      returnCode ret = GetAllTasksName(data, names);
+      if (ret == returnCode::SUCCESS) {
+        version = mocked_version;
+      }
+      return ret;
+    }
+    TaskContent content;
+    returnCode ret = Query(data, content);
+    if (ret == returnCode::SUCCESS) {
+      version = mocked_version;
+    }
+    return ret;
+  }
+
   bool CheckWritePerm(const std::string &user, const std::string &other_user,
                       const std::string &tasklist) {
     std::shared_ptr<MockedTasklistsWorker> mocked_tasklists_worker =
@@ -429,6 +483,8 @@ private:
   std::map<std::string,
            std::map<std::string, std::map<std::string, TaskContent>>>
       mocked_data;
+  /* bumped by every change, shared by all tasks */
+  int64_t mocked_version = 1;
 };
 
 class APITest : public ::testing::Test {
@@ -473,8 +529,7 @@ TEST_F(APITest, UsersRegister) {
     nlohmann::json req_body;
     req_body["name"] = "Alice";
     client.set_basic_auth("alice@columbia.edu", "123456");
-    mocked_users->SetCreateResult(true);
-    mocked_users->SetDuplicatedemaiResult(false);
+    mocked_users->SetRegisterResult(SUCCESS);
     auto result =
         client.Post("/v1/users/register", req_body.dump(), "text/plain");
     EXPECT_EQ(result.error(), httplib::Error::Success);
@@ -486,19 +541,19 @@ TEST_F(APITest, UsersRegister) {
     nlohmann::json req_body;
     req_body["name"] = "Alice";
     client.set_basic_auth("alice@columbia.edu", "123456");
-    mocked_users->SetCreateResult(false);
-    mocked_users->SetDuplicatedemaiResult(true);
+    mocked_users->SetRegisterResult(ERR_DUP_NODE);
     auto result =
         client.Post("/v1/users/register", req_body.dump(), "text/plain");
     EXPECT_EQ(result.error(), httplib::Error::Success);
-    EXPECT_NE(result->body.find("failed"), std::string::npos);
+    EXPECT_EQ(result->status, 400);
+    EXPECT_NE(result->body.find("failed duplicated email"), std::string::npos);
   }
 
   {
     httplib::Client client(test_host, test_port);
     nlohmann::json req_body;
     client.set_basic_auth("bob@columbia.edu", "123456");
-    mocked_users->SetCreateResult(true);
+    mocked_users->SetRegisterResult(SUCCESS);
     auto result =
         client.Post("/v1/users/register", req_body.dump(), "text/plain");
     EXPECT_EQ(result.error(), httplib::Error::Success);
@@ -509,7 +564,7 @@ TEST_F(APITest, UsersRegister) {
     httplib::Client client(test_host, test_port);
     nlohmann::json req_body;
     req_body["name"] = "Bob";
-    mocked_users->SetCreateResult(true);
+    mocked_users->SetRegisterResult(SUCCESS);
     auto result =
         client.Post("/v1/users/register", req_body.dump(), "text/plain");
     EXPECT_EQ(result.error(), httplib::Error::Success);
@@ -521,7 +576,7 @@ TEST_F(APITest, UsersRegister) {
     nlohmann::json req_body;
     client.set_basic_auth("", "123456");
     req_body["name"] = "Bob";
-    mocked_users->SetCreateResult(true);
+    mocked_users->SetRegisterResult(SUCCESS);
     auto result =
         client.Post("/v1/users/register", req_body.dump(), "text/plain");
     EXPECT_EQ(result.error(), httplib::Error::Success);
@@ -873,6 +928,254 @@ TEST_F(APITest, TaskListsCreate) {
   mocked_tasklists_worker->Clear();
 }
 
+TEST_F(APITest, ConditionalGet) {
+  std::string token;
+  std::string etag;
+  mocked_tasklists_worker->Clear();
+  mocked_tasks_worker->Clear();
+
+  {
+    httplib::Client client(test_host, test_port);
+    client.set_basic_auth("Alice", "123456");
+    mocked_users->SetValidateResult(true);
+    auto result = client.Post("/v1/users/login");
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    token = nlohmann::json::parse(result->body).at("token");
+  }
+
+  {
+    httplib::Client client(test_host, test_port);
+    client.set_basic_auth(token, "");
+    nlohmann::json request_body;
+    request_body["name"] = "tasklists_test_name_1";
+    request_body["content"] = "some_content_1";
+    auto result =
+        client.Post("/v1/task_lists/create", request_body.dump(), "text/plain");
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_NE(result->body.find("success"), std::string::npos);
+  }
+
+  {
+    httplib::Client client(test_host, test_port);
+    client.set_basic_auth(token, "");
+    auto result = client.Get("/v1/task_lists/tasklists_test_name_1");
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_EQ(result->status, 200);
+    etag = result->get_header_value("ETag");
+    EXPECT_EQ(etag.substr(0, 3), "W/\"");
+  }
+
+  {
+    // the client has the current version
+    httplib::Client client(test_host, test_port);
+    client.set_basic_auth(token, "");
+    auto result = client.Get("/v1/task_lists/tasklists_test_name_1",
+                             {{"If-None-Match", "\"0\", " + etag}});
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_EQ(result->status, 304);
+    EXPECT_TRUE(result->body.empty());
+    EXPECT_EQ(result->get_header_value("ETag"), etag);
+  }
+
+  {
+    // a missing list is never "not modified"
+    httplib::Client client(test_host, test_port);
+    client.set_basic_auth(token, "");
+    auto result = client.Get("/v1/task_lists/tasklists_test_name_2",
+                             {{"If-None-Match", "*"}});
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_EQ(result->status, 500);
+    EXPECT_FALSE(result->has_header("ETag"));
+  }
+
+  {
+    httplib::Client client(test_host, test_port);
+    client.set_basic_auth(token, "");
+    nlohmann::json request_body;
+    request_body["content"] = "some_content_1_new";
+    auto result = client.Put("/v1/task_lists/tasklists_test_name_1",
+                             request_body.dump(), "text/plain");
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_NE(result->body.find("success"), std::string::npos);
+  }
+
+  {
+    // a change gives a new version
+    httplib::Client client(test_host, test_port);
+    client.set_basic_auth(token, "");
+    auto result = client.Get("/v1/task_lists/tasklists_test_name_1",
+                             {{"If-None-Match", etag}});
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_EQ(result->status, 200);
+    EXPECT_NE(result->body.find("some_content_1_new"), std::string::npos);
+    EXPECT_NE(result->get_header_value("ETag"), etag);
+  }
+
+  {
+    httplib::Client client(test_host, test_port);
+    client.set_basic_auth(token, "");
+    nlohmann::json request_body;
+    request_body["name"] = "tasks_test_name_1";
+    auto result =
+        client.Post("/v1/task_lists/tasklists_test_name_1/tasks/create",
+                    request_body.dump(), "text/plain");
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_NE(result->body.find("success"), std::string::npos);
+  }
+
+  {
+    httplib::Client client(test_host, test_port);
+    client.set_basic_auth(token, "");
+    auto result = client.Get("/v1/task_lists/tasklists_test_name_1/tasks");
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_EQ(result->status, 200);
+    etag = result->get_header_value("ETag");
+    EXPECT_FALSE(etag.empty());
+
+    result = client.Get("/v1/task_lists/tasklists_test_name_1/tasks",
+                        {{"If-None-Match", etag}});
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_EQ(result->status, 304);
+
+    result = client.Get(
+        "/v1/task_lists/tasklists_test_name_1/tasks/tasks_test_name_1");
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_EQ(result->status, 200);
+    etag = result->get_header_value("ETag");
+
+    result = client.Get(
+        "/v1/task_lists/tasklists_test_name_1/tasks/tasks_test_name_1",
+        {{"If-None-Match", etag}});
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_EQ(result->status, 304);
+  }
+
+  mocked_tasklists_worker->Clear();
+  mocked_tasks_worker->Clear();
+}
+
+TEST_F(APITest, Sync) {
+  std::string token;
+  uint64_t cursor = 0;
+
+  {
+    httplib::Client client(test_host, test_port);
+    client.set_basic_auth("Alice", "123456");
+    mocked_users->SetValidateResult(true);
+    auto result = client.Post("/v1/users/login");
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    token = nlohmann::json::parse(result->body).at("token");
+  }
+
+  {
+    httplib::Client client(test_host, test_port);
+    client.set_basic_auth(token, "");
+    auto result = client.Get("/v1/sync?since=abc");
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_EQ(result->status, 400);
+  }
+
+  {
+    // the first sync has no cursor, the client reloads everything
+    httplib::Client client(test_host, test_port);
+    client.set_basic_auth(token, "");
+    auto result = client.Get("/v1/sync");
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_EQ(result->status, 200);
+    auto body = nlohmann::json::parse(result->body);
+    EXPECT_EQ(body.at("reset"), true);
+    EXPECT_TRUE(body.at("shared").is_array());
+    cursor = body.at("cursor");
+  }
+
+  {
+    // nothing changed since
+    httplib::Client client(test_host, test_port);
+    client.set_basic_auth(token, "");
+    auto result = client.Get("/v1/sync?since=" + std::to_string(cursor));
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_EQ(result->status, 200);
+    auto body = nlohmann::json::parse(result->body);
+    EXPECT_EQ(body.at("reset"), false);
+    EXPECT_EQ(body.at("cursor"), cursor);
+    EXPECT_TRUE(body.at("data").empty());
+  }
+
+  {
+    // a cursor from the future cannot be served
+    httplib::Client client(test_host, test_port);
+    client.set_basic_auth(token, "");
+    auto result = client.Get("/v1/sync?since=" + std::to_string(cursor + 1));
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_EQ(nlohmann::json::parse(result->body).at("reset"), true);
+  }
+}
+
+TEST_F(APITest, Metrics) {
+  std::string token;
+  mocked_tasklists_worker->Clear();
+
+  {
+    httplib::Client client(test_host, test_port);
+    client.set_basic_auth("Alice", "123456");
+    mocked_users->SetValidateResult(true);
+    auto result = client.Post("/v1/users/login");
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    token = nlohmann::json::parse(result->body).at("token");
+  }
+
+  {
+    httplib::Client client(test_host, test_port);
+    client.set_basic_auth(token, "");
+    // Alice has no task list yet, the worker fails
+    auto result = client.Get("/v1/task_lists");
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_EQ(result->status, 500);
+  }
+
+  {
+    httplib::Client client(test_host, test_port);
+    auto result = client.Get("/metrics");
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_EQ(result->status, 200);
+    const std::string &body = result->body;
+    EXPECT_NE(body.find("lqxx_http_requests_total{method=\"POST\","
+                        "route=\"/v1/users/login\",code=\"200\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(body.find("lqxx_worker_returns_total{method=\"GET\","
+                        "route=\"/v1/task_lists\",code=\"ERR_NO_NODE\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(body.find("lqxx_http_requests_total{method=\"GET\","
+                        "route=\"/v1/task_lists\",code=\"500\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(body.find("lqxx_http_request_duration_seconds_count{method="
+                        "\"GET\",route=\"/v1/task_lists\"} 1\n"),
+              std::string::npos);
+    // the scrape itself is in flight
+    EXPECT_NE(body.find("lqxx_http_requests_in_flight 1\n"),
+              std::string::npos);
+    EXPECT_NE(body.find("# TYPE lqxx_task_queue_depth gauge\n"),
+              std::string::npos);
+  }
+}
+
+TEST_F(APITest, RateLimit) {
+  mocked_users->SetValidateResult(true);
+  httplib::Client client(test_host, test_port);
+  client.set_basic_auth("Alice", "123456");
+
+  // logins of one address may come in a burst of 20, then 2 per second
+  for (int i = 0; i < 20; i++) {
+    auto result = client.Post("/v1/users/login");
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_EQ(result->status, 200);
+  }
+  auto result = client.Post("/v1/users/login");
+  EXPECT_EQ(result.error(), httplib::Error::Success);
+  EXPECT_EQ(result->status, 429);
+  EXPECT_EQ(result->get_header_value("Retry-After"), "1");
+}
+
 TEST_F(APITest, Tasks) {
   std::string token;
   mocked_tasklists_worker->Clear();
@@ -1054,6 +1357,19 @@ TEST_F(APITest, Tasks) {
     EXPECT_NE(result->body.find("tasks_test_name_2"), std::string::npos);
   }
 
+  {
+    // a failed access probe fails the request
+    httplib::Client client(test_host, test_port);
+    client.set_basic_auth(token, "");
+    mocked_tasks_worker->resolve_result = returnCode::ERR_UNKNOWN;
+    auto result = client.Get(
+        "/v1/task_lists/tasklists_test_name_1/tasks/tasks_test_name_2");
+    mocked_tasks_worker->resolve_result = returnCode::SUCCESS;
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_EQ(result->status, 500);
+    EXPECT_NE(result->body.find("failed check access"), std::string::npos);
+  }
+
   mocked_tasklists_worker->Clear();
   mocked_tasks_worker->Clear();
 }
@@ -1286,6 +1602,20 @@ TEST_F(APITest, Share) {
     EXPECT_NE(result->body.find("test_user_2"), std::string::npos);
   }
 
+  {
+    // a body that does not parse removes nothing
+    httplib::Client client(test_host, test_port);
+    client.set_basic_auth(token, "");
+    auto result = client.Delete("/v1/share/tasklists_test_name_1",
+                                "{\"user_list\": [", "text/plain");
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_EQ(result->status, 400);
+    result = client.Get("/v1/share/tasklists_test_name_1");
+    EXPECT_EQ(result.error(), httplib::Error::Success);
+    EXPECT_NE(result->body.find("test_user_1"), std::string::npos);
+    EXPECT_NE(result->body.find("test_user_2"), std::string::npos);
+  }
+
   {
     httplib::Client client(test_host, test_port);
     client.set_basic_auth(token, "");
@@ -0,0 +1,196 @@
+#include "api/bodyParser.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+static void ExpectShare(const shareInfo &share, const std::string &name,
+                        bool permission, bool is_group) {
+  EXPECT_EQ(share.user_name, name);
+  EXPECT_EQ(share.task_list_name, "list0");
+  EXPECT_EQ(share.permission, permission);
+  EXPECT_EQ(share.is_group, is_group);
+}
+
+TEST(BodyParserTest, Task) {
+  TaskContent task;
+  std::string err_field;
+  EXPECT_EQ(BodyParser::ParseTask(R"({"name": "task0", "content": "c",
+                                      "date": "d", "start_date": "01/02/2022",
+                                      "end_date": "01/03/2022", "priority": 2,
+                                      "status": "Doing", "extra": [1, {}]})",
+                                  &task, true, &err_field),
+            SUCCESS);
+  EXPECT_EQ(task.name, "task0");
+  EXPECT_EQ(task.content, "c");
+  EXPECT_EQ(task.date, "d");
+  EXPECT_EQ(task.startDate, "01/02/2022");
+  EXPECT_EQ(task.endDate, "01/03/2022");
+  EXPECT_EQ(task.priority, URGENT);
+  EXPECT_EQ(task.status, "Doing");
+
+  // name is only required on create
+  task.Clear();
+  EXPECT_EQ(BodyParser::ParseTask(R"({"content": "c"})", &task, false,
+                                  &err_field),
+            SUCCESS);
+  EXPECT_EQ(task.content, "c");
+  EXPECT_EQ(BodyParser::ParseTask(R"({"content": "c"})", &task, true,
+                                  &err_field),
+            ERR_RFIELD);
+  EXPECT_EQ(err_field, "name");
+}
+
+TEST(BodyParserTest, TaskBadInput) {
+  TaskContent task;
+  std::string err_field;
+  for (const char *body : {"", "{", "[]", "\"name\"", "{\"name\": \"a\"} x"}) {
+    err_field.clear();
+    EXPECT_EQ(BodyParser::ParseTask(body, &task, true, &err_field), ERR_FORMAT)
+        << body;
+    EXPECT_EQ(err_field, "") << body;
+  }
+
+  EXPECT_EQ(BodyParser::ParseTask(R"({"name": 1})", &task, true, &err_field),
+            ERR_FORMAT);
+  EXPECT_EQ(err_field, "name");
+  EXPECT_EQ(BodyParser::ParseTask(R"({"content": null})", &task, false,
+                                  &err_field),
+            ERR_FORMAT);
+  EXPECT_EQ(err_field, "content");
+  for (const char *body : {R"({"priority": 4})", R"({"priority": -1})",
+                           R"({"priority": 1.5})", R"({"priority": "1"})",
+                           R"({"priority": 18446744073709551615})"}) {
+    EXPECT_EQ(BodyParser::ParseTask(body, &task, false, &err_field),
+              ERR_FORMAT)
+        << body;
+    EXPECT_EQ(err_field, "priority");
+  }
+  EXPECT_EQ(BodyParser::ParseTask(R"({"status": ["Done"]})", &task, false,
+                                  &err_field),
+            ERR_FORMAT);
+  EXPECT_EQ(err_field, "status");
+}
+
+TEST(BodyParserTest, Limits) {
+  TaskContent task;
+  std::string err_field;
+  std::string body = "{\"content\": \"" +
+                     std::string(BodyParser::kMaxStringSize + 1, 'a') + "\"}";
+  EXPECT_EQ(BodyParser::ParseTask(body, &task, false, &err_field), ERR_FORMAT);
+
+  body = "{\"extra\": [";
+  for (size_t i = 0; i < BodyParser::kMaxValues; i++) {
+    body += "0,";
+  }
+  body += "0]}";
+  ASSERT_LE(body.size(), BodyParser::kMaxBodySize);
+  EXPECT_EQ(BodyParser::ParseTask(body, &task, false, &err_field), ERR_FORMAT);
+
+  body = "{\"content\": \"" + std::string(BodyParser::kMaxBodySize, ' ') +
+         "\"}";
+  EXPECT_EQ(BodyParser::ParseTask(body, &task, false, &err_field), ERR_FORMAT);
+}
+
+TEST(BodyParserTest, Shares) {
+  std::vector<shareInfo> shares;
+  std::string err_field;
+  EXPECT_EQ(BodyParser::ParseShares(R"({"user_permission": [
+                                        {"user": "u0", "permission": true},
+                                        {"permission": false, "group": "g0"},
+                                        {"user": "u1", "group": "g1",
+                                         "permission": false, "x": {}}]})",
+                                    "list0", &shares, &err_field),
+            SUCCESS);
+  ASSERT_EQ(shares.size(), 3);
+  ExpectShare(shares[0], "u0", true, false);
+  ExpectShare(shares[1], "g0", false, true);
+  ExpectShare(shares[2], "g1", false, true);
+
+  shares.clear();
+  EXPECT_EQ(BodyParser::ParseShares(R"({"user_permission": []})", "list0",
+                                    &shares, &err_field),
+            SUCCESS);
+  EXPECT_TRUE(shares.empty());
+}
+
+TEST(BodyParserTest, SharesBadInput) {
+  std::vector<shareInfo> shares;
+  std::string err_field;
+  const std::pair<const char *, const char *> format_errors[] = {
+      {R"({"user_permission": {}})", "user_permission"},
+      {R"({"user_permission": [1]})", "user_permission"},
+      {R"({"user_permission": [[]]})", "user_permission"},
+      {R"({"user_permission": [{"user": 1, "permission": true}]})", "user"},
+      {R"({"user_permission": [{"group": [], "permission": true}]})", "group"},
+      {R"({"user_permission": [{"user": "u", "permission": "write"}]})",
+       "permission"}};
+  for (auto &error : format_errors) {
+    EXPECT_EQ(BodyParser::ParseShares(error.first, "list0", &shares,
+                                      &err_field),
+              ERR_FORMAT)
+        << error.first;
+    EXPECT_EQ(err_field, error.second) << error.first;
+  }
+
+  const std::pair<const char *, const char *> missing[] = {
+      {R"({})", "user_permission"},
+      {R"({"user_permission": [{"permission": true}]})", "user"},
+      {R"({"user_permission": [{"user": "u"}]})", "permission"}};
+  for (auto &error : missing) {
+    EXPECT_EQ(BodyParser::ParseShares(error.first, "list0", &shares,
+                                      &err_field),
+              ERR_RFIELD)
+        << error.first;
+    EXPECT_EQ(err_field, error.second) << error.first;
+  }
+}
+
+TEST(BodyParserTest, NameLists) {
+  std::vector<std::string> users;
+  std::vector<std::string> groups;
+  std::string err_field;
+  EXPECT_EQ(BodyParser::ParseNameLists(
+                R"({"user_list": ["u0", "u1"], "other": [["x"]],
+                    "group_list": ["g0"]})",
+                {{"user_list", &users, true}, {"group_list", &groups, false}},
+                &err_field),
+            SUCCESS);
+  EXPECT_EQ(users, std::vector<std::string>({"u0", "u1"}));
+  EXPECT_EQ(groups, std::vector<std::string>({"g0"}));
+
+  EXPECT_EQ(BodyParser::ParseNameLists(R"({"group_list": []})",
+                                       {{"user_list", &users, true}},
+                                       &err_field),
+            ERR_RFIELD);
+  EXPECT_EQ(err_field, "user_list");
+  for (const char *body : {R"({"user_list": "u0"})", R"({"user_list": [1]})",
+                           R"({"user_list": {}})",
+                           R"({"user_list": [["u0"]]})"}) {
+    EXPECT_EQ(BodyParser::ParseNameLists(body, {{"user_list", &users, false}},
+                                         &err_field),
+              ERR_FORMAT)
+        << body;
+    EXPECT_EQ(err_field, "user_list") << body;
+  }
+}
+
+TEST(BodyParserTest, BulkNameList) {
+  std::vector<std::string> users;
+  std::string err_field;
+  std::string body = "{\"user_list\": [";
+  for (int i = 0; i < 10000; i++) {
+    body += (i ? ",\"user" : "\"user") + std::to_string(i) + "\"";
+  }
+  body += "]}";
+  EXPECT_EQ(BodyParser::ParseNameLists(body, {{"user_list", &users, true}},
+                                       &err_field),
+            SUCCESS);
+  ASSERT_EQ(users.size(), 10000);
+  EXPECT_EQ(users.back(), "user9999");
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,128 @@
+#include "api/bulkhead.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+static Bulkhead::Clock::time_point In(int ms) {
+  return Bulkhead::Clock::now() + std::chrono::milliseconds(ms);
+}
+
+static void WaitQueued(const Bulkhead &bulkhead, Bulkhead::Lane lane,
+                       size_t n) {
+  while (bulkhead.Queued(lane) != n) {
+    std::this_thread::yield();
+  }
+}
+
+TEST(BulkheadTest, ReservedSlots) {
+  // 8 threads: 2 for interactive reads, 1 for each other lane, 1 where an
+  // interactive read may wait, 2 shared
+  Bulkhead bulkhead(8);
+  EXPECT_EQ(bulkhead.Acquire(Bulkhead::LOGIN, In(0)), Bulkhead::RESERVED);
+  for (int i = 0; i < 2; i++) {
+    EXPECT_EQ(bulkhead.Acquire(Bulkhead::LOGIN, In(0)), Bulkhead::SHARED);
+  }
+  // no thread left to wait on for a login, refused at once
+  EXPECT_EQ(bulkhead.Acquire(Bulkhead::LOGIN, In(5000)), Bulkhead::REFUSED);
+  EXPECT_EQ(bulkhead.Active(Bulkhead::LOGIN), 3);
+  EXPECT_EQ(bulkhead.Rejected(Bulkhead::LOGIN), 1);
+
+  // logins took the shared slots, reads still have theirs
+  EXPECT_EQ(bulkhead.Acquire(Bulkhead::INTERACTIVE, In(0)), Bulkhead::RESERVED);
+  EXPECT_EQ(bulkhead.Acquire(Bulkhead::INTERACTIVE, In(0)), Bulkhead::RESERVED);
+  EXPECT_EQ(bulkhead.Acquire(Bulkhead::INTERACTIVE, In(0)), Bulkhead::REFUSED);
+
+  bulkhead.Release(Bulkhead::LOGIN, Bulkhead::SHARED);
+  EXPECT_EQ(bulkhead.Acquire(Bulkhead::INTERACTIVE, In(0)), Bulkhead::SHARED);
+}
+
+TEST(BulkheadTest, WaitersHoldThreads) {
+  // every slot taken and every thread for waiting too: 8 threads held
+  Bulkhead bulkhead(8);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_NE(bulkhead.Acquire(Bulkhead::LOGIN, In(0)), Bulkhead::REFUSED);
+  }
+  ASSERT_EQ(bulkhead.Acquire(Bulkhead::BULK, In(0)), Bulkhead::RESERVED);
+  ASSERT_EQ(bulkhead.Acquire(Bulkhead::WRITE, In(0)), Bulkhead::RESERVED);
+  ASSERT_EQ(bulkhead.Acquire(Bulkhead::INTERACTIVE, In(0)), Bulkhead::RESERVED);
+  ASSERT_EQ(bulkhead.Acquire(Bulkhead::INTERACTIVE, In(0)), Bulkhead::RESERVED);
+  Bulkhead::Grant read = Bulkhead::REFUSED;
+  std::thread read_thread(
+      [&] { read = bulkhead.Acquire(Bulkhead::INTERACTIVE, In(5000)); });
+  WaitQueued(bulkhead, Bulkhead::INTERACTIVE, 1);
+
+  size_t held = 0;
+  for (size_t i = 0; i < Bulkhead::kLanes; i++) {
+    const auto lane = static_cast<Bulkhead::Lane>(i);
+    held += bulkhead.Active(lane) + bulkhead.Queued(lane);
+  }
+  EXPECT_EQ(held, 8);
+  // no request of any lane waits on a thread that is not there
+  for (size_t i = 0; i < Bulkhead::kLanes; i++) {
+    const auto lane = static_cast<Bulkhead::Lane>(i);
+    EXPECT_EQ(bulkhead.Acquire(lane, In(5000)), Bulkhead::REFUSED);
+  }
+
+  bulkhead.Release(Bulkhead::BULK, Bulkhead::RESERVED);
+  bulkhead.Release(Bulkhead::LOGIN, Bulkhead::SHARED);
+  read_thread.join();
+  EXPECT_EQ(read, Bulkhead::SHARED);
+}
+
+TEST(BulkheadTest, Priority) {
+  // 16 threads: 4 for interactive reads, 2 for each other lane, 2 where an
+  // interactive read may wait, 1 for each other lane, 1 shared
+  Bulkhead bulkhead(16);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_NE(bulkhead.Acquire(Bulkhead::LOGIN, In(0)), Bulkhead::REFUSED);
+  }
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(bulkhead.Acquire(Bulkhead::BULK, In(0)), Bulkhead::RESERVED);
+  }
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(bulkhead.Acquire(Bulkhead::INTERACTIVE, In(0)),
+              Bulkhead::RESERVED);
+  }
+
+  Bulkhead::Grant bulk = Bulkhead::REFUSED;
+  std::thread bulk_thread(
+      [&] { bulk = bulkhead.Acquire(Bulkhead::BULK, In(5000)); });
+  WaitQueued(bulkhead, Bulkhead::BULK, 1);
+  Bulkhead::Grant read = Bulkhead::REFUSED;
+  std::thread read_thread(
+      [&] { read = bulkhead.Acquire(Bulkhead::INTERACTIVE, In(5000)); });
+  WaitQueued(bulkhead, Bulkhead::INTERACTIVE, 1);
+
+  // the read came last but gets the shared slot
+  bulkhead.Release(Bulkhead::LOGIN, Bulkhead::SHARED);
+  read_thread.join();
+  EXPECT_EQ(read, Bulkhead::SHARED);
+  EXPECT_EQ(bulkhead.Queued(Bulkhead::BULK), 1);
+
+  bulkhead.Release(Bulkhead::INTERACTIVE, read);
+  bulk_thread.join();
+  EXPECT_EQ(bulk, Bulkhead::SHARED);
+}
+
+TEST(BulkheadTest, QueueFull) {
+  Bulkhead bulkhead(16);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_NE(bulkhead.Acquire(Bulkhead::LOGIN, In(0)), Bulkhead::REFUSED);
+  }
+  // one login may wait, the next is refused at once
+  Bulkhead::Grant waiting = Bulkhead::REFUSED;
+  std::thread waiter(
+      [&] { waiting = bulkhead.Acquire(Bulkhead::LOGIN, In(5000)); });
+  WaitQueued(bulkhead, Bulkhead::LOGIN, 1);
+  EXPECT_EQ(bulkhead.Acquire(Bulkhead::LOGIN, In(5000)), Bulkhead::REFUSED);
+
+  bulkhead.Release(Bulkhead::LOGIN, Bulkhead::RESERVED);
+  waiter.join();
+  EXPECT_EQ(waiting, Bulkhead::RESERVED);
+  EXPECT_EQ(bulkhead.Queued(Bulkhead::LOGIN), 0);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
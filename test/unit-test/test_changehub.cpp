@@ -0,0 +1,184 @@
+#include "api/changeHub.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+static ChangeEvent Event(ChangeEvent::Type type, const std::string &tasklist,
+                         const std::string &task = "") {
+  return {type, "owner", tasklist, task, "user"};
+}
+
+TEST(ChangeHubTest, FormatFrame) {
+  EXPECT_EQ(ChangeHub::FormatFrame(
+                Event(ChangeEvent::TASK_REVISED, "list\n0", "task0"), 7),
+            "id: 7\nevent: task.revised\n"
+            "data: {\"tasklist\":\"list\\n0\",\"task\":\"task0\","
+            "\"user\":\"user\"}\n\n");
+  EXPECT_EQ(
+      ChangeHub::FormatFrame(Event(ChangeEvent::TASKLIST_DELETED, "list0"), 8),
+      "id: 8\nevent: tasklist.deleted\n"
+      "data: {\"tasklist\":\"list0\",\"user\":\"user\"}\n\n");
+}
+
+TEST(ChangeHubTest, FanOut) {
+  ChangeHub hub;
+  auto first = hub.Subscribe("owner", "list0", "owner");
+  auto second = hub.Subscribe("owner", "list0", "owner");
+  auto other = hub.Subscribe("owner", "list1", "owner");
+  ASSERT_TRUE(first && second && other);
+  EXPECT_EQ(hub.Size(), 3);
+
+  hub.OnChange(Event(ChangeEvent::TASK_CREATED, "list0", "task0"));
+  hub.OnChange(Event(ChangeEvent::TASK_DELETED, "list0", "task0"));
+  // nobody streams the list of another owner
+  hub.OnChange({ChangeEvent::TASK_CREATED, "stranger", "list0", "task0", ""});
+
+  std::vector<ChangeHub::Frame> frames;
+  bool dropped = true;
+  ASSERT_TRUE(first->Wait(0ms, &frames, &dropped));
+  EXPECT_FALSE(dropped);
+  ASSERT_EQ(frames.size(), 2);
+  EXPECT_NE(frames[0]->find("event: task.created"), std::string::npos);
+  EXPECT_NE(frames[1]->find("event: task.deleted"), std::string::npos);
+
+  // every subscriber shares the same frames
+  std::vector<ChangeHub::Frame> second_frames;
+  ASSERT_TRUE(second->Wait(0ms, &second_frames, &dropped));
+  ASSERT_EQ(second_frames.size(), 2);
+  EXPECT_EQ(second_frames[0], frames[0]);
+
+  frames.clear();
+  ASSERT_TRUE(other->Wait(0ms, &frames, &dropped));
+  EXPECT_TRUE(frames.empty());
+
+  hub.Unsubscribe(first);
+  hub.Unsubscribe(first);
+  EXPECT_EQ(hub.Size(), 2);
+  hub.OnChange(Event(ChangeEvent::TASKLIST_REVISED, "list0"));
+  frames.clear();
+  ASSERT_TRUE(first->Wait(0ms, &frames, &dropped));
+  EXPECT_TRUE(frames.empty());
+}
+
+TEST(ChangeHubTest, SlowSubscriber) {
+  ChangeHub hub(16, 4);
+  auto subscriber = hub.Subscribe("owner", "list0", "owner");
+  ASSERT_TRUE(subscriber);
+  for (int i = 0; i < 10; i++) {
+    hub.OnChange(Event(ChangeEvent::TASK_REVISED, "list0", "task0"));
+  }
+
+  // the queue was dropped, the client is told to reload
+  std::vector<ChangeHub::Frame> frames;
+  bool dropped = false;
+  ASSERT_TRUE(subscriber->Wait(0ms, &frames, &dropped));
+  EXPECT_TRUE(dropped);
+  EXPECT_TRUE(frames.empty());
+
+  hub.OnChange(Event(ChangeEvent::TASK_REVISED, "list0", "task0"));
+  ASSERT_TRUE(subscriber->Wait(0ms, &frames, &dropped));
+  EXPECT_FALSE(dropped);
+  EXPECT_EQ(frames.size(), 1);
+}
+
+TEST(ChangeHubTest, Limits) {
+  ChangeHub hub(2);
+  auto first = hub.Subscribe("owner", "list0", "owner");
+  auto second = hub.Subscribe("owner", "list1", "owner");
+  ASSERT_TRUE(first && second);
+  EXPECT_FALSE(hub.Subscribe("owner", "list2", "owner"));
+
+  hub.Unsubscribe(second);
+  EXPECT_TRUE(hub.Subscribe("owner", "list2", "owner"));
+  hub.SetMaxSubscribers(3);
+  EXPECT_TRUE(hub.Subscribe("owner", "list3", "owner"));
+  EXPECT_EQ(hub.Size(), 3);
+
+  // no stream at all, e.g. a single worker thread
+  hub.SetMaxSubscribers(0);
+  EXPECT_FALSE(hub.Subscribe("owner", "list4", "owner"));
+}
+
+TEST(ChangeHubTest, DeletedTasklist) {
+  ChangeHub hub;
+  auto subscriber = hub.Subscribe("owner", "list0", "user");
+  auto other = hub.Subscribe("owner", "list1", "user");
+  ASSERT_TRUE(subscriber && other);
+
+  // the last frame is delivered, then the stream ends
+  hub.OnChange(Event(ChangeEvent::TASKLIST_DELETED, "list0"));
+  std::vector<ChangeHub::Frame> frames;
+  bool dropped = false;
+  ASSERT_TRUE(subscriber->Wait(10s, &frames, &dropped));
+  ASSERT_EQ(frames.size(), 1);
+  EXPECT_NE(frames[0]->find("event: tasklist.deleted"), std::string::npos);
+  EXPECT_FALSE(subscriber->Wait(10s, &frames, &dropped));
+  ASSERT_TRUE(other->Wait(0ms, &frames, &dropped));
+}
+
+TEST(ChangeHubTest, Revoke) {
+  ChangeHub hub;
+  auto owner = hub.Subscribe("owner", "list0", "owner");
+  auto alice = hub.Subscribe("owner", "list0", "alice");
+  auto bob = hub.Subscribe("owner", "list0", "bob");
+  auto bob_other = hub.Subscribe("other", "list0", "bob");
+  ASSERT_TRUE(owner && alice && bob && bob_other);
+  std::vector<ChangeHub::Frame> frames;
+  bool dropped = false;
+
+  // one user of one tasklist
+  hub.OnChange({ChangeEvent::ACCESS_REVOKED, "owner", "list0", "", "alice"});
+  EXPECT_FALSE(alice->Wait(10s, &frames, &dropped));
+  EXPECT_TRUE(bob->Wait(0ms, &frames, &dropped));
+
+  // one user of any tasklist
+  hub.OnChange({ChangeEvent::ACCESS_REVOKED, "", "", "", "bob"});
+  EXPECT_FALSE(bob->Wait(10s, &frames, &dropped));
+  EXPECT_FALSE(bob_other->Wait(10s, &frames, &dropped));
+
+  // every collaborator, the owner keeps streaming
+  auto carol = hub.Subscribe("owner", "list0", "carol");
+  hub.OnChange({ChangeEvent::ACCESS_REVOKED, "owner", "list0", "", ""});
+  EXPECT_FALSE(carol->Wait(10s, &frames, &dropped));
+  EXPECT_TRUE(owner->Wait(0ms, &frames, &dropped));
+  EXPECT_TRUE(frames.empty());
+}
+
+TEST(ChangeHubTest, WaitAndClose) {
+  ChangeHub hub;
+  auto subscriber = hub.Subscribe("owner", "list0", "owner");
+  ASSERT_TRUE(subscriber);
+
+  // nothing comes before the timeout
+  std::vector<ChangeHub::Frame> frames;
+  bool dropped = false;
+  ASSERT_TRUE(subscriber->Wait(10ms, &frames, &dropped));
+  EXPECT_TRUE(frames.empty());
+
+  // a change wakes the subscriber
+  std::thread writer([&hub]() {
+    std::this_thread::sleep_for(20ms);
+    hub.OnChange(Event(ChangeEvent::TASK_CREATED, "list0", "task0"));
+  });
+  ASSERT_TRUE(subscriber->Wait(10s, &frames, &dropped));
+  EXPECT_EQ(frames.size(), 1);
+  writer.join();
+
+  // closing ends every stream and refuses new ones
+  std::thread closer([&hub]() {
+    std::this_thread::sleep_for(20ms);
+    hub.Close();
+  });
+  EXPECT_FALSE(subscriber->Wait(10s, &frames, &dropped));
+  closer.join();
+  EXPECT_FALSE(hub.Subscribe("owner", "list0", "owner"));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,125 @@
+#include "api/changeJournal.h"
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+static ChangeEvent Event(const std::string &owner, ChangeEvent::Type type,
+                         const std::string &tasklist,
+                         const std::string &task = "") {
+  return {type, owner, tasklist, task, owner};
+}
+
+TEST(ChangeJournalTest, ReadSince) {
+  ChangeJournal journal;
+  const uint64_t start = journal.Cursor();
+  std::vector<ChangeJournal::Entry> changes;
+
+  // a cursor that was not handed out is refused
+  EXPECT_FALSE(journal.Read("user0", nullptr, 0, &changes));
+  EXPECT_FALSE(journal.Read("user0", nullptr, start + 1, &changes));
+  EXPECT_TRUE(journal.Read("user0", nullptr, start, &changes));
+  EXPECT_TRUE(changes.empty());
+
+  journal.OnChange(Event("user0", ChangeEvent::TASKLIST_CREATED, "list0"));
+  journal.OnChange(Event("user1", ChangeEvent::TASKLIST_CREATED, "list1"));
+  const uint64_t middle = journal.Cursor();
+  journal.OnChange(Event("user0", ChangeEvent::TASK_CREATED, "list0", "t0"));
+  EXPECT_EQ(journal.Cursor(), start + 3);
+  EXPECT_EQ(journal.Size(), 3);
+
+  // only the changes of the owner
+  ASSERT_TRUE(journal.Read("user0", nullptr, start, &changes));
+  ASSERT_EQ(changes.size(), 2);
+  EXPECT_EQ(changes[0].seq, start + 1);
+  EXPECT_EQ(changes[0].event.type, ChangeEvent::TASKLIST_CREATED);
+  EXPECT_EQ(changes[1].seq, start + 3);
+  EXPECT_EQ(changes[1].event.task, "t0");
+
+  // only the changes after the cursor
+  changes.clear();
+  ASSERT_TRUE(journal.Read("user0", nullptr, middle, &changes));
+  ASSERT_EQ(changes.size(), 1);
+  EXPECT_EQ(changes[0].event.task, "t0");
+
+  // an owner without changes has none to send
+  changes.clear();
+  ASSERT_TRUE(journal.Read("user2", nullptr, middle, &changes));
+  EXPECT_TRUE(changes.empty());
+}
+
+TEST(ChangeJournalTest, LastChangeAndFilter) {
+  ChangeJournal journal;
+  const uint64_t start = journal.Cursor();
+  for (int i = 0; i < 5; i++) {
+    journal.OnChange(Event("user0", ChangeEvent::TASK_REVISED, "list0", "t0"));
+  }
+  journal.OnChange(Event("user0", ChangeEvent::TASK_REVISED, "list1", "t0"));
+  journal.OnChange(Event("user0", ChangeEvent::TASK_DELETED, "list0", "t0"));
+  journal.OnChange(Event("user0", ChangeEvent::TASKLIST_REVISED, "list0"));
+
+  // repeated changes of a task are sent once, as their last change
+  std::vector<ChangeJournal::Entry> changes;
+  ASSERT_TRUE(journal.Read("user0", nullptr, start, &changes));
+  ASSERT_EQ(changes.size(), 3);
+  EXPECT_EQ(changes[0].event.tasklist, "list1");
+  EXPECT_EQ(changes[1].event.type, ChangeEvent::TASK_DELETED);
+  EXPECT_EQ(changes[1].seq, start + 7);
+  EXPECT_EQ(changes[2].event.type, ChangeEvent::TASKLIST_REVISED);
+
+  // only the changes of the given lists
+  const std::set<std::string> shared = {"list1"};
+  changes.clear();
+  ASSERT_TRUE(journal.Read("user0", &shared, start, &changes));
+  ASSERT_EQ(changes.size(), 1);
+  EXPECT_EQ(changes[0].event.tasklist, "list1");
+}
+
+TEST(ChangeJournalTest, Compact) {
+  ChangeJournal journal(60s, 4);
+  const uint64_t start = journal.Cursor();
+  for (int i = 0; i < 6; i++) {
+    journal.OnChange(
+        Event("user0", ChangeEvent::TASK_CREATED, "list0", std::to_string(i)));
+  }
+  journal.OnChange(Event("user1", ChangeEvent::TASK_CREATED, "list0", "t0"));
+  EXPECT_EQ(journal.Size(), 5);
+
+  // the first two changes of user0 were dropped
+  std::vector<ChangeJournal::Entry> changes;
+  EXPECT_FALSE(journal.Read("user0", nullptr, start + 1, &changes));
+  ASSERT_TRUE(journal.Read("user0", nullptr, start + 2, &changes));
+  EXPECT_EQ(changes.size(), 4);
+
+  // all entries are past the retention window, cursors before them are
+  // refused, later ones still served
+  journal.Compact(ChangeJournal::Clock::now() + 61s);
+  EXPECT_EQ(journal.Size(), 0);
+  EXPECT_FALSE(journal.Read("user0", nullptr, start + 5, &changes));
+  EXPECT_FALSE(journal.Read("user1", nullptr, start + 2, &changes));
+  changes.clear();
+  EXPECT_TRUE(journal.Read("user0", nullptr, journal.Cursor(), &changes));
+  EXPECT_TRUE(journal.Read("user1", nullptr, journal.Cursor(), &changes));
+  EXPECT_TRUE(changes.empty());
+}
+
+TEST(ChangeJournalTest, Restart) {
+  ChangeJournal before;
+  for (int i = 0; i < 100; i++) {
+    before.OnChange(Event("user0", ChangeEvent::TASK_CREATED, "list0", "t"));
+  }
+  // cursors of an earlier journal are older than a new one
+  std::this_thread::sleep_for(1ms);
+  ChangeJournal after;
+  std::vector<ChangeJournal::Entry> changes;
+  EXPECT_FALSE(after.Read("user0", nullptr, before.Cursor(), &changes));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,137 @@
+#include "api/compressor.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+/* Inflate a gzip or zlib stream */
+static std::string Inflate(const std::string &compressed) {
+  z_stream z = {};
+  EXPECT_EQ(inflateInit2(&z, 15 + 32), Z_OK);
+  z.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(compressed.data()));
+  z.avail_in = compressed.size();
+  std::string out;
+  char buf[4096];
+  int ret;
+  do {
+    z.next_out = reinterpret_cast<Bytef *>(buf);
+    z.avail_out = sizeof(buf);
+    ret = inflate(&z, Z_NO_FLUSH);
+    out.append(buf, sizeof(buf) - z.avail_out);
+  } while (ret == Z_OK);
+  EXPECT_EQ(ret, Z_STREAM_END);
+  inflateEnd(&z);
+  return out;
+}
+
+static std::string Body(int n) {
+  std::string body = "{\"msg\":\"success\",\"data\":[";
+  for (int i = 0; i < n; i++) {
+    body += (i ? "," : "") + std::string("{\"user\":\"user") +
+            std::to_string(i) + "\",\"list\":\"list" + std::to_string(i) +
+            "\"}";
+  }
+  return body + "]}";
+}
+
+TEST(CompressorTest, Negotiate) {
+  using namespace Compressor;
+  EXPECT_EQ(Negotiate(""), IDENTITY);
+  EXPECT_EQ(Negotiate("identity"), IDENTITY);
+  EXPECT_EQ(Negotiate("br"), IDENTITY);
+  EXPECT_EQ(Negotiate("gzip"), GZIP);
+  EXPECT_EQ(Negotiate("deflate"), DEFLATE);
+  EXPECT_EQ(Negotiate("gzip, deflate, br"), GZIP);
+  EXPECT_EQ(Negotiate("deflate, gzip"), GZIP);
+  EXPECT_EQ(Negotiate(" deflate ;q=1.0, gzip; q=0.5"), DEFLATE);
+  EXPECT_EQ(Negotiate("gzip;q=0, deflate"), DEFLATE);
+  EXPECT_EQ(Negotiate("gzip;q=0, deflate;q=0"), IDENTITY);
+  EXPECT_EQ(Negotiate("*"), GZIP);
+  EXPECT_EQ(Negotiate("gzip;q=0, *"), DEFLATE);
+  EXPECT_EQ(Negotiate("*;q=0"), IDENTITY);
+  EXPECT_EQ(Name(GZIP), "gzip");
+  EXPECT_EQ(Name(DEFLATE), "deflate");
+}
+
+TEST(CompressorTest, RoundTrip) {
+  for (auto encoding : {Compressor::GZIP, Compressor::DEFLATE}) {
+    for (int n : {0, 1, 100, 10000}) {
+      std::string body = Body(n);
+      std::string compressed;
+      ASSERT_TRUE(Compressor::Compress(body, encoding, &compressed));
+      EXPECT_EQ(Inflate(compressed), body);
+      if (n >= 100) {
+        EXPECT_LT(compressed.size() * 5, body.size());
+      }
+    }
+  }
+  // gzip has its magic number, deflate a zlib header
+  std::string compressed;
+  ASSERT_TRUE(Compressor::Compress(Body(1), Compressor::GZIP, &compressed));
+  EXPECT_EQ(compressed.substr(0, 2), "\x1f\x8b");
+  ASSERT_TRUE(Compressor::Compress(Body(1), Compressor::DEFLATE, &compressed));
+  EXPECT_EQ(compressed[0], '\x78');
+  EXPECT_FALSE(Compressor::Compress(Body(1), Compressor::IDENTITY,
+                                    &compressed));
+}
+
+TEST(CompressorTest, Threads) {
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([i]() {
+      for (int j = 0; j < 50; j++) {
+        std::string body = Body(i * 10 + j);
+        std::string compressed;
+        ASSERT_TRUE(Compressor::Compress(
+            body, j % 2 ? Compressor::GZIP : Compressor::DEFLATE,
+            &compressed));
+        EXPECT_EQ(Inflate(compressed), body);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+TEST(CompressedCacheTest, SameBodyOnly) {
+  CompressedCache cache;
+  std::string first;
+  std::string second;
+  ASSERT_TRUE(cache.Compress("/v1/public/all", Body(100), Compressor::GZIP,
+                             &first));
+  ASSERT_TRUE(cache.Compress("/v1/public/all", Body(100), Compressor::GZIP,
+                             &second));
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(cache.Size(), 1);
+
+  // a changed body is compressed again
+  ASSERT_TRUE(cache.Compress("/v1/public/all", Body(101), Compressor::GZIP,
+                             &second));
+  EXPECT_EQ(Inflate(second), Body(101));
+  EXPECT_EQ(cache.Size(), 1);
+
+  // each encoding has its entry
+  ASSERT_TRUE(cache.Compress("/v1/public/all", Body(101),
+                             Compressor::DEFLATE, &second));
+  EXPECT_EQ(Inflate(second), Body(101));
+  EXPECT_EQ(cache.Size(), 2);
+}
+
+TEST(CompressedCacheTest, Capacity) {
+  CompressedCache cache(4);
+  std::string compressed;
+  for (int i = 0; i < 16; i++) {
+    ASSERT_TRUE(cache.Compress("/route" + std::to_string(i), Body(i),
+                               Compressor::GZIP, &compressed));
+    EXPECT_EQ(Inflate(compressed), Body(i));
+  }
+  EXPECT_EQ(cache.Size(), 4);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,69 @@
+#include "api/concurrencyLimiter.h"
+#include <gtest/gtest.h>
+
+TEST(ConcurrencyLimiterTest, Acquire) {
+  ConcurrencyLimiter limiter(1, 2);
+  EXPECT_EQ(limiter.Limit(), 2);
+  EXPECT_TRUE(limiter.Acquire());
+  EXPECT_TRUE(limiter.Acquire());
+  EXPECT_FALSE(limiter.Acquire());
+  EXPECT_EQ(limiter.InFlight(), 2);
+  EXPECT_EQ(limiter.Shed(), 1);
+
+  limiter.Release(0);
+  EXPECT_TRUE(limiter.Acquire());
+}
+
+TEST(ConcurrencyLimiterTest, Backoff) {
+  ConcurrencyLimiter limiter(2, 10, 2.0, 4);
+  // a window of fast requests sets the baseline
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(limiter.Acquire());
+    limiter.Release(1000);
+  }
+  EXPECT_EQ(limiter.Limit(), 10);
+
+  // the DB got three times slower, the limit is cut until the floor
+  for (int round = 0; round < 20; round++) {
+    for (int i = 0; i < 4; i++) {
+      ASSERT_TRUE(limiter.Acquire());
+      limiter.Release(3000);
+    }
+  }
+  EXPECT_EQ(limiter.Limit(), 2);
+
+  // back to normal, the limit grows again while it is used up
+  for (int round = 0; round < 8; round++) {
+    const size_t n = limiter.Limit();
+    for (size_t i = 0; i < n; i++) {
+      ASSERT_TRUE(limiter.Acquire());
+    }
+    EXPECT_FALSE(limiter.Acquire());
+    for (size_t i = 0; i < n; i++) {
+      limiter.Release(1000);
+    }
+  }
+  EXPECT_GT(limiter.Limit(), 4);
+
+  // but not while it is not
+  const size_t limit = limiter.Limit();
+  for (int i = 0; i < 8; i++) {
+    ASSERT_TRUE(limiter.Acquire());
+    limiter.Release(1000);
+  }
+  EXPECT_EQ(limiter.Limit(), limit);
+}
+
+TEST(ConcurrencyLimiterTest, SetMaxLimit) {
+  ConcurrencyLimiter limiter(2, 64);
+  limiter.SetMaxLimit(8);
+  EXPECT_EQ(limiter.Limit(), 8);
+  limiter.SetMaxLimit(1);
+  EXPECT_EQ(limiter.Limit(), 2);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,224 @@
+#include <api/groupContent.h>
+#include <db/DB.h>
+#include <gmock/gmock.h>
+#include <groups/groupsWorker.h>
+#include <gtest/gtest.h>
+#include <memory>
+
+class MockedDB : public DB {
+public:
+  MOCK_METHOD(returnCode, createGroupNode,
+              (const std::string &user_pkey, const std::string &group_pkey),
+              (override));
+  MOCK_METHOD(returnCode, deleteGroupNode,
+              (const std::string &user_pkey, const std::string &group_pkey,
+               std::vector<std::string> &task_list_pkeys),
+              (override));
+  MOCK_METHOD(returnCode, getGroupNode,
+              (const std::string &user_pkey, const std::string &group_pkey,
+               std::vector<std::string> &members),
+              (override));
+  MOCK_METHOD(returnCode, getAllGroupNodes,
+              (const std::string &user_pkey,
+               (std::vector<std::pair<std::string, std::string>> &)groups),
+              (override));
+  MOCK_METHOD(returnCode, addGroupMembers,
+              (const std::string &user_pkey, const std::string &group_pkey,
+               const std::vector<std::string> &member_pkeys,
+               std::string &err_user),
+              (override));
+  MOCK_METHOD(returnCode, removeGroupMembers,
+              (const std::string &user_pkey, const std::string &group_pkey,
+               const std::vector<std::string> &member_pkeys),
+              (override));
+
+  MockedDB() : DB("testhost") {}
+};
+
+class RecordingListener : public ChangeListener {
+public:
+  void OnChange(const ChangeEvent &event) override { events.push_back(event); }
+
+  std::vector<ChangeEvent> events;
+};
+
+class GroupTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    mockedDB = std::make_shared<MockedDB>();
+    groupsWorker = std::make_shared<GroupsWorker>(mockedDB);
+  }
+
+  void TearDown() override {
+    // pass
+  }
+
+  std::shared_ptr<MockedDB> mockedDB;
+  std::shared_ptr<GroupsWorker> groupsWorker;
+  RequestData data;
+  GroupContent out;
+};
+
+using namespace ::testing;
+
+TEST_F(GroupTest, Create) {
+  // setup input
+  data.user_key = "user0";
+  data.group_key = "group0";
+
+  // normal create, should be successful
+  EXPECT_CALL(*mockedDB, createGroupNode(data.user_key, data.group_key))
+      .WillOnce(Return(SUCCESS));
+  EXPECT_EQ(groupsWorker->Create(data), SUCCESS);
+
+  // group name already used, no rename
+  EXPECT_CALL(*mockedDB, createGroupNode(data.user_key, data.group_key))
+      .WillOnce(Return(ERR_DUP_NODE));
+  EXPECT_EQ(groupsWorker->Create(data), ERR_DUP_NODE);
+
+  // no group key
+  data.group_key = "";
+  EXPECT_EQ(groupsWorker->Create(data), ERR_RFIELD);
+}
+
+TEST_F(GroupTest, Delete) {
+  // setup input
+  data.user_key = "user0";
+  data.group_key = "group0";
+
+  auto listener = std::make_shared<RecordingListener>();
+  groupsWorker->SetChangeListener(listener);
+  std::vector<std::string> tasklists = {"tasklist0", "tasklist1"};
+
+  // normal delete, should be successful
+  EXPECT_CALL(*mockedDB, deleteGroupNode(data.user_key, data.group_key, _))
+      .WillOnce(DoAll(SetArgReferee<2>(tasklists), Return(SUCCESS)));
+  EXPECT_EQ(groupsWorker->Delete(data), SUCCESS);
+  // only the streams of the tasklists granted to the group are told to end
+  ASSERT_EQ(listener->events.size(), 2);
+  for (size_t i = 0; i < tasklists.size(); i++) {
+    EXPECT_EQ(listener->events[i].type, ChangeEvent::ACCESS_REVOKED);
+    EXPECT_EQ(listener->events[i].owner, data.user_key);
+    EXPECT_EQ(listener->events[i].tasklist, tasklists[i]);
+    EXPECT_EQ(listener->events[i].user, "");
+  }
+
+  // the user owns no such group
+  EXPECT_CALL(*mockedDB, deleteGroupNode(data.user_key, data.group_key, _))
+      .WillOnce(Return(ERR_NO_NODE));
+  EXPECT_EQ(groupsWorker->Delete(data), ERR_NO_NODE);
+  EXPECT_EQ(listener->events.size(), 2);
+
+  // no user key
+  data.user_key = "";
+  EXPECT_EQ(groupsWorker->Delete(data), ERR_RFIELD);
+}
+
+TEST_F(GroupTest, Query) {
+  // setup input
+  data.user_key = "user1";
+  data.group_key = "group0";
+  std::string owner = "user0";
+  std::vector<std::string> members = {"user0", "user1"};
+
+  // member query of the group of another user, should be successful
+  data.other_user_key = owner;
+  EXPECT_CALL(*mockedDB, getGroupNode(owner, data.group_key, _))
+      .WillOnce(DoAll(SetArgReferee<2>(members), Return(SUCCESS)));
+  EXPECT_EQ(groupsWorker->Query(data, out), SUCCESS);
+  EXPECT_EQ(out.name, "group0");
+  EXPECT_EQ(out.owner, owner);
+  EXPECT_EQ(out.members, members);
+
+  // not a member
+  out = GroupContent();
+  data.user_key = "user2";
+  EXPECT_CALL(*mockedDB, getGroupNode(owner, data.group_key, _))
+      .WillOnce(DoAll(SetArgReferee<2>(members), Return(SUCCESS)));
+  EXPECT_EQ(groupsWorker->Query(data, out), ERR_ACCESS);
+  EXPECT_EQ(out.owner, "");
+
+  // without other user, the group of the user itself, here no such group
+  data.other_user_key = "";
+  EXPECT_CALL(*mockedDB, getGroupNode(data.user_key, data.group_key, _))
+      .WillOnce(Return(ERR_NO_NODE));
+  EXPECT_EQ(groupsWorker->Query(data, out), ERR_NO_NODE);
+}
+
+TEST_F(GroupTest, GetAllGroups) {
+  // setup input
+  data.user_key = "user0";
+  std::vector<GroupContent> outList;
+  std::vector<std::pair<std::string, std::string>> groups = {
+      {"user0", "group0"}, {"user1", "group0"}};
+
+  // normal call, should be successful
+  EXPECT_CALL(*mockedDB, getAllGroupNodes(data.user_key, _))
+      .WillOnce(DoAll(SetArgReferee<1>(groups), Return(SUCCESS)));
+  EXPECT_EQ(groupsWorker->GetAllGroups(data, outList), SUCCESS);
+  EXPECT_EQ(outList.size(), 2);
+  EXPECT_EQ(outList[0].name, "group0");
+  EXPECT_EQ(outList[0].owner, "user0");
+  EXPECT_EQ(outList[1].name, "group0");
+  EXPECT_EQ(outList[1].owner, "user1");
+
+  // no user key
+  data.user_key = "";
+  EXPECT_EQ(groupsWorker->GetAllGroups(data, outList), ERR_RFIELD);
+}
+
+TEST_F(GroupTest, AddMembers) {
+  // setup input
+  data.user_key = "user0";
+  data.group_key = "group0";
+  std::vector<std::string> in_list = {"user1", "user2"};
+  std::string errUser;
+
+  // normal call, all users are added at once, should be successful
+  EXPECT_CALL(*mockedDB,
+              addGroupMembers(data.user_key, data.group_key, in_list, _))
+      .WillOnce(Return(SUCCESS));
+  EXPECT_EQ(groupsWorker->AddMembers(data, in_list, errUser), SUCCESS);
+  EXPECT_EQ(errUser, "");
+
+  // one of the users does not exist
+  EXPECT_CALL(*mockedDB,
+              addGroupMembers(data.user_key, data.group_key, in_list, _))
+      .WillOnce(
+          DoAll(SetArgReferee<3>(std::string("user2")), Return(ERR_NO_NODE)));
+  EXPECT_EQ(groupsWorker->AddMembers(data, in_list, errUser), ERR_NO_NODE);
+  EXPECT_EQ(errUser, "user2");
+
+  // empty user name
+  in_list.push_back("");
+  EXPECT_EQ(groupsWorker->AddMembers(data, in_list, errUser), ERR_RFIELD);
+}
+
+TEST_F(GroupTest, RemoveMembers) {
+  // setup input
+  data.user_key = "user0";
+  data.group_key = "group0";
+  std::vector<std::string> in_list = {"user1", "user2"};
+
+  // normal call, should be successful
+  EXPECT_CALL(*mockedDB,
+              removeGroupMembers(data.user_key, data.group_key, in_list))
+      .WillOnce(Return(SUCCESS));
+  EXPECT_EQ(groupsWorker->RemoveMembers(data, in_list), SUCCESS);
+
+  // the user owns no such group
+  EXPECT_CALL(*mockedDB,
+              removeGroupMembers(data.user_key, data.group_key, in_list))
+      .WillOnce(Return(ERR_NO_NODE));
+  EXPECT_EQ(groupsWorker->RemoveMembers(data, in_list), ERR_NO_NODE);
+
+  // no group key
+  data.group_key = "";
+  EXPECT_EQ(groupsWorker->RemoveMembers(data, in_list), ERR_RFIELD);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,66 @@
+#include "api/jsonWriter.h"
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <string>
+
+static std::string Write(const nlohmann::json &js) {
+  std::string out;
+  JsonWriter::WriteJson(out, js);
+  return out;
+}
+
+TEST(JsonWriterTest, StringsLikeDump) {
+  for (const std::string str :
+       {std::string(""), std::string("plain ascii"),
+        std::string("a much longer string without any escape in it"),
+        std::string("quote\" and backslash\\ inside"),
+        std::string("new\nline\ttab\rreturn\bback\fform"),
+        std::string("control \x01\x1f and del \x7f"), std::string("\"\"\""),
+        std::string("utf-8 \xc3\xa9\xe4\xb8\xad"),
+        std::string("12345678\"2345678\\"), std::string("\0nul", 4)}) {
+    std::string out;
+    JsonWriter::WriteString(out, str);
+    EXPECT_EQ(out, nlohmann::json(str).dump());
+  }
+}
+
+TEST(JsonWriterTest, ValuesLikeDump) {
+  nlohmann::json js = {
+      {"msg", "success"},
+      {"data",
+       {{{"name", "tasklist0"}, {"permission", "write"}},
+        {{"name", "tasklist\"1"}, {"priority", 2}, {"done", false}}}},
+      {"empty_array", nlohmann::json::array()},
+      {"empty_object", nlohmann::json::object()},
+      {"null", nullptr},
+      {"negative", -42},
+      {"unsigned", 18446744073709551615ULL},
+      {"float", 0.1}};
+  EXPECT_EQ(Write(js), js.dump());
+}
+
+TEST(JsonWriterTest, WriteValue) {
+  std::string out;
+  JsonWriter::WriteValue(out, "literal");
+  out += ',';
+  JsonWriter::WriteValue(out, std::string("string"));
+  out += ',';
+  JsonWriter::WriteValue(out, 7);
+  out += ',';
+  JsonWriter::WriteValue(out, true);
+  out += ',';
+  JsonWriter::WriteValue(out, nlohmann::json{1, 2});
+  EXPECT_EQ(out, "\"literal\",\"string\",7,true,[1,2]");
+}
+
+TEST(JsonWriterTest, ReserveLastSize) {
+  JsonWriter::RecordBufferSize(4096);
+  EXPECT_GE(JsonWriter::TakeBuffer().capacity(), 4096);
+  EXPECT_TRUE(JsonWriter::TakeBuffer().empty());
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
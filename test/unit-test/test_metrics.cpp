@@ -0,0 +1,81 @@
+#include "api/metrics.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(MetricsTest, Counter) {
+  Metrics metrics;
+  Metrics::Counter *counter =
+      metrics.GetCounter("requests_total", "Requests.", {{"code", "200"}});
+  // the same series is handed out again
+  EXPECT_EQ(metrics.GetCounter("requests_total", "", {{"code", "200"}}),
+            counter);
+  EXPECT_NE(metrics.GetCounter("requests_total", "", {{"code", "404"}}),
+            counter);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([counter]() {
+      for (int j = 0; j < 1000; j++) {
+        counter->Add();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(counter->Value(), 8000);
+
+  EXPECT_EQ(metrics.Render(), "# HELP requests_total Requests.\n"
+                              "# TYPE requests_total counter\n"
+                              "requests_total{code=\"200\"} 8000\n"
+                              "requests_total{code=\"404\"} 0\n");
+}
+
+TEST(MetricsTest, GaugeAndCallback) {
+  Metrics metrics;
+  Metrics::Gauge *gauge = metrics.GetGauge("in_flight", "In flight.");
+  gauge->Add(3);
+  gauge->Add(-1);
+  size_t size = 42;
+  metrics.AddCallback("cache_size", "Size.", false,
+                      [&size]() { return size; });
+  metrics.AddCallback("route", "Escaped.", false, []() { return 0.5; },
+                      {{"path", "a\"b\\c"}});
+
+  EXPECT_EQ(metrics.Render(), "# HELP in_flight In flight.\n"
+                              "# TYPE in_flight gauge\n"
+                              "in_flight 2\n"
+                              "# HELP cache_size Size.\n"
+                              "# TYPE cache_size gauge\n"
+                              "cache_size 42\n"
+                              "# HELP route Escaped.\n"
+                              "# TYPE route gauge\n"
+                              "route{path=\"a\\\"b\\\\c\"} 0.5\n");
+}
+
+TEST(MetricsTest, Histogram) {
+  Metrics metrics;
+  Metrics::Histogram *histogram = metrics.GetHistogram(
+      "latency_seconds", "Latency.", {{"route", "/x"}}, {100, 1000});
+  histogram->Observe(50);
+  histogram->Observe(100);
+  histogram->Observe(500);
+  histogram->Observe(2000000);
+
+  EXPECT_EQ(metrics.Render(),
+            "# HELP latency_seconds Latency.\n"
+            "# TYPE latency_seconds histogram\n"
+            "latency_seconds_bucket{route=\"/x\",le=\"0.0001\"} 2\n"
+            "latency_seconds_bucket{route=\"/x\",le=\"0.001\"} 3\n"
+            "latency_seconds_bucket{route=\"/x\",le=\"+Inf\"} 4\n"
+            "latency_seconds_sum{route=\"/x\"} 2.00065\n"
+            "latency_seconds_count{route=\"/x\"} 4\n");
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
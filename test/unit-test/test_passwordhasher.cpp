@@ -0,0 +1,100 @@
+#include "users/passwordHasher.h"
+#include <chrono>
+#include <gtest/gtest.h>
+#include <thread>
+
+static PasswordHasher::Options Pbkdf2(uint64_t cost) {
+  PasswordHasher::Options options;
+  options.cost = cost;
+  return options;
+}
+
+TEST(PasswordHasherTest, Pbkdf2) {
+  PasswordHasher hasher(Pbkdf2(1000));
+  std::string hash;
+  std::string other;
+  ASSERT_TRUE(hasher.Hash("123456", &hash));
+  ASSERT_TRUE(hasher.Hash("123456", &other));
+  EXPECT_EQ(hash.rfind("$pbkdf2-sha256$1000$", 0), 0);
+  // salted
+  EXPECT_NE(hash, other);
+
+  bool upgrade = true;
+  EXPECT_EQ(hasher.Verify("123456", "alice@columbia.edu", hash, &upgrade),
+            PasswordHasher::MATCH);
+  EXPECT_FALSE(upgrade);
+  EXPECT_EQ(hasher.Verify("1234567", "alice@columbia.edu", hash, &upgrade),
+            PasswordHasher::MISMATCH);
+  EXPECT_EQ(hasher.Verify("123456", "", "", &upgrade),
+            PasswordHasher::MISMATCH);
+  EXPECT_EQ(hasher.Verify("123456", "", "$pbkdf2-sha256$x$00$00", &upgrade),
+            PasswordHasher::MISMATCH);
+}
+
+TEST(PasswordHasherTest, Scrypt) {
+  PasswordHasher::Options options;
+  options.kdf = PasswordHasher::SCRYPT;
+  options.cost = 1024;
+  PasswordHasher hasher(options);
+  std::string hash;
+  ASSERT_TRUE(hasher.Hash("123456", &hash));
+  EXPECT_EQ(hash.rfind("$scrypt$1024$8$1$", 0), 0);
+
+  bool upgrade = true;
+  EXPECT_EQ(hasher.Verify("123456", "", hash, &upgrade),
+            PasswordHasher::MATCH);
+  EXPECT_FALSE(upgrade);
+  EXPECT_EQ(hasher.Verify("654321", "", hash, &upgrade),
+            PasswordHasher::MISMATCH);
+}
+
+TEST(PasswordHasherTest, Upgrade) {
+  PasswordHasher hasher(Pbkdf2(2000));
+  // the old way, SHA-256 of the email and the password
+  const std::string legacy =
+      PasswordHasher::LegacyHash("alice@columbia.edu123456");
+  bool upgrade = false;
+  EXPECT_EQ(hasher.Verify("123456", "alice@columbia.edu", legacy, &upgrade),
+            PasswordHasher::MATCH);
+  EXPECT_TRUE(upgrade);
+  EXPECT_EQ(hasher.Verify("123456", "bob@columbia.edu", legacy, &upgrade),
+            PasswordHasher::MISMATCH);
+
+  // a lower cost
+  std::string hash;
+  ASSERT_TRUE(PasswordHasher(Pbkdf2(1000)).Hash("123456", &hash));
+  upgrade = false;
+  EXPECT_EQ(hasher.Verify("123456", "", hash, &upgrade), PasswordHasher::MATCH);
+  EXPECT_TRUE(upgrade);
+}
+
+TEST(PasswordHasherTest, QueueFull) {
+  PasswordHasher::Options options = Pbkdf2(1000000);
+  options.n_threads = 1;
+  options.max_queued = 1;
+  PasswordHasher hasher(options);
+
+  // one hash runs, one waits, the next is refused
+  std::string running;
+  std::string waiting;
+  std::thread first([&] { hasher.Hash("123456", &running); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  std::thread second([&] { hasher.Hash("123456", &waiting); });
+  while (hasher.Depth() != 1) {
+    std::this_thread::yield();
+  }
+  std::string refused;
+  EXPECT_FALSE(hasher.Hash("123456", &refused));
+  EXPECT_EQ(hasher.Rejected(), 1);
+
+  first.join();
+  second.join();
+  EXPECT_FALSE(running.empty());
+  EXPECT_FALSE(waiting.empty());
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
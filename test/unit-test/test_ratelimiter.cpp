@@ -0,0 +1,78 @@
+#include "api/rateLimiter.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST(RateLimiterTest, Burst) {
+  RateLimiter limiter(10, 5);
+  const auto now = RateLimiter::Clock::now();
+  RateLimiter::Clock::duration retry_after{};
+  for (int i = 0; i < 5; i++) {
+    EXPECT_TRUE(limiter.Allow("user0", &retry_after, now));
+  }
+  // the bucket is empty, the next token comes in 100ms
+  EXPECT_FALSE(limiter.Allow("user0", &retry_after, now));
+  EXPECT_GT(retry_after, 99ms);
+  EXPECT_LE(retry_after, 100ms);
+
+  // other keys have their own bucket
+  EXPECT_TRUE(limiter.Allow("user1", &retry_after, now));
+  EXPECT_EQ(limiter.Size(), 2);
+}
+
+TEST(RateLimiterTest, Refill) {
+  RateLimiter limiter(10, 2);
+  const auto now = RateLimiter::Clock::now();
+  RateLimiter::Clock::duration retry_after{};
+  EXPECT_TRUE(limiter.Allow("user0", &retry_after, now));
+  EXPECT_TRUE(limiter.Allow("user0", &retry_after, now));
+  EXPECT_FALSE(limiter.Allow("user0", &retry_after, now));
+
+  EXPECT_TRUE(limiter.Allow("user0", &retry_after, now + 100ms));
+  EXPECT_FALSE(limiter.Allow("user0", &retry_after, now + 100ms));
+
+  // never more than the burst
+  EXPECT_TRUE(limiter.Allow("user0", &retry_after, now + 10s));
+  EXPECT_TRUE(limiter.Allow("user0", &retry_after, now + 10s));
+  EXPECT_FALSE(limiter.Allow("user0", &retry_after, now + 10s));
+}
+
+TEST(RateLimiterTest, IdleEviction) {
+  RateLimiter limiter(10, 2, 1);
+  const auto now = RateLimiter::Clock::now();
+  RateLimiter::Clock::duration retry_after{};
+  EXPECT_TRUE(limiter.Allow("user0", &retry_after, now));
+  EXPECT_TRUE(limiter.Allow("user1", &retry_after, now));
+  EXPECT_EQ(limiter.Size(), 2);
+
+  // both buckets refilled after 200ms, they are dropped on the next sweep
+  EXPECT_TRUE(limiter.Allow("user2", &retry_after, now + 1s));
+  EXPECT_EQ(limiter.Size(), 1);
+}
+
+TEST(RateLimiterTest, Concurrent) {
+  RateLimiter limiter(1e-3, 1000);
+  std::atomic<int> allowed{0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([&limiter, &allowed]() {
+      RateLimiter::Clock::duration retry_after{};
+      for (int j = 0; j < 500; j++) {
+        allowed += limiter.Allow("user0", &retry_after);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(allowed, 1000);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,96 @@
+#include "api/router.h"
+#include <gtest/gtest.h>
+#include <string>
+
+class RouterTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    Add("GET", "/v1/task_lists", "all");
+    Add("GET", "/v1/task_lists/{list}", "get");
+    Add("POST", "/v1/task_lists/create", "create");
+    Add("PUT", "/v1/task_lists/{list}", "update");
+    Add("GET", "/v1/task_lists/{list}/tasks/{task}", "task");
+    Add("POST", "/v1/task_lists/{list}/tasks/create", "task-create");
+    Add("GET", "/health/{n:int}", "health");
+    Add("GET", "/health/{name}", "health-name");
+  }
+
+  void Add(const std::string &method, const std::string &pattern,
+           const std::string &name) {
+    router.Add(method, pattern,
+               [this, name](const httplib::Request &, httplib::Response &) {
+                 handled = name;
+                 match1 = Router::Match(1);
+                 match2 = Router::Match(2);
+               });
+  }
+
+  bool Dispatch(const std::string &method, const std::string &path) {
+    httplib::Request req;
+    httplib::Response res;
+    req.method = method;
+    req.path = path;
+    handled = match1 = match2 = "";
+    return router.Dispatch(req, res);
+  }
+
+  Router router;
+  std::string handled;
+  std::string match1;
+  std::string match2;
+};
+
+TEST_F(RouterTest, LiteralRoutes) {
+  EXPECT_TRUE(Dispatch("GET", "/v1/task_lists"));
+  EXPECT_EQ(handled, "all");
+  EXPECT_TRUE(Dispatch("POST", "/v1/task_lists/create"));
+  EXPECT_EQ(handled, "create");
+  // HEAD is served by GET routes
+  EXPECT_TRUE(Dispatch("HEAD", "/v1/task_lists"));
+  EXPECT_EQ(handled, "all");
+}
+
+TEST_F(RouterTest, Captures) {
+  EXPECT_TRUE(Dispatch("GET", "/v1/task_lists/list0"));
+  EXPECT_EQ(handled, "get");
+  EXPECT_EQ(match1, "list0");
+  EXPECT_TRUE(Dispatch("PUT", "/v1/task_lists/create"));
+  EXPECT_EQ(handled, "update");
+  EXPECT_EQ(match1, "create");
+  EXPECT_TRUE(Dispatch("GET", "/v1/task_lists/list0/tasks/task0"));
+  EXPECT_EQ(handled, "task");
+  EXPECT_EQ(match1, "list0");
+  EXPECT_EQ(match2, "task0");
+  // literal segment is tried before the capture
+  EXPECT_TRUE(Dispatch("POST", "/v1/task_lists/list0/tasks/create"));
+  EXPECT_EQ(handled, "task-create");
+  EXPECT_EQ(match1, "list0");
+  EXPECT_EQ(match2, "");
+}
+
+TEST_F(RouterTest, TypedCaptures) {
+  EXPECT_TRUE(Dispatch("GET", "/health/123"));
+  EXPECT_EQ(handled, "health");
+  EXPECT_EQ(match1, "123");
+  EXPECT_TRUE(Dispatch("GET", "/health/12a"));
+  EXPECT_EQ(handled, "health-name");
+  EXPECT_EQ(match1, "12a");
+}
+
+TEST_F(RouterTest, NoMatch) {
+  EXPECT_FALSE(Dispatch("GET", "/v1/task_lists/"));
+  EXPECT_FALSE(Dispatch("GET", "/v1/task_lists/list0/tasks"));
+  EXPECT_FALSE(Dispatch("GET", "/v1/task_lists/list0/tasks/task0/x"));
+  EXPECT_FALSE(Dispatch("GET", "/v1//tasks"));
+  EXPECT_FALSE(Dispatch("DELETE", "/v1/task_lists/list0"));
+  EXPECT_FALSE(Dispatch("POST", "/v1/task_lists"));
+  EXPECT_FALSE(Dispatch("GET", ""));
+  EXPECT_FALSE(Dispatch("GET", "/"));
+  EXPECT_EQ(handled, "");
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -27,6 +27,11 @@ public:
               (const std::string &user_pkey,
                std::vector<std::string> &outNames),
               (override));
+  MOCK_METHOD(returnCode, getTaskListNodes,
+              (const std::string &user_pkey,
+               const std::vector<std::string> &fields,
+               (std::vector<std::map<std::string, std::string>> &)infos),
+              (override));
   MOCK_METHOD(returnCode, addAccess,
               (const std::string &src_user_pkey,
                const std::string &dst_user_pkey,
@@ -42,10 +47,35 @@ public:
                const std::string &dst_user_pkey,
                const std::string &task_list_pkey),
               (override));
+  MOCK_METHOD(returnCode, addAccessBatch,
+              (const std::string &src_user_pkey,
+               const std::string &task_list_pkey,
+               (const std::vector<std::pair<std::string, bool>> &)grants,
+               (const std::vector<std::pair<std::string, bool>> &)group_grants,
+               std::string &err_dst),
+              (override));
+  MOCK_METHOD(returnCode, removeAccessBatch,
+              (const std::string &src_user_pkey,
+               const std::string &task_list_pkey,
+               const std::vector<std::string> &dst_user_pkeys,
+               std::string &err_user),
+              (override));
+  MOCK_METHOD(returnCode, removeGroupAccessBatch,
+              (const std::string &src_user_pkey,
+               const std::string &task_list_pkey,
+               const std::vector<std::string> &group_pkeys,
+               std::string &err_group),
+              (override));
+  MOCK_METHOD(returnCode, allGroupGrant,
+              (const std::string &src_user_pkey,
+               const std::string &task_list_pkey,
+               (std::map<std::string, bool> &)group_grants),
+              (override));
   MOCK_METHOD(
       returnCode, allAccess,
       (const std::string &dst_user_pkey,
-       (std::map<std::pair<std::string, std::string>, bool> &)list_accesses),
+       (std::map<std::pair<std::string, std::string>, bool> &)list_accesses,
+       const std::string &owner_pkey, size_t skip, size_t limit),
       (override));
   MOCK_METHOD(returnCode, allGrant,
               (const std::string &src_user_pkey,
@@ -55,6 +85,10 @@ public:
   MOCK_METHOD(returnCode, getAllPublic,
               ((std::vector<std::pair<std::string, std::string>> &)user_list),
               (override));
+  MOCK_METHOD(returnCode, getVersion,
+              (const std::string &user_pkey, const std::string &task_list_pkey,
+               const std::string &task_pkey, int64_t &version),
+              (override));
 
   MockedDB() : DB("testhost") {}
 };
@@ -66,6 +100,13 @@ public:
   MockedUsers(std::shared_ptr<DB> _db) : Users(_db) {}
 };
 
+class RecordingListener : public ChangeListener {
+public:
+  void OnChange(const ChangeEvent &event) override { events.push_back(event); }
+
+  std::vector<ChangeEvent> events;
+};
+
 class TaskListTest : public ::testing::Test {
 protected:
   void SetUp() override {
@@ -127,6 +168,22 @@ TEST_F(TaskListTest, QueryOwned) {
   EXPECT_EQ(out.visibility, "");
 }
 
+TEST_F(TaskListTest, ExistsIgnoresFields) {
+  // a task query on an own tasklist asks for fields of the task
+  data = RequestData("user0", "tasklist0", "task0", "");
+  data.fields = {"status", "priority"};
+  std::map<std::string, std::string> task_list_info;
+  EXPECT_CALL(*mockedDB,
+              getTaskListNode(data.user_key, data.tasklist_key, task_list_info))
+      .WillOnce(Return(SUCCESS));
+  EXPECT_TRUE(tasklistsWorker->Exists(data));
+
+  EXPECT_CALL(*mockedDB,
+              getTaskListNode(data.user_key, data.tasklist_key, task_list_info))
+      .WillOnce(Return(ERR_NO_NODE));
+  EXPECT_FALSE(tasklistsWorker->Exists(data));
+}
+
 TEST_F(TaskListTest, QueryAccess) {
   // setup input
   data.user_key = "user0";
@@ -177,6 +234,86 @@ TEST_F(TaskListTest, QueryAccess) {
   EXPECT_EQ(out.visibility, "");
 }
 
+TEST_F(TaskListTest, Version) {
+  data.user_key = "user0";
+  data.tasklist_key = "tasklist0";
+  int64_t version = 0;
+
+  // version of an owned tasklist
+  EXPECT_CALL(*mockedDB, getVersion("user0", "tasklist0", "", version))
+      .WillOnce(DoAll(SetArgReferee<3>(3), Return(SUCCESS)));
+  EXPECT_EQ(tasklistsWorker->Version(data, version), SUCCESS);
+  EXPECT_EQ(version, 3);
+
+  // version of a shared tasklist needs access to it
+  data.other_user_key = "anotherUser0";
+  version = 0;
+  bool permission = false;
+  EXPECT_CALL(*mockedDB,
+              checkAccess("anotherUser0", "user0", "tasklist0", permission))
+      .WillOnce(Return(SUCCESS));
+  EXPECT_CALL(*mockedDB, getVersion("anotherUser0", "tasklist0", "", version))
+      .WillOnce(DoAll(SetArgReferee<3>(4), Return(SUCCESS)));
+  EXPECT_EQ(tasklistsWorker->Version(data, version), SUCCESS);
+  EXPECT_EQ(version, 4);
+
+  EXPECT_CALL(*mockedDB,
+              checkAccess("anotherUser0", "user0", "tasklist0", permission))
+      .WillOnce(Return(ERR_NO_NODE));
+  EXPECT_EQ(tasklistsWorker->Version(data, version), ERR_NO_NODE);
+
+  // a resolved access already has the version, no query
+  data.access.resolved = true;
+  data.access.exists = true;
+  data.access.readable = true;
+  data.access.version = 5;
+  EXPECT_CALL(*mockedDB, checkAccess(_, _, _, _)).Times(0);
+  EXPECT_CALL(*mockedDB, getVersion(_, _, _, _)).Times(0);
+  EXPECT_EQ(tasklistsWorker->Version(data, version), SUCCESS);
+  EXPECT_EQ(version, 5);
+  data.access.readable = false;
+  EXPECT_EQ(tasklistsWorker->Version(data, version), ERR_ACCESS);
+  data.access.exists = false;
+  EXPECT_EQ(tasklistsWorker->Version(data, version), ERR_NO_NODE);
+  data.access = RequestData::Access();
+
+  // request tasklist_key is empty
+  data.other_user_key = "";
+  data.tasklist_key = "";
+  EXPECT_EQ(tasklistsWorker->Version(data, version), ERR_RFIELD);
+}
+
+TEST_F(TaskListTest, Notify) {
+  auto listener = std::make_shared<RecordingListener>();
+  tasklistsWorker->SetChangeListener(listener);
+  data.user_key = "user0";
+  data.tasklist_key = "tasklist0";
+  in = TasklistContent();
+  in.content = "revised";
+  std::map<std::string, std::string> task_list_info = {{"content", "revised"}};
+
+  EXPECT_CALL(*mockedDB,
+              reviseTaskListNode("user0", "tasklist0", task_list_info))
+      .WillOnce(Return(SUCCESS))
+      .WillOnce(Return(ERR_NO_NODE));
+  EXPECT_EQ(tasklistsWorker->Revise(data, in), SUCCESS);
+  EXPECT_EQ(tasklistsWorker->Revise(data, in), ERR_NO_NODE);
+  EXPECT_CALL(*mockedDB, deleteTaskListNode("user0", "tasklist0"))
+      .WillOnce(Return(SUCCESS));
+  EXPECT_EQ(tasklistsWorker->Delete(data), SUCCESS);
+
+  // only the writes that succeeded are reported
+  ASSERT_EQ(listener->events.size(), 2);
+  EXPECT_EQ(listener->events[0].type, ChangeEvent::TASKLIST_REVISED);
+  EXPECT_EQ(listener->events[1].type, ChangeEvent::TASKLIST_DELETED);
+  for (auto &event : listener->events) {
+    EXPECT_EQ(event.owner, "user0");
+    EXPECT_EQ(event.tasklist, "tasklist0");
+    EXPECT_EQ(event.task, "");
+    EXPECT_EQ(event.user, "user0");
+  }
+}
+
 TEST_F(TaskListTest, Create) {
   // setup input
   data.user_key = "user0";
@@ -372,6 +509,35 @@ TEST_F(TaskListTest, GetAllTasklist) {
   EXPECT_EQ(tasklistsWorker->GetAllTasklist(data, outNames), ERR_RFIELD);
 }
 
+TEST_F(TaskListTest, GetAllTasklistContent) {
+  // setup input
+  data.user_key = "user0";
+  data.fields = {"name", "visibility"};
+  std::vector<TasklistContent> out;
+  std::vector<std::map<std::string, std::string>> infos = {
+      {{"name", "tasklist0"}, {"visibility", "public"}},
+      {{"name", "tasklist1"}, {"visibility", "private"}}};
+
+  // only the requested fields are returned
+  EXPECT_CALL(*mockedDB, getTaskListNodes(data.user_key, data.fields, _))
+      .WillOnce(DoAll(SetArgReferee<2>(infos), Return(SUCCESS)));
+  EXPECT_EQ(tasklistsWorker->GetAllTasklistContent(data, out), SUCCESS);
+  EXPECT_EQ(out.size(), 2);
+  EXPECT_EQ(out[0].name, "tasklist0");
+  EXPECT_EQ(out[1].visibility, "private");
+  EXPECT_EQ(out[1].content, "");
+
+  // unknown field
+  out.clear();
+  data.fields = {"user"};
+  EXPECT_EQ(tasklistsWorker->GetAllTasklistContent(data, out), ERR_FORMAT);
+  EXPECT_EQ(out.size(), 0);
+
+  // request user_key empty
+  data.user_key = "";
+  EXPECT_EQ(tasklistsWorker->GetAllTasklistContent(data, out), ERR_RFIELD);
+}
+
 TEST_F(TaskListTest, GetAllAccessTaskList) {
   // setup input
   data.user_key = "user";
@@ -384,7 +550,7 @@ TEST_F(TaskListTest, GetAllAccessTaskList) {
   }
 
   // normal getAllAccessTaskList call, should be successful
-  EXPECT_CALL(*mockedDB, allAccess(data.user_key, list_accesses))
+  EXPECT_CALL(*mockedDB, allAccess(data.user_key, list_accesses, "", 0, 0))
       .WillOnce(DoAll(SetArgReferee<1>(new_list_accesses), Return(SUCCESS)));
   EXPECT_EQ(tasklistsWorker->GetAllAccessTaskList(data, outList), SUCCESS);
   EXPECT_EQ(outList.size(), 20);
@@ -397,6 +563,17 @@ TEST_F(TaskListTest, GetAllAccessTaskList) {
     ind++;
   }
 
+  // owner filter and page are passed down to the query
+  data.other_user_key = "user3";
+  data.offset = 10;
+  data.limit = 5;
+  outList.clear();
+  EXPECT_CALL(*mockedDB,
+              allAccess(data.user_key, list_accesses, "user3", 10, 5))
+      .WillOnce(Return(SUCCESS));
+  EXPECT_EQ(tasklistsWorker->GetAllAccessTaskList(data, outList), SUCCESS);
+  EXPECT_EQ(outList.size(), 0);
+
   // request user_key empty
   data.user_key = "";
   outList.clear();
@@ -477,16 +654,23 @@ TEST_F(TaskListTest, GetAllGrantTaskList) {
   EXPECT_CALL(*mockedDB,
               allGrant(data.user_key, data.tasklist_key, list_grants))
       .WillOnce(DoAll(SetArgReferee<2>(new_list_grants), Return(SUCCESS)));
+  std::map<std::string, bool> new_group_grants = {{"group0", true}};
+  EXPECT_CALL(*mockedDB, allGroupGrant(data.user_key, data.tasklist_key, _))
+      .WillOnce(DoAll(SetArgReferee<2>(new_group_grants), Return(SUCCESS)));
   EXPECT_EQ(tasklistsWorker->GetAllGrantTaskList(data, outList, isPublic),
             SUCCESS);
-  EXPECT_EQ(outList.size(), 20);
+  EXPECT_EQ(outList.size(), 21);
   int ind = 0;
   for (auto &it : new_list_grants) {
     EXPECT_EQ(outList[ind].user_name, it.first);
     EXPECT_EQ(outList[ind].task_list_name, "");
     EXPECT_EQ(outList[ind].permission, false);
+    EXPECT_EQ(outList[ind].is_group, false);
     ind++;
   }
+  EXPECT_EQ(outList[20].user_name, "group0");
+  EXPECT_EQ(outList[20].permission, true);
+  EXPECT_EQ(outList[20].is_group, true);
   EXPECT_EQ(isPublic, false);
   new_list_grants.clear();
 
@@ -536,45 +720,48 @@ TEST_F(TaskListTest, ReviseGrantTaskList) {
   data.user_key = "user";
   data.tasklist_key = "tasklist";
   std::vector<shareInfo> in_list;
+  std::vector<std::pair<std::string, bool>> grants;
   for (int i = 0; i < 20; i++) {
     shareInfo info;
     info.user_name = "user" + std::to_string(i);
     info.permission = false;
     in_list.push_back(info);
+    grants.emplace_back(info.user_name, info.permission);
   }
   std::string errUser;
 
-  std::map<std::string, std::string> task_list_info;
-  task_list_info["visibility"];
-  std::map<std::string, std::string> new_task_list_info;
-  new_task_list_info["visibility"] = "shared";
-
-  // normal call, should be successful
-  EXPECT_CALL(*mockedDB,
-              getTaskListNode(data.user_key, data.tasklist_key, task_list_info))
-      .WillOnce(DoAll(SetArgReferee<2>(new_task_list_info), Return(SUCCESS)));
-  for (int i = 0; i < in_list.size(); i++) {
-    EXPECT_CALL(*mockedDB, addAccess(data.user_key, in_list[i].user_name,
-                                     data.tasklist_key, in_list[i].permission))
-        .WillOnce(Return(SUCCESS));
-  }
+  // normal call, all users are granted at once, should be successful
+  std::vector<std::pair<std::string, bool>> group_grants;
+  EXPECT_CALL(*mockedDB, addAccessBatch(data.user_key, data.tasklist_key,
+                                        grants, group_grants, _))
+      .WillOnce(Return(SUCCESS));
   EXPECT_EQ(tasklistsWorker->ReviseGrantTaskList(data, in_list, errUser),
             SUCCESS);
   EXPECT_EQ(errUser, "");
 
-  // failed on third user (no such user)
-  EXPECT_CALL(*mockedDB,
-              getTaskListNode(data.user_key, data.tasklist_key, task_list_info))
-      .WillOnce(DoAll(SetArgReferee<2>(new_task_list_info), Return(SUCCESS)));
-  for (int i = 0; i < 3; i++) {
-    EXPECT_CALL(*mockedDB, addAccess(data.user_key, in_list[i].user_name,
-                                     data.tasklist_key, in_list[i].permission))
-        .WillOnce(Return(SUCCESS));
-  }
-
-  EXPECT_CALL(*mockedDB, addAccess(data.user_key, in_list[3].user_name,
-                                   data.tasklist_key, in_list[3].permission))
-      .WillOnce(Return(ERR_NO_NODE));
+  // groups are granted with the users, in the same call
+  shareInfo group;
+  group.user_name = "group0";
+  group.permission = true;
+  group.is_group = true;
+  in_list.push_back(group);
+  group_grants.emplace_back("group0", true);
+  EXPECT_CALL(*mockedDB, addAccessBatch(data.user_key, data.tasklist_key,
+                                        grants, group_grants, _))
+      .WillOnce(
+          DoAll(SetArgReferee<4>(std::string("group0")), Return(ERR_NO_NODE)));
+  EXPECT_EQ(tasklistsWorker->ReviseGrantTaskList(data, in_list, errUser),
+            ERR_NO_NODE);
+  EXPECT_EQ(errUser, "group0");
+  errUser = "";
+  in_list.pop_back();
+  group_grants.clear();
+
+  // failed on fourth user (no such user)
+  EXPECT_CALL(*mockedDB, addAccessBatch(data.user_key, data.tasklist_key,
+                                        grants, group_grants, _))
+      .WillOnce(DoAll(SetArgReferee<4>(in_list[3].user_name),
+                      Return(ERR_NO_NODE)));
   EXPECT_EQ(tasklistsWorker->ReviseGrantTaskList(data, in_list, errUser),
             ERR_NO_NODE);
   EXPECT_EQ(errUser, in_list[3].user_name);
@@ -587,35 +774,80 @@ TEST_F(TaskListTest, ReviseGrantTaskList) {
   EXPECT_EQ(errUser, "");
   data.tasklist_key = "tasklist";
 
-  // failed, because tasklist is not "share"
-  new_task_list_info["visibility"] = "public";
-  EXPECT_CALL(*mockedDB,
-              getTaskListNode(data.user_key, data.tasklist_key, task_list_info))
-      .WillOnce(DoAll(SetArgReferee<2>(new_task_list_info), Return(SUCCESS)));
+  // failed, because tasklist is not "share", checked with the grants
+  EXPECT_CALL(*mockedDB, addAccessBatch(data.user_key, data.tasklist_key,
+                                        grants, group_grants, _))
+      .WillOnce(Return(ERR_ACCESS));
   EXPECT_EQ(tasklistsWorker->ReviseGrantTaskList(data, in_list, errUser),
             ERR_ACCESS);
   EXPECT_EQ(errUser, "");
-  new_task_list_info["visibility"] = "shared";
 
-  // failed, because (one of the in_list) 's user_name is empty
+  // failed, because tasklist does not exist
+  EXPECT_CALL(*mockedDB, addAccessBatch(data.user_key, data.tasklist_key,
+                                        grants, group_grants, _))
+      .WillOnce(Return(ERR_NO_NODE));
+  EXPECT_EQ(tasklistsWorker->ReviseGrantTaskList(data, in_list, errUser),
+            ERR_ACCESS);
+  EXPECT_EQ(errUser, "");
+
+  // failed, because (one of the in_list) 's user_name is empty, nothing is
+  // granted
   in_list[3].user_name = "";
-  EXPECT_CALL(*mockedDB,
-              getTaskListNode(data.user_key, data.tasklist_key, task_list_info))
-      .WillOnce(DoAll(SetArgReferee<2>(new_task_list_info), Return(SUCCESS)));
-  for (int i = 0; i < 3; i++) {
-    EXPECT_CALL(*mockedDB, addAccess(data.user_key, in_list[i].user_name,
-                                     data.tasklist_key, in_list[i].permission))
-        .WillOnce(Return(SUCCESS));
-  }
+  EXPECT_CALL(*mockedDB, addAccessBatch(_, _, _, _, _)).Times(0);
   EXPECT_EQ(tasklistsWorker->ReviseGrantTaskList(data, in_list, errUser),
             ERR_RFIELD);
 }
 
+TEST_F(TaskListTest, RemoveGrantTaskListBatch) {
+  // setup input
+  data.user_key = "user";
+  data.tasklist_key = "tasklist";
+  std::vector<std::string> in_list = {"user0", "user1", "user2"};
+  std::string errUser;
+
+  // normal call, all users are removed at once, should be successful
+  EXPECT_CALL(*mockedDB,
+              removeAccessBatch(data.user_key, data.tasklist_key, in_list, _))
+      .WillOnce(Return(SUCCESS));
+  EXPECT_EQ(tasklistsWorker->RemoveGrantTaskList(data, in_list, errUser),
+            SUCCESS);
+  EXPECT_EQ(errUser, "");
+
+  // one of the users does not exist
+  EXPECT_CALL(*mockedDB,
+              removeAccessBatch(data.user_key, data.tasklist_key, in_list, _))
+      .WillOnce(DoAll(SetArgReferee<3>("user1"), Return(ERR_NO_NODE)));
+  EXPECT_EQ(tasklistsWorker->RemoveGrantTaskList(data, in_list, errUser),
+            ERR_NO_NODE);
+  EXPECT_EQ(errUser, "user1");
+  errUser = "";
+
+  // cannot remove access to a tasklist that is "public"
+  EXPECT_CALL(*mockedDB,
+              removeAccessBatch(data.user_key, data.tasklist_key, in_list, _))
+      .WillOnce(Return(ERR_ACCESS));
+  EXPECT_EQ(tasklistsWorker->RemoveGrantTaskList(data, in_list, errUser),
+            ERR_ACCESS);
+
+  // empty user name, nothing is removed
+  in_list[1] = "";
+  EXPECT_CALL(*mockedDB, removeAccessBatch(_, _, _, _)).Times(0);
+  EXPECT_EQ(tasklistsWorker->RemoveGrantTaskList(data, in_list, errUser),
+            ERR_RFIELD);
+
+  // no tasklist key
+  data.tasklist_key = "";
+  EXPECT_EQ(tasklistsWorker->RemoveGrantTaskList(data, in_list, errUser),
+            ERR_RFIELD);
+}
+
 TEST_F(TaskListTest, RemoveGrantTaskList) {
   // setup input
   data.user_key = "user";
   data.tasklist_key = "tasklist";
   data.other_user_key = "other_user";
+  auto listener = std::make_shared<RecordingListener>();
+  tasklistsWorker->SetChangeListener(listener);
 
   std::map<std::string, std::string> task_list_info;
   task_list_info["visibility"];
@@ -632,6 +864,12 @@ TEST_F(TaskListTest, RemoveGrantTaskList) {
                                       data.tasklist_key))
       .WillOnce(Return(SUCCESS));
   EXPECT_EQ(tasklistsWorker->RemoveGrantTaskList(data), SUCCESS);
+  // the streams of the other user are told to end
+  ASSERT_EQ(listener->events.size(), 1);
+  EXPECT_EQ(listener->events[0].type, ChangeEvent::ACCESS_REVOKED);
+  EXPECT_EQ(listener->events[0].owner, "user");
+  EXPECT_EQ(listener->events[0].tasklist, "tasklist");
+  EXPECT_EQ(listener->events[0].user, "other_user");
 
   // no tasklist key
   data.tasklist_key = "";
@@ -662,6 +900,33 @@ TEST_F(TaskListTest, RemoveGrantTaskList) {
   EXPECT_EQ(tasklistsWorker->RemoveGrantTaskList(data), ERR_NO_NODE);
 }
 
+TEST_F(TaskListTest, RemoveGroupGrantTaskList) {
+  // setup input
+  data.user_key = "user";
+  data.tasklist_key = "tasklist";
+  std::vector<std::string> in_list = {"group0", "group1"};
+  std::string errGroup;
+
+  // normal call, should be successful
+  EXPECT_CALL(*mockedDB, removeGroupAccessBatch(data.user_key,
+                                                data.tasklist_key, in_list, _))
+      .WillOnce(Return(SUCCESS));
+  EXPECT_EQ(tasklistsWorker->RemoveGroupGrantTaskList(data, in_list, errGroup),
+            SUCCESS);
+
+  // cannot remove access to a tasklist that is "private"
+  EXPECT_CALL(*mockedDB, removeGroupAccessBatch(data.user_key,
+                                                data.tasklist_key, in_list, _))
+      .WillOnce(Return(ERR_ACCESS));
+  EXPECT_EQ(tasklistsWorker->RemoveGroupGrantTaskList(data, in_list, errGroup),
+            ERR_ACCESS);
+
+  // no tasklist key
+  data.tasklist_key = "";
+  EXPECT_EQ(tasklistsWorker->RemoveGroupGrantTaskList(data, in_list, errGroup),
+            ERR_RFIELD);
+}
+
 TEST_F(TaskListTest, GetAllPublicTaskList) {
   // setup input
   std::vector<std::pair<std::string, std::string>> out_list;
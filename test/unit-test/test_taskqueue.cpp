@@ -0,0 +1,122 @@
+#include "api/taskQueue.h"
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+
+TEST(TaskQueueTest, RunAllTasks) {
+  auto stats = std::make_shared<TaskQueueStats>();
+  std::atomic<int> counter{0};
+  {
+    WorkStealingQueue queue(4, false, 0, stats);
+    for (int i = 0; i < 1000; i++) {
+      EXPECT_TRUE(queue.enqueue([&counter] { counter++; }));
+    }
+    queue.shutdown();
+  }
+  EXPECT_EQ(counter.load(), 1000);
+  EXPECT_EQ(stats->tasks.load(), 1000);
+  EXPECT_EQ(stats->depth.load(), 0);
+  EXPECT_EQ(stats->rejected.load(), 0);
+  EXPECT_LE(stats->wait_us_max.load(), stats->wait_us_total.load());
+}
+
+TEST(TaskQueueTest, StealFromBusyWorker) {
+  std::atomic<bool> release{false};
+  std::atomic<int> counter{0};
+  WorkStealingQueue queue(2);
+
+  // Block one worker, the tasks put into its deque are stolen by the other
+  EXPECT_TRUE(queue.enqueue([&release] {
+    while (!release.load()) {
+      std::this_thread::yield();
+    }
+  }));
+  for (int i = 0; i < 10; i++) {
+    EXPECT_TRUE(queue.enqueue([&counter] { counter++; }));
+  }
+  for (int i = 0; i < 1000 && counter.load() < 10; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(counter.load(), 10);
+
+  release = true;
+  queue.shutdown();
+}
+
+TEST(TaskQueueTest, RejectWhenFull) {
+  auto stats = std::make_shared<TaskQueueStats>();
+  std::atomic<bool> release{false};
+  std::atomic<bool> started{false};
+  WorkStealingQueue queue(1, false, 2, stats);
+
+  // The only worker is busy, two tasks can wait, the third is rejected
+  EXPECT_TRUE(queue.enqueue([&release, &started] {
+    started = true;
+    while (!release.load()) {
+      std::this_thread::yield();
+    }
+  }));
+  while (!started.load()) {
+    std::this_thread::yield();
+  }
+  EXPECT_TRUE(queue.enqueue([] {}));
+  EXPECT_TRUE(queue.enqueue([] {}));
+  EXPECT_FALSE(queue.enqueue([] {}));
+  EXPECT_EQ(stats->rejected.load(), 1);
+
+  release = true;
+  queue.shutdown();
+  EXPECT_EQ(stats->tasks.load(), 3);
+}
+
+TEST(TaskQueueTest, DetachFreesWorker) {
+  std::atomic<bool> release{false};
+  std::atomic<bool> detached{false};
+  std::atomic<bool> ended{false};
+  std::atomic<int> counter{0};
+  WorkStealingQueue queue(1);
+
+  // Not called from a worker
+  EXPECT_FALSE(WorkStealingQueue::Detach());
+
+  // The only worker detaches, the next tasks run on its replacement
+  EXPECT_TRUE(queue.enqueue([&] {
+    detached = WorkStealingQueue::Detach();
+    while (!release.load()) {
+      std::this_thread::yield();
+    }
+    ended = true;
+  }));
+  for (int i = 0; i < 10; i++) {
+    EXPECT_TRUE(queue.enqueue([&counter] { counter++; }));
+  }
+  for (int i = 0; i < 1000 && counter.load() < 10; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_TRUE(detached.load());
+  EXPECT_EQ(counter.load(), 10);
+  EXPECT_FALSE(ended.load());
+
+  // shutdown waits for the detached task
+  std::thread releaser([&release] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    release = true;
+  });
+  queue.shutdown();
+  EXPECT_TRUE(ended.load());
+  releaser.join();
+}
+
+TEST(TaskQueueTest, RejectAfterShutdown) {
+  WorkStealingQueue queue(2, true);
+  queue.shutdown();
+  EXPECT_FALSE(queue.enqueue([] {}));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
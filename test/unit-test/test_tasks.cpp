@@ -31,11 +31,30 @@ public:
               (const std::string &user_pkey, const std::string &task_list_pkey,
                std::vector<std::string> &task_info),
               (override));
+  MOCK_METHOD(returnCode, getTaskNodes,
+              (const std::string &user_pkey, const std::string &task_list_pkey,
+               const std::vector<std::string> &fields,
+               (std::vector<std::map<std::string, std::string>> &)task_infos),
+              (override));
+  MOCK_METHOD(returnCode, getAgenda,
+              (const std::string &user_pkey, const std::string &status,
+               (std::vector<std::map<std::string, std::string>> &)task_infos),
+              (override));
   MOCK_METHOD(returnCode, checkAccess,
               (const std::string &src_user_pkey,
                const std::string &dst_user_pkey,
                const std::string &task_list_pkey, bool &read_write),
               (override));
+  MOCK_METHOD(returnCode, probeAccess,
+              (const std::string &src_user_pkey,
+               const std::string &dst_user_pkey,
+               const std::string &task_list_pkey, const std::string &task_pkey,
+               bool &read_write, int64_t &version),
+              (override));
+  MOCK_METHOD(returnCode, getVersion,
+              (const std::string &user_pkey, const std::string &task_list_pkey,
+               const std::string &task_pkey, int64_t &version),
+              (override));
   MockedDB() : DB("testhost") {}
 };
 
@@ -52,6 +71,13 @@ public:
   MockedUsers(std::shared_ptr<DB> _db) : Users(_db) {}
 };
 
+class RecordingListener : public ChangeListener {
+public:
+  void OnChange(const ChangeEvent &event) override { events.push_back(event); }
+
+  std::vector<ChangeEvent> events;
+};
+
 class TasksWorkerTest : public ::testing::Test {
 protected:
   void SetUp() override {
@@ -75,6 +101,177 @@ protected:
 
 using namespace ::testing;
 
+TEST_F(TasksWorkerTest, Version) {
+  data = RequestData("user0", "tasklist0", "task0", "");
+  int64_t version = 0;
+
+  // version of an own task
+  EXPECT_CALL(*mockedDB, getVersion("user0", "tasklist0", "task0", version))
+      .WillOnce(DoAll(SetArgReferee<3>(7), Return(SUCCESS)));
+  EXPECT_EQ(tasksWorker->Version(data, version), SUCCESS);
+  EXPECT_EQ(version, 7);
+
+  // version of a shared task needs access to its tasklist
+  data.other_user_key = "user1";
+  version = 0;
+  bool permission = false;
+  EXPECT_CALL(*mockedDB, checkAccess("user1", "user0", "tasklist0", permission))
+      .WillOnce(Return(SUCCESS));
+  EXPECT_CALL(*mockedDB, getVersion("user1", "tasklist0", "task0", version))
+      .WillOnce(DoAll(SetArgReferee<3>(8), Return(SUCCESS)));
+  EXPECT_EQ(tasksWorker->Version(data, version), SUCCESS);
+  EXPECT_EQ(version, 8);
+
+  EXPECT_CALL(*mockedDB, checkAccess("user1", "user0", "tasklist0", permission))
+      .WillOnce(Return(ERR_ACCESS));
+  EXPECT_EQ(tasksWorker->Version(data, version), ERR_ACCESS);
+  data.other_user_key = "";
+
+  // all tasks have the version of their tasklist
+  data.task_key = "";
+  version = 0;
+  EXPECT_CALL(*mockedDB, getVersion("user0", "tasklist0", "", version))
+      .WillOnce(DoAll(SetArgReferee<3>(9), Return(SUCCESS)));
+  EXPECT_EQ(tasksWorker->Version(data, version), SUCCESS);
+  EXPECT_EQ(version, 9);
+
+  // missing task
+  data.task_key = "task1";
+  EXPECT_CALL(*mockedDB, getVersion("user0", "tasklist0", "task1", version))
+      .WillOnce(Return(ERR_NO_NODE));
+  EXPECT_EQ(tasksWorker->Version(data, version), ERR_NO_NODE);
+
+  // request is empty
+  data.user_key = "";
+  EXPECT_EQ(tasksWorker->Version(data, version), ERR_RFIELD);
+}
+
+TEST_F(TasksWorkerTest, ResolveAccess) {
+  data = RequestData("user0", "tasklist0", "task0", "");
+  bool permission = false;
+  int64_t version = 0;
+
+  // own tasklist: one probe that reads the version too, then no Exists for
+  // the query and no query for the version
+  EXPECT_CALL(*mockedDB, probeAccess("user0", "user0", "tasklist0", "task0",
+                                     permission, _))
+      .WillOnce(DoAll(SetArgReferee<4>(true), SetArgReferee<5>(42),
+                      Return(SUCCESS)));
+  EXPECT_EQ(tasksWorker->ResolveAccess(data), SUCCESS);
+  EXPECT_TRUE(data.access.resolved);
+  EXPECT_EQ(data.access.owner, "user0");
+  EXPECT_CALL(*mockedTaskLists, Exists(_)).Times(0);
+  EXPECT_CALL(*mockedDB, checkAccess(_, _, _, _)).Times(0);
+  EXPECT_CALL(*mockedDB, getVersion(_, _, _, _)).Times(0);
+  EXPECT_EQ(tasksWorker->Version(data, version), SUCCESS);
+  EXPECT_EQ(version, 42);
+  std::map<std::string, std::string> task_info;
+  EXPECT_CALL(*mockedDB, getTaskNode("user0", "tasklist0", "task0", task_info))
+      .WillOnce(Return(SUCCESS));
+  EXPECT_EQ(tasksWorker->Query(data, out), SUCCESS);
+
+  // shared read only: reads go to the owner, writes are refused at once
+  data = RequestData("user0", "tasklist1", "task0", "user1");
+  EXPECT_CALL(*mockedDB, probeAccess("user1", "user0", "tasklist1", "task0",
+                                     permission, _))
+      .WillOnce(DoAll(SetArgReferee<4>(false), Return(SUCCESS)));
+  EXPECT_EQ(tasksWorker->ResolveAccess(data), SUCCESS);
+  EXPECT_CALL(*mockedDB, getTaskNode("user1", "tasklist1", "task0", task_info))
+      .WillOnce(Return(SUCCESS));
+  EXPECT_EQ(tasksWorker->Query(data, out), SUCCESS);
+  EXPECT_EQ(tasksWorker->Delete(data), ERR_ACCESS);
+  in = TaskContent("task1", "content", "", "", NORMAL, "To Do");
+  std::string outTaskName;
+  EXPECT_EQ(tasksWorker->Create(data, in, outTaskName), ERR_ACCESS);
+  EXPECT_EQ(tasksWorker->Revise(data, in), ERR_ACCESS);
+
+  // no access or no tasklist are resolved too
+  data = RequestData("user0", "tasklist1", "", "user1");
+  EXPECT_CALL(*mockedDB,
+              probeAccess("user1", "user0", "tasklist1", "", permission, _))
+      .WillOnce(Return(ERR_ACCESS));
+  EXPECT_EQ(tasksWorker->ResolveAccess(data), SUCCESS);
+  std::vector<std::string> task_names;
+  EXPECT_EQ(tasksWorker->GetAllTasksName(data, task_names), ERR_ACCESS);
+  EXPECT_EQ(tasksWorker->Version(data, version), ERR_ACCESS);
+  data = RequestData("user0", "tasklist2", "", "");
+  EXPECT_CALL(*mockedDB,
+              probeAccess("user0", "user0", "tasklist2", "", permission, _))
+      .WillOnce(Return(ERR_NO_NODE));
+  EXPECT_EQ(tasksWorker->ResolveAccess(data), SUCCESS);
+  std::vector<TaskContent> tasks;
+  EXPECT_EQ(tasksWorker->GetAllTasks(data, tasks), ERR_NO_NODE);
+  EXPECT_EQ(tasksWorker->Version(data, version), ERR_NO_NODE);
+
+  // the tasklist exists but not the task: never "not modified"
+  data = RequestData("user0", "tasklist0", "task1", "");
+  EXPECT_CALL(*mockedDB, probeAccess("user0", "user0", "tasklist0", "task1",
+                                     permission, _))
+      .WillOnce(DoAll(SetArgReferee<4>(true), SetArgReferee<5>(-1),
+                      Return(SUCCESS)));
+  EXPECT_EQ(tasksWorker->ResolveAccess(data), SUCCESS);
+  EXPECT_EQ(tasksWorker->Version(data, version), ERR_NO_NODE);
+  Mock::VerifyAndClearExpectations(mockedTaskLists.get());
+  Mock::VerifyAndClearExpectations(mockedDB.get());
+
+  // a failed probe leaves the access to the workers
+  data = RequestData("user0", "tasklist0", "task0", "");
+  EXPECT_CALL(*mockedDB, probeAccess("user0", "user0", "tasklist0", "task0",
+                                     permission, _))
+      .WillOnce(Return(ERR_UNKNOWN));
+  EXPECT_EQ(tasksWorker->ResolveAccess(data), ERR_UNKNOWN);
+  EXPECT_FALSE(data.access.resolved);
+  EXPECT_CALL(*mockedTaskLists, Exists(data)).WillOnce(Return(false));
+  EXPECT_EQ(tasksWorker->Query(data, out), ERR_NO_NODE);
+}
+
+TEST_F(TasksWorkerTest, Notify) {
+  auto listener = std::make_shared<RecordingListener>();
+  tasksWorker->SetChangeListener(listener);
+  data = RequestData("user0", "tasklist0", "task0", "user1");
+  in = TaskContent();
+  in.content = "4156 Iteration-2";
+  std::map<std::string, std::string> task_info = {{"content", in.content}};
+  bool permission = false;
+
+  // a write to a shared task is reported with the owner and the writer
+  EXPECT_CALL(*mockedDB, checkAccess("user1", "user0", "tasklist0", permission))
+      .WillOnce(DoAll(SetArgReferee<3>(true), Return(SUCCESS)));
+  EXPECT_CALL(*mockedDB,
+              reviseTaskNode("user1", "tasklist0", "task0", task_info))
+      .WillOnce(Return(SUCCESS));
+  EXPECT_EQ(tasksWorker->Revise(data, in), SUCCESS);
+  ASSERT_EQ(listener->events.size(), 1);
+  EXPECT_EQ(listener->events[0].type, ChangeEvent::TASK_REVISED);
+  EXPECT_EQ(listener->events[0].owner, "user1");
+  EXPECT_EQ(listener->events[0].tasklist, "tasklist0");
+  EXPECT_EQ(listener->events[0].task, "task0");
+  EXPECT_EQ(listener->events[0].user, "user0");
+
+  // a failed write is not reported
+  EXPECT_CALL(*mockedDB, checkAccess("user1", "user0", "tasklist0", permission))
+      .WillOnce(DoAll(SetArgReferee<3>(true), Return(SUCCESS)));
+  EXPECT_CALL(*mockedDB, deleteTaskNode("user1", "tasklist0", "task0"))
+      .WillOnce(Return(ERR_UNKNOWN));
+  EXPECT_EQ(tasksWorker->Delete(data), ERR_UNKNOWN);
+  EXPECT_EQ(listener->events.size(), 1);
+
+  // a created task is reported with the name it got
+  data = RequestData("user0", "tasklist0", "", "");
+  in = TaskContent();
+  in.name = "task0";
+  EXPECT_CALL(*mockedTaskLists, Exists(data)).WillOnce(Return(true));
+  EXPECT_CALL(*mockedDB, createTaskNode("user0", "tasklist0", _))
+      .WillOnce(Return(ERR_DUP_NODE))
+      .WillOnce(Return(SUCCESS));
+  std::string outName;
+  EXPECT_EQ(tasksWorker->Create(data, in, outName), SUCCESS);
+  ASSERT_EQ(listener->events.size(), 2);
+  EXPECT_EQ(listener->events[1].type, ChangeEvent::TASK_CREATED);
+  EXPECT_EQ(listener->events[1].owner, "user0");
+  EXPECT_EQ(listener->events[1].task, outName);
+}
+
 // Query Function
 TEST_F(TasksWorkerTest, Query) {
   // setup input
@@ -612,6 +809,114 @@ TEST_F(TasksWorkerTest, GetAllTasksName) {
   EXPECT_EQ(task_names.size(), 0);
 }
 
+// GetAllTasks Function
+TEST_F(TasksWorkerTest, GetAllTasks) {
+  // setup input
+  data.user_key = "user0";
+  data.tasklist_key = "tasklist0";
+  data.fields = {"name", "priority"};
+
+  std::vector<TaskContent> tasks;
+  std::vector<std::map<std::string, std::string>> task_infos = {
+      {{"name", "task0"}, {"priority", "1"}},
+      {{"name", "task1"}, {"priority", ""}}};
+
+  // only the requested fields are returned
+  EXPECT_CALL(*mockedDB, getTaskNodes(data.user_key, data.tasklist_key,
+                                      data.fields, _))
+      .WillOnce(DoAll(SetArgReferee<3>(task_infos), Return(SUCCESS)));
+  EXPECT_EQ(tasksWorker->GetAllTasks(data, tasks), SUCCESS);
+  EXPECT_EQ(tasks.size(), 2);
+  EXPECT_EQ(tasks[0].name, "task0");
+  EXPECT_EQ(tasks[0].priority, VERY_URGENT);
+  EXPECT_EQ(tasks[1].name, "task1");
+  EXPECT_EQ(tasks[1].priority, NULL_PRIORITY);
+  EXPECT_EQ(tasks[0].content, "");
+
+  // get others' tasks without access
+  tasks.clear();
+  data.other_user_key = "user1";
+  EXPECT_CALL(*mockedDB, checkAccess(data.other_user_key, data.user_key,
+                                     data.tasklist_key, _))
+      .WillOnce(Return(ERR_ACCESS));
+  EXPECT_EQ(tasksWorker->GetAllTasks(data, tasks), ERR_ACCESS);
+  EXPECT_EQ(tasks.size(), 0);
+  data.other_user_key = "";
+
+  // unknown field
+  data.fields = {"name", "user"};
+  EXPECT_EQ(tasksWorker->GetAllTasks(data, tasks), ERR_FORMAT);
+  EXPECT_EQ(tasks.size(), 0);
+
+  // request is empty
+  data.tasklist_key = "";
+  EXPECT_EQ(tasksWorker->GetAllTasks(data, tasks), ERR_RFIELD);
+}
+
+// GetAgenda Function
+TEST_F(TasksWorkerTest, GetAgenda) {
+  // setup input
+  data = RequestData("user0", "", "", "");
+  std::vector<AgendaItem> agenda;
+  std::vector<std::map<std::string, std::string>> task_infos;
+  std::vector<std::map<std::string, std::string>> new_task_infos;
+  new_task_infos.push_back({{"name", "task0"},
+                            {"user", "user0"},
+                            {"list", "tasklist0"},
+                            {"permission", "1"},
+                            {"startDate", "10/01/2022"},
+                            {"endDate", "10/10/2022"}});
+  new_task_infos.push_back({{"name", "task1"},
+                            {"user", "user1"},
+                            {"list", "tasklist1"},
+                            {"permission", "0"},
+                            {"startDate", "11/01/2022"},
+                            {"endDate", "11/10/2022"}});
+  new_task_infos.push_back(
+      {{"name", "task2"}, {"user", "user1"}, {"list", "tasklist1"}});
+
+  // no date range, should return every task
+  EXPECT_CALL(*mockedDB, getAgenda(data.user_key, "", task_infos))
+      .WillOnce(DoAll(SetArgReferee<2>(new_task_infos), Return(SUCCESS)));
+  EXPECT_EQ(tasksWorker->GetAgenda(data, "", "", "", agenda), SUCCESS);
+  EXPECT_EQ(agenda.size(), 3);
+  EXPECT_EQ(agenda[0].user_name, "user0");
+  EXPECT_EQ(agenda[0].task_list_name, "tasklist0");
+  EXPECT_TRUE(agenda[0].permission);
+  EXPECT_EQ(agenda[0].task.name, "task0");
+  EXPECT_FALSE(agenda[1].permission);
+
+  // date range only keeps overlapping tasks
+  agenda.clear();
+  EXPECT_CALL(*mockedDB, getAgenda(data.user_key, "To Do", task_infos))
+      .WillOnce(DoAll(SetArgReferee<2>(new_task_infos), Return(SUCCESS)));
+  EXPECT_EQ(tasksWorker->GetAgenda(data, "10/09/2022", "10/20/2022", "To Do",
+                                   agenda),
+            SUCCESS);
+  EXPECT_EQ(agenda.size(), 1);
+  EXPECT_EQ(agenda[0].task.name, "task0");
+
+  // invalid date range or status
+  agenda.clear();
+  EXPECT_EQ(
+      tasksWorker->GetAgenda(data, "10/20/2022", "10/09/2022", "", agenda),
+      ERR_FORMAT);
+  EXPECT_EQ(tasksWorker->GetAgenda(data, "10/09/2022", "", "", agenda),
+            ERR_FORMAT);
+  EXPECT_EQ(tasksWorker->GetAgenda(data, "", "", "Unknown", agenda),
+            ERR_FORMAT);
+  EXPECT_EQ(agenda.size(), 0);
+
+  // user does not exist
+  EXPECT_CALL(*mockedDB, getAgenda(data.user_key, "", task_infos))
+      .WillOnce(Return(ERR_NO_NODE));
+  EXPECT_EQ(tasksWorker->GetAgenda(data, "", "", "", agenda), ERR_NO_NODE);
+
+  // request is empty
+  data.user_key = "";
+  EXPECT_EQ(tasksWorker->GetAgenda(data, "", "", "", agenda), ERR_RFIELD);
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
 
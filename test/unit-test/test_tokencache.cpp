@@ -0,0 +1,116 @@
+#include "api/tokenCache.h"
+#include <chrono>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = VerifiedTokenCache::Clock;
+
+TEST(TokenCacheTest, FindUntilExpiry) {
+  VerifiedTokenCache cache(16, 4);
+  const auto now = Clock::now();
+  std::string email;
+
+  EXPECT_FALSE(cache.Find("token0", &email));
+  cache.Insert("token0", "user0@test.com", now + std::chrono::hours(1));
+  EXPECT_TRUE(cache.Find("token0", &email));
+  EXPECT_EQ(email, "user0@test.com");
+  EXPECT_EQ(cache.Size(), 1);
+
+  // expired tokens are not kept
+  cache.Insert("token1", "user1@test.com", now - std::chrono::seconds(1));
+  EXPECT_FALSE(cache.Find("token1", &email));
+  EXPECT_EQ(cache.Size(), 1);
+
+  // logged out tokens are forgotten
+  cache.Erase("token0");
+  EXPECT_FALSE(cache.Find("token0", &email));
+  EXPECT_EQ(cache.Size(), 0);
+}
+
+TEST(TokenCacheTest, Bounded) {
+  VerifiedTokenCache cache(8, 2);
+  const auto expires = Clock::now() + std::chrono::hours(1);
+  std::string email;
+
+  for (int i = 0; i < 100; i++) {
+    cache.Insert("token" + std::to_string(i), "user@test.com", expires);
+    EXPECT_LE(cache.Size(), 8);
+  }
+  // the last token is always kept
+  EXPECT_TRUE(cache.Find("token99", &email));
+}
+
+TEST(TokenCacheTest, EvictFirstToExpire) {
+  VerifiedTokenCache cache(3, 1);
+  const auto now = Clock::now();
+  std::string email;
+
+  cache.Insert("token0", "user0@test.com", now + std::chrono::hours(2));
+  cache.Insert("token1", "user1@test.com", now + std::chrono::hours(1));
+  cache.Insert("token2", "user2@test.com", now + std::chrono::hours(3));
+  // inserting again moves the token in the expiry order
+  cache.Insert("token0", "user0@test.com", now + std::chrono::hours(4));
+  EXPECT_EQ(cache.Size(), 3);
+
+  cache.Insert("token3", "user3@test.com", now + std::chrono::hours(5));
+  EXPECT_EQ(cache.Size(), 3);
+  EXPECT_FALSE(cache.Find("token1", &email));
+  cache.Insert("token4", "user4@test.com", now + std::chrono::hours(5));
+  EXPECT_FALSE(cache.Find("token2", &email));
+  EXPECT_TRUE(cache.Find("token0", &email));
+  EXPECT_TRUE(cache.Find("token3", &email));
+  EXPECT_TRUE(cache.Find("token4", &email));
+
+  // erased tokens leave the expiry order too
+  cache.Erase("token0");
+  cache.Insert("token5", "user5@test.com", now + std::chrono::hours(6));
+  EXPECT_EQ(cache.Size(), 3);
+  EXPECT_TRUE(cache.Find("token3", &email));
+}
+
+TEST(TokenCacheTest, DropExpired) {
+  VerifiedTokenCache cache(4, 1);
+  std::string email;
+
+  cache.Insert("token0", "user0@test.com",
+               Clock::now() + std::chrono::milliseconds(20));
+  cache.Insert("token1", "user1@test.com",
+               Clock::now() + std::chrono::milliseconds(20));
+  EXPECT_EQ(cache.Size(), 2);
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  cache.Insert("token2", "user2@test.com",
+               Clock::now() + std::chrono::hours(1));
+  EXPECT_EQ(cache.Size(), 1);
+}
+
+TEST(TokenCacheTest, ConcurrentInsertAndFind) {
+  VerifiedTokenCache cache(1024);
+  const auto expires = Clock::now() + std::chrono::hours(1);
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&cache, &expires, t] {
+      std::string email;
+      for (int i = 0; i < 1000; i++) {
+        std::string token = std::to_string(t) + "-" + std::to_string(i % 50);
+        if (!cache.Find(token, &email)) {
+          cache.Insert(token, token + "@test.com", expires);
+        } else {
+          EXPECT_EQ(email, token + "@test.com");
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(cache.Size(), 400);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,88 @@
+#include "api/tokenStore.h"
+#include <chrono>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = RevokedTokenStore::Clock;
+
+TEST(TokenStoreTest, RevokeUntilExpiry) {
+  RevokedTokenStore store(4);
+  const auto now = Clock::now();
+
+  EXPECT_FALSE(store.IsRevoked("token0"));
+  store.Revoke("token0", now + std::chrono::hours(1));
+  EXPECT_TRUE(store.IsRevoked("token0"));
+  EXPECT_FALSE(store.IsRevoked("token1"));
+  EXPECT_EQ(store.Size(), 1);
+
+  // revoking twice keeps one entry
+  store.Revoke("token0", now + std::chrono::hours(1));
+  EXPECT_EQ(store.Size(), 1);
+
+  // already expired tokens are not kept
+  store.Revoke("token1", now - std::chrono::seconds(1));
+  EXPECT_FALSE(store.IsRevoked("token1"));
+  EXPECT_EQ(store.Size(), 1);
+}
+
+TEST(TokenStoreTest, SweepExpired) {
+  RevokedTokenStore store(4);
+  const auto now = Clock::now();
+
+  for (int i = 0; i < 100; i++) {
+    store.Revoke("token" + std::to_string(i),
+                 i % 2 ? now + std::chrono::milliseconds(50)
+                       : now + std::chrono::hours(1));
+  }
+  EXPECT_EQ(store.Size(), 100);
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  EXPECT_FALSE(store.IsRevoked("token1"));
+
+  // the checks sweep one shard in turn every 64 of them
+  for (int i = 0; i < 64 * 4; i++) {
+    store.IsRevoked("other");
+  }
+  EXPECT_EQ(store.Size(), 50);
+  EXPECT_TRUE(store.IsRevoked("token0"));
+
+  // so does every logout
+  RevokedTokenStore logouts(4);
+  for (int i = 0; i < 10; i++) {
+    logouts.Revoke("token" + std::to_string(i),
+                   Clock::now() + std::chrono::milliseconds(50));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  for (int i = 0; i < 4; i++) {
+    logouts.Revoke("late" + std::to_string(i),
+                   Clock::now() + std::chrono::hours(1));
+  }
+  EXPECT_EQ(logouts.Size(), 4);
+}
+
+TEST(TokenStoreTest, ConcurrentRevokeAndCheck) {
+  RevokedTokenStore store;
+  const auto expires = Clock::now() + std::chrono::hours(1);
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&store, &expires, t] {
+      for (int i = 0; i < 1000; i++) {
+        std::string token = std::to_string(t) + "-" + std::to_string(i);
+        store.Revoke(token, expires);
+        EXPECT_TRUE(store.IsRevoked(token));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(store.Size(), 8000);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
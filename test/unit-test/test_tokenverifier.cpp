@@ -0,0 +1,120 @@
+#include "api/tokenVerifier.h"
+#include <chrono>
+#include <gtest/gtest.h>
+#include <jwt/jwt.hpp>
+#include <string>
+
+/* Same as EncodeTokenFromEmail in api.cpp */
+static std::string Encode(const std::string &email,
+                          const std::chrono::seconds &expire_seconds,
+                          const std::string &secret_key) {
+  jwt::jwt_object jwt_obj{jwt::params::algorithm("HS256"),
+                          jwt::params::secret(secret_key),
+                          jwt::params::payload({{"email", email}})};
+  jwt_obj.add_claim("exp", std::chrono::system_clock::now() + expire_seconds);
+  return jwt_obj.signature();
+}
+
+/* Same as DecodeEmailFromToken in api.cpp */
+static std::string Decode(const std::string &token,
+                          const std::string &secret_key, uint64_t *exp) {
+  std::error_code err;
+  const auto jwt_obj = jwt::decode(
+      jwt::string_view(token), jwt::params::algorithms({"HS256"}), err,
+      jwt::params::secret(secret_key), jwt::params::verify(true));
+  if (err) {
+    return {};
+  }
+  *exp = jwt_obj.payload().get_claim_value<uint64_t>("exp");
+  return jwt_obj.payload().get_claim_value<std::string>("email");
+}
+
+TEST(TokenVerifierTest, SameClaimsAsJwtDecode) {
+  const std::string secret = "secret-key";
+  Hs256Verifier verifier(secret);
+
+  for (const std::string email :
+       {"a@b.com", "ab", "abc@x.io", "user.name+tag@example.com"}) {
+    std::string token = Encode(email, std::chrono::seconds(3600), secret);
+    std::string out_email;
+    std::chrono::system_clock::time_point expires;
+    uint64_t exp = 0;
+    EXPECT_EQ(verifier.Verify(token, &out_email, &expires),
+              Hs256Verifier::VALID);
+    EXPECT_EQ(out_email, Decode(token, secret, &exp));
+    EXPECT_EQ(out_email, email);
+    EXPECT_EQ(std::chrono::duration_cast<std::chrono::seconds>(
+                  expires.time_since_epoch())
+                  .count(),
+              exp);
+  }
+}
+
+TEST(TokenVerifierTest, RejectLikeJwtDecode) {
+  const std::string secret = "secret-key";
+  Hs256Verifier verifier(secret);
+  std::string email;
+  uint64_t exp = 0;
+
+  // wrong secret
+  std::string token = Encode("a@b.com", std::chrono::seconds(3600), "other");
+  EXPECT_EQ(verifier.Verify(token, &email, nullptr), Hs256Verifier::INVALID);
+  EXPECT_EQ(Decode(token, secret, &exp), "");
+
+  // tampered signature
+  token = Encode("a@b.com", std::chrono::seconds(3600), secret);
+  token.back() = token.back() == 'A' ? 'B' : 'A';
+  EXPECT_EQ(verifier.Verify(token, &email, nullptr), Hs256Verifier::INVALID);
+  EXPECT_EQ(Decode(token, secret, &exp), "");
+
+  // expired
+  token = Encode("a@b.com", std::chrono::seconds(-10), secret);
+  EXPECT_EQ(verifier.Verify(token, &email, nullptr), Hs256Verifier::INVALID);
+  EXPECT_EQ(Decode(token, secret, &exp), "");
+}
+
+TEST(TokenVerifierTest, LeaveOtherTokensToJwtDecode) {
+  const std::string secret = "secret-key";
+  Hs256Verifier verifier(secret);
+  std::string email;
+
+  // escaped characters in the email
+  std::string token = Encode("a\"b", std::chrono::seconds(3600), secret);
+  EXPECT_EQ(verifier.Verify(token, &email, nullptr),
+            Hs256Verifier::UNSUPPORTED);
+
+  // other claims
+  jwt::jwt_object jwt_obj{jwt::params::algorithm("HS256"),
+                          jwt::params::secret(secret),
+                          jwt::params::payload({{"email", "a@b.com"}})};
+  jwt_obj.add_claim("iss", "lqxx");
+  jwt_obj.add_claim("exp", std::chrono::system_clock::now() +
+                               std::chrono::seconds(3600));
+  EXPECT_EQ(verifier.Verify(jwt_obj.signature(), &email, nullptr),
+            Hs256Verifier::UNSUPPORTED);
+
+  // not a token
+  EXPECT_EQ(verifier.Verify("", &email, nullptr), Hs256Verifier::UNSUPPORTED);
+  EXPECT_EQ(verifier.Verify("a.b.c", &email, nullptr),
+            Hs256Verifier::UNSUPPORTED);
+}
+
+TEST(TokenVerifierTest, KeyPerVerifier) {
+  Hs256Verifier verifier0("secret0");
+  Hs256Verifier verifier1("secret1");
+  std::string email;
+
+  // the per thread HMAC context is keyed again for each verifier
+  std::string token0 = Encode("a@b.com", std::chrono::seconds(3600), "secret0");
+  std::string token1 = Encode("a@b.com", std::chrono::seconds(3600), "secret1");
+  EXPECT_EQ(verifier0.Verify(token0, &email, nullptr), Hs256Verifier::VALID);
+  EXPECT_EQ(verifier1.Verify(token1, &email, nullptr), Hs256Verifier::VALID);
+  EXPECT_EQ(verifier0.Verify(token1, &email, nullptr), Hs256Verifier::INVALID);
+  EXPECT_EQ(verifier0.Verify(token0, &email, nullptr), Hs256Verifier::VALID);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
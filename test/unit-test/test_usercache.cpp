@@ -0,0 +1,88 @@
+#include "users/userCache.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(UserCacheTest, FindInsert) {
+  UserCache cache;
+  UserCache::Record record;
+  uint64_t generation = 0;
+  EXPECT_EQ(cache.Find("alice@columbia.edu", &record, &generation),
+            UserCache::MISS);
+
+  const UserCache::Record alice = {{"email", "alice@columbia.edu"},
+                                   {"passwd", "hash"}};
+  cache.Insert("alice@columbia.edu", &alice, generation);
+  EXPECT_EQ(cache.Find("alice@columbia.edu", &record, &generation),
+            UserCache::FOUND);
+  EXPECT_EQ(record, alice);
+
+  // no user with this email
+  EXPECT_EQ(cache.Find("bob@columbia.edu", &record, &generation),
+            UserCache::MISS);
+  cache.Insert("bob@columbia.edu", nullptr, generation);
+  EXPECT_EQ(cache.Find("bob@columbia.edu", &record, &generation),
+            UserCache::MISSING);
+  EXPECT_EQ(cache.Size(), 2);
+
+  cache.Erase("bob@columbia.edu");
+  EXPECT_EQ(cache.Find("bob@columbia.edu", &record, &generation),
+            UserCache::MISS);
+  EXPECT_EQ(cache.Size(), 1);
+}
+
+TEST(UserCacheTest, Expire) {
+  UserCache cache(16, std::chrono::milliseconds(50),
+                  std::chrono::milliseconds(10));
+  UserCache::Record record;
+  uint64_t generation = 0;
+  const UserCache::Record alice = {{"email", "alice@columbia.edu"}};
+  cache.Find("alice@columbia.edu", &record, &generation);
+  cache.Insert("alice@columbia.edu", &alice, generation);
+  cache.Find("bob@columbia.edu", &record, &generation);
+  cache.Insert("bob@columbia.edu", nullptr, generation);
+
+  // emails with no user expire first
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(cache.Find("alice@columbia.edu", &record, &generation),
+            UserCache::FOUND);
+  EXPECT_EQ(cache.Find("bob@columbia.edu", &record, &generation),
+            UserCache::MISS);
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  EXPECT_EQ(cache.Find("alice@columbia.edu", &record, &generation),
+            UserCache::MISS);
+}
+
+TEST(UserCacheTest, StaleInsert) {
+  UserCache cache;
+  UserCache::Record record;
+  uint64_t generation = 0;
+  const UserCache::Record alice = {{"email", "alice@columbia.edu"}};
+  EXPECT_EQ(cache.Find("alice@columbia.edu", &record, &generation),
+            UserCache::MISS);
+  // the user was written while it was being read
+  cache.Erase("alice@columbia.edu");
+  cache.Insert("alice@columbia.edu", &alice, generation);
+  EXPECT_EQ(cache.Find("alice@columbia.edu", &record, &generation),
+            UserCache::MISS);
+  cache.Insert("alice@columbia.edu", &alice, generation);
+  EXPECT_EQ(cache.Find("alice@columbia.edu", &record, &generation),
+            UserCache::FOUND);
+}
+
+TEST(UserCacheTest, Capacity) {
+  UserCache cache(2, std::chrono::seconds(30), std::chrono::seconds(5), 1);
+  UserCache::Record record;
+  uint64_t generation = 0;
+  for (int i = 0; i < 4; i++) {
+    const std::string email = "user" + std::to_string(i) + "@columbia.edu";
+    cache.Find(email, &record, &generation);
+    cache.Insert(email, nullptr, generation);
+  }
+  EXPECT_EQ(cache.Size(), 2);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
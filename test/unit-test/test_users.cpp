@@ -9,6 +9,7 @@ public:
 
   returnCode
   createUserNode(const std::map<std::string, std::string> &user_info) override {
+    creates++;
     const auto pk_it = user_info.find("email");
     if (pk_it == user_info.cend()) {
       return returnCode::ERR_KEY;
@@ -24,12 +25,21 @@ public:
   returnCode
   reviseUserNode(const std::string &user_pkey,
                  const std::map<std::string, std::string> &user_info) override {
+    if (mocked_data.find(user_pkey) == mocked_data.end()) {
+      return returnCode::ERR_NO_NODE;
+    }
+    for (auto &field : user_info) {
+      mocked_data[user_pkey][field.first] = field.second;
+    }
     return returnCode::SUCCESS;
   }
 
   returnCode
   getUserNode(const std::string &user_pkey,
               std::map<std::string, std::string> &user_info) override {
+    if (slow) {
+      return returnCode::ERR_TIMEOUT;
+    }
     if (mocked_data.find(user_pkey) == mocked_data.end()) {
       return returnCode::ERR_NO_NODE;
     }
@@ -47,6 +57,10 @@ public:
 
   void Clear() { mocked_data.clear(); }
 
+  /* reads time out, as past the deadline of the request */
+  bool slow = false;
+  int creates = 0;
+
 private:
   std::map<std::string, std::map<std::string, std::string>> mocked_data;
 };
@@ -55,7 +69,10 @@ class UsersTest : public ::testing::Test {
 protected:
   void SetUp() override {
     mocked_db = std::make_shared<MockedDB>();
-    users = std::make_shared<Users>(mocked_db);
+    PasswordHasher::Options options;
+    options.cost = 1000;
+    users = std::make_shared<Users>(mocked_db,
+                                    std::make_shared<PasswordHasher>(options));
   }
 
   void TearDown() override {}
@@ -96,6 +113,65 @@ TEST_F(UsersTest, Validate) {
   EXPECT_FALSE(users->Validate(UserInfo("Sam", "Sam@", "123456")));
 }
 
+TEST_F(UsersTest, UpgradePassword) {
+  mocked_db->Clear();
+  // a password stored the old way
+  const std::string legacy =
+      PasswordHasher::LegacyHash("alice@columbia.edu123456");
+  mocked_db->createUserNode(
+      {{"email", "alice@columbia.edu"}, {"passwd", legacy}});
+  std::map<std::string, std::string> user_info;
+  EXPECT_FALSE(
+      users->Validate(UserInfo("", "alice@columbia.edu", "wrong password")));
+  mocked_db->getUserNode("alice@columbia.edu", user_info);
+  EXPECT_EQ(user_info["passwd"], legacy);
+
+  // upgraded at the first login
+
+  EXPECT_TRUE(users->Validate(UserInfo("", "alice@columbia.edu", "123456")));
+  mocked_db->getUserNode("alice@columbia.edu", user_info);
+  EXPECT_EQ(user_info["passwd"].rfind("$pbkdf2-sha256$1000$", 0), 0);
+  EXPECT_TRUE(users->Validate(UserInfo("", "alice@columbia.edu", "123456")));
+}
+
+TEST_F(UsersTest, Register) {
+  mocked_db->Clear();
+  EXPECT_EQ(users->Register(UserInfo("alice", "alice@columbia.edu", "123456")),
+            SUCCESS);
+  EXPECT_EQ(users->Register(UserInfo("alice", "alice@columbia.edu", "654321")),
+            ERR_DUP_NODE);
+  // the taken email is now cached, the next try is refused before the hash
+  const int creates = mocked_db->creates;
+  EXPECT_EQ(users->Register(UserInfo("alice", "alice@columbia.edu", "654321")),
+            ERR_DUP_NODE);
+  EXPECT_EQ(mocked_db->creates, creates);
+  EXPECT_EQ(users->Register(UserInfo("Sam", "Sam@", "123456")), ERR_FORMAT);
+
+  // an email known to have no user is forgotten once registered
+  EXPECT_FALSE(users->DuplicatedEmail(UserInfo("bob@columbia.edu")));
+  EXPECT_FALSE(users->Validate(UserInfo("", "bob@columbia.edu", "123456")));
+  EXPECT_EQ(users->Register(UserInfo("bob", "bob@columbia.edu", "123456")),
+            SUCCESS);
+  EXPECT_TRUE(users->DuplicatedEmail(UserInfo("bob@columbia.edu")));
+  EXPECT_TRUE(users->Validate(UserInfo("", "bob@columbia.edu", "123456")));
+
+  // and a deleted user is forgotten too
+  EXPECT_TRUE(users->Delete(UserInfo("bob@columbia.edu")));
+  EXPECT_FALSE(users->DuplicatedEmail(UserInfo("bob@columbia.edu")));
+}
+
+TEST_F(UsersTest, TimedOutLookup) {
+  mocked_db->Clear();
+  EXPECT_EQ(users->Register(UserInfo("alice", "alice@columbia.edu", "123456")),
+            SUCCESS);
+
+  // a timed out read is not taken for a missing user
+  mocked_db->slow = true;
+  EXPECT_FALSE(users->Validate(UserInfo("", "alice@columbia.edu", "123456")));
+  mocked_db->slow = false;
+  EXPECT_TRUE(users->Validate(UserInfo("", "alice@columbia.edu", "123456")));
+}
+
 TEST_F(UsersTest, DuplicatedEmail) {
   mocked_db->Clear();
   EXPECT_TRUE(users->Create(UserInfo("alice", "alice@columbia.edu", "123456")));
@@ -0,0 +1,257 @@
+#include "users/passwordHasher.h"
+#include <algorithm>
+#include <future>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+static constexpr size_t kSaltSize = 16;
+static constexpr size_t kKeySize = 32;
+
+/* KDF and cost of a hash, as written in front of it */
+struct KdfParams {
+  PasswordHasher::Kdf kdf;
+  uint64_t cost;
+  uint64_t r;
+  uint64_t p;
+
+  bool operator==(const KdfParams &other) const {
+    return kdf == other.kdf && cost == other.cost &&
+           (kdf != PasswordHasher::SCRYPT || (r == other.r && p == other.p));
+  }
+};
+
+static std::string ToHex(const unsigned char *data, size_t size) {
+  static const char digits[] = "0123456789abcdef";
+  std::string hex;
+  hex.reserve(size * 2);
+  for (size_t i = 0; i < size; i++) {
+    hex += digits[data[i] >> 4];
+    hex += digits[data[i] & 0xf];
+  }
+  return hex;
+}
+
+static bool FromHex(const std::string &hex, std::string *data) {
+  if (hex.size() % 2) {
+    return false;
+  }
+  data->clear();
+  for (size_t i = 0; i < hex.size(); i += 2) {
+    int byte = 0;
+    for (size_t j = i; j < i + 2; j++) {
+      const char c = hex[j];
+      byte <<= 4;
+      if (c >= '0' && c <= '9') {
+        byte |= c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        byte |= c - 'a' + 10;
+      } else {
+        return false;
+      }
+    }
+    *data += static_cast<char>(byte);
+  }
+  return true;
+}
+
+static bool ParseNumber(const std::string &text, uint64_t *number) {
+  if (text.empty() || text.size() > 18 ||
+      !std::all_of(text.begin(), text.end(),
+                   [](char c) { return c >= '0' && c <= '9'; })) {
+    return false;
+  }
+  *number = std::stoull(text);
+  return *number > 0;
+}
+
+static bool Derive(const KdfParams &params, const std::string &password,
+                   const std::string &salt, unsigned char *key) {
+  const auto *salt_data = reinterpret_cast<const unsigned char *>(salt.data());
+  if (params.kdf == PasswordHasher::PBKDF2_SHA256) {
+    return params.cost <= INT32_MAX &&
+           PKCS5_PBKDF2_HMAC(password.data(), password.size(), salt_data,
+                             salt.size(), static_cast<int>(params.cost),
+                             EVP_sha256(), kKeySize, key) == 1;
+  }
+  /* scrypt needs 128 * r * (N + p) bytes, leave some room */
+  const uint64_t max_mem = 128 * params.r * (params.cost + params.p) + 65536;
+  return EVP_PBE_scrypt(password.data(), password.size(), salt_data,
+                        salt.size(), params.cost, params.r, params.p, max_mem,
+                        key, kKeySize) == 1;
+}
+
+/* $pbkdf2-sha256$i$salt$key or $scrypt$N$r$p$salt$key */
+static std::string Format(const KdfParams &params, const std::string &salt,
+                          const unsigned char *key) {
+  std::string hash;
+  if (params.kdf == PasswordHasher::PBKDF2_SHA256) {
+    hash = "$pbkdf2-sha256$" + std::to_string(params.cost);
+  } else {
+    hash = "$scrypt$" + std::to_string(params.cost) + "$" +
+           std::to_string(params.r) + "$" + std::to_string(params.p);
+  }
+  hash += "$";
+  hash += ToHex(reinterpret_cast<const unsigned char *>(salt.data()),
+                salt.size());
+  hash += "$";
+  hash += ToHex(key, kKeySize);
+  return hash;
+}
+
+static bool Parse(const std::string &hash, KdfParams *params,
+                  std::string *salt, std::string *key) {
+  std::vector<std::string> parts;
+  size_t start = 1;
+  while (start <= hash.size()) {
+    size_t end = hash.find('$', start);
+    if (end == std::string::npos) {
+      end = hash.size();
+    }
+    parts.push_back(hash.substr(start, end - start));
+    start = end + 1;
+  }
+  size_t n_params = 0;
+  if (parts[0] == "pbkdf2-sha256") {
+    params->kdf = PasswordHasher::PBKDF2_SHA256;
+    n_params = 1;
+  } else if (parts[0] == "scrypt") {
+    params->kdf = PasswordHasher::SCRYPT;
+    n_params = 3;
+  } else {
+    return false;
+  }
+  params->r = params->p = 0;
+  return parts.size() == n_params + 3 &&
+         ParseNumber(parts[1], &params->cost) &&
+         (n_params == 1 || (ParseNumber(parts[2], &params->r) &&
+                            ParseNumber(parts[3], &params->p))) &&
+         FromHex(parts[n_params + 1], salt) &&
+         FromHex(parts[n_params + 2], key) && key->size() == kKeySize;
+}
+
+PasswordHasher::PasswordHasher(Options options) : options(options) {
+  const size_t n_threads = std::max<size_t>(options.n_threads, 1);
+  for (size_t i = 0; i < n_threads; i++) {
+    threads.emplace_back(&PasswordHasher::Work, this);
+  }
+}
+
+PasswordHasher::~PasswordHasher() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopped = true;
+  }
+  ready.notify_all();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+bool PasswordHasher::Hash(const std::string &password, std::string *hash) {
+  const KdfParams params = {options.kdf, options.cost, options.scrypt_r,
+                            options.scrypt_p};
+  unsigned char salt[kSaltSize];
+  if (RAND_bytes(salt, kSaltSize) != 1) {
+    return false;
+  }
+  const std::string salt_data(reinterpret_cast<char *>(salt), kSaltSize);
+  bool ok = false;
+  if (!Run([&] {
+        unsigned char key[kKeySize];
+        ok = Derive(params, password, salt_data, key);
+        if (ok) {
+          *hash = Format(params, salt_data, key);
+        }
+      })) {
+    return false;
+  }
+  return ok;
+}
+
+PasswordHasher::Verdict
+PasswordHasher::Verify(const std::string &password,
+                       const std::string &legacy_prefix,
+                       const std::string &stored, bool *upgrade) {
+  *upgrade = false;
+  if (stored.empty()) {
+    return MISMATCH;
+  }
+  if (stored[0] != '$') {
+    /* one SHA-256 is cheap, no need for a thread */
+    const std::string legacy = LegacyHash(legacy_prefix + password);
+    if (legacy.size() != stored.size() ||
+        CRYPTO_memcmp(legacy.data(), stored.data(), stored.size()) != 0) {
+      return MISMATCH;
+    }
+    *upgrade = true;
+    return MATCH;
+  }
+
+  KdfParams params;
+  std::string salt;
+  std::string key;
+  if (!Parse(stored, &params, &salt, &key)) {
+    return MISMATCH;
+  }
+  bool ok = false;
+  unsigned char derived[kKeySize];
+  if (!Run([&] { ok = Derive(params, password, salt, derived); }) || !ok) {
+    return BUSY;
+  }
+  if (CRYPTO_memcmp(derived, key.data(), kKeySize) != 0) {
+    return MISMATCH;
+  }
+  *upgrade = !(params == KdfParams{options.kdf, options.cost,
+                                   options.scrypt_r, options.scrypt_p});
+  return MATCH;
+}
+
+size_t PasswordHasher::Depth() const {
+  std::lock_guard<std::mutex> guard(lock);
+  return jobs.size();
+}
+
+std::string PasswordHasher::LegacyHash(const std::string &input) {
+  unsigned char hash[EVP_MAX_MD_SIZE];
+  unsigned int size = 0;
+  if (EVP_Digest(input.data(), input.size(), hash, &size, EVP_sha256(),
+                 nullptr) != 1) {
+    return "";
+  }
+  return ToHex(hash, size);
+}
+
+bool PasswordHasher::Run(std::function<void()> job) {
+  std::promise<void> done;
+  std::future<void> finished = done.get_future();
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (jobs.size() >= std::max<size_t>(options.max_queued, 1)) {
+      rejected.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    jobs.push_back([&job, &done] {
+      job();
+      done.set_value();
+    });
+  }
+  ready.notify_one();
+  finished.wait();
+  return true;
+}
+
+void PasswordHasher::Work() {
+  std::unique_lock<std::mutex> guard(lock);
+  for (;;) {
+    ready.wait(guard, [this] { return stopped || !jobs.empty(); });
+    if (jobs.empty()) {
+      return;
+    }
+    std::function<void()> job = std::move(jobs.front());
+    jobs.pop_front();
+    guard.unlock();
+    job();
+    guard.lock();
+  }
+}
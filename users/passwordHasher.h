@@ -0,0 +1,130 @@
+/**
+ * @file passwordHasher.h
+ * @brief Definition of PasswordHasher, which hashes and checks passwords with
+ * a slow KDF on threads of its own.
+ *
+ * Passwords used to be stored as one unsalted SHA-256 of the email and the
+ * password. They are now stored as a salted PBKDF2-HMAC-SHA256 or scrypt
+ * hash, with the KDF and its cost written in front of it, so the cost can be
+ * raised later. Such a hash takes a good part of a second of CPU on purpose.
+ * Done on the request threads, a few logins would hold all of them, so the
+ * hashes run on a small pool of their own behind a bounded queue: logins
+ * compete for those threads only, and a login arriving to a full queue is
+ * refused at once.
+ *
+ * A password stored the old way, or with another KDF or cost, still matches,
+ * and is reported as to be upgraded, so that it can be hashed again the new
+ * way while the password is at hand.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class PasswordHasher {
+public:
+  enum Kdf {
+    PBKDF2_SHA256,
+    SCRYPT,
+  };
+
+  struct Options {
+    Kdf kdf = PBKDF2_SHA256;
+    /* iterations of PBKDF2, or N of scrypt, a power of 2 */
+    uint64_t cost = 600000;
+    /* block size and parallelization of scrypt */
+    uint64_t scrypt_r = 8;
+    uint64_t scrypt_p = 1;
+    /* threads hashing, at least 1 */
+    size_t n_threads = 2;
+    /* hashes waiting for a thread, at least 1 */
+    size_t max_queued = 64;
+  };
+
+  /**
+   * @brief Result of checking a password.
+   */
+  enum Verdict {
+    MATCH,
+    MISMATCH,
+    /* the queue was full or the KDF failed */
+    BUSY,
+  };
+
+  /**
+   * @brief Construct a new Password Hasher object and start its threads.
+   */
+  explicit PasswordHasher(Options options);
+
+  PasswordHasher() : PasswordHasher(Options()) {}
+
+  /**
+   * @brief Destroy the Password Hasher object, after the hashes queued.
+   */
+  ~PasswordHasher();
+
+  /**
+   * @brief Hash a password with a new salt, waiting for a thread.
+   *
+   * @param password The password.
+   * @param hash The hash to store will be put there.
+   * @return false if the queue was full or the KDF failed.
+   */
+  bool Hash(const std::string &password, std::string *hash);
+
+  /**
+   * @brief Check a password against a stored hash, waiting for a thread.
+   *
+   * @param password The password.
+   * @param legacy_prefix What was put in front of the password before it was
+   * hashed the old way, the email of the user.
+   * @param stored The stored hash.
+   * @param upgrade Set to true if the password matched but the hash is not
+   * of the current KDF and cost.
+   * @return Verdict
+   */
+  Verdict Verify(const std::string &password, const std::string &legacy_prefix,
+                 const std::string &stored, bool *upgrade);
+
+  /**
+   * @brief Hashes waiting for a thread.
+   */
+  size_t Depth() const;
+
+  /**
+   * @brief Hashes refused because the queue was full.
+   */
+  uint64_t Rejected() const { return rejected.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief The old way: hex SHA-256 of the input.
+   */
+  static std::string LegacyHash(const std::string &input);
+
+private:
+  /* Run a job on a hashing thread and wait for it, false if the queue was
+     full */
+  bool Run(std::function<void()> job);
+
+  void Work();
+
+  const Options options;
+
+  mutable std::mutex lock;
+  std::condition_variable ready;
+  std::deque<std::function<void()>> jobs;
+  bool stopped = false;
+  std::vector<std::thread> threads;
+  std::atomic<uint64_t> rejected{0};
+};
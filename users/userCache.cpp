@@ -0,0 +1,73 @@
+#include "users/userCache.h"
+#include <algorithm>
+#include <functional>
+
+UserCache::UserCache(size_t capacity, Clock::duration ttl,
+                     Clock::duration missing_ttl, size_t n_shards)
+    : ttl(ttl), missing_ttl(missing_ttl) {
+  n_shards = std::max<size_t>(n_shards, 1);
+  shard_capacity = std::max<size_t>(capacity / n_shards, 1);
+  for (size_t i = 0; i < n_shards; i++) {
+    shards.push_back(std::make_unique<Shard>());
+  }
+}
+
+UserCache::Lookup UserCache::Find(const std::string &email, Record *record,
+                                  uint64_t *generation) const {
+  Shard &shard = ShardOf(email);
+  std::lock_guard<std::mutex> guard(shard.lock);
+  const auto it = shard.users.find(email);
+  if (it == shard.users.end() || it->second.expires <= Clock::now()) {
+    *generation = shard.generation;
+    return MISS;
+  }
+  if (!it->second.exists) {
+    return MISSING;
+  }
+  *record = it->second.record;
+  return FOUND;
+}
+
+void UserCache::Insert(const std::string &email, const Record *record,
+                       uint64_t generation) {
+  const auto now = Clock::now();
+  Shard &shard = ShardOf(email);
+  std::lock_guard<std::mutex> guard(shard.lock);
+  if (generation != shard.generation) {
+    return;
+  }
+  if (shard.users.size() >= shard_capacity &&
+      shard.users.find(email) == shard.users.end()) {
+    /* Drop the expired emails first, evict any email if still full */
+    for (auto it = shard.users.begin(); it != shard.users.end();) {
+      if (it->second.expires <= now) {
+        it = shard.users.erase(it);
+        count--;
+      } else {
+        it++;
+      }
+    }
+    if (shard.users.size() >= shard_capacity) {
+      shard.users.erase(shard.users.begin());
+      count--;
+    }
+  }
+  Entry entry = record ? Entry{true, *record, now + ttl}
+                       : Entry{false, {}, now + missing_ttl};
+  if (shard.users.insert_or_assign(email, std::move(entry)).second) {
+    count++;
+  }
+}
+
+void UserCache::Erase(const std::string &email) {
+  Shard &shard = ShardOf(email);
+  std::lock_guard<std::mutex> guard(shard.lock);
+  shard.generation++;
+  if (shard.users.erase(email)) {
+    count--;
+  }
+}
+
+UserCache::Shard &UserCache::ShardOf(const std::string &email) const {
+  return *shards[std::hash<std::string>{}(email) % shards.size()];
+}
@@ -0,0 +1,111 @@
+/**
+ * @file userCache.h
+ * @brief Definition of UserCache, the user records recently read from the DB.
+ *
+ * Every login reads the user node of its email, and sharing a task list reads
+ * the user node of the other user only to know that it exists. The records
+ * read are kept for a short time, so that the next reads of the same email
+ * are a hash lookup; emails with no user are kept too, for a shorter time, so
+ * that a client retrying an unknown email does not reach the DB every time.
+ *
+ * Users erases the record of an email whenever it writes it. A record read
+ * from the DB while the same email was being written could be older than the
+ * write, so Find hands out the generation of the shard, bumped by every
+ * Erase, and Insert drops a record read before the last Erase. Writes made by
+ * other processes are only seen once the record expires.
+ *
+ * The cache is sharded and bounded like VerifiedTokenCache.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class UserCache {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Record = std::map<std::string, std::string>;
+
+  enum Lookup {
+    MISS,
+    FOUND,
+    /* there is no user with this email */
+    MISSING,
+  };
+
+  /**
+   * @brief Construct a new User Cache object.
+   *
+   * @param capacity Max number of emails kept, at least one per shard.
+   * @param ttl How long a record is kept.
+   * @param missing_ttl How long an email with no user is kept.
+   * @param n_shards Number of shards, at least 1.
+   */
+  explicit UserCache(size_t capacity = 65536,
+                     Clock::duration ttl = std::chrono::seconds(30),
+                     Clock::duration missing_ttl = std::chrono::seconds(5),
+                     size_t n_shards = 16);
+
+  /**
+   * @brief Look up the record of an email.
+   *
+   * @param email The email.
+   * @param record The record will be put there if FOUND.
+   * @param generation On a MISS, what to give to Insert once the record is
+   * read.
+   * @return Lookup
+   */
+  Lookup Find(const std::string &email, Record *record,
+              uint64_t *generation) const;
+
+  /**
+   * @brief Keep the record of an email read from the DB, unless the email was
+   * erased since the generation was handed out.
+   *
+   * @param record The record, nullptr if there is no user with this email.
+   */
+  void Insert(const std::string &email, const Record *record,
+              uint64_t generation);
+
+  /**
+   * @brief Forget an email, when its user is written.
+   */
+  void Erase(const std::string &email);
+
+  /**
+   * @brief Number of emails kept.
+   */
+  size_t Size() const { return count.load(); }
+
+private:
+  struct Entry {
+    bool exists;
+    Record record;
+    Clock::time_point expires;
+  };
+
+  struct Shard {
+    mutable std::mutex lock;
+    std::unordered_map<std::string, Entry> users;
+    uint64_t generation = 0;
+  };
+
+  Shard &ShardOf(const std::string &email) const;
+
+  const Clock::duration ttl;
+  const Clock::duration missing_ttl;
+  std::vector<std::unique_ptr<Shard>> shards;
+  size_t shard_capacity;
+  std::atomic<size_t> count{0};
+};
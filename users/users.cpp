@@ -32,24 +32,77 @@ static inline UserInfo DbType2UserInfo(const UserInfoDbType &user_info_db) {
   return user_info;
 }
 
-Users::Users(std::shared_ptr<DB> _db) : db(_db) {
+Users::Users(std::shared_ptr<DB> _db, std::shared_ptr<PasswordHasher> _hasher,
+             std::shared_ptr<UserCache> _cache)
+    : db(_db), hasher(_hasher), cache(_cache) {
   if (!db) {
     db = std::make_shared<DB>();
   }
+  if (!hasher) {
+    hasher = std::make_shared<PasswordHasher>();
+  }
+  if (!cache) {
+    cache = std::make_shared<UserCache>();
+  }
 }
 
 Users::~Users() {}
 
-bool Users::Create(const UserInfo &user_info) {
+returnCode Users::GetUser(const std::string &email,
+                          UserInfoDbType &user_info_db) {
+  uint64_t generation = 0;
+  switch (cache->Find(email, &user_info_db, &generation)) {
+  case UserCache::FOUND:
+    return returnCode::SUCCESS;
+  case UserCache::MISSING:
+    return returnCode::ERR_NO_NODE;
+  case UserCache::MISS:
+    break;
+  }
+
+  const returnCode ret = db->getUserNode(email, user_info_db);
+  if (ret == returnCode::SUCCESS) {
+    cache->Insert(email, &user_info_db, generation);
+  } else if (ret == returnCode::ERR_NO_NODE && !DB::threadTimedOut()) {
+    // a read abandoned at the deadline says nothing about the user
+    cache->Insert(email, nullptr, generation);
+  }
+  return ret;
+}
+
+returnCode Users::Register(const UserInfo &user_info) {
   // check email format
   if (!Common::IsEmail(user_info.email)) {
-    return false;
+    return returnCode::ERR_FORMAT;
   }
 
-  if (db->createUserNode(UserInfo2DbType(user_info)) != returnCode::SUCCESS) {
-    return false;
+  // an email the cache knows is taken is refused before the costly hash
+  UserInfoDbType user_info_db;
+  uint64_t generation = 0;
+  if (cache->Find(user_info.email, &user_info_db, &generation) ==
+      UserCache::FOUND) {
+    return returnCode::ERR_DUP_NODE;
   }
-  return true;
+
+  UserInfo hashed_info = user_info;
+  if (!hasher->Hash(user_info.passwd, &hashed_info.passwd)) {
+    return returnCode::ERR_UNKNOWN;
+  }
+  // the unique constraint on the email finds the duplicates
+  const returnCode ret = db->createUserNode(UserInfo2DbType(hashed_info));
+  if (ret == returnCode::SUCCESS || ret == returnCode::ERR_DUP_NODE) {
+    cache->Erase(user_info.email);
+  }
+  if (ret == returnCode::ERR_DUP_NODE) {
+    // cache the user taking the email, so that the next tries are refused
+    // without a hash
+    GetUser(user_info.email, user_info_db);
+  }
+  return ret;
+}
+
+bool Users::Create(const UserInfo &user_info) {
+  return Register(user_info) == returnCode::SUCCESS;
 };
 
 bool Users::Validate(const UserInfo &user_info) {
@@ -63,7 +116,7 @@ bool Users::Validate(const UserInfo &user_info) {
   }
 
   UserInfoDbType user_info_db;
-  if (db->getUserNode(user_info.email, user_info_db) != returnCode::SUCCESS) {
+  if (GetUser(user_info.email, user_info_db) != returnCode::SUCCESS) {
     return false;
   }
 
@@ -74,10 +127,18 @@ bool Users::Validate(const UserInfo &user_info) {
   if (user_info.email != true_user_info.email) {
     return false;
   }
-  if (user_info.passwd != true_user_info.passwd) {
+  bool upgrade = false;
+  if (hasher->Verify(user_info.passwd, user_info.email, true_user_info.passwd,
+                     &upgrade) != PasswordHasher::MATCH) {
     return false;
   }
 
+  // the password is at hand, store it the current way
+  std::string upgraded;
+  if (upgrade && hasher->Hash(user_info.passwd, &upgraded)) {
+    db->reviseUserNode(user_info.email, {{"passwd", upgraded}});
+    cache->Erase(user_info.email);
+  }
   return true;
 };
 
@@ -88,7 +149,7 @@ bool Users::DuplicatedEmail(const UserInfo &user_info) {
   }
 
   UserInfoDbType user_info_db;
-  if (db->getUserNode(user_info.email, user_info_db) == returnCode::SUCCESS) {
+  if (GetUser(user_info.email, user_info_db) == returnCode::SUCCESS) {
     return true;
   }
   return false;
@@ -100,8 +161,7 @@ bool Users::Delete(const UserInfo &user_info) {
     return false;
   }
 
-  if (db->deleteUserNode(user_info.email) != returnCode::SUCCESS) {
-    return false;
-  }
-  return true;
+  const returnCode ret = db->deleteUserNode(user_info.email);
+  cache->Erase(user_info.email);
+  return ret == returnCode::SUCCESS;
 }
\ No newline at end of file
@@ -10,6 +10,8 @@
 
 #include "common/utils.h"
 #include "db/DB.h"
+#include "users/passwordHasher.h"
+#include "users/userCache.h"
 #include <memory>
 #include <string>
 #include <type_traits>
@@ -45,18 +47,47 @@ public:
  */
 class Users {
 public:
-  Users(std::shared_ptr<DB> = nullptr);
+  Users(std::shared_ptr<DB> = nullptr,
+        std::shared_ptr<PasswordHasher> = nullptr,
+        std::shared_ptr<UserCache> = nullptr);
 
   virtual ~Users();
 
+  /**
+   * @brief Create a user, its password is hashed before it is stored. An
+   * email the cache knows is taken is refused without hashing.
+   *
+   * @return returnCode ERR_DUP_NODE if the email is taken, ERR_FORMAT if it
+   * is not an email.
+   */
+  virtual returnCode Register(const UserInfo &);
+
+  /**
+   * @brief Create a user, see Register.
+   */
   virtual bool Create(const UserInfo &);
 
+  /**
+   * @brief Check the password of a user. A password stored with an older
+   * KDF or cost is hashed again and stored if it matches.
+   */
   virtual bool Validate(const UserInfo &);
 
   virtual bool DuplicatedEmail(const UserInfo &);
 
   virtual bool Delete(const UserInfo &);
 
+  /**
+   * @brief The hasher of the passwords, e.g. to export its queue depth.
+   */
+  std::shared_ptr<const PasswordHasher> Hasher() const { return hasher; }
+
 private:
+  /* Read a user node through the cache */
+  returnCode GetUser(const std::string &email,
+                     std::map<std::string, std::string> &user_info_db);
+
   std::shared_ptr<DB> db;
+  std::shared_ptr<PasswordHasher> hasher;
+  std::shared_ptr<UserCache> cache;
 };